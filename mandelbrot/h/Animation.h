@@ -0,0 +1,107 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "Renderer.h"
+#include "HighPrecision.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// How frames are written.
+/// </summary>
+enum class VideoFormat
+{
+	// YUV4MPEG2 with full resolution chroma, which ffmpeg and most encoders read from a pipe
+	Y4m,
+	// Bare 8-bit RGB frames one after another, for encoders told the size and rate separately
+	Rgb
+};
+
+/// <summary>
+/// A point on the path of an animation.
+/// </summary>
+struct Keyframe
+{
+	int m_frame = 0;
+	std::string m_centreX;
+	std::string m_centreY;
+	double m_spacing = 0.0;
+	int m_iterations = 1024;
+};
+
+/// <summary>
+/// Renders a zoom video along a path of keyframes and streams it out. Between keyframes the pixel spacing
+/// moves on a log scale, so the zoom runs at a steady speed, and the centre moves in step with the
+/// spacing. Neighbouring frames mostly show the same thing, so they aren't rendered one by one. Runs of
+/// frames share one key image, rendered larger than a frame at the finest spacing of the run and over
+/// every frame's view, and each frame is an area-weighted resample of its key. A frame is never
+/// magnified from its key, so it costs only the resample. A key is rendered with the highest iteration
+/// cap of its frames and each frame is coloured for its own cap. Keys are rendered while the frames of
+/// the last one are resampled and written.
+/// </summary>
+class Animation
+{
+public:
+	bool m_reproducible = false;
+	int m_fps = 30;
+
+	Animation(Renderer &t_renderer, int t_width, int t_height, VideoFormat t_format, FILE *t_output);
+	~Animation();
+
+	bool build(const std::vector<Keyframe> &t_path);
+	bool run();
+	int frames() const;
+	int keys() const;
+
+	static bool readPath(const std::string &t_path, std::vector<Keyframe> &t_keyframes);
+
+private:
+	/// <summary>
+	/// Where one frame looks.
+	/// </summary>
+	struct Frame
+	{
+		HighPrecision m_centreX;
+		HighPrecision m_centreY;
+		double m_spacing;
+		int m_iterations;
+	};
+
+	/// <summary>
+	/// A key image and the frames taken from it.
+	/// </summary>
+	struct Key
+	{
+		HighPrecision m_centreX;
+		HighPrecision m_centreY;
+		double m_spacing;
+		int m_iterations;
+		int m_first;
+		int m_last;
+	};
+
+	Renderer &m_renderer;
+	int m_width;
+	int m_height;
+	VideoFormat m_format;
+	FILE *m_output;
+	std::vector<Frame> m_frames;
+	int m_keys = 0;
+	std::atomic<bool> m_written{ true };
+	std::vector<uint32_t> m_key;
+	std::vector<int> m_keyCounts;
+	Palette m_keyPalette;
+	std::vector<uint8_t> m_frame;
+	std::thread m_writer;
+
+	void nextKey(int t_first, Key &t_key) const;
+	void writeFrames(const Key &t_key);
+	void resample(const Key &t_key, const Frame &t_frame);
+	void finishWriting();
+};
+
+#endif // !ANIMATION_H
@@ -4,7 +4,13 @@
 #include "Vector2.h"
 #include "PixelGrid.h"
 #include "WorkerThread.h"
+#include "Renderer.h"
+#include "TileCache.h"
+#include "TileQuadtree.h"
 #include "Globals.h"
+#include "Viewport.h"
+#include "Perturbation.h"
+#include "Palette.h"
 
 #include <SFML/Graphics.hpp>
 #include <chrono>
@@ -15,10 +21,7 @@
 class Application
 {
 public:
-	int *m_fractal = nullptr;
-	int m_iterations = 1024;
-
-	Application();
+	Application(const std::string &t_cacheDirectory);
 	~Application();
 	void run();
 
@@ -26,15 +29,24 @@ private:
 	sf::RenderWindow m_window;
 	sf::RenderTexture m_renderTexture;
 	PixelGrid m_pixelGrid{ Globals::SCREEN_WIDTH, Globals::SCREEN_HEIGHT };
+	TileCache m_tileCache;
+	TileQuadtree m_quadtree{ m_tileCache };
+	Renderer m_renderer{ Globals::SCREEN_WIDTH, Globals::SCREEN_HEIGHT, (uint32_t *)m_pixelGrid.getPixelArray() };
 	sf::Font m_font;
 	bool m_exitGame{ false };
 	bool m_leftBtnClicked = false;
 	bool m_rightBtnClicked = false;
+	bool m_reproducible = false;
+	bool m_recompute = true;
+	bool m_cyclePalette = false;
+	bool m_previewing = false;
+	bool m_tiles = true;
+	bool m_tilesPending = false;
+	int m_gradient = 0;
 	std::chrono::duration<double> m_elapsedTime;
-	WorkerThread m_workers[Globals::MAX_THREADS];
-	Vector2 m_offset = { 0.0f, 0.0f };
 	Vector2 m_startPan = { 0.0f, 0.0f };
-	Vector2 m_scale = { Globals::SCREEN_WIDTH / 2.0f, Globals::SCREEN_HEIGHT };
+	Viewport m_viewport{ Globals::SCREEN_WIDTH, Globals::SCREEN_HEIGHT };
+	Viewport m_mandelbrotViewport{ Globals::SCREEN_WIDTH, Globals::SCREEN_HEIGHT };
 
 	void processEvents();
 	void update();
@@ -43,8 +55,8 @@ private:
 	void drawText();
 	void worldToScreen(const Vector2 &t_world, Vector2 &t_screen);
 	void screenToWorld(const Vector2 &t_screen, Vector2 &t_world);
-	void createFractal(const Vector2 &t_pixTL, const Vector2 &t_pixBR, const Vector2 &t_fracTL, const Vector2 &t_fracBR, const int t_iterations);
-	void threadPoolInit();
+	void screenToWorld(const Vector2 &t_screen, Vector2 &t_world, Vector2 &t_worldLow);
+	void toggleJulia(const Vector2 &t_mouse);
 };
 
 #endif // !APPLICATION_H
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "WorkerThread.h"
+#include "Viewport.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// A fixed view used by the benchmarks so results can be compared between runs.
+/// </summary>
+struct BenchmarkLocation
+{
+	std::string m_name;
+	std::string m_cr;
+	std::string m_ci;
+	double m_spacing;
+	int m_iterations;
+};
+
+/// <summary>
+/// Timing runs over fixed locations. Results are written as plain text.
+/// </summary>
+class Benchmark
+{
+public:
+	static const int WIDTH = 640;
+	static const int HEIGHT = 360;
+	static const int FLOAT_COUNT_TOLERANCE = 2;
+	static constexpr double FLOAT_PIXEL_TOLERANCE = 0.01;
+
+	static void run(std::ostream &t_out);
+	static bool widths(std::ostream &t_out);
+	static bool floatViews(std::ostream &t_out);
+	static void perturbation(std::ostream &t_out);
+	static void kernels(std::ostream &t_out);
+	static void kernelFamily(std::ostream &t_out);
+	static void multibrot(std::ostream &t_out);
+	static void julia(std::ostream &t_out);
+	static void colouring(std::ostream &t_out);
+	static void antialiasing(std::ostream &t_out);
+
+private:
+	static std::vector<BenchmarkLocation> deepLocations();
+	static std::vector<BenchmarkLocation> kernelLocations();
+	static std::vector<BenchmarkLocation> floatLocations();
+	static Viewport locationViewport(const BenchmarkLocation &t_location);
+	static double renderKernel(Kernel t_kernel, const BenchmarkLocation &t_location, std::vector<int> &t_fractal);
+	static double renderEntry(const KernelEntry &t_entry, const BenchmarkLocation &t_location, std::vector<int> &t_fractal);
+	static int countDifferences(const std::vector<int> &t_a, const std::vector<int> &t_b);
+};
+
+#endif // !BENCHMARK_H
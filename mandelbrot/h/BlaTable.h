@@ -0,0 +1,46 @@
+#ifndef BLATABLE_H
+#define BLATABLE_H
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+/// A single bilinear approximation step. Applying it to a perturbation delta
+/// skips m_length iterations in one go: dz' = A * dz + B * dc.
+/// It may only be used while |dz| is below the validity radius m_radius.
+/// </summary>
+struct BlaStep
+{
+	std::complex<double> m_a;
+	std::complex<double> m_b;
+	double m_radius = 0.0;
+	int m_length = 0;
+};
+
+/// <summary>
+/// Level-merged table of bilinear approximations built from a reference orbit.
+/// Level k holds steps of length 2^k that start at iteration 1 + j * 2^k.
+/// Low levels are dropped first when the table would exceed its memory budget,
+/// plain perturbation iterations cover whatever the table leaves out.
+/// </summary>
+class BlaTable
+{
+public:
+	BlaTable();
+	~BlaTable();
+	void build(const std::vector<std::complex<double>> &t_orbit, double t_maxDelta, size_t t_memoryBudget, double t_epsilon = 1.0 / 9007199254740992.0);
+	void clear();
+	const BlaStep *lookup(int t_iteration, double t_deltaNorm) const;
+	size_t memoryUsed() const;
+	int levelCount() const;
+	int minLevel() const;
+
+private:
+	std::vector<std::vector<BlaStep>> m_levels;
+	int m_minLevel = 0;
+
+	static BlaStep merge(const BlaStep &t_x, const BlaStep &t_y, double t_maxDelta);
+};
+
+#endif // !BLATABLE_H
@@ -0,0 +1,47 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "CountFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Lets a long render carry on after it stops. Finished bands go to a count file that also holds their
+/// colours. A manifest next to it lists the bands that are safely on disk. Syncing is batched: every
+/// Globals::CHECKPOINT_SECONDS the count file is flushed to disk, then the bands finished since are
+/// added to the manifest and that is flushed too, so the manifest never lists a band the disk doesn't
+/// hold. A render started again with the same settings reads the manifest and skips those bands.
+/// </summary>
+class Checkpoint
+{
+public:
+	Checkpoint(CountFile &t_file);
+	~Checkpoint();
+
+	bool open(const std::string &t_path, const std::string &t_settings);
+	bool finished(int t_firstRow) const;
+	int resumed() const;
+	bool writeBand(int t_firstRow, int t_rows, const int *t_counts, const float *t_smooth, const float *t_distance, const uint32_t *t_pixels);
+	bool sync();
+	double seconds() const;
+
+	static const char *MANIFEST_HEADER;
+
+private:
+	CountFile &m_file;
+	FILE *m_manifest = nullptr;
+	// The bands an earlier run finished, never changed after open
+	std::set<int> m_finished;
+	std::vector<int> m_pending;
+	int m_resumed = 0;
+	double m_seconds = 0.0;
+	std::chrono::steady_clock::time_point m_lastSync;
+
+	bool readManifest(const std::string &t_path, const std::string &t_settings);
+};
+
+#endif // !CHECKPOINT_H
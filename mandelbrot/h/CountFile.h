@@ -0,0 +1,96 @@
+#ifndef COUNTFILE_H
+#define COUNTFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/// <summary>
+/// The fixed start of a count file. All values are little-endian. The centre follows as two decimal
+/// strings, then zero padding up to m_headerSize.
+/// </summary>
+struct CountFileHeader
+{
+	char m_magic[8];
+	uint32_t m_headerSize;
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_iterations;
+	uint32_t m_kernel;
+	uint32_t m_exponent;
+	uint32_t m_flags;
+	uint32_t m_centreXLength;
+	uint32_t m_centreYLength;
+	uint32_t m_reserved;
+	double m_spacing;
+	double m_juliaCr;
+	double m_juliaCi;
+};
+
+/// <summary>
+/// Raw iteration data, the counts and the optional smooth and distance channels, in a file that can be
+/// used in place. The header is padded to 64 bytes and is followed by the planes, each width * height
+/// values padded to 64 bytes: int32 counts, then float32 smooth fractions and float32 distances in
+/// pixels and uint32 packed RGBA colours if the flags say they are there. Files are written a band of rows
+/// at a time with one write per plane, and read by mapping them, so nothing is parsed or copied however
+/// large they are.
+/// </summary>
+class CountFile
+{
+public:
+	static const uint32_t FLAG_SMOOTH = 1;
+	static const uint32_t FLAG_DISTANCE = 2;
+	static const uint32_t FLAG_JULIA = 4;
+	static const uint32_t FLAG_PIXELS = 8;
+
+	CountFileHeader m_header;
+	std::string m_centreX;
+	std::string m_centreY;
+
+	CountFile();
+	~CountFile();
+
+	bool create(const std::string &t_path);
+	bool reopen(const std::string &t_path);
+	bool writeRows(int t_firstRow, int t_rows, const int *t_counts, const float *t_smooth, const float *t_distance, const uint32_t *t_pixels = nullptr);
+	bool readRows(int t_firstRow, int t_rows, int *t_counts, float *t_smooth, float *t_distance, uint32_t *t_pixels);
+	bool sync();
+	bool open(const std::string &t_path);
+	void close();
+
+	const int *counts() const;
+	const float *smooth() const;
+	const float *distance() const;
+	const uint32_t *pixels() const;
+
+	static bool syncFile(FILE *t_file);
+
+private:
+	static const size_t ALIGNMENT = 64;
+	static const uint32_t MAX_HEADER_SIZE = 1 << 20;
+
+	static const int PLANES = 4;
+
+	FILE *m_output = nullptr;
+	const uint8_t *m_mapping = nullptr;
+	size_t m_mappingSize = 0;
+#ifdef _WIN32
+	void *m_fileHandle = nullptr;
+	void *m_mappingHandle = nullptr;
+#else
+	int m_fileDescriptor = -1;
+#endif
+
+	size_t planeSize() const;
+	size_t planeOffset(int t_plane) const;
+	size_t fileSize() const;
+	bool hasPlane(int t_plane) const;
+	bool readHeader(const uint8_t *t_header, size_t t_size);
+	void unmap();
+
+	static size_t align(size_t t_size);
+	static bool seek(FILE *t_file, size_t t_offset);
+};
+
+#endif // !COUNTFILE_H
@@ -0,0 +1,51 @@
+#ifndef DEFLATER_H
+#define DEFLATER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Streaming zlib compressor (RFC 1950 and 1951). Input can arrive in any number of pieces and only the
+/// last 32 KB of it is kept for matching, so memory doesn't grow with the stream. Matches are found with
+/// hash chains and coded with the fixed Huffman tables, which is plenty for filtered image rows.
+/// </summary>
+class Deflater
+{
+public:
+	Deflater();
+	~Deflater();
+
+	void write(const uint8_t *t_data, size_t t_size, std::vector<uint8_t> &t_out);
+	void finish(std::vector<uint8_t> &t_out);
+
+	static uint32_t adler32(uint32_t t_adler, const uint8_t *t_data, size_t t_size);
+
+private:
+	static const int WINDOW_SIZE = 32768;
+	static const int HASH_BITS = 15;
+	static const int MIN_MATCH = 3;
+	static const int MAX_MATCH = 258;
+	static const int MAX_CHAIN = 64;
+
+	std::vector<uint8_t> m_buffer;
+	int64_t m_bufferStart = 0;
+	int64_t m_position = 0;
+	std::vector<int64_t> m_head;
+	std::vector<int64_t> m_previous;
+	uint32_t m_bits = 0;
+	int m_bitCount = 0;
+	uint32_t m_adler = 1;
+	bool m_started = false;
+
+	void compress(bool t_final, std::vector<uint8_t> &t_out);
+	void insert(int64_t t_position);
+	int longestMatch(int64_t t_position, int64_t t_end, int &t_distance) const;
+	uint32_t hash(int64_t t_position) const;
+	void putBits(uint32_t t_value, int t_count, std::vector<uint8_t> &t_out);
+	void putHuffman(uint32_t t_code, int t_length, std::vector<uint8_t> &t_out);
+	void putLiteral(int t_literal, std::vector<uint8_t> &t_out);
+	void putMatch(int t_length, int t_distance, std::vector<uint8_t> &t_out);
+};
+
+#endif // !DEFLATER_H
@@ -0,0 +1,57 @@
+#ifndef DOUBLEDOUBLE_H
+#define DOUBLEDOUBLE_H
+
+#include <cmath>
+
+/// <summary>
+/// An unevaluated sum of two doubles, giving about 106 bits of mantissa.
+/// Only the operations needed to place pixels are provided here,
+/// the vectorised versions used by the kernels live in WorkerThread.cpp.
+/// </summary>
+struct DoubleDouble
+{
+	double hi = 0.0;
+	double lo = 0.0;
+
+	DoubleDouble() {}
+	DoubleDouble(double t_hi, double t_lo = 0.0) : hi{ t_hi }, lo{ t_lo } {}
+
+	/// <summary>
+	/// Adds two doubles without losing the rounding error.
+	/// </summary>
+	static DoubleDouble twoSum(double t_a, double t_b)
+	{
+		double f_sum = t_a + t_b;
+		double f_bb = f_sum - t_a;
+		return DoubleDouble(f_sum, (t_a - (f_sum - f_bb)) + (t_b - f_bb));
+	}
+
+	/// <summary>
+	/// Multiplies two doubles without losing the rounding error.
+	/// </summary>
+	static DoubleDouble twoProd(double t_a, double t_b)
+	{
+		double f_product = t_a * t_b;
+		return DoubleDouble(f_product, std::fma(t_a, t_b, -f_product));
+	}
+
+	DoubleDouble operator+(const DoubleDouble &t_other) const
+	{
+		DoubleDouble f_sum = twoSum(hi, t_other.hi);
+		f_sum.lo += lo + t_other.lo;
+		double f_hi = f_sum.hi + f_sum.lo;
+		return DoubleDouble(f_hi, f_sum.lo - (f_hi - f_sum.hi));
+	}
+
+	DoubleDouble operator-(const DoubleDouble &t_other) const
+	{
+		return *this + DoubleDouble(-t_other.hi, -t_other.lo);
+	}
+
+	double toDouble() const
+	{
+		return hi + lo;
+	}
+};
+
+#endif // !DOUBLEDOUBLE_H
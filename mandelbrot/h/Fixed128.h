@@ -0,0 +1,203 @@
+#ifndef FIXED128_H
+#define FIXED128_H
+
+#include <cmath>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/// <summary>
+/// Signed 128-bit fixed-point number with 7 integer bits and 120 fraction bits,
+/// stored as two's complement in two 64-bit words. Only integer instructions are used,
+/// so results are bit-identical on every x86-64 host regardless of compiler flags.
+/// </summary>
+struct Fixed128
+{
+	static const int FRACTION_BITS = 120;
+
+	uint64_t lo = 0;
+	int64_t hi = 0;
+
+	Fixed128() {}
+	Fixed128(int64_t t_hi, uint64_t t_lo) : lo{ t_lo }, hi{ t_hi } {}
+
+	/// <summary>
+	/// Converts a double in the range (-128, 128). Bits below 2^-120 are truncated.
+	/// </summary>
+	static Fixed128 fromDouble(double t_value)
+	{
+		double f_scaled = std::ldexp(t_value, 56);
+		double f_whole = std::floor(f_scaled);
+		return Fixed128(int64_t(f_whole), uint64_t(std::ldexp(f_scaled - f_whole, 64)));
+	}
+
+	/// <summary>
+	/// Converts a double-double given as its hi and lo parts.
+	/// </summary>
+	static Fixed128 fromDoubleDouble(double t_hi, double t_lo)
+	{
+		return fromDouble(t_hi) + fromDouble(t_lo);
+	}
+
+	double toDouble() const
+	{
+		return std::ldexp(double(hi), -56) + std::ldexp(double(lo), -FRACTION_BITS);
+	}
+
+	bool isNegative() const
+	{
+		return hi < 0;
+	}
+
+	/// <summary>
+	/// True if the value is below the given integer. Only the top word is needed for that.
+	/// </summary>
+	bool lessThan(int t_integer) const
+	{
+		return hi < (int64_t(t_integer) << 56);
+	}
+
+	Fixed128 operator+(const Fixed128 &t_other) const
+	{
+		uint64_t f_lo = lo + t_other.lo;
+		return Fixed128(int64_t(uint64_t(hi) + uint64_t(t_other.hi) + (f_lo < lo ? 1 : 0)), f_lo);
+	}
+
+	Fixed128 operator-(const Fixed128 &t_other) const
+	{
+		return *this + t_other.negate();
+	}
+
+	Fixed128 negate() const
+	{
+		uint64_t f_lo = ~lo + 1;
+		return Fixed128(int64_t(~uint64_t(hi) + (f_lo == 0 ? 1 : 0)), f_lo);
+	}
+
+	Fixed128 twice() const
+	{
+		return Fixed128(int64_t((uint64_t(hi) << 1) | (lo >> 63)), lo << 1);
+	}
+
+	/// <summary>
+	/// Multiplies two values, truncating the 256-bit product towards zero.
+	/// </summary>
+	Fixed128 operator*(const Fixed128 &t_other) const
+	{
+		bool f_negative = isNegative() != t_other.isNegative();
+		Fixed128 f_a = isNegative() ? negate() : *this;
+		Fixed128 f_b = t_other.isNegative() ? t_other.negate() : t_other;
+		Fixed128 f_product = multiplyUnsigned(f_a, f_b);
+
+		return f_negative ? f_product.negate() : f_product;
+	}
+
+	/// <summary>
+	/// Squares a value. The result is always non-negative so no sign fix-up is needed.
+	/// </summary>
+	Fixed128 sqr() const
+	{
+		Fixed128 f_a = isNegative() ? negate() : *this;
+		return multiplyUnsigned(f_a, f_a);
+	}
+
+	/// <summary>
+	/// Divides by a positive integer, truncating towards zero.
+	/// </summary>
+	Fixed128 divide(uint32_t t_divisor) const
+	{
+		Fixed128 f_a = isNegative() ? negate() : *this;
+		uint32_t f_words[4] = { uint32_t(uint64_t(f_a.hi) >> 32), uint32_t(f_a.hi), uint32_t(f_a.lo >> 32), uint32_t(f_a.lo) };
+		uint64_t f_remainder = 0;
+
+		for (int i = 0; i < 4; i++)
+		{
+			uint64_t f_current = (f_remainder << 32) | f_words[i];
+			f_words[i] = uint32_t(f_current / t_divisor);
+			f_remainder = f_current % t_divisor;
+		}
+
+		Fixed128 f_result(int64_t((uint64_t(f_words[0]) << 32) | f_words[1]), (uint64_t(f_words[2]) << 32) | f_words[3]);
+
+		return isNegative() ? f_result.negate() : f_result;
+	}
+
+	/// <summary>
+	/// Multiplies by a non-negative integer. Bits that overflow the top word are lost.
+	/// </summary>
+	Fixed128 multiply(uint32_t t_factor) const
+	{
+		Fixed128 f_a = isNegative() ? negate() : *this;
+		uint32_t f_words[4] = { uint32_t(uint64_t(f_a.hi) >> 32), uint32_t(f_a.hi), uint32_t(f_a.lo >> 32), uint32_t(f_a.lo) };
+		uint64_t f_carry = 0;
+
+		for (int i = 3; i >= 0; i--)
+		{
+			uint64_t f_current = uint64_t(f_words[i]) * t_factor + f_carry;
+			f_words[i] = uint32_t(f_current);
+			f_carry = f_current >> 32;
+		}
+
+		Fixed128 f_result(int64_t((uint64_t(f_words[0]) << 32) | f_words[1]), (uint64_t(f_words[2]) << 32) | f_words[3]);
+
+		return isNegative() ? f_result.negate() : f_result;
+	}
+
+private:
+	/// <summary>
+	/// Full 64 x 64 -> 128 bit multiply.
+	/// </summary>
+	static inline uint64_t multiply64(uint64_t t_a, uint64_t t_b, uint64_t &t_high)
+	{
+#ifdef _MSC_VER
+		return _umul128(t_a, t_b, &t_high);
+#else
+		unsigned __int128 f_product = (unsigned __int128)t_a * t_b;
+		t_high = uint64_t(f_product >> 64);
+		return uint64_t(f_product);
+#endif
+	}
+
+	/// <summary>
+	/// Adds into a 64-bit word and returns the carry.
+	/// </summary>
+	static inline uint64_t addCarry(uint64_t &t_word, uint64_t t_value)
+	{
+		t_word += t_value;
+		return t_word < t_value ? 1 : 0;
+	}
+
+	/// <summary>
+	/// Multiplies two non-negative values and keeps bits 120 to 247 of the 256-bit product.
+	/// </summary>
+	static Fixed128 multiplyUnsigned(const Fixed128 &t_a, const Fixed128 &t_b)
+	{
+		uint64_t f_a1 = uint64_t(t_a.hi);
+		uint64_t f_b1 = uint64_t(t_b.hi);
+		uint64_t f_p00High;
+		uint64_t f_p01High;
+		uint64_t f_p10High;
+		uint64_t f_p11High;
+		multiply64(t_a.lo, t_b.lo, f_p00High);
+		uint64_t f_p01 = multiply64(t_a.lo, f_b1, f_p01High);
+		uint64_t f_p10 = multiply64(f_a1, t_b.lo, f_p10High);
+		uint64_t f_p11 = multiply64(f_a1, f_b1, f_p11High);
+
+		uint64_t f_r1 = f_p00High;
+		uint64_t f_carry = addCarry(f_r1, f_p01);
+		f_carry += addCarry(f_r1, f_p10);
+
+		uint64_t f_r2 = f_carry;
+		f_carry = addCarry(f_r2, f_p01High);
+		f_carry += addCarry(f_r2, f_p10High);
+		f_carry += addCarry(f_r2, f_p11);
+
+		uint64_t f_r3 = f_p11High + f_carry;
+
+		return Fixed128(int64_t((f_r2 >> 56) | (f_r3 << 8)), (f_r1 >> 56) | (f_r2 << 8));
+	}
+};
+
+#endif // !FIXED128_H
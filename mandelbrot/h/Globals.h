@@ -1,6 +1,7 @@
 #ifndef GLOBALS_H
 #define GLOBALS_H
 
+#include <cstddef>
 #include <cstdint>
 #include <atomic>
 
@@ -11,6 +12,72 @@ public:
 	static const int SCREEN_HEIGHT = 720;
 	static const int MAX_THREADS = 32;
 
+	// Pixel spacing below which float rounding starts to show, the float kernel is only used above this
+	static constexpr double FLOAT_SPACING_LIMIT = 1.0e-3;
+
+	// Pixel spacing below which double can no longer tell neighbouring pixels apart
+	static constexpr double DOUBLE_SPACING_LIMIT = 1.0e-13;
+
+	// Pixel spacing below which double-double runs out and perturbation takes over
+	static constexpr double DOUBLE_DOUBLE_SPACING_LIMIT = 1.0e-30;
+
+	// Memory the bilinear approximation table may use, lower levels are dropped beyond this
+	static const size_t BLA_MEMORY_BUDGET = size_t(64) * 1024 * 1024;
+
+	// Escape radius used when the smooth channel is wanted, large enough that the fraction is accurate
+	static constexpr double SMOOTH_BAILOUT = 256.0;
+
+	// Fraction of a pixel within which an orbit that returns to a saved point counts as periodic
+	static constexpr double PERIOD_TOLERANCE = 1.0e-3;
+
+	// Samples per side of the grid used to antialias an edge pixel, 4 gives 16 samples
+	static const int ANTIALIAS_SAMPLES = 4;
+
+	// Variance of the brightness of a pixel's 3x3 neighbourhood above which it is antialiased
+	static constexpr float ANTIALIAS_THRESHOLD = 64.0f;
+
+	// Pixels per side of the blocks drawn while the Julia parameter is being dragged
+	static const int JULIA_PREVIEW_STEP = 4;
+
+	// Pixels the headless renderer computes at once, large images are rendered and written in bands of this many
+	static const int BAND_PIXELS = 1 << 22;
+
+	// Seconds between checkpoints, each one flushes the finished bands to disk before listing them in the manifest
+	static constexpr double CHECKPOINT_SECONDS = 30.0;
+
+	// Memory the tile cache may hold before it spills the least recently used tiles to disk
+	static const size_t TILE_CACHE_MEMORY = size_t(256) * 1024 * 1024;
+
+	// Disk space the tiles spilled in one session may take
+	static const size_t TILE_CACHE_DISK = size_t(2) * 1024 * 1024 * 1024;
+
+	// Seconds a viewer frame spends computing quadtree tiles before the rest are drawn from their ancestors
+	static constexpr double TILE_FRAME_SECONDS = 0.05;
+
+	// Tiles a render farm worker is sent ahead of the one it is working on, so it never waits for the next
+	static const int FARM_DEPTH = 2;
+
+	// Times a farm tile is handed out again after the worker holding it was lost, before the render fails
+	static const int FARM_RETRIES = 3;
+
+	// Seconds a farm worker holding tiles may go without sending anything before it is dropped as hung
+	static constexpr double FARM_TILE_SECONDS = 120.0;
+
+	// Seconds a farm coordinator waits with no workers connected before it gives up
+	static constexpr double FARM_WAIT_SECONDS = 30.0;
+
+	// Connections the tile server serves at once, more wait to be accepted
+	static const int SERVER_CONNECTIONS = 64;
+
+	// Seconds the tile server keeps an idle connection open for its next request
+	static constexpr double SERVER_IDLE_SECONDS = 30.0;
+
+	// Part of every tile cache key, bump it whenever a kernel change alters the counts it produces
+	static const int KERNEL_VERSION = 1;
+
+	// Palette cycles per frame while cycling is on
+	static constexpr float PALETTE_CYCLE_SPEED = 0.01f;
+
 	static std::atomic<int> WORKER_COMPLETE;
 
 	static const uint8_t DEFAULT_FONT[];
@@ -0,0 +1,50 @@
+#ifndef HIGHPRECISION_H
+#define HIGHPRECISION_H
+
+#include "DoubleDouble.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Arbitrary precision signed fixed-point number.
+/// m_limbs[0] is the integer part and every following 32-bit limb adds 32 fraction bits.
+/// The number of limbs is chosen by the owner to suit the zoom depth.
+/// </summary>
+class HighPrecision
+{
+public:
+	HighPrecision();
+	HighPrecision(double t_value, int t_limbs);
+	~HighPrecision();
+
+	static HighPrecision fromString(const std::string &t_decimal, int t_limbs);
+	std::string toString(int t_digits) const;
+	double toDouble() const;
+	DoubleDouble toDoubleDouble() const;
+
+	void setLimbs(int t_limbs);
+	int limbs() const;
+	bool isZero() const;
+
+	HighPrecision operator+(const HighPrecision &t_other) const;
+	HighPrecision operator-(const HighPrecision &t_other) const;
+	HighPrecision operator*(const HighPrecision &t_other) const;
+	HighPrecision operator-() const;
+	HighPrecision &operator+=(double t_value);
+	HighPrecision &operator-=(double t_value);
+
+private:
+	std::vector<uint32_t> m_limbs;
+	bool m_negative = false;
+
+	int compareMagnitude(const HighPrecision &t_other) const;
+	void addMagnitude(const HighPrecision &t_other);
+	void subtractMagnitude(const HighPrecision &t_other);
+	void multiplyMagnitude(uint32_t t_factor);
+	void divideMagnitude(uint32_t t_divisor);
+	static HighPrecision addSigned(const HighPrecision &t_a, const HighPrecision &t_b, bool t_negateB);
+};
+
+#endif // !HIGHPRECISION_H
@@ -0,0 +1,250 @@
+#ifndef KERNELFAMILY_H
+#define KERNELFAMILY_H
+
+#include <immintrin.h>
+
+// Optional outputs and early-outs of a kernel. Each combination is its own instantiation,
+// so a kernel only carries the work for the flags it was built with.
+const int KERNEL_SMOOTH = 1;
+const int KERNEL_DERIVATIVE = 2;
+const int KERNEL_PERIOD = 4;
+const int KERNEL_BULB_CHECK = 8;
+const int KERNEL_JULIA = 16;
+const int KERNEL_FEATURES = 32;
+
+#pragma region simd
+
+/// <summary>
+/// Eight floats to an AVX register. Counts are 32-bit, one per lane.
+/// </summary>
+struct SimdFloat8
+{
+	typedef __m256 Real;
+	typedef __m256i Count;
+	static const int WIDTH = 8;
+
+	static inline Real set1(double t_value) { return _mm256_set1_ps(float(t_value)); }
+	static inline Real zero() { return _mm256_setzero_ps(); }
+	static inline Real lanes() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+	static inline Real add(Real t_a, Real t_b) { return _mm256_add_ps(t_a, t_b); }
+	static inline Real sub(Real t_a, Real t_b) { return _mm256_sub_ps(t_a, t_b); }
+	static inline Real mul(Real t_a, Real t_b) { return _mm256_mul_ps(t_a, t_b); }
+	static inline Real fmadd(Real t_a, Real t_b, Real t_c) { return _mm256_fmadd_ps(t_a, t_b, t_c); }
+	static inline Real fmsub(Real t_a, Real t_b, Real t_c) { return _mm256_fmsub_ps(t_a, t_b, t_c); }
+	static inline Real abs(Real t_a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), t_a); }
+	static inline Real less(Real t_a, Real t_b) { return _mm256_cmp_ps(t_a, t_b, _CMP_LT_OQ); }
+	static inline Real lessEqual(Real t_a, Real t_b) { return _mm256_cmp_ps(t_a, t_b, _CMP_LE_OQ); }
+	static inline Real both(Real t_a, Real t_b) { return _mm256_and_ps(t_a, t_b); }
+	static inline Real either(Real t_a, Real t_b) { return _mm256_or_ps(t_a, t_b); }
+	static inline Real without(Real t_a, Real t_b) { return _mm256_andnot_ps(t_b, t_a); }
+	static inline Real blend(Real t_a, Real t_b, Real t_mask) { return _mm256_blendv_ps(t_a, t_b, t_mask); }
+	static inline bool any(Real t_mask) { return _mm256_movemask_ps(t_mask) != 0; }
+	static inline void store(double *t_out, Real t_a)
+	{
+		alignas(32) float f_lanes[8];
+		_mm256_store_ps(f_lanes, t_a);
+
+		for (int i = 0; i < 8; i++)
+		{
+			t_out[i] = f_lanes[i];
+		}
+	}
+
+	static inline Count count(int t_value) { return _mm256_set1_epi32(t_value); }
+	static inline Real countLess(Count t_a, Count t_b) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(t_b, t_a)); }
+	static inline Count countAdd(Count t_a, Count t_b, Real t_mask) { return _mm256_add_epi32(t_a, _mm256_and_si256(t_b, _mm256_castps_si256(t_mask))); }
+	static inline Count countBlend(Count t_a, Count t_b, Real t_mask) { return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(t_a), _mm256_castsi256_ps(t_b), t_mask)); }
+	static inline void storeCounts(int *t_out, Count t_a, int t_lanes)
+	{
+		if (t_lanes >= 8)
+		{
+			_mm256_storeu_si256((__m256i *)t_out, t_a);
+		}
+		else
+		{
+			_mm256_maskstore_epi32(t_out, _mm256_cmpgt_epi32(_mm256_set1_epi32(t_lanes), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)), t_a);
+		}
+	}
+};
+
+/// <summary>
+/// Four doubles to an AVX register. Counts are 64-bit so they line up with the lanes.
+/// </summary>
+struct SimdDouble4
+{
+	typedef __m256d Real;
+	typedef __m256i Count;
+	static const int WIDTH = 4;
+
+	static inline Real set1(double t_value) { return _mm256_set1_pd(t_value); }
+	static inline Real zero() { return _mm256_setzero_pd(); }
+	static inline Real lanes() { return _mm256_setr_pd(0, 1, 2, 3); }
+	static inline Real add(Real t_a, Real t_b) { return _mm256_add_pd(t_a, t_b); }
+	static inline Real sub(Real t_a, Real t_b) { return _mm256_sub_pd(t_a, t_b); }
+	static inline Real mul(Real t_a, Real t_b) { return _mm256_mul_pd(t_a, t_b); }
+	static inline Real fmadd(Real t_a, Real t_b, Real t_c) { return _mm256_fmadd_pd(t_a, t_b, t_c); }
+	static inline Real fmsub(Real t_a, Real t_b, Real t_c) { return _mm256_fmsub_pd(t_a, t_b, t_c); }
+	static inline Real abs(Real t_a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), t_a); }
+	static inline Real less(Real t_a, Real t_b) { return _mm256_cmp_pd(t_a, t_b, _CMP_LT_OQ); }
+	static inline Real lessEqual(Real t_a, Real t_b) { return _mm256_cmp_pd(t_a, t_b, _CMP_LE_OQ); }
+	static inline Real both(Real t_a, Real t_b) { return _mm256_and_pd(t_a, t_b); }
+	static inline Real either(Real t_a, Real t_b) { return _mm256_or_pd(t_a, t_b); }
+	static inline Real without(Real t_a, Real t_b) { return _mm256_andnot_pd(t_b, t_a); }
+	static inline Real blend(Real t_a, Real t_b, Real t_mask) { return _mm256_blendv_pd(t_a, t_b, t_mask); }
+	static inline bool any(Real t_mask) { return _mm256_movemask_pd(t_mask) != 0; }
+	static inline void store(double *t_out, Real t_a) { _mm256_storeu_pd(t_out, t_a); }
+
+	static inline Count count(int t_value) { return _mm256_set1_epi64x(t_value); }
+	static inline Real countLess(Count t_a, Count t_b) { return _mm256_castsi256_pd(_mm256_cmpgt_epi64(t_b, t_a)); }
+	static inline Count countAdd(Count t_a, Count t_b, Real t_mask) { return _mm256_add_epi64(t_a, _mm256_and_si256(t_b, _mm256_castpd_si256(t_mask))); }
+	static inline Count countBlend(Count t_a, Count t_b, Real t_mask) { return _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(t_a), _mm256_castsi256_pd(t_b), t_mask)); }
+	static inline void storeCounts(int *t_out, Count t_a, int t_lanes)
+	{
+		// The low half of each 64-bit count, gathered into the bottom four 32-bit lanes
+		__m128i __f_counts = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(t_a, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+
+		if (t_lanes >= 4)
+		{
+			_mm_storeu_si128((__m128i *)t_out, __f_counts);
+		}
+		else
+		{
+			_mm_maskstore_epi32(t_out, _mm_cmpgt_epi32(_mm_set1_epi32(t_lanes), _mm_setr_epi32(0, 1, 2, 3)), __f_counts);
+		}
+	}
+};
+
+/// <summary>
+/// Two doubles to an SSE register, for comparing widths.
+/// </summary>
+struct SimdDouble2
+{
+	typedef __m128d Real;
+	typedef __m128i Count;
+	static const int WIDTH = 2;
+
+	static inline Real set1(double t_value) { return _mm_set1_pd(t_value); }
+	static inline Real zero() { return _mm_setzero_pd(); }
+	static inline Real lanes() { return _mm_setr_pd(0, 1); }
+	static inline Real add(Real t_a, Real t_b) { return _mm_add_pd(t_a, t_b); }
+	static inline Real sub(Real t_a, Real t_b) { return _mm_sub_pd(t_a, t_b); }
+	static inline Real mul(Real t_a, Real t_b) { return _mm_mul_pd(t_a, t_b); }
+	static inline Real fmadd(Real t_a, Real t_b, Real t_c) { return _mm_fmadd_pd(t_a, t_b, t_c); }
+	static inline Real fmsub(Real t_a, Real t_b, Real t_c) { return _mm_fmsub_pd(t_a, t_b, t_c); }
+	static inline Real abs(Real t_a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), t_a); }
+	static inline Real less(Real t_a, Real t_b) { return _mm_cmplt_pd(t_a, t_b); }
+	static inline Real lessEqual(Real t_a, Real t_b) { return _mm_cmple_pd(t_a, t_b); }
+	static inline Real both(Real t_a, Real t_b) { return _mm_and_pd(t_a, t_b); }
+	static inline Real either(Real t_a, Real t_b) { return _mm_or_pd(t_a, t_b); }
+	static inline Real without(Real t_a, Real t_b) { return _mm_andnot_pd(t_b, t_a); }
+	static inline Real blend(Real t_a, Real t_b, Real t_mask) { return _mm_blendv_pd(t_a, t_b, t_mask); }
+	static inline bool any(Real t_mask) { return _mm_movemask_pd(t_mask) != 0; }
+	static inline void store(double *t_out, Real t_a) { _mm_storeu_pd(t_out, t_a); }
+
+	static inline Count count(int t_value) { return _mm_set1_epi64x(t_value); }
+	static inline Real countLess(Count t_a, Count t_b) { return _mm_castsi128_pd(_mm_cmpgt_epi64(t_b, t_a)); }
+	static inline Count countAdd(Count t_a, Count t_b, Real t_mask) { return _mm_add_epi64(t_a, _mm_and_si128(t_b, _mm_castpd_si128(t_mask))); }
+	static inline Count countBlend(Count t_a, Count t_b, Real t_mask) { return _mm_castpd_si128(_mm_blendv_pd(_mm_castsi128_pd(t_a), _mm_castsi128_pd(t_b), t_mask)); }
+	static inline void storeCounts(int *t_out, Count t_a, int t_lanes)
+	{
+		t_out[0] = _mm_cvtsi128_si32(t_a);
+
+		if (t_lanes >= 2)
+		{
+			t_out[1] = _mm_cvtsi128_si32(_mm_unpackhi_epi64(t_a, t_a));
+		}
+	}
+};
+
+#pragma endregion
+
+#pragma region power
+
+/// <summary>
+/// z^n as a chain of complex multiplications, unrolled at compile time.
+/// </summary>
+template <typename T, int t_exponent>
+struct ComplexPower
+{
+	static inline void apply(typename T::Real t_zr, typename T::Real t_zi, typename T::Real &t_r, typename T::Real &t_i)
+	{
+		typename T::Real __f_r;
+		typename T::Real __f_i;
+		ComplexPower<T, t_exponent - 1>::apply(t_zr, t_zi, __f_r, __f_i);
+		t_r = T::fmsub(__f_r, t_zr, T::mul(__f_i, t_zi));
+		t_i = T::fmadd(__f_r, t_zi, T::mul(__f_i, t_zr));
+	}
+};
+
+template <typename T>
+struct ComplexPower<T, 1>
+{
+	static inline void apply(typename T::Real t_zr, typename T::Real t_zi, typename T::Real &t_r, typename T::Real &t_i)
+	{
+		t_r = t_zr;
+		t_i = t_zi;
+	}
+};
+
+// Small powers get their own expansions, fewer multiplications than the plain chain
+
+template <typename T>
+struct ComplexPower<T, 2>
+{
+	static inline void apply(typename T::Real t_zr, typename T::Real t_zi, typename T::Real &t_r, typename T::Real &t_i)
+	{
+		t_r = T::fmsub(t_zr, t_zr, T::mul(t_zi, t_zi));
+		t_i = T::mul(T::add(t_zr, t_zr), t_zi);
+	}
+};
+
+/// <summary>
+/// z^3 = x(x^2 - 3y^2) + i y(3x^2 - y^2)
+/// </summary>
+template <typename T>
+struct ComplexPower<T, 3>
+{
+	static inline void apply(typename T::Real t_zr, typename T::Real t_zi, typename T::Real &t_r, typename T::Real &t_i)
+	{
+		typename T::Real __f_three = T::set1(3.0);
+		typename T::Real __f_x2 = T::mul(t_zr, t_zr);
+		typename T::Real __f_y2 = T::mul(t_zi, t_zi);
+		t_r = T::mul(t_zr, T::sub(__f_x2, T::mul(__f_three, __f_y2)));
+		t_i = T::mul(t_zi, T::fmsub(__f_three, __f_x2, __f_y2));
+	}
+};
+
+/// <summary>
+/// z^4 as z^2 squared.
+/// </summary>
+template <typename T>
+struct ComplexPower<T, 4>
+{
+	static inline void apply(typename T::Real t_zr, typename T::Real t_zi, typename T::Real &t_r, typename T::Real &t_i)
+	{
+		typename T::Real __f_r;
+		typename T::Real __f_i;
+		ComplexPower<T, 2>::apply(t_zr, t_zi, __f_r, __f_i);
+		ComplexPower<T, 2>::apply(__f_r, __f_i, t_r, t_i);
+	}
+};
+
+/// <summary>
+/// z^5 as z^4 times z.
+/// </summary>
+template <typename T>
+struct ComplexPower<T, 5>
+{
+	static inline void apply(typename T::Real t_zr, typename T::Real t_zi, typename T::Real &t_r, typename T::Real &t_i)
+	{
+		typename T::Real __f_r;
+		typename T::Real __f_i;
+		ComplexPower<T, 4>::apply(t_zr, t_zi, __f_r, __f_i);
+		t_r = T::fmsub(__f_r, t_zr, T::mul(__f_i, t_zi));
+		t_i = T::fmadd(__f_r, t_zi, T::mul(__f_i, t_zr));
+	}
+};
+
+#pragma endregion
+
+#endif // !KERNELFAMILY_H
@@ -0,0 +1,61 @@
+#ifndef LOADTEST_H
+#define LOADTEST_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Puts a tile server on this machine under load the way a few map viewers would, and reports how it
+/// held up. Every client follows the same walk through the pyramid, zooming and panning, each in a
+/// slightly different order, so clients ask for the same tiles at about the same time. Some requests are
+/// for tiles only that client wants and are hung up on straight after being sent, like a viewer that
+/// has panned away. Results are written as plain text, with the server's own counters at the end.
+/// </summary>
+class LoadTest
+{
+public:
+	int m_clients = 8;
+	int m_requests = 1000;
+	int m_levels = 6;
+	double m_drop = 0.1;
+
+	LoadTest(int t_port);
+	~LoadTest();
+
+	bool run(std::ostream &t_out);
+
+private:
+	/// <summary>
+	/// A tile of the pyramid.
+	/// </summary>
+	struct Tile
+	{
+		int m_level;
+		int m_x;
+		int m_y;
+	};
+
+	/// <summary>
+	/// What one client saw.
+	/// </summary>
+	struct Result
+	{
+		std::vector<double> m_latencies;
+		int m_errors = 0;
+		int m_dropped = 0;
+	};
+
+	int m_port;
+	std::vector<Tile> m_walk;
+
+	void buildWalk(int t_length);
+	void client(int t_index, int t_count, Result &t_result) const;
+
+	int connectToServer() const;
+	static bool get(int t_socket, const std::string &t_path, std::string &t_input, int &t_status, std::string &t_body);
+	static std::string tilePath(const Tile &t_tile);
+};
+
+#endif // !LOADTEST_H
@@ -0,0 +1,59 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// A colour at a position along one cycle of a gradient, position in [0, 1).
+/// </summary>
+struct PaletteStop
+{
+	float m_position;
+	uint32_t m_colour;
+};
+
+/// <summary>
+/// Lookup table from iteration count to a packed RGBA colour.
+/// Colours are stored as they sit in the pixel array, R in the lowest byte.
+/// The table is built from a cyclic gradient: m_scale iterations per cycle, shifted by m_offset cycles.
+/// Any change marks the palette dirty so the owner knows to rebuild and recolour.
+/// </summary>
+class Palette
+{
+public:
+	Palette();
+	~Palette();
+	void build(int t_iterations);
+	void apply(const int *t_counts, uint32_t *t_pixels, int t_count) const;
+	void applySmooth(const int *t_counts, const float *t_fractions, uint32_t *t_pixels, int t_count) const;
+	void applySmooth(const int *t_counts, const uint16_t *t_fractions, uint32_t *t_pixels, int t_count) const;
+	uint32_t colour(int t_count) const;
+	int size() const;
+
+	void setStops(const std::vector<PaletteStop> &t_stops);
+	const std::vector<PaletteStop> &stops() const;
+	void setScale(float t_scale);
+	float scale() const;
+	void setOffset(float t_offset);
+	float offset() const;
+	bool isDirty() const;
+
+	static void shadeBoundary(const float *t_distances, uint32_t *t_pixels, int t_count);
+	static uint32_t pack(uint8_t t_r, uint8_t t_g, uint8_t t_b);
+	static std::vector<PaletteStop> rainbowStops();
+	static std::vector<PaletteStop> fireStops();
+	static std::vector<PaletteStop> greyStops();
+
+private:
+	std::vector<uint32_t> m_colours;
+	std::vector<PaletteStop> m_stops = rainbowStops();
+	float m_scale = 62.83185f;
+	float m_offset = 0.0f;
+	bool m_dirty = true;
+
+	uint32_t gradient(float t_position) const;
+	uint32_t blend(int t_count, float t_fraction) const;
+};
+
+#endif // !PALETTE_H
@@ -0,0 +1,36 @@
+#ifndef PERTURBATION_H
+#define PERTURBATION_H
+
+#include "BlaTable.h"
+#include "HighPrecision.h"
+#include "Vector2.h"
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+/// Perturbation renderer for deep zooms. One reference orbit is iterated at the
+/// centre of the view and every pixel only iterates its small delta from it.
+/// </summary>
+class Perturbation
+{
+public:
+	std::vector<std::complex<double>> m_orbit;
+	BlaTable m_bla;
+	bool m_useBla = false;
+	Vector2 m_referencePixel = { 0, 0 };
+	double m_spacing = 0.0;
+
+	Perturbation();
+	~Perturbation();
+	void setReference(const HighPrecision &t_cr, const HighPrecision &t_ci, int t_iterations);
+	void buildBla(double t_maxDelta, size_t t_memoryBudget);
+	int iterate(std::complex<double> t_dc) const;
+	void render(int *t_fractal, const Vector2 &t_pixTL, const Vector2 &t_pixBR, int t_rowSize) const;
+
+private:
+	int m_iterations = 0;
+};
+
+#endif // !PERTURBATION_H
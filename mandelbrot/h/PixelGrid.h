@@ -13,6 +13,7 @@ public:
 	void setPixel(int t_x, int t_y, sf::Color t_colour);
 	sf::Color getPixel(int t_x, int t_y);
 	sf::Texture &getPixelBuffer();
+	uint8_t *getPixelArray();
 
 private:
 	std::vector<uint8_t> m_pixelArray;
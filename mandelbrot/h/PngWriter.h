@@ -0,0 +1,50 @@
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include "Deflater.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Writes an 8-bit RGB PNG a few rows at a time. Rows are filtered and compressed as they arrive and the
+/// compressed data goes out in IDAT chunks, so only the previous row and one chunk are held in memory
+/// however large the image is. The image can also be built in memory.
+/// </summary>
+class PngWriter
+{
+public:
+	PngWriter();
+	~PngWriter();
+
+	bool open(const std::string &t_path, int t_width, int t_height);
+	bool open(std::vector<uint8_t> &t_buffer, int t_width, int t_height);
+	bool writeRows(const uint32_t *t_pixels, int t_rows);
+	bool close();
+
+	static uint32_t crc32(uint32_t t_crc, const uint8_t *t_data, size_t t_size);
+
+private:
+	static const size_t CHUNK_SIZE = size_t(1) << 16;
+
+	std::ofstream m_file;
+	std::vector<uint8_t> *m_buffer = nullptr;
+	Deflater m_deflater;
+	int m_width = 0;
+	int m_height = 0;
+	int m_rows = 0;
+	std::vector<uint8_t> m_previous;
+	std::vector<uint8_t> m_current;
+	std::vector<uint8_t> m_filtered;
+	std::vector<uint8_t> m_best;
+	std::vector<uint8_t> m_compressed;
+
+	bool start(int t_width, int t_height);
+	void filterRow();
+	void writeChunk(const char *t_type, const uint8_t *t_data, size_t t_size);
+	void output(const void *t_data, size_t t_size);
+};
+
+#endif // !PNGWRITER_H
@@ -0,0 +1,132 @@
+#ifndef RENDERFARM_H
+#define RENDERFARM_H
+
+#include "Vector2.h"
+#include "WorkerThread.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Everything a farm worker needs to render its tiles of an image.
+/// </summary>
+struct FarmJob
+{
+	int m_width = 0;
+	int m_height = 0;
+	int m_tileSize = 256;
+	int m_iterations = 1024;
+	int m_exponent = 2;
+	bool m_julia = false;
+	Vector2 m_juliaC = { 0, 0 };
+	SmoothFormat m_smoothFormat = SmoothFormat::None;
+	bool m_boundary = false;
+	bool m_antialias = false;
+	bool m_interiorChecks = false;
+	bool m_reproducible = false;
+	// 0 rainbow, 1 fire, 2 grey, as the viewer's gradients are numbered
+	int m_palette = 0;
+	double m_spacing = 0.0;
+	std::string m_centreX;
+	std::string m_centreY;
+};
+
+/// <summary>
+/// Splits a render into tiles and hands them to worker processes over a Unix domain socket. Workers are
+/// started by the coordinator or by hand with --worker, and can join at any time. Each worker is kept a
+/// few tiles ahead so it never waits for the next. When the queue runs dry a worker with nothing to do
+/// takes a tile another worker has queued but not started, and the first result for a tile wins. A
+/// worker that disconnects or goes quiet for too long is dropped and its tiles go back on the queue,
+/// up to Globals::FARM_RETRIES times each. Results are put together into bands of rows, handed out in
+/// order as soon as each one is complete. POSIX only.
+/// </summary>
+class FarmCoordinator
+{
+public:
+	FarmCoordinator(const FarmJob &t_job, const std::string &t_socket);
+	~FarmCoordinator();
+
+	bool listen();
+	bool spawn(const std::string &t_executable, int t_count);
+	bool nextBand(std::vector<uint32_t> &t_pixels, int &t_rows);
+	bool failed() const;
+
+	int tiles() const;
+	int retries() const;
+	int steals() const;
+	int duplicates() const;
+	int workersSeen() const;
+
+private:
+	/// <summary>
+	/// One tile of the image and how far it has got.
+	/// </summary>
+	struct Tile
+	{
+		int m_x;
+		int m_y;
+		int m_width;
+		int m_height;
+		bool m_done;
+		int m_attempts;
+	};
+
+	/// <summary>
+	/// A connected worker, the bytes read from it that don't make a whole message yet and the tiles
+	/// it has been sent, in the order it works through them.
+	/// </summary>
+	struct Connection
+	{
+		int m_socket;
+		std::vector<uint8_t> m_input;
+		std::deque<int> m_tiles;
+		std::chrono::steady_clock::time_point m_lastHeard;
+		bool m_dead;
+	};
+
+	FarmJob m_job;
+	std::string m_socketPath;
+	int m_listener = -1;
+	std::vector<int> m_children;
+	std::vector<Tile> m_tiles;
+	std::deque<int> m_queue;
+	std::vector<Connection> m_connections;
+	std::map<int, std::vector<uint32_t>> m_bands;
+	std::map<int, int> m_bandTiles;
+	int m_nextBand = 0;
+	int m_tilesAcross = 0;
+	bool m_failed = false;
+	int m_retries = 0;
+	int m_steals = 0;
+	int m_duplicates = 0;
+	int m_workersSeen = 0;
+	std::chrono::steady_clock::time_point m_lastWorker;
+
+	FarmCoordinator(const FarmCoordinator &) = delete;
+	FarmCoordinator &operator=(const FarmCoordinator &) = delete;
+
+	void pump();
+	void assign();
+	bool send(Connection &t_connection, int t_tile);
+	void receive(Connection &t_connection);
+	void result(Connection &t_connection, int t_tile, const uint8_t *t_pixels, size_t t_size);
+	void cancel(int t_tile, const Connection *t_except);
+	void drop(size_t t_index);
+	void reap();
+};
+
+/// <summary>
+/// The worker side of the farm. Connects to a coordinator, renders the tiles it is sent with the usual
+/// renderer and sends each one back as soon as it is done.
+/// </summary>
+class FarmWorker
+{
+public:
+	static int run(const std::string &t_socket);
+};
+
+#endif // !RENDERFARM_H
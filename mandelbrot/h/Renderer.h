@@ -0,0 +1,92 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "Vector2.h"
+#include "WorkerThread.h"
+#include "Globals.h"
+#include "Viewport.h"
+#include "Perturbation.h"
+#include "Palette.h"
+#include "TileCache.h"
+
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// The worker pool and the buffers it renders into, with no window attached. A renderer draws frames of a
+/// fixed size in pixels. A frame can be a whole view or a part of a larger one, given by the pixel origin of
+/// the frame within the viewport. The settings are read when a frame is started.
+/// </summary>
+class Renderer
+{
+public:
+	int m_iterations = 1024;
+	Kernel m_kernel = Kernel::Float;
+	bool m_fuseColour = true;
+	SmoothFormat m_smoothFormat = SmoothFormat::None;
+	bool m_boundary = false;
+	bool m_antialias = false;
+	bool m_interiorChecks = false;
+	int m_exponent = 2;
+	bool m_julia = false;
+	Vector2 m_juliaC = { 0, 0 };
+	Palette m_palette;
+	// Checked before a frame is computed and filled in after, no caching when null
+	TileCache *m_cache = nullptr;
+
+	Renderer(int t_width, int t_height, uint32_t *t_pixels = nullptr);
+	~Renderer();
+
+	void render(const Viewport &t_viewport, const Vector2 &t_origin = Vector2(0, 0));
+	void compute(const Viewport &t_viewport, const Vector2 &t_origin = Vector2(0, 0));
+	void present(const Viewport &t_viewport);
+	void colour();
+	void antialias();
+	void preview(const Viewport &t_viewport, int t_step);
+	void buildPalette();
+
+	int width() const;
+	int height() const;
+	int *fractal() const;
+	const void *smooth() const;
+	void *smooth();
+	const float *distance() const;
+	float *distance();
+	uint32_t *pixels() const;
+	int antialiased() const;
+	bool cached() const;
+	const KernelEntry *entry() const;
+	std::string kernelName() const;
+
+	uint64_t tileKey(const Viewport &t_viewport, const Vector2 &t_origin = Vector2(0, 0)) const;
+
+	static Kernel chooseKernel(double t_spacing, int t_exponent, bool t_julia, bool t_reproducible);
+
+private:
+	int m_width;
+	int m_height;
+	int *m_fractal = nullptr;
+	void *m_smooth = nullptr;
+	float *m_distance = nullptr;
+	int *m_preview = nullptr;
+	uint32_t *m_pixels = nullptr;
+	bool m_ownsPixels = false;
+	int m_antialiased = 0;
+	bool m_cached = false;
+	Kernel m_cachedKernel = Kernel::Double;
+	WorkerThread m_workers[Globals::MAX_THREADS];
+	Perturbation m_perturbation;
+	HighPrecision m_referenceX;
+	HighPrecision m_referenceY;
+	int m_referenceIterations = 0;
+
+	Renderer(const Renderer &) = delete;
+	Renderer &operator=(const Renderer &) = delete;
+
+	void dispatch(const Viewport &t_viewport, const Vector2 &t_origin, bool t_compute);
+	void section(int t_index, int t_width, int t_height, Vector2 &t_pixTL, Vector2 &t_pixBR) const;
+	void wait();
+	void threadPoolInit();
+};
+
+#endif // !RENDERER_H
@@ -0,0 +1,106 @@
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include "WorkerThread.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// The iteration data of one rendered tile, without its colours, so a hit can be coloured with whatever
+/// palette is current.
+/// </summary>
+struct TileData
+{
+	int m_width = 0;
+	int m_height = 0;
+	int m_iterations = 0;
+	Kernel m_kernel = Kernel::Double;
+	int m_exponent = 2;
+	SmoothFormat m_smoothFormat = SmoothFormat::None;
+	std::vector<int> m_counts;
+	std::vector<uint8_t> m_smooth;
+	std::vector<float> m_distance;
+
+	size_t bytes() const;
+};
+
+/// <summary>
+/// Content-addressed store of computed tiles. A tile is found by a hash of everything that decides its
+/// counts: where it is in the world and how big, the iteration cap, the formula and the kernel with
+/// Globals::KERNEL_VERSION. Recently used tiles are kept in memory. When that is over budget the least
+/// recently used ones are spilled to a directory as count files named by their hash, so they are found
+/// again in a later session. Safe to use from several threads.
+/// </summary>
+class TileCache
+{
+public:
+	TileCache(size_t t_memoryBudget = Globals::TILE_CACHE_MEMORY, const std::string &t_directory = "", size_t t_diskBudget = Globals::TILE_CACHE_DISK);
+	~TileCache();
+
+	bool fetch(uint64_t t_key, TileData &t_tile);
+	bool fetch(uint64_t t_key, int *t_counts, void *t_smooth, float *t_distance, size_t t_pixels, Kernel &t_kernel);
+	bool contains(uint64_t t_key) const;
+	void store(uint64_t t_key, TileData &&t_tile);
+	void clear();
+
+	uint64_t hits() const;
+	uint64_t misses() const;
+	uint64_t diskHits() const;
+	size_t memoryUsed() const;
+
+	/// <summary>
+	/// Builds a key a value at a time. 64-bit FNV-1a, which is plenty to tell tiles apart.
+	/// </summary>
+	class Hasher
+	{
+	public:
+		Hasher &add(const void *t_data, size_t t_size);
+		Hasher &add(const std::string &t_value);
+		template <typename T> Hasher &add(const T &t_value) { return add(&t_value, sizeof(T)); }
+		uint64_t value() const;
+
+	private:
+		uint64_t m_hash = 14695981039346656037ull;
+	};
+
+private:
+	/// <summary>
+	/// A tile held in memory. It is on disk already if it was read from there or spilled before.
+	/// </summary>
+	struct Entry
+	{
+		uint64_t m_key;
+		TileData m_tile;
+		bool m_onDisk;
+	};
+
+	typedef std::list<Entry> Entries;
+
+	size_t m_memoryBudget;
+	size_t m_memoryUsed = 0;
+	std::string m_directory;
+	size_t m_diskBudget;
+	size_t m_diskUsed = 0;
+	Entries m_entries;
+	std::unordered_map<uint64_t, Entries::iterator> m_index;
+	std::deque<std::pair<uint64_t, size_t>> m_spilled;
+	uint64_t m_hits = 0;
+	uint64_t m_misses = 0;
+	uint64_t m_diskHits = 0;
+	mutable std::mutex m_mutex;
+
+	bool find(uint64_t t_key);
+	bool load(uint64_t t_key);
+	void insert(uint64_t t_key, TileData &&t_tile, bool t_onDisk);
+	void spill(Entry &t_entry);
+	std::string path(uint64_t t_key) const;
+};
+
+#endif // !TILECACHE_H
@@ -0,0 +1,65 @@
+#ifndef TILEPYRAMID_H
+#define TILEPYRAMID_H
+
+#include "Renderer.h"
+#include "HighPrecision.h"
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// The directory layout a pyramid is written in.
+/// </summary>
+enum class PyramidLayout
+{
+	// z/x/y.png, one tile at level 0, as used by Leaflet and OpenLayers
+	Xyz,
+	// Deep Zoom: name.dzi and name_files/level/x_y.png, level 0 is one pixel, as used by OpenSeadragon
+	DeepZoom
+};
+
+/// <summary>
+/// Exports a zoomable image as a pyramid of tiles. Every tile of every level is rendered directly by the
+/// kernels rather than cut from a larger image, one tile per frame of the renderer, level by level.
+/// A tile whose pixels all reach the iteration cap is not written, and shares one interior tile that
+/// viewers can fall back to. Its children are still rendered, since they sample points between its pixels.
+/// </summary>
+class TilePyramid
+{
+public:
+	bool m_reproducible = false;
+
+	TilePyramid(Renderer &t_renderer, const std::string &t_directory, PyramidLayout t_layout);
+	~TilePyramid();
+
+	bool build(const HighPrecision &t_centreX, const HighPrecision &t_centreY, double t_extent, int t_levels);
+	int rendered() const;
+	uint64_t skipped() const;
+
+	static const char *DEEP_ZOOM_NAME;
+
+private:
+	Renderer &m_renderer;
+	std::string m_directory;
+	PyramidLayout m_layout;
+	int m_tileSize;
+	int m_rendered = 0;
+	uint64_t m_skipped = 0;
+	bool m_written = true;
+	std::vector<uint32_t> m_tile;
+	std::thread m_writer;
+
+	bool renderTile(const Viewport &t_viewport, int t_x, int t_y, int t_size, const std::string &t_path);
+	void writeTile(const std::string &t_path, int t_size);
+	bool writeInterior();
+	bool writeDeepZoomDescriptor(int t_size);
+	std::string tilePath(int t_level, int t_x, int t_y);
+	int deepZoomLevel(int t_level) const;
+	void finishWriting();
+
+	static bool makeDirectory(const std::string &t_path);
+};
+
+#endif // !TILEPYRAMID_H
@@ -0,0 +1,60 @@
+#ifndef TILEQUADTREE_H
+#define TILEQUADTREE_H
+
+#include "Renderer.h"
+#include "TileCache.h"
+#include "Viewport.h"
+
+#include <cstdint>
+
+/// <summary>
+/// Draws a view from tiles fixed in the world rather than to the screen, so work done at one zoom level or
+/// position is found again at another. The world is a square of side WORLD_SIZE around the origin, split
+/// in a quadtree: level L has 2^L by 2^L tiles of TILE by TILE pixels, so each level halves the pixel
+/// spacing. A view is drawn from the coarsest level whose spacing is no larger than its own, so tiles are
+/// never magnified, sampling the tiles' counts into the screen renderer's buffers. Tiles go through the tile cache, so a panned view finds the tiles
+/// it shares with the last one. When a frame's time budget runs out, tiles not yet computed are filled
+/// from a cached ancestor at a coarser level as a placeholder and computed on a later frame.
+/// </summary>
+class TileQuadtree
+{
+public:
+	// Pixels per side of a tile
+	static const int TILE = 256;
+
+	// Side of the square of the world the quadtree covers, centred on the origin
+	static constexpr double WORLD_SIZE = 4.0;
+
+	TileQuadtree(TileCache &t_cache);
+	~TileQuadtree();
+
+	bool covers(const Viewport &t_viewport) const;
+	bool update(Renderer &t_screen, const Viewport &t_viewport, double t_budget, bool t_reproducible);
+
+	int level() const;
+	int exact() const;
+	int placeholders() const;
+
+	static int levelFor(double t_spacing);
+	static double tileSpacing(int t_level);
+
+private:
+	TileCache &m_cache;
+	Renderer m_tileRenderer{ TILE, TILE };
+	bool m_reproducible = false;
+	int m_level = 0;
+	int m_exact = 0;
+	int m_placeholders = 0;
+
+	TileQuadtree(const TileQuadtree &) = delete;
+	TileQuadtree &operator=(const TileQuadtree &) = delete;
+
+	void tileViewport(int t_level, int64_t t_x, int64_t t_y, Viewport &t_viewport) const;
+	uint64_t key(int t_level, int64_t t_x, int64_t t_y);
+	void compose(Renderer &t_screen, const Viewport &t_viewport, int t_level, int64_t t_x, int64_t t_y, const Vector2 &t_pixTL, const Vector2 &t_pixBR,
+		const int *t_counts, const uint8_t *t_smooth, size_t t_smoothBytes, const float *t_distance) const;
+
+	static int64_t floorDiv(int64_t t_value, int64_t t_divisor);
+};
+
+#endif // !TILEQUADTREE_H
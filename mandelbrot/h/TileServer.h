@@ -0,0 +1,95 @@
+#ifndef TILESERVER_H
+#define TILESERVER_H
+
+#include "Renderer.h"
+#include "HighPrecision.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// A small HTTP server that renders z/x/y.png tiles on request, laid out like an XYZ pyramid, for map
+/// viewers such as Leaflet. Each connection has a thread that reads its requests, but tiles are rendered
+/// one at a time by a single render thread through the renderer's worker pool and tile cache, newest
+/// request first since that is what a viewer is looking at now. A request for a tile that is already
+/// queued or rendering waits for that render instead of starting another. A request whose client hangs
+/// up while it waits is dropped, and a queued tile nobody is waiting for any more is never rendered. A
+/// tile already rendering is finished and kept in the tile cache. GET /stats gives the counters as text.
+/// Listens on the loopback address only. POSIX only.
+/// </summary>
+class TileServer
+{
+public:
+	bool m_reproducible = false;
+
+	TileServer(Renderer &t_renderer, const HighPrecision &t_centreX, const HighPrecision &t_centreY, double t_extent, int t_levels);
+	~TileServer();
+
+	bool listen(int t_port);
+	void run(const std::atomic<bool> &t_stop);
+
+	uint64_t requests() const;
+	uint64_t renders() const;
+	uint64_t coalesced() const;
+	uint64_t cancelled() const;
+	uint64_t dropped() const;
+	std::string stats() const;
+
+private:
+	/// <summary>
+	/// A tile that has been asked for and isn't rendered yet, with the number of requests waiting for it.
+	/// </summary>
+	struct Pending
+	{
+		int m_level;
+		int m_x;
+		int m_y;
+		int m_waiters;
+		bool m_started;
+		bool m_done;
+		std::vector<uint8_t> m_png;
+	};
+
+	Renderer &m_renderer;
+	HighPrecision m_centreX;
+	HighPrecision m_centreY;
+	double m_extent;
+	int m_levels;
+	int m_tileSize;
+	int m_listener = -1;
+	std::map<uint64_t, std::shared_ptr<Pending>> m_pending;
+	std::deque<std::shared_ptr<Pending>> m_queue;
+	int m_connections = 0;
+	bool m_stopping = false;
+	uint64_t m_requests = 0;
+	uint64_t m_renders = 0;
+	uint64_t m_coalesced = 0;
+	uint64_t m_cancelled = 0;
+	uint64_t m_dropped = 0;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_work;
+	std::condition_variable m_finished;
+	std::thread m_renderThread;
+
+	TileServer(const TileServer &) = delete;
+	TileServer &operator=(const TileServer &) = delete;
+
+	void serve(int t_socket);
+	bool respond(int t_socket, const std::string &t_target, bool t_keepAlive);
+	std::shared_ptr<Pending> request(int t_socket, int t_level, int t_x, int t_y);
+	void abandon(const std::shared_ptr<Pending> &t_pending);
+	void renderTiles();
+	void renderTile(Pending &t_pending, std::vector<uint8_t> &t_png);
+
+	static uint64_t key(int t_level, int t_x, int t_y);
+};
+
+#endif // !TILESERVER_H
@@ -1,7 +1,11 @@
 #ifndef VECTOR2_H
 #define VECTOR2_H
 
+// The headless build has no SFML, so the conversions to and from its vectors are left out
+#ifndef MANDELBROT_HEADLESS
 #include <SFML/Graphics.hpp>
+#endif
+
 #include <string>
 
 // Last updated on 25.08.21 ~ AJB
@@ -11,9 +15,11 @@ class Vector2
 public:
 	Vector2();
 	Vector2(double t_x, double t_y);
+#ifndef MANDELBROT_HEADLESS
 	Vector2(sf::Vector2i t_vector);
 	Vector2(sf::Vector2f t_vector);
 	Vector2(sf::Vector2u t_vector);
+#endif
 	~Vector2();
 
 	double length() const;
@@ -46,9 +52,11 @@ public:
 	bool operator==(const Vector2 t_vector) const;
 	bool operator!=(const Vector2 t_vector) const;
 
+#ifndef MANDELBROT_HEADLESS
 	operator sf::Vector2i() { return sf::Vector2i(static_cast<int>(x), static_cast<int>(y)); };
 	operator sf::Vector2f() { return sf::Vector2f(static_cast<float>(x), static_cast<float>(y)); };
 	operator sf::Vector2u() { return sf::Vector2u(static_cast<unsigned int>(x), static_cast<unsigned int>(y)); };
+#endif
 
 	double x;
 	double y;
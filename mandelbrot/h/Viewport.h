@@ -0,0 +1,44 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include "HighPrecision.h"
+#include "Vector2.h"
+
+/// <summary>
+/// The camera. The centre is held in arbitrary precision and the scale as a mantissa and
+/// a power of two, so zooming and panning never lose precision however deep the view goes.
+/// Scale is in pixels per world unit and pixels are square.
+/// </summary>
+class Viewport
+{
+public:
+	Viewport(int t_width, int t_height);
+	~Viewport();
+
+	void setCentre(const HighPrecision &t_x, const HighPrecision &t_y);
+	void setScale(double t_scale);
+	void zoom(double t_factor, const Vector2 &t_anchor);
+	void pan(const Vector2 &t_screenDelta);
+	void screenToWorld(const Vector2 &t_screen, HighPrecision &t_worldX, HighPrecision &t_worldY) const;
+	void screenToWorld(const Vector2 &t_screen, Vector2 &t_world, Vector2 &t_worldLow) const;
+	void worldToScreen(const HighPrecision &t_worldX, const HighPrecision &t_worldY, Vector2 &t_screen) const;
+
+	const HighPrecision &centreX() const;
+	const HighPrecision &centreY() const;
+	double pixelSpacing() const;
+	double scaleMantissa() const;
+	int scaleExponent() const;
+	int precisionLimbs() const;
+
+private:
+	HighPrecision m_centreX;
+	HighPrecision m_centreY;
+	double m_scaleMantissa = 1.0;
+	int m_scaleExponent = 0;
+	int m_width;
+	int m_height;
+
+	void normalise();
+};
+
+#endif // !VIEWPORT_H
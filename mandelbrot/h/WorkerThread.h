@@ -3,12 +3,65 @@
 
 #include "Vector2.h"
 #include "Globals.h"
+#include "Perturbation.h"
+#include "Palette.h"
 
 #include <thread>
 #include <condition_variable>
 #include <immintrin.h>
 #include <atomic>
 #include <complex>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// The arithmetic used by a worker to iterate its section.
+/// </summary>
+enum class Kernel
+{
+	Float,
+	Double,
+	DoubleDouble,
+	Fixed128,
+	Perturbation
+};
+
+/// <summary>
+/// How the optional smooth channel is stored. It holds the fraction to add to each
+/// iteration count, so half precision is plenty.
+/// </summary>
+enum class SmoothFormat
+{
+	None,
+	Float32,
+	Float16
+};
+
+/// <summary>
+/// What a worker does with its section when it is started.
+/// </summary>
+enum class WorkerJob
+{
+	Compute,
+	Colour,
+	Antialias
+};
+
+class WorkerThread;
+
+/// <summary>
+/// A kernel that can be picked at runtime and what it was built for.
+/// The width is the number of pixels iterated together.
+/// </summary>
+struct KernelEntry
+{
+	Kernel m_kernel;
+	int m_width;
+	int m_exponent;
+	int m_features;
+	bool m_tuned;
+	void (WorkerThread::*m_function)();
+};
 
 class WorkerThread
 {
@@ -17,18 +70,77 @@ public:
 	std::mutex m_mutex;
 	std::condition_variable m_cvStart;
 	bool m_alive = true;	
+	bool m_started = false;
 	Vector2 m_pixTL = { 0, 0 };
 	Vector2 m_pixBR = { 0, 0 };
 	Vector2 m_fracTL = { 0, 0 };
 	Vector2 m_fracBR = { 0, 0 };
+	Vector2 m_fracTLLow = { 0, 0 };
+	Vector2 m_fracBRLow = { 0, 0 };
+	Vector2 m_viewTL = { 0, 0 };
+	Vector2 m_viewTLLow = { 0, 0 };
+	Vector2 m_origin = { 0, 0 };
+	double m_spacing = 0.0;
+	Kernel m_kernel = Kernel::Double;
 	int m_iterations = 0;
 	int m_screenWidth = 0;
 	int *m_fractal = nullptr;
+	const Perturbation *m_perturbation = nullptr;
+	const Palette *m_palette = nullptr;
+	uint32_t *m_pixels = nullptr;
+	WorkerJob m_job = WorkerJob::Compute;
+	bool m_fuseColour = false;
+	bool m_keepCounts = true;
+	SmoothFormat m_smoothFormat = SmoothFormat::None;
+	void *m_smooth = nullptr;
+	float *m_distance = nullptr;
+	int *m_period = nullptr;
+	bool m_interiorChecks = false;
+	int m_exponent = 2;
+	bool m_julia = false;
+	Vector2 m_juliaC = { 0, 0 };
+	const KernelEntry *m_entry = nullptr;
+	int m_antialiasSamples = Globals::ANTIALIAS_SAMPLES;
+	float m_antialiasThreshold = Globals::ANTIALIAS_THRESHOLD;
+	int m_antialiased = 0;
 
 	WorkerThread();
 	~WorkerThread();
-	void start(const Vector2 &t_pixTL, const Vector2 &t_pixBR, const Vector2 &t_fracTL, const Vector2 &t_fracBR, const int t_iterations);
+	void assign(const Vector2 &t_pixTL, const Vector2 &t_pixBR, const Vector2 &t_fracTL, const Vector2 &t_fracBR, const Vector2 &t_fracTLLow, const Vector2 &t_fracBRLow, const int t_iterations, const Kernel t_kernel);
+	void start(const Vector2 &t_pixTL, const Vector2 &t_pixBR, const Vector2 &t_fracTL, const Vector2 &t_fracBR, const Vector2 &t_fracTLLow, const Vector2 &t_fracBRLow, const int t_iterations, const Kernel t_kernel);
+	void startColouring(const Vector2 &t_pixTL, const Vector2 &t_pixBR);
+	void startAntialiasing(const Vector2 &t_pixTL, const Vector2 &t_pixBR);
 	void createFractal();	
+	void compute();
+	void colour();
+	void antialias();
+	int features() const;
+	static const char *kernelName(Kernel t_kernel);
+	static const std::vector<KernelEntry> &kernelRegistry();
+	static const KernelEntry *findKernel(Kernel t_kernel, int t_exponent, int t_features, int t_width);
+	static std::string entryName(const KernelEntry &t_entry);
+
+private:
+	static const int ANTIALIAS_MAX_GRID = 8;
+
+	template <bool t_smooth> void kernelFloat();
+	template <bool t_smooth, bool t_distance> void kernelDouble();
+	template <typename T, int t_exponent, int t_features> void kernelFamily();
+	void kernelDoubleDouble();
+	void kernelFixed128();
+	int *countRow(int t_offsetY);
+	void finishRow(int t_offsetY, const int *t_counts);
+	void colourRow(int t_offset, const int *t_counts, int t_count);
+	void storeSmooth(int t_offset, const int *t_counts, const float *t_norms, int t_lanes);
+	void storeDistance(int t_offset, const int *t_counts, const double *t_norms, const double *t_derivativeNorms, double t_spacing, int t_lanes);
+	void clearChannels();
+	bool isEdge(int t_x, int t_y) const;
+	template <int t_exponent> void sampleDouble(const double *t_cr, const double *t_ci, int *t_counts, float *t_fractions, int t_count) const;
+	static float smoothFraction(float t_norm, int t_exponent);
+
+	std::vector<int> m_rowCounts;
+
+	template <typename T, int t_exponent, int t_features, bool t_valid> friend struct KernelRegistration;
 };
 
 #endif // !WORKERTHREAD_H
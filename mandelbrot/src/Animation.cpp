@@ -0,0 +1,408 @@
+#include "Animation.h"
+#include "Viewport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+/// <summary>
+/// Animation constructor.
+/// </summary>
+/// <param name="t_renderer">The renderer for key images, its size is the key size and its settings are made.</param>
+/// <param name="t_width">The width of a frame in pixels, no more than the key width.</param>
+/// <param name="t_height">The height of a frame in pixels, no more than the key height.</param>
+/// <param name="t_format">How frames are written.</param>
+/// <param name="t_output">Where frames are written, usually stdout.</param>
+Animation::Animation(Renderer &t_renderer, int t_width, int t_height, VideoFormat t_format, FILE *t_output) : m_renderer{ t_renderer }, m_width{ t_width }, m_height{ t_height }, m_format{ t_format }, m_output{ t_output }
+{
+	m_key.resize(size_t(m_renderer.width()) * size_t(m_renderer.height()));
+	m_keyCounts.resize(m_key.size());
+	m_frame.resize(size_t(m_width) * size_t(m_height) * 3);
+}
+
+/// <summary>
+/// Animation destructor.
+/// </summary>
+Animation::~Animation()
+{
+	finishWriting();
+}
+
+/// <summary>
+/// Works out every frame's view from the path. The centres are held at the precision of the deepest
+/// keyframe, and are moved from whichever end of a stretch is nearer, so a frame near the deep end is
+/// placed relative to that end and keeps all of its digits.
+/// </summary>
+/// <param name="t_path">The keyframes, in order of frame.</param>
+/// <returns>False if the path is empty, out of order or has a spacing that isn't above 0.</returns>
+bool Animation::build(const std::vector<Keyframe> &t_path)
+{
+	m_frames.clear();
+
+	if (t_path.empty())
+	{
+		return false;
+	}
+
+	double f_finest = t_path[0].m_spacing;
+
+	for (size_t i = 0; i < t_path.size(); i++)
+	{
+		if (t_path[i].m_spacing <= 0.0 || t_path[i].m_iterations < 1 || (i > 0 && t_path[i].m_frame <= t_path[i - 1].m_frame))
+		{
+			return false;
+		}
+
+		f_finest = std::min(f_finest, t_path[i].m_spacing);
+	}
+
+	Viewport f_deepest(m_renderer.width(), m_renderer.height());
+	f_deepest.setScale(1.0 / f_finest);
+	const int f_limbs = f_deepest.precisionLimbs();
+
+	std::vector<HighPrecision> f_x;
+	std::vector<HighPrecision> f_y;
+
+	for (const Keyframe &f_keyframe : t_path)
+	{
+		f_x.push_back(HighPrecision::fromString(f_keyframe.m_centreX, f_limbs));
+		f_y.push_back(HighPrecision::fromString(f_keyframe.m_centreY, f_limbs));
+	}
+
+	m_frames.push_back(Frame{ f_x[0], f_y[0], t_path[0].m_spacing, t_path[0].m_iterations });
+
+	for (size_t k = 1; k < t_path.size(); k++)
+	{
+		const Keyframe &f_from = t_path[k - 1];
+		const Keyframe &f_to = t_path[k];
+		const HighPrecision f_dx = f_x[k] - f_x[k - 1];
+		const HighPrecision f_dy = f_y[k] - f_y[k - 1];
+
+		for (int f_frame = f_from.m_frame + 1; f_frame <= f_to.m_frame; f_frame++)
+		{
+			double f_t = double(f_frame - f_from.m_frame) / double(f_to.m_frame - f_from.m_frame);
+			double f_spacing = std::exp2(std::log2(f_from.m_spacing) + (std::log2(f_to.m_spacing) - std::log2(f_from.m_spacing)) * f_t);
+
+			// How far the centre has come, in step with how far the spacing has, so the point the zoom
+			// heads for drifts smoothly across the screen. Both ends are found directly to keep them exact.
+			double f_along = f_t;
+			double f_left = 1.0 - f_t;
+
+			if (f_from.m_spacing != f_to.m_spacing)
+			{
+				f_along = (f_from.m_spacing - f_spacing) / (f_from.m_spacing - f_to.m_spacing);
+				f_left = (f_spacing - f_to.m_spacing) / (f_from.m_spacing - f_to.m_spacing);
+			}
+
+			Frame f_view{ f_x[k], f_y[k], f_spacing, int(std::lround(f_from.m_iterations + (f_to.m_iterations - f_from.m_iterations) * f_t)) };
+
+			if (f_along <= 0.5)
+			{
+				f_view.m_centreX = f_x[k - 1] + f_dx * HighPrecision(f_along, f_limbs);
+				f_view.m_centreY = f_y[k - 1] + f_dy * HighPrecision(f_along, f_limbs);
+			}
+			else
+			{
+				f_view.m_centreX = f_x[k] - f_dx * HighPrecision(f_left, f_limbs);
+				f_view.m_centreY = f_y[k] - f_dy * HighPrecision(f_left, f_limbs);
+			}
+
+			m_frames.push_back(f_view);
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Renders the keys and streams every frame out.
+/// </summary>
+/// <returns>False if the output couldn't be written.</returns>
+bool Animation::run()
+{
+	m_keys = 0;
+	m_written = true;
+
+	if (m_format == VideoFormat::Y4m)
+	{
+		m_written = std::fprintf(m_output, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", m_width, m_height, m_fps) > 0;
+	}
+
+	Key f_key;
+
+	for (int f_first = 0; f_first < int(m_frames.size()) && m_written; f_first = f_key.m_last + 1)
+	{
+		nextKey(f_first, f_key);
+
+		Viewport f_viewport(m_renderer.width(), m_renderer.height());
+		f_viewport.setScale(1.0 / f_key.m_spacing);
+		f_viewport.setCentre(f_key.m_centreX, f_key.m_centreY);
+
+		// The key is rendered with the highest cap of its frames
+		int f_iterations = 1;
+
+		for (int i = f_key.m_first; i <= f_key.m_last; i++)
+		{
+			f_iterations = std::max(f_iterations, m_frames[i].m_iterations);
+		}
+
+		f_key.m_iterations = f_iterations;
+		m_renderer.m_iterations = f_iterations;
+		m_renderer.m_kernel = Renderer::chooseKernel(f_key.m_spacing, m_renderer.m_exponent, m_renderer.m_julia, m_reproducible);
+		m_renderer.render(f_viewport);
+		m_keys++;
+
+		finishWriting();
+
+		std::copy(m_renderer.pixels(), m_renderer.pixels() + m_key.size(), m_key.begin());
+		std::copy(m_renderer.fractal(), m_renderer.fractal() + m_keyCounts.size(), m_keyCounts.begin());
+		m_keyPalette = m_renderer.m_palette;
+		m_writer = std::thread(&Animation::writeFrames, this, f_key);
+	}
+
+	finishWriting();
+
+	return std::fflush(m_output) == 0 && m_written;
+}
+
+/// <summary>
+/// Gets the number of frames in the animation.
+/// </summary>
+/// <returns>The number of frames.</returns>
+int Animation::frames() const
+{
+	return int(m_frames.size());
+}
+
+/// <summary>
+/// Gets the number of key images the last run rendered.
+/// </summary>
+/// <returns>The number of keys.</returns>
+int Animation::keys() const
+{
+	return m_keys;
+}
+
+/// <summary>
+/// Reads a path file. Each line is a keyframe, "frame re im spacing iterations", with the centre in any
+/// number of digits. Blank lines and lines starting with # are skipped.
+/// </summary>
+/// <param name="t_path">The file.</param>
+/// <param name="t_keyframes">The keyframes read.</param>
+/// <returns>False if the file couldn't be read or a line is wrong.</returns>
+bool Animation::readPath(const std::string &t_path, std::vector<Keyframe> &t_keyframes)
+{
+	std::ifstream f_file(t_path);
+
+	if (!f_file)
+	{
+		return false;
+	}
+
+	std::string f_line;
+
+	while (std::getline(f_file, f_line))
+	{
+		std::istringstream f_fields(f_line);
+		Keyframe f_keyframe;
+
+		if (f_line.find_first_not_of(" \t\r") == std::string::npos || f_line[f_line.find_first_not_of(" \t\r")] == '#')
+		{
+			continue;
+		}
+
+		if (!(f_fields >> f_keyframe.m_frame >> f_keyframe.m_centreX >> f_keyframe.m_centreY >> f_keyframe.m_spacing >> f_keyframe.m_iterations))
+		{
+			return false;
+		}
+
+		t_keyframes.push_back(f_keyframe);
+	}
+
+	return !t_keyframes.empty();
+}
+
+/// <summary>
+/// Finds the run of frames the next key can serve: as many as fit inside one key at the finest spacing
+/// among them. Offsets are taken from the first frame, they are small enough to hold in double.
+/// </summary>
+/// <param name="t_first">The first frame of the run.</param>
+/// <param name="t_key">The key, its view and the frames it serves.</param>
+void Animation::nextKey(int t_first, Key &t_key) const
+{
+	const Frame &f_first = m_frames[t_first];
+	const double f_keyWidth = m_renderer.width();
+	const double f_keyHeight = m_renderer.height();
+
+	double f_spacing = f_first.m_spacing;
+	double f_left = -m_width / 2.0 * f_spacing;
+	double f_right = m_width / 2.0 * f_spacing;
+	double f_top = -m_height / 2.0 * f_spacing;
+	double f_bottom = m_height / 2.0 * f_spacing;
+	int f_last = t_first;
+
+	for (int i = t_first + 1; i < int(m_frames.size()); i++)
+	{
+		const Frame &f_frame = m_frames[i];
+		double f_dx = (f_frame.m_centreX - f_first.m_centreX).toDouble();
+		double f_dy = (f_frame.m_centreY - f_first.m_centreY).toDouble();
+		double f_nextSpacing = std::min(f_spacing, f_frame.m_spacing);
+		double f_nextLeft = std::min(f_left, f_dx - m_width / 2.0 * f_frame.m_spacing);
+		double f_nextRight = std::max(f_right, f_dx + m_width / 2.0 * f_frame.m_spacing);
+		double f_nextTop = std::min(f_top, f_dy - m_height / 2.0 * f_frame.m_spacing);
+		double f_nextBottom = std::max(f_bottom, f_dy + m_height / 2.0 * f_frame.m_spacing);
+
+		if (f_nextRight - f_nextLeft > f_keyWidth * f_nextSpacing || f_nextBottom - f_nextTop > f_keyHeight * f_nextSpacing)
+		{
+			break;
+		}
+
+		f_spacing = f_nextSpacing;
+		f_left = f_nextLeft;
+		f_right = f_nextRight;
+		f_top = f_nextTop;
+		f_bottom = f_nextBottom;
+		f_last = i;
+	}
+
+	t_key.m_centreX = f_first.m_centreX;
+	t_key.m_centreY = f_first.m_centreY;
+	t_key.m_centreX += (f_left + f_right) / 2.0;
+	t_key.m_centreY += (f_top + f_bottom) / 2.0;
+	t_key.m_spacing = f_spacing;
+	t_key.m_first = t_first;
+	t_key.m_last = f_last;
+}
+
+/// <summary>
+/// Resamples and writes the frames a key serves. Runs on the writer thread.
+/// </summary>
+/// <param name="t_key">The key, whose image is in m_key.</param>
+void Animation::writeFrames(const Key &t_key)
+{
+	for (int i = t_key.m_first; i <= t_key.m_last && m_written; i++)
+	{
+		resample(t_key, m_frames[i]);
+
+		if (m_format == VideoFormat::Y4m)
+		{
+			m_written = std::fputs("FRAME\n", m_output) >= 0;
+		}
+
+		m_written = m_written && std::fwrite(m_frame.data(), 1, m_frame.size(), m_output) == m_frame.size();
+	}
+}
+
+/// <summary>
+/// Makes a frame from the key image. Each frame pixel covers a square of the key at least one key pixel
+/// across, and takes the average of the key pixels under it weighted by how much of each it covers.
+/// The result is left in m_frame as RGB, or as Y, Cb and Cr planes (BT.601, studio range) for Y4M.
+/// Below the key's iteration cap, entries of the palette don't depend on the cap, so a key pixel keeps
+/// its colour unless it reached the frame's cap. It is then inside the set for the frame and takes the
+/// frame's interior colour, as a frame rendered on its own would.
+/// </summary>
+/// <param name="t_key">The key, whose image is in m_key.</param>
+/// <param name="t_frame">The frame.</param>
+void Animation::resample(const Key &t_key, const Frame &t_frame)
+{
+	const int f_keyWidth = m_renderer.width();
+	const int f_keyHeight = m_renderer.height();
+	const double f_ratio = t_frame.m_spacing / t_key.m_spacing;
+	const double f_footprint = std::max(f_ratio, 1.0);
+	const bool f_lowerCap = t_frame.m_iterations < t_key.m_iterations;
+	const uint32_t f_interior = m_keyPalette.colour(t_frame.m_iterations);
+
+	// The key pixels under each frame column and row, with their weights
+	struct Tap
+	{
+		int m_index;
+		float m_weight;
+	};
+
+	auto f_taps = [&](double t_offset, int t_count, int t_keySize, std::vector<std::vector<Tap>> &t_taps)
+	{
+		t_taps.assign(t_count, std::vector<Tap>());
+
+		for (int i = 0; i < t_count; i++)
+		{
+			double f_centre = t_offset + (i - t_count / 2.0) * f_ratio;
+			double f_from = f_centre - f_footprint / 2.0;
+			double f_to = f_centre + f_footprint / 2.0;
+
+			for (int k = std::max(0, int(std::floor(f_from + 0.5))); k <= std::min(t_keySize - 1, int(std::floor(f_to + 0.5))); k++)
+			{
+				double f_weight = std::min(f_to, k + 0.5) - std::max(f_from, k - 0.5);
+
+				if (f_weight > 0.0)
+				{
+					t_taps[i].push_back(Tap{ k, float(f_weight) });
+				}
+			}
+		}
+	};
+
+	std::vector<std::vector<Tap>> f_columns;
+	std::vector<std::vector<Tap>> f_rows;
+	f_taps((t_frame.m_centreX - t_key.m_centreX).toDouble() / t_key.m_spacing + f_keyWidth / 2.0, m_width, f_keyWidth, f_columns);
+	f_taps((t_frame.m_centreY - t_key.m_centreY).toDouble() / t_key.m_spacing + f_keyHeight / 2.0, m_height, f_keyHeight, f_rows);
+
+	const size_t f_plane = size_t(m_width) * size_t(m_height);
+
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			float f_red = 0.0f;
+			float f_green = 0.0f;
+			float f_blue = 0.0f;
+			float f_total = 0.0f;
+
+			for (const Tap &f_row : f_rows[y])
+			{
+				const uint32_t *f_source = m_key.data() + size_t(f_row.m_index) * f_keyWidth;
+				const int *f_counts = m_keyCounts.data() + size_t(f_row.m_index) * f_keyWidth;
+
+				for (const Tap &f_column : f_columns[x])
+				{
+					uint32_t f_pixel = f_lowerCap && f_counts[f_column.m_index] >= t_frame.m_iterations ? f_interior : f_source[f_column.m_index];
+					float f_weight = f_row.m_weight * f_column.m_weight;
+
+					f_red += f_weight * float(f_pixel & 0xFF);
+					f_green += f_weight * float((f_pixel >> 8) & 0xFF);
+					f_blue += f_weight * float((f_pixel >> 16) & 0xFF);
+					f_total += f_weight;
+				}
+			}
+
+			int f_r = f_total > 0.0f ? int(f_red / f_total + 0.5f) : 0;
+			int f_g = f_total > 0.0f ? int(f_green / f_total + 0.5f) : 0;
+			int f_b = f_total > 0.0f ? int(f_blue / f_total + 0.5f) : 0;
+			size_t f_index = size_t(y) * m_width + x;
+
+			if (m_format == VideoFormat::Rgb)
+			{
+				m_frame[f_index * 3] = uint8_t(f_r);
+				m_frame[f_index * 3 + 1] = uint8_t(f_g);
+				m_frame[f_index * 3 + 2] = uint8_t(f_b);
+			}
+			else
+			{
+				m_frame[f_index] = uint8_t(((66 * f_r + 129 * f_g + 25 * f_b + 128) >> 8) + 16);
+				m_frame[f_plane + f_index] = uint8_t(((-38 * f_r - 74 * f_g + 112 * f_b + 128) >> 8) + 128);
+				m_frame[2 * f_plane + f_index] = uint8_t(((112 * f_r - 94 * f_g - 18 * f_b + 128) >> 8) + 128);
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Waits for the frames of the last key to be written.
+/// </summary>
+void Animation::finishWriting()
+{
+	if (m_writer.joinable())
+	{
+		m_writer.join();
+	}
+}
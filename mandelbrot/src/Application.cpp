@@ -1,11 +1,11 @@
 #include "Application.h"
 
-std::atomic<int> Globals::WORKER_COMPLETE = 0;
-
 /// <summary>
 /// Application constructor.
 /// </summary>
-Application::Application() : m_window{ sf::VideoMode{ Globals::SCREEN_WIDTH, Globals::SCREEN_HEIGHT, 32 }, "Mandelbrot", sf::Style::Default }
+/// <param name="t_cacheDirectory">Where to spill tiles so later sessions can use them, or empty to keep them in memory only.</param>
+Application::Application(const std::string &t_cacheDirectory) : m_window{ sf::VideoMode{ Globals::SCREEN_WIDTH, Globals::SCREEN_HEIGHT, 32 }, "Mandelbrot", sf::Style::Default },
+	m_tileCache{ Globals::TILE_CACHE_MEMORY, t_cacheDirectory }
 {
 	// Load app font
 	m_font.loadFromMemory(Globals::DEFAULT_FONT, (size_t)75864 * sizeof(uint8_t));
@@ -13,11 +13,8 @@ Application::Application() : m_window{ sf::VideoMode{ Globals::SCREEN_WIDTH, Glo
 	// Set render texture size
 	m_renderTexture.create(Globals::SCREEN_WIDTH, Globals::SCREEN_HEIGHT);
 
-	// Align memory
-	m_fractal = (int*)_aligned_malloc(size_t(Globals::SCREEN_WIDTH) * size_t(Globals::SCREEN_HEIGHT) * sizeof(int), 64);
-
-	// Initialise the thread pool
-	threadPoolInit();
+	// Views that were rendered before come from the cache, and from earlier sessions too when it spills to disk
+	m_renderer.m_cache = &m_tileCache;
 }
 
 /// <summary>
@@ -25,21 +22,7 @@ Application::Application() : m_window{ sf::VideoMode{ Globals::SCREEN_WIDTH, Glo
 /// </summary>
 Application::~Application()
 {
-	// Stop worker threads
-	for (int i = 0; i < Globals::MAX_THREADS; i++)
-	{
-		m_workers[i].m_alive = false;
-		m_workers[i].m_cvStart.notify_one();
-	}
 
-	// Clean up worker threads
-	for (int i = 0; i < Globals::MAX_THREADS; i++)
-	{
-		m_workers[i].m_thread.join();
-	}		
-
-	// Clean up memory
-	_aligned_free(m_fractal);
 }
 
 /// <summary>
@@ -85,6 +68,80 @@ void Application::processEvents()
 			{
 				m_exitGame = true;
 			}
+
+			// R toggles the fixed-point kernel for renders that must match on every machine
+			if (sf::Keyboard::R == f_event.key.code)
+			{
+				m_reproducible = !m_reproducible;
+			}
+
+			// F toggles colouring inside the workers against colouring as a separate pass
+			if (sf::Keyboard::F == f_event.key.code)
+			{
+				m_renderer.m_fuseColour = !m_renderer.m_fuseColour;
+				m_recompute = true;
+			}
+
+			// S steps through no smooth channel, a float32 channel and a float16 channel
+			if (sf::Keyboard::S == f_event.key.code)
+			{
+				m_renderer.m_smoothFormat = m_renderer.m_smoothFormat == SmoothFormat::None ? SmoothFormat::Float32 : m_renderer.m_smoothFormat == SmoothFormat::Float32 ? SmoothFormat::Float16 : SmoothFormat::None;
+				m_recompute = true;
+			}
+
+			// D turns the distance estimate and boundary outline on or off
+			if (sf::Keyboard::D == f_event.key.code)
+			{
+				m_renderer.m_boundary = !m_renderer.m_boundary;
+				m_recompute = true;
+			}
+
+			// E turns antialiasing of the edges on or off
+			if (sf::Keyboard::E == f_event.key.code)
+			{
+				m_renderer.m_antialias = !m_renderer.m_antialias;
+				m_recompute = true;
+			}
+
+			// I turns the cardioid, bulb and periodicity checks on or off
+			if (sf::Keyboard::I == f_event.key.code)
+			{
+				m_renderer.m_interiorChecks = !m_renderer.m_interiorChecks;
+				m_recompute = true;
+			}
+
+			// M steps the power of z through 2, 3, 4 and 5
+			if (sf::Keyboard::M == f_event.key.code)
+			{
+				m_renderer.m_exponent = m_renderer.m_exponent == 5 ? 2 : m_renderer.m_exponent + 1;
+				m_recompute = true;
+			}
+
+			// J switches between the Mandelbrot set and the Julia set for the point under the mouse
+			if (sf::Keyboard::J == f_event.key.code)
+			{
+				toggleJulia(Vector2(sf::Mouse::getPosition(m_window)));
+			}
+
+			// T switches between drawing from world tiles and rendering the screen as one frame
+			if (sf::Keyboard::T == f_event.key.code)
+			{
+				m_tiles = !m_tiles;
+				m_recompute = true;
+			}
+
+			// C starts or stops cycling the palette
+			if (sf::Keyboard::C == f_event.key.code)
+			{
+				m_cyclePalette = !m_cyclePalette;
+			}
+
+			// G switches to the next gradient
+			if (sf::Keyboard::G == f_event.key.code)
+			{
+				m_gradient = (m_gradient + 1) % 3;
+				m_renderer.m_palette.setStops(m_gradient == 0 ? Palette::rainbowStops() : m_gradient == 1 ? Palette::fireStops() : Palette::greyStops());
+			}
 		}
 	}
 }
@@ -105,85 +162,154 @@ void Application::update()
 	}
 	else if (sf::Mouse::isButtonPressed(sf::Mouse::Right) && m_rightBtnClicked)
 	{
-		m_offset -= (f_mouse - m_startPan) / m_scale;
-		m_startPan = f_mouse;
+		if (f_mouse != m_startPan)
+		{
+			m_viewport.pan(f_mouse - m_startPan);
+			m_startPan = f_mouse;
+			m_recompute = true;
+		}
 	}
 	else if (!sf::Mouse::isButtonPressed(sf::Mouse::Right) && m_rightBtnClicked)
 	{
 		m_rightBtnClicked = false;
 	}
 
-	Vector2 f_mouseBeforeZoom;
-	screenToWorld(f_mouse, f_mouseBeforeZoom);
-
-	// Use Q and A to scale up or down
+	// Use Q and A to scale up or down, the point under the mouse stays put
 	if (sf::Keyboard::isKeyPressed(sf::Keyboard::Q))
 	{
-		m_scale *= 1.1f;
+		m_viewport.zoom(1.1, f_mouse);
+		m_recompute = true;
 	}
 
 	if (sf::Keyboard::isKeyPressed(sf::Keyboard::A))
 	{
-		m_scale *= 0.9f;
-	}	
-
-	Vector2 f_mouseAfterZoom;
-	screenToWorld(f_mouse, f_mouseAfterZoom);
-	m_offset += (f_mouseBeforeZoom - f_mouseAfterZoom);
+		m_viewport.zoom(0.9, f_mouse);
+		m_recompute = true;
+	}
 
-	Vector2 f_pixTL = { 0, 0 };
-	Vector2 f_pixBR = { Globals::SCREEN_WIDTH, Globals::SCREEN_HEIGHT };
-	Vector2 f_fracTL = { -2.0, -1.0 };
-	Vector2 f_fracBR = { 1.0, 1.0 };
+	// The renderer picks the kernel from the pixel spacing
+	double f_spacing = m_viewport.pixelSpacing();
+	Kernel f_kernel = m_renderer.m_kernel;
+	m_renderer.m_kernel = Renderer::chooseKernel(f_spacing, m_renderer.m_exponent, m_renderer.m_julia, m_reproducible);
 
-	screenToWorld(f_pixTL, f_fracTL);
-	screenToWorld(f_pixBR, f_fracBR);
+	if (m_renderer.m_kernel != f_kernel)
+	{
+		m_recompute = true;
+	}
 
 	// Adjust iteration amount
 	if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up))
 	{
-		m_iterations += 64;
+		m_renderer.m_iterations += 64;
+		m_recompute = true;
 	}
-	else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down))
+	else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down) && m_renderer.m_iterations > 64)
 	{
-		m_iterations -= 64;
+		m_renderer.m_iterations -= 64;
+		m_recompute = true;
 	}
 
-	if (m_iterations < 64)
+	if (m_renderer.m_iterations < 64)
 	{
-		m_iterations = 64;
+		m_renderer.m_iterations = 64;
 	}
 
-	// Start timing
-	auto f_start = std::chrono::high_resolution_clock::now();
+	// In Julia mode the left button drags the parameter, which is read off the Mandelbrot view the
+	// Julia set was opened from. While it moves only a coarse preview is drawn, then the full
+	// render follows once the button is let go.
+	bool f_preview = false;
 
-	// Do the computation
-	createFractal(f_pixTL, f_pixBR, f_fracTL, f_fracBR, m_iterations);
+	if (m_renderer.m_julia && sf::Mouse::isButtonPressed(sf::Mouse::Left))
+	{
+		Vector2 f_juliaC;
+		Vector2 f_juliaCLow;
+		m_mandelbrotViewport.screenToWorld(f_mouse, f_juliaC, f_juliaCLow);
 
-	// Stop timing
-	auto f_stop = std::chrono::high_resolution_clock::now();
-	std::chrono::duration<double> elapsedTime = f_stop - f_start;
+		if (f_juliaC != m_renderer.m_juliaC)
+		{
+			m_renderer.m_juliaC = f_juliaC;
+			f_preview = true;
+		}
+	}
+	else if (m_previewing)
+	{
+		m_previewing = false;
+		m_recompute = true;
+	}
+
+	// Palette changes only need the colours redone, never the iterations
+	if (m_cyclePalette)
+	{
+		m_renderer.m_palette.setOffset(m_renderer.m_palette.offset() + Globals::PALETTE_CYCLE_SPEED);
+	}
 
-	// Render result to screen
-	for (int y = 0; y < Globals::SCREEN_HEIGHT; y++)
+	if (sf::Keyboard::isKeyPressed(sf::Keyboard::RBracket))
 	{
-		for (int x = 0; x < Globals::SCREEN_WIDTH; x++)
+		m_renderer.m_palette.setScale(m_renderer.m_palette.scale() * 1.05f);
+	}
+	else if (sf::Keyboard::isKeyPressed(sf::Keyboard::LBracket))
+	{
+		m_renderer.m_palette.setScale(m_renderer.m_palette.scale() / 1.05f);
+	}
+
+	// The palette has one entry per iteration count, so rebuild it when the count changes
+	bool f_recolour = m_renderer.m_palette.isDirty() || m_renderer.m_palette.size() != m_renderer.m_iterations + 1;
+
+	if (f_recolour)
+	{
+		m_renderer.buildPalette();
+	}
+
+	if (f_preview)
+	{
+		auto f_start = std::chrono::high_resolution_clock::now();
+
+		m_renderer.preview(m_viewport, Globals::JULIA_PREVIEW_STEP);
+		m_previewing = true;
+		m_recompute = false;
+
+		m_elapsedTime = std::chrono::high_resolution_clock::now() - f_start;
+		return;
+	}
+
+	if (!m_recompute && !m_tilesPending)
+	{
+		// The counts are the source of truth, so a new palette is a colouring pass over them
+		if (f_recolour)
 		{
-			int i = m_fractal[y * Globals::SCREEN_WIDTH + x];
-			float n = (float)i;
-			float a = 0.1f;
-
-			// Credit to @Eriksonn for this - it converts the fractal into a colour
-			// RBG values are normalised between 0 and 1 so I've multiplied them by 255
-			// so they work properly with SFML ~ AB
-			m_pixelGrid.setPixel(x, y, sf::Color(
-				(0.5f * sin(a * n) + 0.5f) * 255.0f,			// R
-				(0.5f * sin(a * n + 2.094f) + 0.5f) * 255.0f,	// G
-				(0.5f * sin(a * n + 4.188f) + 0.5f) * 255.0f)); // B
+			m_renderer.colour();
+
+			if (m_renderer.m_antialias)
+			{
+				m_renderer.antialias();
+			}
 		}
+
+		return;
+	}
+
+	// Start timing
+	auto f_start = std::chrono::high_resolution_clock::now();
+
+	// Compute, colour and antialias as the settings ask. Tiles that were placeholders are asked for
+	// again every frame until they are all exact.
+	if (m_tiles && m_quadtree.covers(m_viewport))
+	{
+		m_tilesPending = !m_quadtree.update(m_renderer, m_viewport, Globals::TILE_FRAME_SECONDS, m_reproducible);
+		m_renderer.present(m_viewport);
 	}
+	else
+	{
+		m_tilesPending = false;
+		m_renderer.render(m_viewport);
+	}
+
+	// Stop timing
+	auto f_stop = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsedTime = f_stop - f_start;
 
 	m_elapsedTime = elapsedTime;
+	m_recompute = false;
 }
 
 /// <summary>
@@ -237,8 +363,24 @@ void Application::drawString(int t_x, int t_y, std::string t_string, sf::Color t
 void Application::drawText()
 {
 	drawString(10, Globals::SCREEN_HEIGHT - 50, "TIME TAKEN: " + std::to_string(m_elapsedTime.count()) + "s", sf::Color::White);
-	drawString(10, Globals::SCREEN_HEIGHT - 30, "ITERATIONS: " + std::to_string(m_iterations), sf::Color::White);
-	drawString(Globals::SCREEN_WIDTH - 136, Globals::SCREEN_HEIGHT - 30, "MANDELBROT", sf::Color::White);
+	drawString(10, Globals::SCREEN_HEIGHT - 30, "ITERATIONS: " + std::to_string(m_renderer.m_iterations), sf::Color::White);
+	drawString(10, Globals::SCREEN_HEIGHT - 70, "KERNEL: " + m_renderer.kernelName(), sf::Color::White);
+	drawString(10, Globals::SCREEN_HEIGHT - 90, "ZOOM: 2^" + std::to_string(m_viewport.scaleExponent()), sf::Color::White);
+	drawString(10, Globals::SCREEN_HEIGHT - 110, std::string("COLOUR: ") + (m_renderer.m_fuseColour ? "FUSED" : "SEPARATE"), sf::Color::White);
+	drawString(10, Globals::SCREEN_HEIGHT - 130, std::string("SMOOTH: ") + (m_renderer.m_smoothFormat == SmoothFormat::None ? "OFF" : m_renderer.m_smoothFormat == SmoothFormat::Float32 ? "FLOAT32" : "FLOAT16"), sf::Color::White);
+	drawString(10, Globals::SCREEN_HEIGHT - 150, std::string("BOUNDARY: ") + (m_renderer.m_boundary ? "ON" : "OFF"), sf::Color::White);
+	drawString(10, Globals::SCREEN_HEIGHT - 170, std::string("ANTIALIAS: ") + (m_renderer.m_antialias ? std::to_string(Globals::ANTIALIAS_SAMPLES) + "x" + std::to_string(Globals::ANTIALIAS_SAMPLES) + " ON " + std::to_string(100 * m_renderer.antialiased() / (Globals::SCREEN_WIDTH * Globals::SCREEN_HEIGHT)) + "% OF PIXELS" : "OFF"), sf::Color::White);
+	uint64_t f_lookups = m_tileCache.hits() + m_tileCache.misses();
+	drawString(10, Globals::SCREEN_HEIGHT - 190, "CACHE: " + std::to_string(m_tileCache.hits()) + " HITS (" + std::to_string(m_tileCache.diskHits()) + " FROM DISK) " + std::to_string(m_tileCache.misses()) + " MISSES "
+		+ std::to_string(f_lookups > 0 ? 100 * m_tileCache.hits() / f_lookups : 0) + "%" + (m_renderer.cached() ? " - HIT" : ""), sf::Color::White);
+	drawString(10, Globals::SCREEN_HEIGHT - 210, "TILES: " + (!m_tiles ? std::string("OFF") : !m_quadtree.covers(m_viewport) ? std::string("SCREEN") : "LEVEL " + std::to_string(m_quadtree.level()) + " - "
+		+ std::to_string(m_quadtree.exact()) + " EXACT " + std::to_string(m_quadtree.placeholders()) + " PLACEHOLDERS"), sf::Color::White);
+	if (m_renderer.m_julia)
+	{
+		drawString(10, Globals::SCREEN_HEIGHT - 230, "JULIA C: " + std::to_string(m_renderer.m_juliaC.x) + (m_renderer.m_juliaC.y < 0.0 ? " - " : " + ") + std::to_string(std::abs(m_renderer.m_juliaC.y)) + "i" + (m_previewing ? " (PREVIEW)" : ""), sf::Color::White);
+	}
+
+	drawString(Globals::SCREEN_WIDTH - 136, Globals::SCREEN_HEIGHT - 30, m_renderer.m_julia ? "JULIA" : "MANDELBROT", sf::Color::White);
 }
 
 /// <summary>
@@ -248,8 +390,10 @@ void Application::drawText()
 /// <param name="t_screen">Screen coordinates.</param>
 void Application::worldToScreen(const Vector2 &t_world, Vector2 &t_screen)
 {
-	t_screen.x = (int)((t_world.x - m_offset.x) * m_scale.x);
-	t_screen.y = (int)((t_world.y - m_offset.y) * m_scale.y);
+	HighPrecision f_worldX(t_world.x, m_viewport.precisionLimbs());
+	HighPrecision f_worldY(t_world.y, m_viewport.precisionLimbs());
+
+	m_viewport.worldToScreen(f_worldX, f_worldY, t_screen);
 }
 
 /// <summary>
@@ -259,52 +403,47 @@ void Application::worldToScreen(const Vector2 &t_world, Vector2 &t_screen)
 /// <param name="t_world">World coordinates.</param>
 void Application::screenToWorld(const Vector2 &t_screen, Vector2 &t_world)
 {
-	t_world.x = (double)(t_screen.x) / m_scale.x + m_offset.x;
-	t_world.y = (double)(t_screen.y) / m_scale.y + m_offset.y;
+	HighPrecision f_worldX;
+	HighPrecision f_worldY;
+
+	m_viewport.screenToWorld(t_screen, f_worldX, f_worldY);
+	t_world = Vector2(f_worldX.toDouble(), f_worldY.toDouble());
 }
 
 /// <summary>
-/// Create fractal using multi-threading (thread pooling).
+/// Converts screen coordinates to world coordinates as double-double hi and lo parts.
 /// </summary>
-/// <param name="t_pixTL">Pixel top left coordinate.</param>
-/// <param name="t_pixBR">Pixel top right coordinate.</param>
-/// <param name="t_fracTL">Fractal top left coordinate.</param>
-/// <param name="t_fracBR">Fractal top right coordinate.</param>
-/// <param name="t_iterations">The number of iterations.</param>
-void Application::createFractal(const Vector2 &t_pixTL, const Vector2 &t_pixBR, const Vector2 &t_fracTL, const Vector2 &t_fracBR, const int t_iterations)
+/// <param name="t_screen">Screen coordinates.</param>
+/// <param name="t_world">World coordinates (hi part).</param>
+/// <param name="t_worldLow">World coordinates (lo part).</param>
+void Application::screenToWorld(const Vector2 &t_screen, Vector2 &t_world, Vector2 &t_worldLow)
 {
-	int f_sectionWidth = (t_pixBR.x - t_pixTL.x) / Globals::MAX_THREADS;
-	double f_fractalWidth = (t_fracBR.x - t_fracTL.x) / double(Globals::MAX_THREADS);
-
-	Globals::WORKER_COMPLETE = 0;
-
-	for (size_t i = 0; i < Globals::MAX_THREADS; i++)
-	{
-		m_workers[i].start(
-			Vector2(t_pixTL.x + f_sectionWidth * i, t_pixTL.y),
-			Vector2(t_pixTL.x + f_sectionWidth * (i + 1), t_pixBR.y),
-			Vector2(t_fracTL.x + f_fractalWidth * double(i), t_fracTL.y),
-			Vector2(t_fracTL.x + f_fractalWidth * double(i + 1), t_fracBR.y),
-			t_iterations);
-	}
-
-	// Wait for all workers to complete
-	while (Globals::WORKER_COMPLETE < Globals::MAX_THREADS)
-	{
-		// Blip, bloop, bleep!
-	}
+	m_viewport.screenToWorld(t_screen, t_world, t_worldLow);
 }
 
 /// <summary>
-/// Initialise the thread pool.
+/// Switches between the Mandelbrot set and a Julia set. The Julia parameter is the point under the
+/// mouse, and the Mandelbrot view is kept so it can be returned to and used to drag the parameter.
 /// </summary>
-void Application::threadPoolInit()
+/// <param name="t_mouse">The mouse position.</param>
+void Application::toggleJulia(const Vector2 &t_mouse)
 {
-	for (int i = 0; i < Globals::MAX_THREADS; i++)
+	if (m_renderer.m_julia)
+	{
+		m_viewport = m_mandelbrotViewport;
+	}
+	else
 	{
-		m_workers[i].m_alive = true;
-		m_workers[i].m_fractal = m_fractal;
-		m_workers[i].m_screenWidth = Globals::SCREEN_WIDTH;
-		m_workers[i].m_thread = std::thread(&WorkerThread::createFractal, &m_workers[i]);
+		Vector2 f_juliaCLow;
+		screenToWorld(t_mouse, m_renderer.m_juliaC, f_juliaCLow);
+
+		// Julia sets sit within |z| < 2, so start centred on the origin with all of that in view
+		m_mandelbrotViewport = m_viewport;
+		m_viewport = Viewport(Globals::SCREEN_WIDTH, Globals::SCREEN_HEIGHT);
+		m_viewport.setScale(Globals::SCREEN_HEIGHT / 3.0);
+		m_viewport.setCentre(HighPrecision(0.0, m_viewport.precisionLimbs()), HighPrecision(0.0, m_viewport.precisionLimbs()));
 	}
-}
\ No newline at end of file
+
+	m_renderer.m_julia = !m_renderer.m_julia;
+	m_recompute = true;
+}
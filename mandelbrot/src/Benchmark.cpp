@@ -0,0 +1,687 @@
+#include "Benchmark.h"
+#include "Perturbation.h"
+#include "Palette.h"
+#include "KernelFamily.h"
+#include "Renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+/// <summary>
+/// Runs every benchmark.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+void Benchmark::run(std::ostream &t_out)
+{
+	widths(t_out);
+	kernels(t_out);
+	kernelFamily(t_out);
+	multibrot(t_out);
+	julia(t_out);
+	colouring(t_out);
+	antialiasing(t_out);
+	perturbation(t_out);
+}
+
+/// <summary>
+/// Measures the throughput of each kernel on a single thread.
+/// The float kernel is checked against double, and the fixed-point kernel against double-double,
+/// which they should match away from the boundary.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+void Benchmark::kernels(std::ostream &t_out)
+{
+	const Kernel f_kernels[] = { Kernel::Double, Kernel::Float, Kernel::DoubleDouble, Kernel::Fixed128 };
+
+	std::vector<int> f_fractal(size_t(WIDTH) * size_t(HEIGHT));
+	std::vector<int> f_double(size_t(WIDTH) * size_t(HEIGHT));
+	std::vector<int> f_reference(size_t(WIDTH) * size_t(HEIGHT));
+
+	t_out << "KERNEL THROUGHPUT (" << WIDTH << "x" << HEIGHT << ", 1 thread)" << std::endl;
+
+	for (const BenchmarkLocation &f_location : kernelLocations())
+	{
+		for (const Kernel f_kernel : f_kernels)
+		{
+			double f_time = renderKernel(f_kernel, f_location, f_fractal);
+
+			double f_iterations = 0.0;
+
+			for (int f_n : f_fractal)
+			{
+				f_iterations += f_n;
+			}
+
+			t_out << f_location.m_name << " " << WorkerThread::kernelName(f_kernel)
+				<< ": " << f_time << "s"
+				<< ", " << (WIDTH * HEIGHT) / f_time / 1.0e6 << " Mpixel/s"
+				<< ", " << f_iterations / f_time / 1.0e6 << " Miter/s";
+
+			if (f_kernel == Kernel::Double)
+			{
+				f_double = f_fractal;
+			}
+			else if (f_kernel == Kernel::Float)
+			{
+				t_out << ", differing pixels vs DOUBLE " << countDifferences(f_double, f_fractal);
+			}
+			else if (f_kernel == Kernel::DoubleDouble)
+			{
+				f_reference = f_fractal;
+			}
+			else if (f_kernel == Kernel::Fixed128)
+			{
+				t_out << ", differing pixels vs DOUBLE-DOUBLE " << countDifferences(f_reference, f_fractal);
+			}
+
+			t_out << std::endl;
+		}
+	}
+}
+
+/// <summary>
+/// Times every registered z^2 kernel without outputs, and with the interior checks, against
+/// the hand-written double kernel. Float kernels are skipped where float can't resolve the pixels.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+void Benchmark::kernelFamily(std::ostream &t_out)
+{
+	std::vector<int> f_fractal(size_t(WIDTH) * size_t(HEIGHT));
+	std::vector<int> f_reference(size_t(WIDTH) * size_t(HEIGHT));
+
+	t_out << "KERNEL FAMILY (" << WIDTH << "x" << HEIGHT << ", 1 thread)" << std::endl;
+
+	for (const BenchmarkLocation &f_location : kernelLocations())
+	{
+		renderEntry(*WorkerThread::findKernel(Kernel::Double, 2, 0, 0), f_location, f_reference);
+
+		for (const KernelEntry &f_entry : WorkerThread::kernelRegistry())
+		{
+			bool f_plain = f_entry.m_features == 0 || f_entry.m_features == (KERNEL_PERIOD | KERNEL_BULB_CHECK);
+
+			if (!f_plain || f_entry.m_exponent != 2 || (f_entry.m_kernel == Kernel::Float && f_location.m_spacing < Globals::FLOAT_SPACING_LIMIT))
+			{
+				continue;
+			}
+
+			double f_time = renderEntry(f_entry, f_location, f_fractal);
+
+			t_out << f_location.m_name << " " << WorkerThread::entryName(f_entry) << ": " << f_time << "s"
+				<< ", differing pixels vs DOUBLE TUNED " << countDifferences(f_reference, f_fractal) << std::endl;
+		}
+	}
+}
+
+/// <summary>
+/// Measures the float and double kernels for each power of z over the whole set.
+/// The rate is in iterations per second so exponents with larger interiors can be compared.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+void Benchmark::multibrot(std::ostream &t_out)
+{
+	const BenchmarkLocation f_location = { "multibrot", "0.0", "0.0", 3.0 / WIDTH, 1024 };
+	const Kernel f_kernels[] = { Kernel::Float, Kernel::Double };
+
+	std::vector<int> f_fractal(size_t(WIDTH) * size_t(HEIGHT));
+
+	t_out << "MULTIBROT (" << WIDTH << "x" << HEIGHT << ", 1 thread, " << f_location.m_iterations << " iterations)" << std::endl;
+
+	for (int f_exponent = 2; f_exponent <= 5; f_exponent++)
+	{
+		for (const Kernel f_kernel : f_kernels)
+		{
+			const KernelEntry *f_entry = WorkerThread::findKernel(f_kernel, f_exponent, 0, 0);
+			double f_time = renderEntry(*f_entry, f_location, f_fractal);
+
+			double f_iterations = 0.0;
+
+			for (int f_count : f_fractal)
+			{
+				f_iterations += f_count;
+			}
+
+			t_out << WorkerThread::entryName(*f_entry) << ": " << f_time << "s"
+				<< ", " << f_iterations / f_time / 1.0e6 << " M iterations/s" << std::endl;
+		}
+	}
+}
+
+/// <summary>
+/// Times a Julia set at the viewer's full size and as the coarse preview drawn while the parameter is
+/// dragged, on one thread, with the frame rate that would give spread over every hardware thread.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+void Benchmark::julia(std::ostream &t_out)
+{
+	const int f_width = Globals::SCREEN_WIDTH;
+	const int f_height = Globals::SCREEN_HEIGHT;
+	const int f_steps[] = { 1, Globals::JULIA_PREVIEW_STEP };
+	const double f_spacing = 3.0 / f_height;
+	const int f_iterations = 1024;
+	const unsigned f_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<int> f_fractal(size_t(f_width) * size_t(f_height));
+
+	t_out << "JULIA (" << f_width << "x" << f_height << ", 1 thread, c = -0.8 + 0.156i, " << f_iterations << " iterations)" << std::endl;
+
+	for (const int f_step : f_steps)
+	{
+		int f_stepWidth = f_width / f_step;
+		int f_stepHeight = f_height / f_step;
+
+		WorkerThread f_worker;
+		f_worker.m_fractal = f_fractal.data();
+		f_worker.m_screenWidth = f_stepWidth;
+		f_worker.m_julia = true;
+		f_worker.m_juliaC = Vector2(-0.8, 0.156);
+
+		Vector2 f_fracTL(-f_spacing * f_width / 2.0, -f_spacing * f_height / 2.0);
+		Vector2 f_fracBR(f_spacing * f_width / 2.0, f_spacing * f_height / 2.0);
+		f_worker.start(Vector2(0, 0), Vector2(f_stepWidth, f_stepHeight), f_fracTL, f_fracBR, Vector2(0, 0), Vector2(0, 0), f_iterations, Kernel::Float);
+
+		auto f_start = std::chrono::high_resolution_clock::now();
+		f_worker.compute();
+		std::chrono::duration<double> f_time = std::chrono::high_resolution_clock::now() - f_start;
+
+		t_out << (f_step == 1 ? "full" : "preview " + std::to_string(f_step) + "x" + std::to_string(f_step))
+			<< " " << WorkerThread::entryName(*f_worker.m_entry) << ": " << f_time.count() << "s"
+			<< ", about " << f_threads / f_time.count() << " fps on " << f_threads << " threads" << std::endl;
+	}
+}
+
+/// <summary>
+/// Compares colouring as a separate pass over the count buffer with colouring fused into the kernel,
+/// then times the fused path with the smooth channel in each format and with the distance channel.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+void Benchmark::colouring(std::ostream &t_out)
+{
+	const BenchmarkLocation f_location = kernelLocations().front();
+
+	std::vector<int> f_fractal(size_t(WIDTH) * size_t(HEIGHT));
+	std::vector<uint32_t> f_separate(size_t(WIDTH) * size_t(HEIGHT));
+	std::vector<uint32_t> f_fused(size_t(WIDTH) * size_t(HEIGHT));
+
+	Palette f_palette;
+	f_palette.build(f_location.m_iterations);
+
+	Viewport f_viewport = locationViewport(f_location);
+	Vector2 f_fracTL;
+	Vector2 f_fracBR;
+	Vector2 f_fracTLLow;
+	Vector2 f_fracBRLow;
+
+	f_viewport.screenToWorld(Vector2(0, 0), f_fracTL, f_fracTLLow);
+	f_viewport.screenToWorld(Vector2(WIDTH, HEIGHT), f_fracBR, f_fracBRLow);
+
+	WorkerThread f_worker;
+	f_worker.m_fractal = f_fractal.data();
+	f_worker.m_palette = &f_palette;
+	f_worker.m_screenWidth = WIDTH;
+	f_worker.start(Vector2(0, 0), Vector2(WIDTH, HEIGHT), f_fracTL, f_fracBR, f_fracTLLow, f_fracBRLow, f_location.m_iterations, Kernel::Double);
+
+	auto f_start = std::chrono::high_resolution_clock::now();
+	f_worker.m_pixels = f_separate.data();
+	f_worker.compute();
+	f_worker.colour();
+	std::chrono::duration<double> f_separateTime = std::chrono::high_resolution_clock::now() - f_start;
+
+	f_start = std::chrono::high_resolution_clock::now();
+	f_worker.m_pixels = f_fused.data();
+	f_worker.m_fuseColour = true;
+	f_worker.m_keepCounts = false;
+	f_worker.compute();
+	std::chrono::duration<double> f_fusedTime = std::chrono::high_resolution_clock::now() - f_start;
+
+	t_out << "COLOURING (" << WIDTH << "x" << HEIGHT << ", 1 thread, " << f_location.m_name << ")" << std::endl;
+	t_out << "separate pass " << f_separateTime.count() << "s"
+		<< ", fused " << f_fusedTime.count() << "s"
+		<< ", identical " << (f_separate == f_fused ? "yes" : "no") << std::endl;
+
+	// The smooth channel costs a larger bailout, a blend per iteration and a log per pixel
+	std::vector<float> f_smooth(size_t(WIDTH) * size_t(HEIGHT));
+	const SmoothFormat f_formats[] = { SmoothFormat::Float32, SmoothFormat::Float16 };
+
+	f_worker.m_smooth = f_smooth.data();
+
+	for (const SmoothFormat f_format : f_formats)
+	{
+		f_worker.m_smoothFormat = f_format;
+
+		f_start = std::chrono::high_resolution_clock::now();
+		f_worker.compute();
+		std::chrono::duration<double> f_smoothTime = std::chrono::high_resolution_clock::now() - f_start;
+
+		t_out << "smooth " << (f_format == SmoothFormat::Float32 ? "float32" : "float16")
+			<< ": fused " << f_smoothTime.count() << "s"
+			<< ", " << (f_format == SmoothFormat::Float32 ? sizeof(float) : sizeof(uint16_t)) * WIDTH * HEIGHT / 1024 << " KB channel" << std::endl;
+	}
+
+	// The distance channel adds the derivative, two more registers of complex multiply per iteration
+	std::vector<float> f_distance(size_t(WIDTH) * size_t(HEIGHT));
+
+	f_worker.m_smoothFormat = SmoothFormat::None;
+	f_worker.m_distance = f_distance.data();
+
+	f_start = std::chrono::high_resolution_clock::now();
+	f_worker.compute();
+	std::chrono::duration<double> f_distanceTime = std::chrono::high_resolution_clock::now() - f_start;
+
+	t_out << "distance: fused " << f_distanceTime.count() << "s" << std::endl;
+}
+
+/// <summary>
+/// Compares antialiasing only the edge pixels with supersampling every pixel, in time and in how far
+/// the adaptive result is from the full one. A threshold below zero makes every pixel an edge.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+void Benchmark::antialiasing(std::ostream &t_out)
+{
+	std::vector<int> f_fractal(size_t(WIDTH) * size_t(HEIGHT));
+	std::vector<uint32_t> f_adaptive(size_t(WIDTH) * size_t(HEIGHT));
+	std::vector<uint32_t> f_full(size_t(WIDTH) * size_t(HEIGHT));
+
+	t_out << "ANTIALIASING (" << WIDTH << "x" << HEIGHT << ", 1 thread, " << Globals::ANTIALIAS_SAMPLES << "x" << Globals::ANTIALIAS_SAMPLES << " samples)" << std::endl;
+
+	for (const BenchmarkLocation &f_location : kernelLocations())
+	{
+		Palette f_palette;
+		f_palette.build(f_location.m_iterations);
+
+		Viewport f_viewport = locationViewport(f_location);
+		Vector2 f_fracTL;
+		Vector2 f_fracBR;
+		Vector2 f_fracTLLow;
+		Vector2 f_fracBRLow;
+
+		f_viewport.screenToWorld(Vector2(0, 0), f_fracTL, f_fracTLLow);
+		f_viewport.screenToWorld(Vector2(WIDTH, HEIGHT), f_fracBR, f_fracBRLow);
+
+		WorkerThread f_worker;
+		f_worker.m_fractal = f_fractal.data();
+		f_worker.m_palette = &f_palette;
+		f_worker.m_screenWidth = WIDTH;
+		f_worker.m_fuseColour = true;
+		f_worker.start(Vector2(0, 0), Vector2(WIDTH, HEIGHT), f_fracTL, f_fracBR, f_fracTLLow, f_fracBRLow, f_location.m_iterations, Kernel::Double);
+
+		auto f_start = std::chrono::high_resolution_clock::now();
+		f_worker.m_pixels = f_adaptive.data();
+		f_worker.compute();
+		std::chrono::duration<double> f_renderTime = std::chrono::high_resolution_clock::now() - f_start;
+
+		f_start = std::chrono::high_resolution_clock::now();
+		f_worker.antialias();
+		std::chrono::duration<double> f_adaptiveTime = std::chrono::high_resolution_clock::now() - f_start;
+		int f_edges = f_worker.m_antialiased;
+
+		f_worker.m_pixels = f_full.data();
+		f_worker.m_antialiasThreshold = -1.0f;
+		f_worker.compute();
+
+		f_start = std::chrono::high_resolution_clock::now();
+		f_worker.antialias();
+		std::chrono::duration<double> f_fullTime = std::chrono::high_resolution_clock::now() - f_start;
+
+		// Per channel difference between the two results
+		double f_total = 0.0;
+		int f_worst = 0;
+
+		for (size_t i = 0; i < f_full.size(); i++)
+		{
+			for (int f_shift = 0; f_shift < 24; f_shift += 8)
+			{
+				int f_difference = std::abs(int((f_adaptive[i] >> f_shift) & 0xFF) - int((f_full[i] >> f_shift) & 0xFF));
+				f_total += f_difference;
+				f_worst = std::max(f_worst, f_difference);
+			}
+		}
+
+		t_out << f_location.m_name << ": render " << f_renderTime.count() << "s"
+			<< ", edges " << f_adaptiveTime.count() << "s (" << 100.0 * f_edges / (WIDTH * HEIGHT) << "% of pixels)"
+			<< ", every pixel " << f_fullTime.count() << "s"
+			<< ", mean difference " << f_total / (3.0 * f_full.size()) << ", worst " << f_worst << std::endl;
+	}
+}
+
+/// <summary>
+/// Compares plain perturbation with bilinear approximation on the deep zoom locations.
+/// Both renders share the same reference orbit, so the BLA build time is reported separately.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+void Benchmark::perturbation(std::ostream &t_out)
+{
+	const size_t f_memoryBudget = size_t(64) * 1024 * 1024;
+
+	std::vector<int> f_plain(size_t(WIDTH) * size_t(HEIGHT));
+	std::vector<int> f_bla(size_t(WIDTH) * size_t(HEIGHT));
+
+	t_out << "PERTURBATION vs BLA (" << WIDTH << "x" << HEIGHT << ")" << std::endl;
+
+	for (const BenchmarkLocation &f_location : deepLocations())
+	{
+		Viewport f_viewport = locationViewport(f_location);
+
+		Perturbation f_perturbation;
+		f_perturbation.setReference(f_viewport.centreX(), f_viewport.centreY(), f_location.m_iterations);
+		f_perturbation.m_referencePixel = Vector2(WIDTH / 2, HEIGHT / 2);
+		f_perturbation.m_spacing = f_location.m_spacing;
+
+		auto f_start = std::chrono::high_resolution_clock::now();
+		f_perturbation.m_useBla = false;
+		f_perturbation.render(f_plain.data(), Vector2(0, 0), Vector2(WIDTH, HEIGHT), WIDTH);
+		std::chrono::duration<double> f_plainTime = std::chrono::high_resolution_clock::now() - f_start;
+
+		f_start = std::chrono::high_resolution_clock::now();
+		f_perturbation.buildBla(f_location.m_spacing * WIDTH, f_memoryBudget);
+		std::chrono::duration<double> f_buildTime = std::chrono::high_resolution_clock::now() - f_start;
+
+		f_start = std::chrono::high_resolution_clock::now();
+		f_perturbation.m_useBla = true;
+		f_perturbation.render(f_bla.data(), Vector2(0, 0), Vector2(WIDTH, HEIGHT), WIDTH);
+		std::chrono::duration<double> f_blaTime = std::chrono::high_resolution_clock::now() - f_start;
+
+		t_out << f_location.m_name
+			<< ": plain " << f_plainTime.count() << "s"
+			<< ", bla " << f_blaTime.count() << "s"
+			<< " + build " << f_buildTime.count() << "s"
+			<< " (" << f_perturbation.m_bla.levelCount() << " levels from " << f_perturbation.m_bla.minLevel()
+			<< ", " << f_perturbation.m_bla.memoryUsed() / 1024 << " KB)"
+			<< ", speedup " << f_plainTime.count() / (f_blaTime.count() + f_buildTime.count())
+			<< ", differing pixels " << countDifferences(f_plain, f_bla) << std::endl;
+	}
+}
+
+/// <summary>
+/// Renders a strip whose width isn't a multiple of the vector width or of 4 * Globals::MAX_THREADS with
+/// every kernel, and checks that nothing is written past the edge of a section. The strip is rendered on
+/// one thread into rows with guard pixels after them, which have to come out untouched, and then by the
+/// worker pool, whose narrow sections have to match it but for the odd pixel on the boundary.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+/// <returns>False if a kernel wrote past the strip or left a pixel unwritten.</returns>
+bool Benchmark::widths(std::ostream &t_out)
+{
+	const int f_width = 1002;
+	const int f_height = 8;
+	const int f_guard = 8;
+	const int f_stride = f_width + f_guard;
+	const Kernel f_kernels[] = { Kernel::Float, Kernel::Double, Kernel::DoubleDouble, Kernel::Fixed128, Kernel::Perturbation };
+	const BenchmarkLocation f_location = kernelLocations()[1];
+
+	Viewport f_viewport(f_width, f_height);
+	f_viewport.setScale(1.0 / f_location.m_spacing);
+	f_viewport.setCentre(
+		HighPrecision::fromString(f_location.m_cr, f_viewport.precisionLimbs()),
+		HighPrecision::fromString(f_location.m_ci, f_viewport.precisionLimbs()));
+
+	Vector2 f_fracTL;
+	Vector2 f_fracBR;
+	Vector2 f_fracTLLow;
+	Vector2 f_fracBRLow;
+
+	f_viewport.screenToWorld(Vector2(0, 0), f_fracTL, f_fracTLLow);
+	f_viewport.screenToWorld(Vector2(f_width, f_height), f_fracBR, f_fracBRLow);
+
+	Perturbation f_perturbation;
+	f_perturbation.setReference(f_viewport.centreX(), f_viewport.centreY(), f_location.m_iterations);
+	f_perturbation.m_referencePixel = Vector2(f_width / 2, f_height / 2);
+	f_perturbation.m_spacing = f_location.m_spacing;
+
+	Renderer f_renderer(f_width, f_height);
+	f_renderer.m_iterations = f_location.m_iterations;
+
+	std::vector<int> f_counts(size_t(f_stride) * f_height);
+	bool f_passed = true;
+
+	t_out << "ODD WIDTHS (" << f_width << "x" << f_height << ", " << f_guard << " guard pixels a row)" << std::endl;
+
+	for (const Kernel f_kernel : f_kernels)
+	{
+		std::fill(f_counts.begin(), f_counts.end(), -1);
+
+		if (f_kernel == Kernel::Perturbation)
+		{
+			f_perturbation.render(f_counts.data(), Vector2(0, 0), Vector2(f_width, f_height), f_stride);
+		}
+		else
+		{
+			WorkerThread f_worker;
+			f_worker.m_fractal = f_counts.data();
+			f_worker.m_screenWidth = f_stride;
+			f_worker.m_viewTL = f_fracTL;
+			f_worker.m_viewTLLow = f_fracTLLow;
+			f_worker.m_spacing = f_viewport.pixelSpacing();
+			f_worker.start(Vector2(0, 0), Vector2(f_width, f_height), f_fracTL, f_fracBR, f_fracTLLow, f_fracBRLow, f_location.m_iterations, f_kernel);
+			f_worker.compute();
+		}
+
+		f_renderer.m_kernel = f_kernel;
+		f_renderer.render(f_viewport);
+
+		int f_overrun = 0;
+		int f_unwritten = 0;
+		int f_differences = 0;
+
+		for (int f_y = 0; f_y < f_height; f_y++)
+		{
+			for (int f_x = 0; f_x < f_stride; f_x++)
+			{
+				int f_count = f_counts[size_t(f_y) * f_stride + f_x];
+
+				if (f_x >= f_width)
+				{
+					f_overrun += f_count != -1;
+				}
+				else
+				{
+					f_unwritten += f_count < 0;
+					f_differences += f_count != f_renderer.fractal()[size_t(f_y) * f_width + f_x];
+				}
+			}
+		}
+
+		bool f_ok = f_overrun == 0 && f_unwritten == 0 && f_differences * 100 < f_width * f_height;
+		f_passed = f_passed && f_ok;
+
+		t_out << WorkerThread::kernelName(f_kernel) << ": " << f_overrun << " guard pixels written, " << f_unwritten << " pixels unwritten, "
+			<< f_differences << " differ from the worker pool" << (f_ok ? "" : " FAILED") << std::endl;
+	}
+
+	return f_passed;
+}
+
+/// <summary>
+/// Renders shallow views that the kernel choice gives to the float kernel with float and with double,
+/// and checks they look the same. A pixel whose count differs by a few iterations gets about the same
+/// colour, so only counts further apart than FLOAT_COUNT_TOLERANCE are treated as visible. Float rounding
+/// still moves some orbits right on the boundary, about 0.5% of the pixels at Globals::FLOAT_SPACING_LIMIT,
+/// and no more than FLOAT_PIXEL_TOLERANCE of them may differ. Most views sit at the limit, so moving it
+/// three times deeper, where float starts to blur the boundary, fails the check.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+/// <returns>False if a view is rendered with another kernel or float differs visibly from double.</returns>
+bool Benchmark::floatViews(std::ostream &t_out)
+{
+	std::vector<int> f_float(size_t(WIDTH) * size_t(HEIGHT));
+	std::vector<int> f_double(size_t(WIDTH) * size_t(HEIGHT));
+	bool f_passed = true;
+
+	t_out << "FLOAT AGAINST DOUBLE (" << WIDTH << "x" << HEIGHT << ", counts more than " << FLOAT_COUNT_TOLERANCE << " apart, at most "
+		<< FLOAT_PIXEL_TOLERANCE * 100.0 << "% of pixels)" << std::endl;
+
+	for (const BenchmarkLocation &f_location : floatLocations())
+	{
+		Kernel f_chosen = Renderer::chooseKernel(f_location.m_spacing, 2, false, false);
+
+		renderKernel(Kernel::Float, f_location, f_float);
+		renderKernel(Kernel::Double, f_location, f_double);
+
+		int f_differing = 0;
+		int f_visible = 0;
+
+		for (size_t i = 0; i < f_float.size(); i++)
+		{
+			f_differing += f_float[i] != f_double[i];
+			f_visible += std::abs(f_float[i] - f_double[i]) > FLOAT_COUNT_TOLERANCE;
+		}
+
+		bool f_ok = f_chosen == Kernel::Float && f_visible <= FLOAT_PIXEL_TOLERANCE * f_float.size();
+		f_passed = f_passed && f_ok;
+
+		t_out << f_location.m_name << ": " << WorkerThread::kernelName(f_chosen) << ", " << f_differing << " pixels differ, " << f_visible
+			<< " visibly" << (f_ok ? "" : " FAILED") << std::endl;
+	}
+
+	return f_passed;
+}
+
+/// <summary>
+/// The fixed set of deep zoom locations.
+/// </summary>
+/// <returns>The locations.</returns>
+std::vector<BenchmarkLocation> Benchmark::deepLocations()
+{
+	return {
+		{ "seahorse valley 1e-12", "-0.743643887037151", "0.131825904205330", 1.0e-12, 8192 },
+		{ "mini brot 1e-11", "-1.7685736562992002", "0.0009638188185110", 1.0e-11, 8192 },
+		{ "cardioid edge 1e-20", "-0.7371475738978354602904119773824579245", "0.1306743014442230110938158994459972681", 1.0e-20, 8192 },
+		{ "cardioid edge 1e-32", "-0.7371475738978354602904119773824579245", "0.1306743014442230110938158994459972681", 1.0e-32, 16384 },
+		{ "cardioid edge 1e-48", "-0.7371475738978354602904119773824579245", "0.1306743014442230110938158994459972681", 1.0e-48, 16384 }
+	};
+}
+
+/// <summary>
+/// The fixed set of locations for kernel throughput, all within reach of double.
+/// </summary>
+/// <returns>The locations.</returns>
+std::vector<BenchmarkLocation> Benchmark::kernelLocations()
+{
+	return {
+		{ "full set", "-0.5", "0.0", 3.0 / WIDTH, 1024 },
+		{ "seahorse valley 1e-3", "-0.743643887037151", "0.131825904205330", 1.0e-3, 1024 },
+		{ "seahorse valley 1e-6", "-0.743643887037151", "0.131825904205330", 1.0e-6, 2048 },
+		{ "mini brot 1e-9", "-1.7685736562992002", "0.0009638188185110", 1.0e-9, 4096 }
+	};
+}
+
+/// <summary>
+/// Shallow views around the boundary, down to the spacing where the kernel choice leaves float.
+/// </summary>
+/// <returns>The locations.</returns>
+std::vector<BenchmarkLocation> Benchmark::floatLocations()
+{
+	const double f_limit = Globals::FLOAT_SPACING_LIMIT;
+
+	return {
+		{ "full set", "-0.5", "0.0", 3.0 / WIDTH, 1024 },
+		{ "seahorse valley", "-0.743643887037151", "0.131825904205330", f_limit, 1024 },
+		{ "elephant valley", "0.2925", "0.0149", f_limit, 1024 },
+		{ "needle", "-1.7590", "0.0", f_limit, 2048 },
+		{ "spiral", "-0.7615", "-0.0848", 2.0 * f_limit, 1024 }
+	};
+}
+
+/// <summary>
+/// Builds the viewport for a location, with the centre parsed at the precision its depth needs.
+/// </summary>
+/// <param name="t_location">The location.</param>
+/// <returns>The viewport.</returns>
+Viewport Benchmark::locationViewport(const BenchmarkLocation &t_location)
+{
+	Viewport f_viewport(WIDTH, HEIGHT);
+	f_viewport.setScale(1.0 / t_location.m_spacing);
+	f_viewport.setCentre(
+		HighPrecision::fromString(t_location.m_cr, f_viewport.precisionLimbs()),
+		HighPrecision::fromString(t_location.m_ci, f_viewport.precisionLimbs()));
+
+	return f_viewport;
+}
+
+/// <summary>
+/// Renders a location with one kernel on the calling thread.
+/// </summary>
+/// <param name="t_kernel">The kernel to use.</param>
+/// <param name="t_location">The location to render.</param>
+/// <param name="t_fractal">The output buffer, WIDTH x HEIGHT.</param>
+/// <returns>The time taken in seconds.</returns>
+double Benchmark::renderKernel(Kernel t_kernel, const BenchmarkLocation &t_location, std::vector<int> &t_fractal)
+{
+	Viewport f_viewport = locationViewport(t_location);
+	Vector2 f_fracTL;
+	Vector2 f_fracBR;
+	Vector2 f_fracTLLow;
+	Vector2 f_fracBRLow;
+
+	f_viewport.screenToWorld(Vector2(0, 0), f_fracTL, f_fracTLLow);
+	f_viewport.screenToWorld(Vector2(WIDTH, HEIGHT), f_fracBR, f_fracBRLow);
+
+	WorkerThread f_worker;
+	f_worker.m_fractal = t_fractal.data();
+	f_worker.m_screenWidth = WIDTH;
+	f_worker.m_viewTL = f_fracTL;
+	f_worker.m_viewTLLow = f_fracTLLow;
+	f_worker.m_spacing = f_viewport.pixelSpacing();
+	f_worker.start(Vector2(0, 0), Vector2(WIDTH, HEIGHT), f_fracTL, f_fracBR, f_fracTLLow, f_fracBRLow, t_location.m_iterations, t_kernel);
+
+	auto f_start = std::chrono::high_resolution_clock::now();
+	f_worker.compute();
+	std::chrono::duration<double> f_time = std::chrono::high_resolution_clock::now() - f_start;
+
+	return f_time.count();
+}
+
+/// <summary>
+/// Renders a location on the calling thread with one registered kernel.
+/// </summary>
+/// <param name="t_entry">The kernel.</param>
+/// <param name="t_location">The location.</param>
+/// <param name="t_fractal">The iteration counts, WIDTH * HEIGHT.</param>
+/// <returns>The time taken in seconds.</returns>
+double Benchmark::renderEntry(const KernelEntry &t_entry, const BenchmarkLocation &t_location, std::vector<int> &t_fractal)
+{
+	Viewport f_viewport = locationViewport(t_location);
+	Vector2 f_fracTL;
+	Vector2 f_fracBR;
+	Vector2 f_fracTLLow;
+	Vector2 f_fracBRLow;
+
+	f_viewport.screenToWorld(Vector2(0, 0), f_fracTL, f_fracTLLow);
+	f_viewport.screenToWorld(Vector2(WIDTH, HEIGHT), f_fracBR, f_fracBRLow);
+
+	WorkerThread f_worker;
+	f_worker.m_fractal = t_fractal.data();
+	f_worker.m_screenWidth = WIDTH;
+	f_worker.m_viewTL = f_fracTL;
+	f_worker.m_viewTLLow = f_fracTLLow;
+	f_worker.m_spacing = f_viewport.pixelSpacing();
+	f_worker.start(Vector2(0, 0), Vector2(WIDTH, HEIGHT), f_fracTL, f_fracBR, f_fracTLLow, f_fracBRLow, t_location.m_iterations, t_entry.m_kernel);
+
+	auto f_start = std::chrono::high_resolution_clock::now();
+	(f_worker.*t_entry.m_function)();
+	std::chrono::duration<double> f_time = std::chrono::high_resolution_clock::now() - f_start;
+
+	return f_time.count();
+}
+
+/// <summary>
+/// Counts the pixels that differ between two renders.
+/// </summary>
+/// <param name="t_a">The first render.</param>
+/// <param name="t_b">The second render.</param>
+/// <returns>The number of differing pixels.</returns>
+int Benchmark::countDifferences(const std::vector<int> &t_a, const std::vector<int> &t_b)
+{
+	int f_count = 0;
+
+	for (size_t i = 0; i < t_a.size() && i < t_b.size(); i++)
+	{
+		if (t_a[i] != t_b[i])
+		{
+			f_count++;
+		}
+	}
+
+	return f_count;
+}
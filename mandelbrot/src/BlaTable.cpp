@@ -0,0 +1,202 @@
+#include "BlaTable.h"
+
+#include <algorithm>
+
+/// <summary>
+/// BlaTable constructor.
+/// </summary>
+BlaTable::BlaTable()
+{
+
+}
+
+/// <summary>
+/// BlaTable destructor.
+/// </summary>
+BlaTable::~BlaTable()
+{
+
+}
+
+/// <summary>
+/// Builds the table from a reference orbit.
+/// A single step at iteration m is dz' = 2 * Z[m] * dz + dc, which stays valid while
+/// the dropped dz^2 term is negligible, i.e. |dz| < epsilon * |Z[m]|.
+/// </summary>
+/// <param name="t_orbit">The reference orbit, starting with Z[0] = 0.</param>
+/// <param name="t_maxDelta">The largest |dc| of any pixel that will use the table.</param>
+/// <param name="t_memoryBudget">The maximum number of bytes the table may use.</param>
+/// <param name="t_epsilon">The relative error allowed per approximation.</param>
+void BlaTable::build(const std::vector<std::complex<double>> &t_orbit, double t_maxDelta, size_t t_memoryBudget, double t_epsilon)
+{
+	clear();
+
+	// Steps start at iteration 1 and must end before the last orbit entry
+	int f_steps = int(t_orbit.size()) - 2;
+
+	if (f_steps < 1)
+	{
+		return;
+	}
+
+	// Find the lowest level that fits the memory budget (level k costs about steps / 2^k entries)
+	while ((size_t(f_steps) >> m_minLevel) > 0 && (size_t(f_steps) >> m_minLevel) * 2 * sizeof(BlaStep) > t_memoryBudget)
+	{
+		m_minLevel++;
+	}
+
+	int f_blockLength = 1 << m_minLevel;
+	int f_blocks = f_steps / f_blockLength;
+
+	if (f_blocks < 1)
+	{
+		return;
+	}
+
+	// Fold single steps into the lowest stored level
+	std::vector<BlaStep> f_level(f_blocks);
+
+	for (int j = 0; j < f_blocks; j++)
+	{
+		for (int i = 0; i < f_blockLength; i++)
+		{
+			const std::complex<double> &f_z = t_orbit[size_t(1) + size_t(j) * f_blockLength + i];
+
+			BlaStep f_single;
+			f_single.m_a = 2.0 * f_z;
+			f_single.m_b = 1.0;
+			f_single.m_radius = t_epsilon * std::abs(f_z);
+			f_single.m_length = 1;
+
+			f_level[j] = (i == 0) ? f_single : merge(f_level[j], f_single, t_maxDelta);
+		}
+	}
+
+	m_levels.push_back(std::move(f_level));
+
+	// Merge neighbouring pairs until a single step covers the orbit
+	while (m_levels.back().size() > 1)
+	{
+		const std::vector<BlaStep> &f_below = m_levels.back();
+		std::vector<BlaStep> f_above(f_below.size() / 2);
+
+		for (size_t j = 0; j < f_above.size(); j++)
+		{
+			f_above[j] = merge(f_below[j * 2], f_below[j * 2 + 1], t_maxDelta);
+		}
+
+		m_levels.push_back(std::move(f_above));
+	}
+}
+
+/// <summary>
+/// Removes all levels from the table.
+/// </summary>
+void BlaTable::clear()
+{
+	m_levels.clear();
+	m_minLevel = 0;
+}
+
+/// <summary>
+/// Finds the longest step that starts at the given iteration and is valid for the given delta.
+/// A merged step is never valid for a larger delta than its first half, so the search walks
+/// up from the lowest level and stops at the first step that is too small.
+/// </summary>
+/// <param name="t_iteration">The current index into the reference orbit.</param>
+/// <param name="t_deltaNorm">The squared magnitude of the current delta.</param>
+/// <returns>The step to apply, or nullptr if a plain perturbation iteration is required.</returns>
+const BlaStep *BlaTable::lookup(int t_iteration, double t_deltaNorm) const
+{
+	const BlaStep *f_best = nullptr;
+
+	if (t_iteration < 1)
+	{
+		return f_best;
+	}
+
+	int f_start = t_iteration - 1;
+
+	for (size_t i = 0; i < m_levels.size(); i++)
+	{
+		int f_level = m_minLevel + int(i);
+
+		if ((f_start & ((1 << f_level) - 1)) != 0)
+		{
+			break;
+		}
+
+		size_t f_index = size_t(f_start >> f_level);
+
+		if (f_index >= m_levels[i].size())
+		{
+			break;
+		}
+
+		const BlaStep &f_step = m_levels[i][f_index];
+
+		if (t_deltaNorm >= f_step.m_radius * f_step.m_radius)
+		{
+			break;
+		}
+
+		f_best = &f_step;
+	}
+
+	return f_best;
+}
+
+/// <summary>
+/// Gets the number of bytes used by the table.
+/// </summary>
+/// <returns>The memory used in bytes.</returns>
+size_t BlaTable::memoryUsed() const
+{
+	size_t f_total = 0;
+
+	for (const std::vector<BlaStep> &f_level : m_levels)
+	{
+		f_total += f_level.size() * sizeof(BlaStep);
+	}
+
+	return f_total;
+}
+
+/// <summary>
+/// Gets the number of stored levels.
+/// </summary>
+/// <returns>The number of levels.</returns>
+int BlaTable::levelCount() const
+{
+	return int(m_levels.size());
+}
+
+/// <summary>
+/// Gets the lowest stored level. Levels below this were dropped to fit the memory budget.
+/// </summary>
+/// <returns>The lowest level.</returns>
+int BlaTable::minLevel() const
+{
+	return m_minLevel;
+}
+
+/// <summary>
+/// Merges two consecutive steps, x followed by y, into one.
+/// </summary>
+/// <param name="t_x">The first step.</param>
+/// <param name="t_y">The second step.</param>
+/// <param name="t_maxDelta">The largest |dc| of any pixel that will use the table.</param>
+/// <returns>The merged step.</returns>
+BlaStep BlaTable::merge(const BlaStep &t_x, const BlaStep &t_y, double t_maxDelta)
+{
+	BlaStep f_step;
+	f_step.m_a = t_y.m_a * t_x.m_a;
+	f_step.m_b = t_y.m_a * t_x.m_b + t_y.m_b;
+	f_step.m_length = t_x.m_length + t_y.m_length;
+
+	// The delta after x must still be inside the radius of y
+	double f_radiusY = (t_y.m_radius - std::abs(t_x.m_b) * t_maxDelta) / std::abs(t_x.m_a);
+	f_step.m_radius = std::min(t_x.m_radius, std::max(0.0, f_radiusY));
+
+	return f_step;
+}
@@ -0,0 +1,215 @@
+#include "Checkpoint.h"
+#include "Globals.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+const char *Checkpoint::MANIFEST_HEADER = "mandelbrot checkpoint 1";
+
+/// <summary>
+/// Checkpoint constructor.
+/// </summary>
+/// <param name="t_file">The count file, with its header set up for a new render.</param>
+Checkpoint::Checkpoint(CountFile &t_file) : m_file{ t_file }
+{
+
+}
+
+/// <summary>
+/// Checkpoint destructor.
+/// </summary>
+Checkpoint::~Checkpoint()
+{
+	if (m_manifest != nullptr)
+	{
+		std::fclose(m_manifest);
+	}
+}
+
+/// <summary>
+/// Picks up the checkpoint at a path if it was made with the same settings, or starts a new one.
+/// </summary>
+/// <param name="t_path">The count file. The manifest is the same path with .manifest added.</param>
+/// <param name="t_settings">Everything that changes the image, on one line.</param>
+/// <returns>False if the files couldn't be created.</returns>
+bool Checkpoint::open(const std::string &t_path, const std::string &t_settings)
+{
+	const std::string f_manifest = t_path + ".manifest";
+
+	if (readManifest(f_manifest, t_settings) && m_file.reopen(t_path))
+	{
+		m_resumed = int(m_finished.size());
+	}
+	else
+	{
+		m_finished.clear();
+
+		if (!m_file.create(t_path) || !m_file.sync())
+		{
+			return false;
+		}
+	}
+
+	// The manifest is written again from what was read, which drops a line left half written. It is
+	// written beside the old one and moved over it, so there is always a whole manifest on the disk.
+	FILE *f_file = std::fopen((f_manifest + ".new").c_str(), "wb");
+
+	if (f_file == nullptr)
+	{
+		return false;
+	}
+
+	std::fprintf(f_file, "%s\n%s\n", MANIFEST_HEADER, t_settings.c_str());
+
+	for (int f_row : m_finished)
+	{
+		std::fprintf(f_file, "band %d\n", f_row);
+	}
+
+	bool f_synced = CountFile::syncFile(f_file);
+	std::fclose(f_file);
+
+#ifdef _WIN32
+	std::remove(f_manifest.c_str());
+#endif
+
+	if (!f_synced || std::rename((f_manifest + ".new").c_str(), f_manifest.c_str()) != 0)
+	{
+		return false;
+	}
+
+	m_manifest = std::fopen(f_manifest.c_str(), "ab");
+
+	if (m_manifest == nullptr)
+	{
+		return false;
+	}
+
+	m_lastSync = std::chrono::steady_clock::now();
+
+	return true;
+}
+
+/// <summary>
+/// Gets whether a band was finished by an earlier run. The bands are only read when the checkpoint is
+/// opened, so this is safe to call while another thread writes bands.
+/// </summary>
+/// <param name="t_firstRow">The first row of the band.</param>
+/// <returns>True if the band is in the count file.</returns>
+bool Checkpoint::finished(int t_firstRow) const
+{
+	return m_finished.count(t_firstRow) != 0;
+}
+
+/// <summary>
+/// Gets the number of bands the manifest listed when it was opened.
+/// </summary>
+/// <returns>The number of bands.</returns>
+int Checkpoint::resumed() const
+{
+	return m_resumed;
+}
+
+/// <summary>
+/// Writes a finished band and syncs if the last sync was long enough ago.
+/// </summary>
+/// <param name="t_firstRow">The first row of the band.</param>
+/// <param name="t_rows">The number of rows.</param>
+/// <param name="t_counts">The iteration counts.</param>
+/// <param name="t_smooth">The smooth fractions, ignored unless the file has them.</param>
+/// <param name="t_distance">The distances, ignored unless the file has them.</param>
+/// <param name="t_pixels">The colours.</param>
+/// <returns>False if the band couldn't be written.</returns>
+bool Checkpoint::writeBand(int t_firstRow, int t_rows, const int *t_counts, const float *t_smooth, const float *t_distance, const uint32_t *t_pixels)
+{
+	auto f_start = std::chrono::steady_clock::now();
+	bool f_written = m_file.writeRows(t_firstRow, t_rows, t_counts, t_smooth, t_distance, t_pixels);
+	m_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - f_start).count();
+
+	if (f_written)
+	{
+		m_pending.push_back(t_firstRow);
+	}
+
+	if (std::chrono::duration<double>(std::chrono::steady_clock::now() - m_lastSync).count() >= Globals::CHECKPOINT_SECONDS)
+	{
+		f_written = sync() && f_written;
+	}
+
+	return f_written;
+}
+
+/// <summary>
+/// Flushes the count file to disk, then lists the bands written since the last sync in the manifest.
+/// </summary>
+/// <returns>False if either file couldn't be flushed.</returns>
+bool Checkpoint::sync()
+{
+	auto f_start = std::chrono::steady_clock::now();
+	bool f_synced = m_file.sync();
+
+	// A band only goes in the manifest once its data is on the disk
+	if (f_synced && !m_pending.empty())
+	{
+		for (int f_row : m_pending)
+		{
+			std::fprintf(m_manifest, "band %d\n", f_row);
+		}
+
+		m_pending.clear();
+		f_synced = CountFile::syncFile(m_manifest);
+	}
+
+	m_lastSync = std::chrono::steady_clock::now();
+	m_seconds += std::chrono::duration<double>(m_lastSync - f_start).count();
+
+	return f_synced;
+}
+
+/// <summary>
+/// Gets the time spent writing and syncing the checkpoint.
+/// </summary>
+/// <returns>The time in seconds.</returns>
+double Checkpoint::seconds() const
+{
+	return m_seconds;
+}
+
+/// <summary>
+/// Reads the bands listed in a manifest. Only whole lines count, since a run can stop part way
+/// through adding one.
+/// </summary>
+/// <param name="t_path">The manifest.</param>
+/// <param name="t_settings">The settings the manifest has to have been made with.</param>
+/// <returns>False if there is no manifest or it was made with other settings.</returns>
+bool Checkpoint::readManifest(const std::string &t_path, const std::string &t_settings)
+{
+	std::ifstream f_file(t_path, std::ios::binary);
+	std::stringstream f_contents;
+	f_contents << f_file.rdbuf();
+
+	std::string f_text = f_contents.str();
+	f_text.erase(f_text.find_last_of('\n') == std::string::npos ? 0 : f_text.find_last_of('\n') + 1);
+
+	std::istringstream f_lines(f_text);
+	std::string f_header;
+	std::string f_settings;
+
+	if (!std::getline(f_lines, f_header) || f_header != MANIFEST_HEADER || !std::getline(f_lines, f_settings) || f_settings != t_settings)
+	{
+		return false;
+	}
+
+	std::string f_line;
+
+	while (std::getline(f_lines, f_line))
+	{
+		if (f_line.compare(0, 5, "band ") == 0)
+		{
+			m_finished.insert(std::atoi(f_line.c_str() + 5));
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,454 @@
+#include "CountFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char COUNT_FILE_MAGIC[8] = { 'M', 'B', 'C', 'O', 'U', 'N', 'T', '1' };
+
+// The planes are used in place, so the header has to be the same on every compiler
+static_assert(sizeof(CountFileHeader) == 72, "CountFileHeader must have no padding");
+
+/// <summary>
+/// CountFile constructor.
+/// </summary>
+CountFile::CountFile()
+{
+	std::memset(&m_header, 0, sizeof(m_header));
+	std::memcpy(m_header.m_magic, COUNT_FILE_MAGIC, sizeof(COUNT_FILE_MAGIC));
+}
+
+/// <summary>
+/// CountFile destructor.
+/// </summary>
+CountFile::~CountFile()
+{
+	close();
+}
+
+/// <summary>
+/// Creates the file from the header and the centre, and sizes it for every plane the flags ask for.
+/// The planes are filled in afterwards with writeRows.
+/// </summary>
+/// <param name="t_path">The file to write.</param>
+/// <returns>False if the file couldn't be created.</returns>
+bool CountFile::create(const std::string &t_path)
+{
+	close();
+
+	m_header.m_centreXLength = uint32_t(m_centreX.size());
+	m_header.m_centreYLength = uint32_t(m_centreY.size());
+	m_header.m_headerSize = uint32_t(align(sizeof(m_header) + m_centreX.size() + m_centreY.size()));
+
+	std::vector<char> f_header(m_header.m_headerSize, 0);
+	std::memcpy(f_header.data(), &m_header, sizeof(m_header));
+	std::memcpy(f_header.data() + sizeof(m_header), m_centreX.data(), m_centreX.size());
+	std::memcpy(f_header.data() + sizeof(m_header) + m_centreX.size(), m_centreY.data(), m_centreY.size());
+
+	m_output = std::fopen(t_path.c_str(), "wb");
+
+	if (m_output == nullptr)
+	{
+		return false;
+	}
+
+	// Planes are written in whole bands, so buffering would only add a copy
+	std::setvbuf(m_output, nullptr, _IONBF, 0);
+
+	// Writing the last byte gives the file its full size, the planes in between are left to the file system
+	return std::fwrite(f_header.data(), 1, f_header.size(), m_output) == f_header.size()
+		&& seek(m_output, fileSize() - 1) && std::fputc(0, m_output) != EOF;
+}
+
+/// <summary>
+/// Opens a count file written before to carry on writing it. The header and centre are read from it.
+/// </summary>
+/// <param name="t_path">The file to write.</param>
+/// <returns>False if the file isn't there or isn't a whole count file.</returns>
+bool CountFile::reopen(const std::string &t_path)
+{
+	close();
+
+	m_output = std::fopen(t_path.c_str(), "r+b");
+
+	if (m_output == nullptr)
+	{
+		return false;
+	}
+
+	std::setvbuf(m_output, nullptr, _IONBF, 0);
+
+	// The fixed part says how long the whole header is
+	CountFileHeader f_fixed;
+	std::vector<uint8_t> f_header;
+
+	if (std::fread(&f_fixed, 1, sizeof(f_fixed), m_output) == sizeof(f_fixed) && f_fixed.m_headerSize <= MAX_HEADER_SIZE)
+	{
+		f_header.resize(std::max(sizeof(f_fixed), size_t(f_fixed.m_headerSize)));
+	}
+
+	if (f_header.empty() || !seek(m_output, 0) || std::fread(f_header.data(), 1, f_header.size(), m_output) != f_header.size()
+		|| !readHeader(f_header.data(), f_header.size()) || std::fseek(m_output, 0, SEEK_END) != 0)
+	{
+		close();
+		return false;
+	}
+
+#ifdef _WIN32
+	size_t f_size = size_t(_ftelli64(m_output));
+#else
+	size_t f_size = size_t(ftello(m_output));
+#endif
+
+	if (f_size < fileSize())
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Writes a band of rows to every plane, one write per plane.
+/// </summary>
+/// <param name="t_firstRow">The first row of the band.</param>
+/// <param name="t_rows">The number of rows.</param>
+/// <param name="t_counts">The iteration counts, width * rows.</param>
+/// <param name="t_smooth">The smooth fractions, ignored unless the file has them.</param>
+/// <param name="t_distance">The distances, ignored unless the file has them.</param>
+/// <param name="t_pixels">The colours, ignored unless the file has them.</param>
+/// <returns>False if the file couldn't be written.</returns>
+bool CountFile::writeRows(int t_firstRow, int t_rows, const int *t_counts, const float *t_smooth, const float *t_distance, const uint32_t *t_pixels)
+{
+	const size_t f_start = size_t(t_firstRow) * m_header.m_width * 4;
+	const size_t f_size = size_t(t_rows) * m_header.m_width * 4;
+	const void *f_planes[PLANES] = { t_counts, t_smooth, t_distance, t_pixels };
+	bool f_written = m_output != nullptr;
+
+	for (int f_plane = 0; f_plane < PLANES && f_written; f_plane++)
+	{
+		if (hasPlane(f_plane))
+		{
+			f_written = seek(m_output, planeOffset(f_plane) + f_start) && std::fwrite(f_planes[f_plane], 1, f_size, m_output) == f_size;
+		}
+	}
+
+	return f_written;
+}
+
+/// <summary>
+/// Reads rows back from a file being written, from every plane the file has and a buffer is given for.
+/// </summary>
+/// <param name="t_firstRow">The first row.</param>
+/// <param name="t_rows">The number of rows.</param>
+/// <param name="t_counts">Where to put the counts, width * rows, or null.</param>
+/// <param name="t_smooth">Where to put the smooth fractions, or null.</param>
+/// <param name="t_distance">Where to put the distances, or null.</param>
+/// <param name="t_pixels">Where to put the colours, or null.</param>
+/// <returns>False if the file couldn't be read.</returns>
+bool CountFile::readRows(int t_firstRow, int t_rows, int *t_counts, float *t_smooth, float *t_distance, uint32_t *t_pixels)
+{
+	const size_t f_start = size_t(t_firstRow) * m_header.m_width * 4;
+	const size_t f_size = size_t(t_rows) * m_header.m_width * 4;
+	void *f_planes[PLANES] = { t_counts, t_smooth, t_distance, t_pixels };
+	bool f_read = m_output != nullptr;
+
+	for (int f_plane = 0; f_plane < PLANES && f_read; f_plane++)
+	{
+		if (hasPlane(f_plane) && f_planes[f_plane] != nullptr)
+		{
+			f_read = seek(m_output, planeOffset(f_plane) + f_start) && std::fread(f_planes[f_plane], 1, f_size, m_output) == f_size;
+		}
+	}
+
+	return f_read;
+}
+
+/// <summary>
+/// Makes everything written so far durable, so it survives the process or the machine stopping.
+/// </summary>
+/// <returns>False if the file couldn't be flushed.</returns>
+bool CountFile::sync()
+{
+	return m_output != nullptr && syncFile(m_output);
+}
+
+/// <summary>
+/// Maps a count file read-only. The header and centre are read, the planes stay in the mapping.
+/// </summary>
+/// <param name="t_path">The file to read.</param>
+/// <returns>False if the file couldn't be mapped or isn't a whole count file.</returns>
+bool CountFile::open(const std::string &t_path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE f_file = CreateFileA(t_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (f_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER f_size;
+	GetFileSizeEx(f_file, &f_size);
+	m_fileHandle = f_file;
+	m_mappingSize = size_t(f_size.QuadPart);
+	m_mappingHandle = m_mappingSize > 0 ? CreateFileMappingA(f_file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	m_mapping = m_mappingHandle != nullptr ? (const uint8_t *)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+	m_fileDescriptor = ::open(t_path.c_str(), O_RDONLY);
+
+	if (m_fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat f_stat;
+	fstat(m_fileDescriptor, &f_stat);
+	m_mappingSize = size_t(f_stat.st_size);
+
+	if (m_mappingSize > 0)
+	{
+		void *f_mapping = mmap(nullptr, m_mappingSize, PROT_READ, MAP_SHARED, m_fileDescriptor, 0);
+		m_mapping = f_mapping != MAP_FAILED ? (const uint8_t *)f_mapping : nullptr;
+	}
+#endif
+
+	if (m_mapping == nullptr || m_mappingSize < sizeof(m_header))
+	{
+		close();
+		return false;
+	}
+
+	if (!readHeader(m_mapping, m_mappingSize) || m_mappingSize < fileSize())
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Finishes writing or unmaps the file.
+/// </summary>
+void CountFile::close()
+{
+	if (m_output != nullptr)
+	{
+		std::fclose(m_output);
+		m_output = nullptr;
+	}
+
+	unmap();
+}
+
+/// <summary>
+/// Gets the iteration counts of a mapped file.
+/// </summary>
+/// <returns>The counts, width * height, row by row.</returns>
+const int *CountFile::counts() const
+{
+	return m_mapping != nullptr ? (const int *)(m_mapping + planeOffset(0)) : nullptr;
+}
+
+/// <summary>
+/// Gets the smooth fractions of a mapped file.
+/// </summary>
+/// <returns>The fractions, or null if the file doesn't have them.</returns>
+const float *CountFile::smooth() const
+{
+	return m_mapping != nullptr && hasPlane(1) ? (const float *)(m_mapping + planeOffset(1)) : nullptr;
+}
+
+/// <summary>
+/// Gets the distance estimates of a mapped file.
+/// </summary>
+/// <returns>The distances in pixels, or null if the file doesn't have them.</returns>
+const float *CountFile::distance() const
+{
+	return m_mapping != nullptr && hasPlane(2) ? (const float *)(m_mapping + planeOffset(2)) : nullptr;
+}
+
+/// <summary>
+/// Gets the colours of a mapped file.
+/// </summary>
+/// <returns>The packed RGBA colours, or null if the file doesn't have them.</returns>
+const uint32_t *CountFile::pixels() const
+{
+	return m_mapping != nullptr && hasPlane(3) ? (const uint32_t *)(m_mapping + planeOffset(3)) : nullptr;
+}
+
+/// <summary>
+/// Gets the size of one plane, padded so the next one starts aligned.
+/// </summary>
+/// <returns>The size in bytes.</returns>
+size_t CountFile::planeSize() const
+{
+	return align(size_t(m_header.m_width) * size_t(m_header.m_height) * 4);
+}
+
+/// <summary>
+/// Gets where a plane starts. Planes the file doesn't have take no space.
+/// </summary>
+/// <param name="t_plane">0 for the counts, 1 for the smooth fractions, 2 for the distances, 3 for the colours.</param>
+/// <returns>The offset in bytes from the start of the file.</returns>
+size_t CountFile::planeOffset(int t_plane) const
+{
+	size_t f_offset = m_header.m_headerSize;
+
+	for (int f_plane = 0; f_plane < t_plane; f_plane++)
+	{
+		if (hasPlane(f_plane))
+		{
+			f_offset += planeSize();
+		}
+	}
+
+	return f_offset;
+}
+
+/// <summary>
+/// Gets the size of the whole file.
+/// </summary>
+/// <returns>The size in bytes.</returns>
+size_t CountFile::fileSize() const
+{
+	return planeOffset(PLANES);
+}
+
+/// <summary>
+/// Flushes a file to the disk itself, not just to the operating system.
+/// </summary>
+/// <param name="t_file">The file.</param>
+/// <returns>False if it couldn't be flushed.</returns>
+bool CountFile::syncFile(FILE *t_file)
+{
+	if (std::fflush(t_file) != 0)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	return _commit(_fileno(t_file)) == 0;
+#else
+	return fsync(fileno(t_file)) == 0;
+#endif
+}
+
+/// <summary>
+/// Gets whether the file has a plane. The counts are always there, the others are in the flags.
+/// </summary>
+/// <param name="t_plane">The plane, as for planeOffset.</param>
+/// <returns>True if the plane is in the file.</returns>
+bool CountFile::hasPlane(int t_plane) const
+{
+	static const uint32_t f_flags[PLANES] = { 0, FLAG_SMOOTH, FLAG_DISTANCE, FLAG_PIXELS };
+
+	return t_plane == 0 || (m_header.m_flags & f_flags[t_plane]) != 0;
+}
+
+/// <summary>
+/// Reads the header and centre from the start of a file and checks them.
+/// </summary>
+/// <param name="t_header">The start of the file.</param>
+/// <param name="t_size">The bytes there are at t_header.</param>
+/// <returns>False if this isn't a count file.</returns>
+bool CountFile::readHeader(const uint8_t *t_header, size_t t_size)
+{
+	std::memcpy(&m_header, t_header, sizeof(m_header));
+
+	if (std::memcmp(m_header.m_magic, COUNT_FILE_MAGIC, sizeof(COUNT_FILE_MAGIC)) != 0
+		|| size_t(m_header.m_headerSize) < sizeof(m_header) + size_t(m_header.m_centreXLength) + m_header.m_centreYLength
+		|| m_header.m_headerSize % ALIGNMENT != 0 || t_size < m_header.m_headerSize)
+	{
+		return false;
+	}
+
+	const char *f_centre = (const char *)t_header + sizeof(m_header);
+	m_centreX.assign(f_centre, m_header.m_centreXLength);
+	m_centreY.assign(f_centre + m_header.m_centreXLength, m_header.m_centreYLength);
+
+	return true;
+}
+
+/// <summary>
+/// Unmaps the file if it is mapped.
+/// </summary>
+void CountFile::unmap()
+{
+#ifdef _WIN32
+	if (m_mapping != nullptr)
+	{
+		UnmapViewOfFile(m_mapping);
+	}
+
+	if (m_mappingHandle != nullptr)
+	{
+		CloseHandle(m_mappingHandle);
+	}
+
+	if (m_fileHandle != nullptr)
+	{
+		CloseHandle(m_fileHandle);
+	}
+
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+#else
+	if (m_mapping != nullptr)
+	{
+		munmap((void *)m_mapping, m_mappingSize);
+	}
+
+	if (m_fileDescriptor >= 0)
+	{
+		::close(m_fileDescriptor);
+	}
+
+	m_fileDescriptor = -1;
+#endif
+
+	m_mapping = nullptr;
+	m_mappingSize = 0;
+}
+
+/// <summary>
+/// Rounds a size up to the plane alignment.
+/// </summary>
+/// <param name="t_size">The size in bytes.</param>
+/// <returns>The padded size.</returns>
+size_t CountFile::align(size_t t_size)
+{
+	return (t_size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+/// <summary>
+/// Moves to an offset that may be past 2 GB.
+/// </summary>
+/// <param name="t_file">The file.</param>
+/// <param name="t_offset">The offset in bytes from the start.</param>
+/// <returns>False if the file couldn't seek.</returns>
+bool CountFile::seek(FILE *t_file, size_t t_offset)
+{
+#ifdef _WIN32
+	return _fseeki64(t_file, __int64(t_offset), SEEK_SET) == 0;
+#else
+	return fseeko(t_file, off_t(t_offset), SEEK_SET) == 0;
+#endif
+}
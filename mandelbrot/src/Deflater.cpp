@@ -0,0 +1,318 @@
+#include "Deflater.h"
+
+#include <algorithm>
+
+// Base values and extra bits of the length codes 257 to 285 and the distance codes 0 to 29, RFC 1951 3.2.5
+static const int LENGTH_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int LENGTH_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const int DISTANCE_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const int DISTANCE_EXTRA[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+/// <summary>
+/// Deflater constructor.
+/// </summary>
+Deflater::Deflater() : m_head(size_t(1) << HASH_BITS, -1), m_previous(WINDOW_SIZE, -1)
+{
+
+}
+
+/// <summary>
+/// Deflater destructor.
+/// </summary>
+Deflater::~Deflater()
+{
+
+}
+
+/// <summary>
+/// Compresses more of the stream. The last few bytes are held back until more input arrives so that
+/// matches can run across the join.
+/// </summary>
+/// <param name="t_data">The input.</param>
+/// <param name="t_size">The input size in bytes.</param>
+/// <param name="t_out">The compressed bytes are appended here.</param>
+void Deflater::write(const uint8_t *t_data, size_t t_size, std::vector<uint8_t> &t_out)
+{
+	if (!m_started)
+	{
+		// zlib header: deflate with a 32 KB window, no dictionary, check bits so the pair is a multiple of 31,
+		// then the one fixed Huffman block that carries the whole stream
+		t_out.push_back(0x78);
+		t_out.push_back(0x01);
+		putBits(0, 1, t_out);
+		putBits(1, 2, t_out);
+		m_started = true;
+	}
+
+	m_adler = adler32(m_adler, t_data, t_size);
+	m_buffer.insert(m_buffer.end(), t_data, t_data + t_size);
+
+	compress(false, t_out);
+}
+
+/// <summary>
+/// Compresses whatever input is left and ends the stream.
+/// </summary>
+/// <param name="t_out">The compressed bytes are appended here.</param>
+void Deflater::finish(std::vector<uint8_t> &t_out)
+{
+	write(nullptr, 0, t_out);
+	compress(true, t_out);
+
+	// End the block, then an empty final block since the last block had to be open before the end was known
+	putLiteral(256, t_out);
+	putBits(1, 1, t_out);
+	putBits(1, 2, t_out);
+	putLiteral(256, t_out);
+
+	if (m_bitCount > 0)
+	{
+		putBits(0, 8 - m_bitCount, t_out);
+	}
+
+	t_out.push_back(uint8_t(m_adler >> 24));
+	t_out.push_back(uint8_t(m_adler >> 16));
+	t_out.push_back(uint8_t(m_adler >> 8));
+	t_out.push_back(uint8_t(m_adler));
+}
+
+/// <summary>
+/// Updates an Adler-32 checksum.
+/// </summary>
+/// <param name="t_adler">The checksum so far, 1 to start.</param>
+/// <param name="t_data">The data.</param>
+/// <param name="t_size">The data size in bytes.</param>
+/// <returns>The updated checksum.</returns>
+uint32_t Deflater::adler32(uint32_t t_adler, const uint8_t *t_data, size_t t_size)
+{
+	uint32_t f_a = t_adler & 0xFFFF;
+	uint32_t f_b = t_adler >> 16;
+
+	while (t_size > 0)
+	{
+		// 5552 is the most bytes that can be summed before the 32-bit sums can overflow
+		size_t f_block = std::min(t_size, size_t(5552));
+		t_size -= f_block;
+
+		for (size_t i = 0; i < f_block; i++)
+		{
+			f_a += t_data[i];
+			f_b += f_a;
+		}
+
+		t_data += f_block;
+		f_a %= 65521;
+		f_b %= 65521;
+	}
+
+	return (f_b << 16) | f_a;
+}
+
+/// <summary>
+/// Codes the buffered input as literals and matches, then drops what has fallen out of the window.
+/// </summary>
+/// <param name="t_final">Whether the input has ended, otherwise a match length's worth is held back.</param>
+/// <param name="t_out">The compressed bytes are appended here.</param>
+void Deflater::compress(bool t_final, std::vector<uint8_t> &t_out)
+{
+	int64_t f_end = m_bufferStart + int64_t(m_buffer.size());
+	int64_t f_limit = t_final ? f_end : f_end - MAX_MATCH;
+
+	while (m_position < f_limit)
+	{
+		int f_distance = 0;
+		int f_length = f_end - m_position >= MIN_MATCH ? longestMatch(m_position, f_end, f_distance) : 0;
+
+		if (f_length >= MIN_MATCH)
+		{
+			putMatch(f_length, f_distance, t_out);
+
+			for (int i = 0; i < f_length; i++)
+			{
+				if (m_position + MIN_MATCH <= f_end)
+				{
+					insert(m_position);
+				}
+
+				m_position++;
+			}
+		}
+		else
+		{
+			putLiteral(m_buffer[size_t(m_position - m_bufferStart)], t_out);
+
+			if (m_position + MIN_MATCH <= f_end)
+			{
+				insert(m_position);
+			}
+
+			m_position++;
+		}
+	}
+
+	// Only drop once a whole window is dead, so the buffer isn't shuffled on every write
+	int64_t f_keep = m_position - WINDOW_SIZE;
+
+	if (f_keep - m_bufferStart >= WINDOW_SIZE)
+	{
+		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + size_t(f_keep - m_bufferStart));
+		m_bufferStart = f_keep;
+	}
+}
+
+/// <summary>
+/// Adds a position to the hash chains.
+/// </summary>
+/// <param name="t_position">The stream position, with at least three bytes after it.</param>
+void Deflater::insert(int64_t t_position)
+{
+	uint32_t f_hash = hash(t_position);
+
+	m_previous[size_t(t_position & (WINDOW_SIZE - 1))] = m_head[f_hash];
+	m_head[f_hash] = t_position;
+}
+
+/// <summary>
+/// Finds the longest earlier copy of the bytes at a position within the window.
+/// </summary>
+/// <param name="t_position">The stream position.</param>
+/// <param name="t_end">The end of the input.</param>
+/// <param name="t_distance">How far back the match is.</param>
+/// <returns>The match length, below MIN_MATCH when there is none.</returns>
+int Deflater::longestMatch(int64_t t_position, int64_t t_end, int &t_distance) const
+{
+	const uint8_t *f_data = m_buffer.data() - m_bufferStart;
+	int64_t f_oldest = std::max(t_position - WINDOW_SIZE, m_bufferStart);
+	int f_maxLength = int(std::min(int64_t(MAX_MATCH), t_end - t_position));
+	int f_best = 0;
+	int64_t f_candidate = m_head[hash(t_position)];
+
+	for (int f_chain = 0; f_chain < MAX_CHAIN && f_candidate >= f_oldest && f_candidate < t_position; f_chain++)
+	{
+		// Check the byte that would make this the best match first, most candidates fail on it
+		if (f_data[f_candidate + f_best] == f_data[t_position + f_best])
+		{
+			int f_length = 0;
+
+			while (f_length < f_maxLength && f_data[f_candidate + f_length] == f_data[t_position + f_length])
+			{
+				f_length++;
+			}
+
+			if (f_length > f_best)
+			{
+				f_best = f_length;
+				t_distance = int(t_position - f_candidate);
+
+				if (f_best == f_maxLength)
+				{
+					break;
+				}
+			}
+		}
+
+		// Entries older than the window may have been overwritten, the chain only ever goes back
+		int64_t f_next = m_previous[size_t(f_candidate & (WINDOW_SIZE - 1))];
+
+		if (f_next >= f_candidate)
+		{
+			break;
+		}
+
+		f_candidate = f_next;
+	}
+
+	return f_best;
+}
+
+/// <summary>
+/// Hashes the three bytes at a position.
+/// </summary>
+/// <param name="t_position">The stream position.</param>
+/// <returns>The hash.</returns>
+uint32_t Deflater::hash(int64_t t_position) const
+{
+	const uint8_t *f_bytes = &m_buffer[size_t(t_position - m_bufferStart)];
+	uint32_t f_key = uint32_t(f_bytes[0]) | (uint32_t(f_bytes[1]) << 8) | (uint32_t(f_bytes[2]) << 16);
+
+	return (f_key * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/// <summary>
+/// Writes bits least significant first, as deflate packs everything but Huffman codes.
+/// </summary>
+/// <param name="t_value">The bits.</param>
+/// <param name="t_count">The number of bits, up to 16.</param>
+/// <param name="t_out">Whole bytes are appended here.</param>
+void Deflater::putBits(uint32_t t_value, int t_count, std::vector<uint8_t> &t_out)
+{
+	m_bits |= t_value << m_bitCount;
+	m_bitCount += t_count;
+
+	while (m_bitCount >= 8)
+	{
+		t_out.push_back(uint8_t(m_bits));
+		m_bits >>= 8;
+		m_bitCount -= 8;
+	}
+}
+
+/// <summary>
+/// Writes a Huffman code, which deflate packs most significant bit first.
+/// </summary>
+/// <param name="t_code">The code.</param>
+/// <param name="t_length">The code length in bits.</param>
+/// <param name="t_out">Whole bytes are appended here.</param>
+void Deflater::putHuffman(uint32_t t_code, int t_length, std::vector<uint8_t> &t_out)
+{
+	uint32_t f_reversed = 0;
+
+	for (int i = 0; i < t_length; i++)
+	{
+		f_reversed = (f_reversed << 1) | ((t_code >> i) & 1);
+	}
+
+	putBits(f_reversed, t_length, t_out);
+}
+
+/// <summary>
+/// Writes a literal/length symbol with the fixed Huffman code, RFC 1951 3.2.6.
+/// </summary>
+/// <param name="t_literal">The symbol, 0 to 287.</param>
+/// <param name="t_out">Whole bytes are appended here.</param>
+void Deflater::putLiteral(int t_literal, std::vector<uint8_t> &t_out)
+{
+	if (t_literal < 144)
+	{
+		putHuffman(0x30 + t_literal, 8, t_out);
+	}
+	else if (t_literal < 256)
+	{
+		putHuffman(0x190 + t_literal - 144, 9, t_out);
+	}
+	else if (t_literal < 280)
+	{
+		putHuffman(t_literal - 256, 7, t_out);
+	}
+	else
+	{
+		putHuffman(0xC0 + t_literal - 280, 8, t_out);
+	}
+}
+
+/// <summary>
+/// Writes a match as its length symbol and distance code, each followed by their extra bits.
+/// </summary>
+/// <param name="t_length">The match length, 3 to 258.</param>
+/// <param name="t_distance">The match distance, 1 to 32768.</param>
+/// <param name="t_out">Whole bytes are appended here.</param>
+void Deflater::putMatch(int t_length, int t_distance, std::vector<uint8_t> &t_out)
+{
+	int f_lengthCode = int(std::upper_bound(std::begin(LENGTH_BASE), std::end(LENGTH_BASE), t_length) - std::begin(LENGTH_BASE)) - 1;
+	int f_distanceCode = int(std::upper_bound(std::begin(DISTANCE_BASE), std::end(DISTANCE_BASE), t_distance) - std::begin(DISTANCE_BASE)) - 1;
+
+	putLiteral(257 + f_lengthCode, t_out);
+	putBits(t_length - LENGTH_BASE[f_lengthCode], LENGTH_EXTRA[f_lengthCode], t_out);
+	putHuffman(f_distanceCode, 5, t_out);
+	putBits(t_distance - DISTANCE_BASE[f_distanceCode], DISTANCE_EXTRA[f_distanceCode], t_out);
+}
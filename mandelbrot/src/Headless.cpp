@@ -0,0 +1,1134 @@
+// Command-line renderer for machines without a display. It drives the same worker pool and kernels as
+// the viewer, but never creates a window, font or texture, and SFML isn't needed to build it.
+// Images are rendered in horizontal bands and each band is written while the next is computed, so
+// memory depends on the band size and not on the image size.
+
+#include "Renderer.h"
+#include "Viewport.h"
+#include "Benchmark.h"
+#include "PngWriter.h"
+#include "TilePyramid.h"
+#include "CountFile.h"
+#include "Checkpoint.h"
+#include "TileCache.h"
+#include "Animation.h"
+#include "RenderFarm.h"
+#include "TileServer.h"
+#include "LoadTest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// What to render, read from the command line.
+/// </summary>
+struct HeadlessOptions
+{
+	std::string m_centreX = "-0.75";
+	std::string m_centreY = "0";
+	double m_spacing = 0.0;
+	int m_width = Globals::SCREEN_WIDTH;
+	int m_height = Globals::SCREEN_HEIGHT;
+	int m_iterations = 1024;
+	int m_exponent = 2;
+	bool m_julia = false;
+	Vector2 m_juliaC = { 0, 0 };
+	SmoothFormat m_smoothFormat = SmoothFormat::None;
+	bool m_boundary = false;
+	bool m_antialias = false;
+	bool m_interiorChecks = false;
+	bool m_reproducible = false;
+	int m_bandRows = 0;
+	std::string m_output;
+	std::string m_counts;
+	bool m_checkpoint = false;
+	std::string m_recolour;
+	std::string m_palette = "rainbow";
+	std::string m_cache;
+	std::string m_pyramid;
+	PyramidLayout m_layout = PyramidLayout::Xyz;
+	int m_levels = 6;
+	int m_tileSize = 256;
+	double m_extent = 3.5;
+	std::string m_animate;
+	VideoFormat m_video = VideoFormat::Y4m;
+	int m_fps = 30;
+	double m_keyScale = 2.0;
+	int m_farm = -1;
+	std::string m_socket;
+	std::string m_worker;
+	int m_serve = -1;
+	int m_loadTest = -1;
+	int m_clients = 8;
+	int m_requests = 1000;
+	double m_drop = 0.1;
+};
+
+/// <summary>
+/// The image file, written a band of rows at a time as PNG or binary PPM.
+/// </summary>
+struct HeadlessImage
+{
+	bool m_png = false;
+	PngWriter m_pngWriter;
+	std::ofstream m_ppmFile;
+	std::vector<uint8_t> m_ppmRow;
+	int m_width = 0;
+};
+
+/// <summary>
+/// Prints how to use the renderer.
+/// </summary>
+static void usage()
+{
+	std::cerr
+		<< "usage: mandelbrot-headless [options] -o <file.png|file.ppm> [--counts <file.mbc>]\n"
+		<< "       mandelbrot-headless --recolour <file.mbc> [--palette <name>] -o <file.png|file.ppm>\n"
+		<< "       mandelbrot-headless [options] --pyramid <directory>\n"
+		<< "       mandelbrot-headless [options] --farm <workers> [--socket <path>] -o <file.png|file.ppm>\n"
+		<< "       mandelbrot-headless --worker <socket>\n"
+		<< "       mandelbrot-headless [options] --animate <path.txt> [-o <file>] | ffmpeg -i - video.mp4\n"
+		<< "       mandelbrot-headless [options] --serve <port>\n"
+		<< "       mandelbrot-headless --load-test <port> [--levels <n>] [--clients <n>] [--requests <n>] [--drop <fraction>]\n"
+		<< "  --centre <re> <im>   centre of the view, any number of digits (default -0.75 0)\n"
+		<< "  --spacing <units>    world units per pixel (default fits 3.5 units in the width)\n"
+		<< "  --size <w> <h>       image size in pixels (default " << Globals::SCREEN_WIDTH << " " << Globals::SCREEN_HEIGHT << ")\n"
+		<< "  --iterations <n>     iteration cap (default 1024)\n"
+		<< "  --exponent <d>       power of z, 2 to 5 (default 2)\n"
+		<< "  --julia <re> <im>    draw the Julia set for this parameter\n"
+		<< "  --smooth             smooth colouring\n"
+		<< "  --boundary           outline the boundary with the distance estimate\n"
+		<< "  --antialias          supersample the edge pixels\n"
+		<< "  --interior           cardioid, bulb and periodicity checks\n"
+		<< "  --reproducible       128-bit fixed-point kernel, identical on every machine\n"
+		<< "  --band <rows>        rows rendered and written at once (default fits " << Globals::BAND_PIXELS << " pixels)\n"
+		<< "  -o, --output <file>  where to write the image, PNG unless the name ends in .ppm\n"
+		<< "  --counts <file>      also write the raw iteration counts, with --smooth and --boundary channels\n"
+		<< "  --checkpoint <file>  counts file that also holds the colours, a render stopped part way carries on from it\n"
+		<< "  --recolour <file>    colour a counts file instead of rendering\n"
+		<< "  --palette <name>     rainbow, fire or grey (default rainbow)\n"
+		<< "  --cache <dir>        reuse bands and tiles computed by earlier runs, and keep these for later ones\n"
+		<< "  --pyramid <dir>      write a tile pyramid instead of one image\n"
+		<< "  --layout xyz|dzi     pyramid layout, z/x/y.png or Deep Zoom (default xyz)\n"
+		<< "  --levels <n>         pyramid levels (default 6)\n"
+		<< "  --tile <pixels>      pyramid tile size, a power of two (default 256)\n"
+		<< "  --extent <units>     width of the level 0 tile in world units (default 3.5)\n"
+		<< "  --animate <file>     render a zoom video along a keyframe path, lines of \"frame re im spacing iterations\",\n"
+		<< "                       to stdout unless -o is given\n"
+		<< "  --video y4m|rgb      video format, YUV4MPEG2 or bare RGB frames (default y4m)\n"
+		<< "  --fps <n>            frame rate written in the Y4M header (default 30)\n"
+		<< "  --key-scale <m>      size of the key images frames are resampled from, times the frame size (default 2, 1 renders every frame)\n"
+		<< "  --farm <workers>     split the render into --tile tiles and farm them out to this many local worker processes\n"
+		<< "  --socket <path>      Unix socket the farm's workers connect to (default /tmp/mandelbrot-farm-<pid>.sock)\n"
+		<< "  --worker <socket>    render tiles for a farm, more can join a running farm this way\n"
+		<< "  --serve <port>       serve /z/x/y.png tiles of the --tile, --extent and --levels pyramid over HTTP on 127.0.0.1\n"
+		<< "  --load-test <port>   put the tile server on this port under load and report throughput and latency\n"
+		<< "  --clients <n>        load test clients at once (default 8)\n"
+		<< "  --requests <n>       load test requests across all clients (default 1000)\n"
+		<< "  --drop <fraction>    load test requests hung up on straight after being sent (default 0.1)\n"
+		<< "  --benchmark [file]   run the benchmarks instead\n"
+		<< "  --check-widths       check every kernel renders an odd width without writing past a section\n"
+		<< "  --check-float        check the float kernel looks the same as double on the views it is chosen for\n";
+}
+
+/// <summary>
+/// Reads the command line.
+/// </summary>
+/// <param name="t_argc">The number of arguments.</param>
+/// <param name="t_argv">The arguments.</param>
+/// <param name="t_options">The options read.</param>
+/// <returns>False if the command line is wrong.</returns>
+static bool parseOptions(int t_argc, char **t_argv, HeadlessOptions &t_options)
+{
+	for (int i = 1; i < t_argc; i++)
+	{
+		std::string f_arg = t_argv[i];
+		int f_left = t_argc - i - 1;
+
+		if (f_arg == "--centre" && f_left >= 2)
+		{
+			t_options.m_centreX = t_argv[++i];
+			t_options.m_centreY = t_argv[++i];
+		}
+		else if (f_arg == "--spacing" && f_left >= 1)
+		{
+			t_options.m_spacing = std::atof(t_argv[++i]);
+		}
+		else if (f_arg == "--size" && f_left >= 2)
+		{
+			t_options.m_width = std::atoi(t_argv[++i]);
+			t_options.m_height = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--iterations" && f_left >= 1)
+		{
+			t_options.m_iterations = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--exponent" && f_left >= 1)
+		{
+			t_options.m_exponent = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--julia" && f_left >= 2)
+		{
+			t_options.m_julia = true;
+			t_options.m_juliaC.x = std::atof(t_argv[++i]);
+			t_options.m_juliaC.y = std::atof(t_argv[++i]);
+		}
+		else if (f_arg == "--smooth")
+		{
+			t_options.m_smoothFormat = SmoothFormat::Float32;
+		}
+		else if (f_arg == "--boundary")
+		{
+			t_options.m_boundary = true;
+		}
+		else if (f_arg == "--antialias")
+		{
+			t_options.m_antialias = true;
+		}
+		else if (f_arg == "--interior")
+		{
+			t_options.m_interiorChecks = true;
+		}
+		else if (f_arg == "--reproducible")
+		{
+			t_options.m_reproducible = true;
+		}
+		else if (f_arg == "--band" && f_left >= 1)
+		{
+			t_options.m_bandRows = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--pyramid" && f_left >= 1)
+		{
+			t_options.m_pyramid = t_argv[++i];
+		}
+		else if (f_arg == "--layout" && f_left >= 1)
+		{
+			std::string f_layout = t_argv[++i];
+			t_options.m_layout = f_layout == "dzi" ? PyramidLayout::DeepZoom : PyramidLayout::Xyz;
+
+			if (f_layout != "dzi" && f_layout != "xyz")
+			{
+				return false;
+			}
+		}
+		else if (f_arg == "--levels" && f_left >= 1)
+		{
+			t_options.m_levels = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--tile" && f_left >= 1)
+		{
+			t_options.m_tileSize = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--extent" && f_left >= 1)
+		{
+			t_options.m_extent = std::atof(t_argv[++i]);
+		}
+		else if (f_arg == "--counts" && f_left >= 1)
+		{
+			t_options.m_counts = t_argv[++i];
+		}
+		else if (f_arg == "--checkpoint" && f_left >= 1)
+		{
+			t_options.m_counts = t_argv[++i];
+			t_options.m_checkpoint = true;
+		}
+		else if (f_arg == "--recolour" && f_left >= 1)
+		{
+			t_options.m_recolour = t_argv[++i];
+		}
+		else if (f_arg == "--palette" && f_left >= 1)
+		{
+			t_options.m_palette = t_argv[++i];
+
+			if (t_options.m_palette != "rainbow" && t_options.m_palette != "fire" && t_options.m_palette != "grey")
+			{
+				return false;
+			}
+		}
+		else if (f_arg == "--cache" && f_left >= 1)
+		{
+			t_options.m_cache = t_argv[++i];
+		}
+		else if (f_arg == "--animate" && f_left >= 1)
+		{
+			t_options.m_animate = t_argv[++i];
+		}
+		else if (f_arg == "--video" && f_left >= 1)
+		{
+			std::string f_video = t_argv[++i];
+			t_options.m_video = f_video == "rgb" ? VideoFormat::Rgb : VideoFormat::Y4m;
+
+			if (f_video != "rgb" && f_video != "y4m")
+			{
+				return false;
+			}
+		}
+		else if (f_arg == "--fps" && f_left >= 1)
+		{
+			t_options.m_fps = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--key-scale" && f_left >= 1)
+		{
+			t_options.m_keyScale = std::atof(t_argv[++i]);
+		}
+		else if (f_arg == "--farm" && f_left >= 1)
+		{
+			t_options.m_farm = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--socket" && f_left >= 1)
+		{
+			t_options.m_socket = t_argv[++i];
+		}
+		else if (f_arg == "--worker" && f_left >= 1)
+		{
+			t_options.m_worker = t_argv[++i];
+		}
+		else if (f_arg == "--serve" && f_left >= 1)
+		{
+			t_options.m_serve = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--load-test" && f_left >= 1)
+		{
+			t_options.m_loadTest = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--clients" && f_left >= 1)
+		{
+			t_options.m_clients = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--requests" && f_left >= 1)
+		{
+			t_options.m_requests = std::atoi(t_argv[++i]);
+		}
+		else if (f_arg == "--drop" && f_left >= 1)
+		{
+			t_options.m_drop = std::atof(t_argv[++i]);
+		}
+		else if ((f_arg == "-o" || f_arg == "--output") && f_left >= 1)
+		{
+			t_options.m_output = t_argv[++i];
+		}
+		else
+		{
+			std::cerr << "unknown or incomplete option: " << f_arg << "\n";
+			return false;
+		}
+	}
+
+	if (t_options.m_loadTest >= 0)
+	{
+		return t_options.m_loadTest > 0 && t_options.m_loadTest < 65536 && t_options.m_levels >= 1 && t_options.m_clients >= 1 && t_options.m_requests >= 1
+			&& t_options.m_drop >= 0.0 && t_options.m_drop <= 1.0;
+	}
+
+	// Tiles halve in size from level to level, so they have to be a power of two
+	if (!t_options.m_pyramid.empty() || t_options.m_serve >= 0)
+	{
+		return t_options.m_levels >= 1 && t_options.m_tileSize >= 32 && (t_options.m_tileSize & (t_options.m_tileSize - 1)) == 0
+			&& t_options.m_extent > 0.0 && t_options.m_iterations >= 1 && t_options.m_exponent >= 2 && t_options.m_exponent <= 5 && t_options.m_serve < 65536;
+	}
+
+	if (!t_options.m_recolour.empty())
+	{
+		return !t_options.m_output.empty();
+	}
+
+	// A worker is told everything else by the coordinator
+	if (!t_options.m_worker.empty())
+	{
+		return true;
+	}
+
+	// The path gives the views, the output defaults to stdout
+	if (!t_options.m_animate.empty())
+	{
+		return t_options.m_width > 0 && t_options.m_height > 0 && t_options.m_fps >= 1 && t_options.m_keyScale >= 1.0
+			&& t_options.m_exponent >= 2 && t_options.m_exponent <= 5;
+	}
+
+	// The farm writes an image only, and the coordinator doesn't render so the whole tile has to be given
+	if (t_options.m_farm >= 0 && (t_options.m_output.empty() || !t_options.m_counts.empty() || t_options.m_tileSize < 16))
+	{
+		return false;
+	}
+
+	if ((t_options.m_output.empty() && t_options.m_counts.empty()) || t_options.m_width <= 0 || t_options.m_height <= 0 || t_options.m_iterations < 1
+		|| t_options.m_exponent < 2 || t_options.m_exponent > 5)
+	{
+		return false;
+	}
+
+	if (t_options.m_spacing <= 0.0)
+	{
+		t_options.m_spacing = 3.5 / t_options.m_width;
+	}
+
+	if (t_options.m_bandRows <= 0)
+	{
+		t_options.m_bandRows = std::max(1, Globals::BAND_PIXELS / t_options.m_width);
+	}
+
+	t_options.m_bandRows = std::min(t_options.m_bandRows, t_options.m_height);
+
+	return true;
+}
+
+/// <summary>
+/// Creates the image file and writes its header.
+/// </summary>
+/// <param name="t_path">The file to write, PPM if the name ends in .ppm and PNG otherwise.</param>
+/// <param name="t_width">The width in pixels.</param>
+/// <param name="t_height">The height in pixels.</param>
+/// <param name="t_image">The image.</param>
+/// <returns>False if the file couldn't be created.</returns>
+static bool openImage(const std::string &t_path, int t_width, int t_height, HeadlessImage &t_image)
+{
+	t_image.m_png = t_path.size() < 4 || t_path.compare(t_path.size() - 4, 4, ".ppm") != 0;
+	t_image.m_width = t_width;
+
+	if (t_image.m_png)
+	{
+		return t_image.m_pngWriter.open(t_path, t_width, t_height);
+	}
+
+	t_image.m_ppmFile.open(t_path, std::ios::binary);
+	t_image.m_ppmFile << "P6\n" << t_width << " " << t_height << "\n255\n";
+	t_image.m_ppmRow.resize(size_t(t_width) * 3);
+
+	return bool(t_image.m_ppmFile);
+}
+
+/// <summary>
+/// Adds rows to the image.
+/// </summary>
+/// <param name="t_image">The image.</param>
+/// <param name="t_pixels">The rows as packed RGBA, R in the lowest byte. The alpha is dropped.</param>
+/// <param name="t_rows">The number of rows.</param>
+/// <returns>False if the file couldn't be written.</returns>
+static bool writeRows(HeadlessImage &t_image, const uint32_t *t_pixels, int t_rows)
+{
+	if (t_image.m_png)
+	{
+		return t_image.m_pngWriter.writeRows(t_pixels, t_rows);
+	}
+
+	for (int f_y = 0; f_y < t_rows; f_y++)
+	{
+		const uint32_t *f_pixels = &t_pixels[size_t(f_y) * t_image.m_width];
+
+		for (int f_x = 0; f_x < t_image.m_width; f_x++)
+		{
+			t_image.m_ppmRow[f_x * 3 + 0] = uint8_t(f_pixels[f_x]);
+			t_image.m_ppmRow[f_x * 3 + 1] = uint8_t(f_pixels[f_x] >> 8);
+			t_image.m_ppmRow[f_x * 3 + 2] = uint8_t(f_pixels[f_x] >> 16);
+		}
+
+		t_image.m_ppmFile.write((const char *)t_image.m_ppmRow.data(), t_image.m_ppmRow.size());
+	}
+
+	return bool(t_image.m_ppmFile);
+}
+
+/// <summary>
+/// Finishes the image file.
+/// </summary>
+/// <param name="t_image">The image.</param>
+/// <returns>False if the file couldn't be written.</returns>
+static bool closeImage(HeadlessImage &t_image)
+{
+	if (t_image.m_png)
+	{
+		return t_image.m_pngWriter.close();
+	}
+
+	t_image.m_ppmFile.close();
+
+	return !t_image.m_ppmFile.fail();
+}
+
+/// <summary>
+/// Gets the gradient a palette is named after.
+/// </summary>
+/// <param name="t_name">rainbow, fire or grey.</param>
+/// <returns>The stops.</returns>
+static std::vector<PaletteStop> paletteStops(const std::string &t_name)
+{
+	if (t_name == "fire")
+	{
+		return Palette::fireStops();
+	}
+
+	return t_name == "grey" ? Palette::greyStops() : Palette::rainbowStops();
+}
+
+/// <summary>
+/// Gets everything that changes the pixels of an image on one line, so a checkpoint is only picked up by a
+/// render that would have made the same bands.
+/// </summary>
+/// <param name="t_options">What to render.</param>
+/// <returns>The settings.</returns>
+static std::string settings(const HeadlessOptions &t_options)
+{
+	std::ostringstream f_settings;
+	f_settings.precision(17);
+	f_settings << "centre " << t_options.m_centreX << " " << t_options.m_centreY << " spacing " << t_options.m_spacing
+		<< " size " << t_options.m_width << " " << t_options.m_height << " band " << t_options.m_bandRows
+		<< " iterations " << t_options.m_iterations << " exponent " << t_options.m_exponent
+		<< " julia " << t_options.m_julia << " " << t_options.m_juliaC.x << " " << t_options.m_juliaC.y
+		<< " smooth " << int(t_options.m_smoothFormat) << " boundary " << t_options.m_boundary << " antialias " << t_options.m_antialias
+		<< " interior " << t_options.m_interiorChecks << " reproducible " << t_options.m_reproducible << " palette " << t_options.m_palette;
+
+	return f_settings.str();
+}
+
+/// <summary>
+/// Colours counts the way the workers do.
+/// </summary>
+/// <param name="t_palette">The palette, built for the iteration cap.</param>
+/// <param name="t_counts">The iteration counts.</param>
+/// <param name="t_smooth">The smooth fractions, or null.</param>
+/// <param name="t_distance">The distances, or null.</param>
+/// <param name="t_pixels">Where to put the colours.</param>
+/// <param name="t_count">The number of pixels.</param>
+static void colourBand(const Palette &t_palette, const int *t_counts, const float *t_smooth, const float *t_distance, uint32_t *t_pixels, int t_count)
+{
+	if (t_smooth != nullptr)
+	{
+		t_palette.applySmooth(t_counts, t_smooth, t_pixels, t_count);
+	}
+	else
+	{
+		t_palette.apply(t_counts, t_pixels, t_count);
+	}
+
+	if (t_distance != nullptr)
+	{
+		Palette::shadeBoundary(t_distance, t_pixels, t_count);
+	}
+}
+
+/// <summary>
+/// Colours a counts file into an image. The file is mapped and coloured a band at a time straight from
+/// the mapping, so nothing is computed and only one band of colours is held in memory.
+/// </summary>
+/// <param name="t_options">The counts file, palette and image.</param>
+/// <returns>0 once the image is written, 1 if the counts couldn't be read or the image written.</returns>
+static int recolour(const HeadlessOptions &t_options)
+{
+	CountFile f_counts;
+
+	if (!f_counts.open(t_options.m_recolour))
+	{
+		std::cerr << "couldn't read " << t_options.m_recolour << "\n";
+		return 1;
+	}
+
+	const int f_width = int(f_counts.m_header.m_width);
+	const int f_height = int(f_counts.m_header.m_height);
+	const int f_bandRows = std::min(std::max(1, Globals::BAND_PIXELS / std::max(1, f_width)), std::max(1, f_height));
+
+	Palette f_palette;
+	f_palette.setStops(paletteStops(t_options.m_palette));
+	f_palette.build(int(f_counts.m_header.m_iterations));
+
+	HeadlessImage f_image;
+
+	if (!openImage(t_options.m_output, f_width, f_height, f_image))
+	{
+		std::cerr << "couldn't write " << t_options.m_output << "\n";
+		return 1;
+	}
+
+	std::vector<uint32_t> f_band(size_t(f_width) * size_t(f_bandRows));
+	bool f_written = true;
+
+	auto f_start = std::chrono::high_resolution_clock::now();
+
+	for (int f_y = 0; f_y < f_height && f_written; f_y += f_bandRows)
+	{
+		int f_rows = std::min(f_bandRows, f_height - f_y);
+		int f_count = f_width * f_rows;
+		size_t f_offset = size_t(f_y) * size_t(f_width);
+
+		colourBand(f_palette, f_counts.counts() + f_offset, f_counts.smooth() != nullptr ? f_counts.smooth() + f_offset : nullptr,
+			f_counts.distance() != nullptr ? f_counts.distance() + f_offset : nullptr, f_band.data(), f_count);
+		f_written = writeRows(f_image, f_band.data(), f_rows);
+	}
+
+	f_written = closeImage(f_image) && f_written;
+	std::chrono::duration<double> f_time = std::chrono::high_resolution_clock::now() - f_start;
+
+	if (!f_written)
+	{
+		std::cerr << "couldn't write " << t_options.m_output << "\n";
+		return 1;
+	}
+
+	std::cout << f_width << "x" << f_height << " recoloured from " << t_options.m_recolour << " " << f_time.count() << "s -> "
+		<< t_options.m_output << std::endl;
+
+	return 0;
+}
+
+/// <summary>
+/// Prints how often the tile cache was used.
+/// </summary>
+/// <param name="t_cache">The cache.</param>
+static void cacheSummary(const TileCache &t_cache)
+{
+	std::cout << "cache: " << t_cache.hits() << " hits (" << t_cache.diskHits() << " from disk), " << t_cache.misses() << " misses" << std::endl;
+}
+
+/// <summary>
+/// Writes a tile pyramid.
+/// </summary>
+/// <param name="t_options">What to render.</param>
+/// <returns>0 once every tile is written, 1 if one couldn't be.</returns>
+static int pyramid(const HeadlessOptions &t_options)
+{
+	Renderer f_renderer(t_options.m_tileSize, t_options.m_tileSize);
+	f_renderer.m_iterations = t_options.m_iterations;
+	f_renderer.m_exponent = t_options.m_exponent;
+	f_renderer.m_julia = t_options.m_julia;
+	f_renderer.m_juliaC = t_options.m_juliaC;
+	f_renderer.m_smoothFormat = t_options.m_smoothFormat;
+	f_renderer.m_boundary = t_options.m_boundary;
+	f_renderer.m_antialias = t_options.m_antialias;
+	f_renderer.m_interiorChecks = t_options.m_interiorChecks;
+	f_renderer.m_palette.setStops(paletteStops(t_options.m_palette));
+
+	TileCache f_cache(Globals::TILE_CACHE_MEMORY, t_options.m_cache);
+	f_renderer.m_cache = t_options.m_cache.empty() ? nullptr : &f_cache;
+
+	// The centre is parsed at the precision of the deepest level
+	Viewport f_deepest(t_options.m_tileSize, t_options.m_tileSize);
+	f_deepest.setScale(std::ldexp(t_options.m_tileSize / t_options.m_extent, t_options.m_levels - 1));
+
+	TilePyramid f_pyramid(f_renderer, t_options.m_pyramid, t_options.m_layout);
+	f_pyramid.m_reproducible = t_options.m_reproducible;
+
+	auto f_start = std::chrono::high_resolution_clock::now();
+	bool f_built = f_pyramid.build(
+		HighPrecision::fromString(t_options.m_centreX, f_deepest.precisionLimbs()),
+		HighPrecision::fromString(t_options.m_centreY, f_deepest.precisionLimbs()),
+		t_options.m_extent, t_options.m_levels);
+	std::chrono::duration<double> f_time = std::chrono::high_resolution_clock::now() - f_start;
+
+	if (!f_built)
+	{
+		std::cerr << "couldn't write the pyramid to " << t_options.m_pyramid << "\n";
+		return 1;
+	}
+
+	std::cout << t_options.m_levels << " levels of " << t_options.m_tileSize << "px tiles, " << f_pyramid.rendered() << " rendered, "
+		<< f_pyramid.skipped() << " interior tiles not written, " << f_time.count() << "s -> " << t_options.m_pyramid << std::endl;
+
+	if (!t_options.m_cache.empty())
+	{
+		cacheSummary(f_cache);
+	}
+
+	return 0;
+}
+
+/// <summary>
+/// Renders a zoom video along a keyframe path and streams it out. Progress goes to stderr, since stdout
+/// is usually the video.
+/// </summary>
+/// <param name="t_options">The path, frame size, settings and video format.</param>
+/// <returns>0 once every frame is written, 1 if the path couldn't be read or the video written.</returns>
+static int animate(const HeadlessOptions &t_options)
+{
+	std::vector<Keyframe> f_path;
+
+	if (!Animation::readPath(t_options.m_animate, f_path))
+	{
+		std::cerr << "couldn't read the path " << t_options.m_animate << "\n";
+		return 1;
+	}
+
+	FILE *f_output = stdout;
+
+	if (!t_options.m_output.empty() && t_options.m_output != "-")
+	{
+		f_output = std::fopen(t_options.m_output.c_str(), "wb");
+
+		if (f_output == nullptr)
+		{
+			std::cerr << "couldn't write " << t_options.m_output << "\n";
+			return 1;
+		}
+	}
+#ifdef _WIN32
+	else
+	{
+		_setmode(_fileno(stdout), _O_BINARY);
+	}
+#endif
+
+	// Keys are a whole number of pixels, rounded up so they never come out smaller than asked
+	Renderer f_renderer(int(std::ceil(t_options.m_width * t_options.m_keyScale)), int(std::ceil(t_options.m_height * t_options.m_keyScale)));
+	f_renderer.m_exponent = t_options.m_exponent;
+	f_renderer.m_julia = t_options.m_julia;
+	f_renderer.m_juliaC = t_options.m_juliaC;
+	f_renderer.m_smoothFormat = t_options.m_smoothFormat;
+	f_renderer.m_boundary = t_options.m_boundary;
+	f_renderer.m_antialias = t_options.m_antialias;
+	f_renderer.m_interiorChecks = t_options.m_interiorChecks;
+	f_renderer.m_palette.setStops(paletteStops(t_options.m_palette));
+
+	TileCache f_cache(Globals::TILE_CACHE_MEMORY, t_options.m_cache);
+	f_renderer.m_cache = t_options.m_cache.empty() ? nullptr : &f_cache;
+
+	Animation f_animation(f_renderer, t_options.m_width, t_options.m_height, t_options.m_video, f_output);
+	f_animation.m_reproducible = t_options.m_reproducible;
+	f_animation.m_fps = t_options.m_fps;
+
+	if (!f_animation.build(f_path))
+	{
+		std::cerr << "keyframes have to be in order of frame, with spacings and iterations above 0\n";
+		return 1;
+	}
+
+	auto f_start = std::chrono::high_resolution_clock::now();
+	bool f_written = f_animation.run();
+	std::chrono::duration<double> f_time = std::chrono::high_resolution_clock::now() - f_start;
+
+	if (f_output != stdout)
+	{
+		f_written = std::fclose(f_output) == 0 && f_written;
+	}
+
+	if (!f_written)
+	{
+		std::cerr << "couldn't write the video\n";
+		return 1;
+	}
+
+	std::cerr << f_animation.frames() << " frames of " << t_options.m_width << "x" << t_options.m_height << " from " << f_animation.keys() << " keys of "
+		<< f_renderer.width() << "x" << f_renderer.height() << " " << f_time.count() << "s (" << f_animation.frames() / f_time.count() << " fps)" << std::endl;
+
+	return 0;
+}
+
+/// <summary>
+/// Renders an image on a farm of worker processes and writes each band as it completes.
+/// </summary>
+/// <param name="t_options">What to render, the number of workers and the socket.</param>
+/// <param name="t_executable">This program, started again for each worker.</param>
+/// <returns>0 once the image is written, 1 if the farm failed or the image couldn't be written.</returns>
+static int farm(const HeadlessOptions &t_options, const std::string &t_executable)
+{
+	FarmJob f_job;
+	f_job.m_width = t_options.m_width;
+	f_job.m_height = t_options.m_height;
+	f_job.m_tileSize = t_options.m_tileSize;
+	f_job.m_iterations = t_options.m_iterations;
+	f_job.m_exponent = t_options.m_exponent;
+	f_job.m_julia = t_options.m_julia;
+	f_job.m_juliaC = t_options.m_juliaC;
+	f_job.m_smoothFormat = t_options.m_smoothFormat;
+	f_job.m_boundary = t_options.m_boundary;
+	f_job.m_antialias = t_options.m_antialias;
+	f_job.m_interiorChecks = t_options.m_interiorChecks;
+	f_job.m_reproducible = t_options.m_reproducible;
+	f_job.m_palette = t_options.m_palette == "fire" ? 1 : t_options.m_palette == "grey" ? 2 : 0;
+	f_job.m_spacing = t_options.m_spacing;
+	f_job.m_centreX = t_options.m_centreX;
+	f_job.m_centreY = t_options.m_centreY;
+
+#ifdef _WIN32
+	std::string f_socket = t_options.m_socket;
+#else
+	std::string f_socket = t_options.m_socket.empty() ? "/tmp/mandelbrot-farm-" + std::to_string(getpid()) + ".sock" : t_options.m_socket;
+#endif
+	FarmCoordinator f_coordinator(f_job, f_socket);
+
+	if (!f_coordinator.listen() || !f_coordinator.spawn(t_executable, t_options.m_farm))
+	{
+		std::cerr << "couldn't start the farm on " << f_socket << "\n";
+		return 1;
+	}
+
+	HeadlessImage f_image;
+
+	if (!openImage(t_options.m_output, t_options.m_width, t_options.m_height, f_image))
+	{
+		std::cerr << "couldn't write " << t_options.m_output << "\n";
+		return 1;
+	}
+
+	std::vector<uint32_t> f_band;
+	int f_rows = 0;
+	bool f_written = true;
+
+	auto f_start = std::chrono::high_resolution_clock::now();
+
+	while (f_written && f_coordinator.nextBand(f_band, f_rows))
+	{
+		f_written = writeRows(f_image, f_band.data(), f_rows);
+	}
+
+	f_written = closeImage(f_image) && f_written && !f_coordinator.failed();
+	std::chrono::duration<double> f_time = std::chrono::high_resolution_clock::now() - f_start;
+
+	if (!f_written)
+	{
+		std::cerr << (f_coordinator.failed() ? "the farm failed" : "couldn't write " + t_options.m_output) << "\n";
+		return 1;
+	}
+
+	std::cout << t_options.m_width << "x" << t_options.m_height << " in " << f_coordinator.tiles() << " tiles on " << f_coordinator.workersSeen() << " workers, "
+		<< f_coordinator.steals() << " stolen, " << f_coordinator.retries() << " retried, " << f_coordinator.duplicates() << " duplicates "
+		<< f_time.count() << "s -> " << t_options.m_output << std::endl;
+
+	return 0;
+}
+
+/// <summary>
+/// Set by SIGINT or SIGTERM to stop the tile server.
+/// </summary>
+static std::atomic<bool> s_stopServer{ false };
+
+/// <summary>
+/// Stops the tile server once the open requests are answered.
+/// </summary>
+static void stopServer(int)
+{
+	s_stopServer = true;
+}
+
+/// <summary>
+/// Serves tiles over HTTP until interrupted.
+/// </summary>
+/// <param name="t_options">The pyramid the tiles are taken from, its settings and the port.</param>
+/// <returns>0 once stopped, 1 if the port couldn't be opened.</returns>
+static int serve(const HeadlessOptions &t_options)
+{
+	Renderer f_renderer(t_options.m_tileSize, t_options.m_tileSize);
+	f_renderer.m_iterations = t_options.m_iterations;
+	f_renderer.m_exponent = t_options.m_exponent;
+	f_renderer.m_julia = t_options.m_julia;
+	f_renderer.m_juliaC = t_options.m_juliaC;
+	f_renderer.m_smoothFormat = t_options.m_smoothFormat;
+	f_renderer.m_boundary = t_options.m_boundary;
+	f_renderer.m_antialias = t_options.m_antialias;
+	f_renderer.m_interiorChecks = t_options.m_interiorChecks;
+	f_renderer.m_palette.setStops(paletteStops(t_options.m_palette));
+
+	// Always cached in memory, so a tile asked for again is only coloured and compressed
+	TileCache f_cache(Globals::TILE_CACHE_MEMORY, t_options.m_cache);
+	f_renderer.m_cache = &f_cache;
+
+	// The centre is parsed at the precision of the deepest level
+	Viewport f_deepest(t_options.m_tileSize, t_options.m_tileSize);
+	f_deepest.setScale(std::ldexp(t_options.m_tileSize / t_options.m_extent, t_options.m_levels - 1));
+
+	TileServer f_server(f_renderer,
+		HighPrecision::fromString(t_options.m_centreX, f_deepest.precisionLimbs()),
+		HighPrecision::fromString(t_options.m_centreY, f_deepest.precisionLimbs()),
+		t_options.m_extent, t_options.m_levels);
+	f_server.m_reproducible = t_options.m_reproducible;
+
+	if (!f_server.listen(t_options.m_serve))
+	{
+		std::cerr << "couldn't serve on 127.0.0.1:" << t_options.m_serve << "\n";
+		return 1;
+	}
+
+	std::signal(SIGINT, stopServer);
+	std::signal(SIGTERM, stopServer);
+
+	std::cout << "serving " << t_options.m_levels << " levels of " << t_options.m_tileSize << "px tiles on http://127.0.0.1:" << t_options.m_serve
+		<< "/{z}/{x}/{y}.png" << std::endl;
+
+	f_server.run(s_stopServer);
+
+	std::cout << f_server.requests() << " requests, " << f_server.renders() << " rendered, " << f_server.coalesced() << " coalesced, "
+		<< f_server.dropped() << " hung up on, " << f_server.cancelled() << " cancelled" << std::endl;
+	cacheSummary(f_cache);
+
+	return 0;
+}
+
+/// <summary>
+/// Headless Mandelbrot.
+/// </summary>
+/// <returns>0 once the image is written, 1 on a bad command line or a failed write.</returns>
+int main(int argc, char **argv)
+{
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		std::ofstream f_file(argc > 2 ? argv[2] : "benchmark.txt");
+		Benchmark::run(f_file);
+
+		return 0;
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--check-widths")
+	{
+		return Benchmark::widths(std::cout) ? 0 : 1;
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--check-float")
+	{
+		return Benchmark::floatViews(std::cout) ? 0 : 1;
+	}
+
+	HeadlessOptions f_options;
+
+	if (!parseOptions(argc, argv, f_options))
+	{
+		usage();
+		return 1;
+	}
+
+	if (!f_options.m_recolour.empty())
+	{
+		return recolour(f_options);
+	}
+
+	if (!f_options.m_pyramid.empty())
+	{
+		return pyramid(f_options);
+	}
+
+	if (f_options.m_serve >= 0)
+	{
+		return serve(f_options);
+	}
+
+	if (f_options.m_loadTest >= 0)
+	{
+		LoadTest f_loadTest(f_options.m_loadTest);
+		f_loadTest.m_clients = f_options.m_clients;
+		f_loadTest.m_requests = f_options.m_requests;
+		f_loadTest.m_levels = f_options.m_levels;
+		f_loadTest.m_drop = f_options.m_drop;
+
+		return f_loadTest.run(std::cout) ? 0 : 1;
+	}
+
+	if (!f_options.m_animate.empty())
+	{
+		return animate(f_options);
+	}
+
+	if (!f_options.m_worker.empty())
+	{
+		return FarmWorker::run(f_options.m_worker);
+	}
+
+	if (f_options.m_farm >= 0)
+	{
+		return farm(f_options, argv[0]);
+	}
+
+	// Only the float fractions are kept in a counts file
+	if (!f_options.m_counts.empty() && f_options.m_smoothFormat != SmoothFormat::None)
+	{
+		f_options.m_smoothFormat = SmoothFormat::Float32;
+	}
+
+	Viewport f_viewport(f_options.m_width, f_options.m_height);
+	f_viewport.setScale(1.0 / f_options.m_spacing);
+	f_viewport.setCentre(
+		HighPrecision::fromString(f_options.m_centreX, f_viewport.precisionLimbs()),
+		HighPrecision::fromString(f_options.m_centreY, f_viewport.precisionLimbs()));
+
+	HeadlessImage f_image;
+	bool f_hasImage = !f_options.m_output.empty();
+
+	if (f_hasImage && !openImage(f_options.m_output, f_options.m_width, f_options.m_height, f_image))
+	{
+		std::cerr << "couldn't write " << f_options.m_output << "\n";
+		return 1;
+	}
+
+	CountFile f_counts;
+	Checkpoint f_checkpoint(f_counts);
+	bool f_hasCounts = !f_options.m_counts.empty();
+
+	if (f_hasCounts)
+	{
+		bool f_smooth = f_options.m_smoothFormat != SmoothFormat::None;
+
+		f_counts.m_header.m_width = uint32_t(f_options.m_width);
+		f_counts.m_header.m_height = uint32_t(f_options.m_height);
+		f_counts.m_header.m_iterations = uint32_t(f_options.m_iterations);
+		f_counts.m_header.m_kernel = uint32_t(Renderer::chooseKernel(f_viewport.pixelSpacing(), f_options.m_exponent, f_options.m_julia, f_options.m_reproducible));
+		f_counts.m_header.m_exponent = uint32_t(f_options.m_exponent);
+		f_counts.m_header.m_flags = (f_smooth ? CountFile::FLAG_SMOOTH : 0) | (f_options.m_boundary ? CountFile::FLAG_DISTANCE : 0)
+			| (f_options.m_julia ? CountFile::FLAG_JULIA : 0);
+
+		// Without antialiasing the colours follow from the counts, so a checkpoint only keeps them otherwise
+		if (f_options.m_checkpoint && f_options.m_antialias)
+		{
+			f_counts.m_header.m_flags |= CountFile::FLAG_PIXELS;
+		}
+		f_counts.m_header.m_spacing = f_options.m_spacing;
+		f_counts.m_header.m_juliaCr = f_options.m_juliaC.x;
+		f_counts.m_header.m_juliaCi = f_options.m_juliaC.y;
+		f_counts.m_centreX = f_options.m_centreX;
+		f_counts.m_centreY = f_options.m_centreY;
+
+		if (f_options.m_checkpoint ? !f_checkpoint.open(f_options.m_counts, settings(f_options)) : !f_counts.create(f_options.m_counts))
+		{
+			std::cerr << "couldn't write " << f_options.m_counts << "\n";
+			return 1;
+		}
+	}
+
+	TileCache f_cache(Globals::TILE_CACHE_MEMORY, f_options.m_cache);
+	Renderer f_renderer(f_options.m_width, f_options.m_bandRows);
+	f_renderer.m_cache = f_options.m_cache.empty() ? nullptr : &f_cache;
+	f_renderer.m_iterations = f_options.m_iterations;
+	f_renderer.m_exponent = f_options.m_exponent;
+	f_renderer.m_julia = f_options.m_julia;
+	f_renderer.m_juliaC = f_options.m_juliaC;
+	f_renderer.m_smoothFormat = f_options.m_smoothFormat;
+	f_renderer.m_boundary = f_options.m_boundary;
+	f_renderer.m_antialias = f_options.m_antialias;
+	f_renderer.m_interiorChecks = f_options.m_interiorChecks;
+	f_renderer.m_palette.setStops(paletteStops(f_options.m_palette));
+	f_renderer.m_kernel = Renderer::chooseKernel(f_viewport.pixelSpacing(), f_options.m_exponent, f_options.m_julia, f_options.m_reproducible);
+
+	// Each band is handed to a writer thread so it is compressed while the pool computes the next one.
+	// The last band is rendered full height and only the rows inside the image are written.
+	const size_t f_bandSize = size_t(f_options.m_width) * size_t(f_options.m_bandRows);
+	std::vector<uint32_t> f_band(f_hasImage || f_options.m_checkpoint ? f_bandSize : 0);
+	f_renderer.buildPalette();
+	std::vector<int> f_bandCounts(f_hasCounts ? f_bandSize : 0);
+	std::vector<float> f_bandSmooth(f_hasCounts && (f_counts.m_header.m_flags & CountFile::FLAG_SMOOTH) != 0 ? f_bandSize : 0);
+	std::vector<float> f_bandDistance(f_hasCounts && f_options.m_boundary ? f_bandSize : 0);
+	std::thread f_writer;
+	bool f_written = true;
+
+	auto f_start = std::chrono::high_resolution_clock::now();
+
+	for (int f_y = 0; f_y < f_options.m_height; f_y += f_options.m_bandRows)
+	{
+		int f_rows = std::min(f_options.m_bandRows, f_options.m_height - f_y);
+		bool f_finished = f_options.m_checkpoint && f_checkpoint.finished(f_y);
+
+		if (!f_finished)
+		{
+			f_renderer.render(f_viewport, Vector2(0, f_y));
+		}
+
+		if (f_writer.joinable())
+		{
+			f_writer.join();
+		}
+
+		// A band an earlier run finished is read back and coloured again instead of rendered
+		if (f_finished)
+		{
+			if (f_hasImage)
+			{
+				f_writer = std::thread([&, f_y, f_rows]
+				{
+					bool f_bandWritten = f_counts.readRows(f_y, f_rows, f_bandCounts.data(), f_bandSmooth.data(), f_bandDistance.data(), f_band.data());
+
+					if ((f_counts.m_header.m_flags & CountFile::FLAG_PIXELS) == 0)
+					{
+						colourBand(f_renderer.m_palette, f_bandCounts.data(), f_bandSmooth.empty() ? nullptr : f_bandSmooth.data(),
+							f_bandDistance.empty() ? nullptr : f_bandDistance.data(), f_band.data(), f_options.m_width * f_rows);
+					}
+
+					f_written = f_bandWritten && writeRows(f_image, f_band.data(), f_rows) && f_written;
+				});
+			}
+
+			continue;
+		}
+
+		size_t f_size = size_t(f_options.m_width) * size_t(f_rows);
+
+		if (!f_band.empty())
+		{
+			std::copy(f_renderer.pixels(), f_renderer.pixels() + f_size, f_band.begin());
+		}
+
+		if (f_hasCounts)
+		{
+			std::copy(f_renderer.fractal(), f_renderer.fractal() + f_size, f_bandCounts.begin());
+
+			if (!f_bandSmooth.empty())
+			{
+				std::copy((const float *)f_renderer.smooth(), (const float *)f_renderer.smooth() + f_size, f_bandSmooth.begin());
+			}
+
+			if (!f_bandDistance.empty())
+			{
+				std::copy(f_renderer.distance(), f_renderer.distance() + f_size, f_bandDistance.begin());
+			}
+		}
+
+		f_writer = std::thread([&, f_y, f_rows]
+		{
+			bool f_bandWritten = !f_hasImage || writeRows(f_image, f_band.data(), f_rows);
+
+			if (f_options.m_checkpoint)
+			{
+				f_bandWritten = f_checkpoint.writeBand(f_y, f_rows, f_bandCounts.data(), f_bandSmooth.data(), f_bandDistance.data(), f_band.data()) && f_bandWritten;
+			}
+			else if (f_hasCounts)
+			{
+				f_bandWritten = f_counts.writeRows(f_y, f_rows, f_bandCounts.data(), f_bandSmooth.data(), f_bandDistance.data()) && f_bandWritten;
+			}
+
+			f_written = f_bandWritten && f_written;
+		});
+	}
+
+	if (f_writer.joinable())
+	{
+		f_writer.join();
+	}
+
+	f_written = (!f_hasImage || closeImage(f_image)) && f_written;
+	f_written = (!f_options.m_checkpoint || f_checkpoint.sync()) && f_written;
+	f_counts.close();
+	std::chrono::duration<double> f_time = std::chrono::high_resolution_clock::now() - f_start;
+
+	if (!f_written)
+	{
+		std::cerr << "couldn't write " << (f_hasImage ? f_options.m_output : f_options.m_counts) << "\n";
+		return 1;
+	}
+
+	std::cout << f_options.m_width << "x" << f_options.m_height << " in bands of " << f_options.m_bandRows << " rows "
+		<< f_renderer.kernelName()
+		<< " " << f_time.count() << "s ->" << (f_hasImage ? " " + f_options.m_output : "") << (f_hasCounts ? " " + f_options.m_counts : "") << std::endl;
+
+	if (f_options.m_checkpoint)
+	{
+		std::cout << f_checkpoint.resumed() << " bands resumed, checkpoint " << f_checkpoint.seconds() << "s ("
+			<< 100.0 * f_checkpoint.seconds() / f_time.count() << "% of the render)" << std::endl;
+	}
+
+	if (!f_options.m_cache.empty())
+	{
+		cacheSummary(f_cache);
+	}
+
+	return 0;
+}
@@ -0,0 +1,463 @@
+#include "HighPrecision.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// <summary>
+/// HighPrecision constructor. The value is zero with only an integer limb.
+/// </summary>
+HighPrecision::HighPrecision() : m_limbs(1, 0)
+{
+
+}
+
+/// <summary>
+/// HighPrecision constructor. Bits of the double that fall below the last limb are truncated.
+/// </summary>
+/// <param name="t_value">The value.</param>
+/// <param name="t_limbs">The number of limbs, including the integer limb.</param>
+HighPrecision::HighPrecision(double t_value, int t_limbs) : m_limbs(std::max(t_limbs, 1), 0)
+{
+	if (t_value == 0.0 || !std::isfinite(t_value))
+	{
+		return;
+	}
+
+	m_negative = t_value < 0.0;
+
+	// value = mantissa * 2^(exponent - 53), with a 53-bit integer mantissa
+	int f_exponent;
+	double f_fraction = std::frexp(std::fabs(t_value), &f_exponent);
+	uint64_t f_mantissa = uint64_t(std::ldexp(f_fraction, 53));
+
+	// Bit position of the mantissa's lowest bit, counted up from the lowest bit of the last limb
+	int f_shift = f_exponent - 53 + 32 * (int(m_limbs.size()) - 1);
+
+	for (int i = 0; i < 53; i++)
+	{
+		int f_bit = f_shift + i;
+
+		if (f_bit < 0 || ((f_mantissa >> i) & 1) == 0)
+		{
+			continue;
+		}
+
+		size_t f_limb = size_t(f_bit / 32);
+
+		if (f_limb < m_limbs.size())
+		{
+			m_limbs[m_limbs.size() - 1 - f_limb] |= uint32_t(1) << (f_bit % 32);
+		}
+	}
+
+	if (isZero())
+	{
+		m_negative = false;
+	}
+}
+
+/// <summary>
+/// HighPrecision destructor.
+/// </summary>
+HighPrecision::~HighPrecision()
+{
+
+}
+
+/// <summary>
+/// Parses a decimal string such as "-0.7436438870371587" or "1.5e-20".
+/// Unparsable characters end the number.
+/// </summary>
+/// <param name="t_decimal">The decimal string.</param>
+/// <param name="t_limbs">The number of limbs, including the integer limb.</param>
+/// <returns>The parsed value.</returns>
+HighPrecision HighPrecision::fromString(const std::string &t_decimal, int t_limbs)
+{
+	HighPrecision f_result(0.0, t_limbs);
+	std::string f_digits;
+	int f_pointPosition = -1;
+	size_t i = 0;
+	bool f_negative = false;
+
+	if (i < t_decimal.size() && (t_decimal[i] == '-' || t_decimal[i] == '+'))
+	{
+		f_negative = t_decimal[i] == '-';
+		i++;
+	}
+
+	for (; i < t_decimal.size(); i++)
+	{
+		if (t_decimal[i] >= '0' && t_decimal[i] <= '9')
+		{
+			f_digits += t_decimal[i];
+		}
+		else if (t_decimal[i] == '.' && f_pointPosition < 0)
+		{
+			f_pointPosition = int(f_digits.size());
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (f_pointPosition < 0)
+	{
+		f_pointPosition = int(f_digits.size());
+	}
+
+	int f_exponent = f_pointPosition;
+
+	if (i < t_decimal.size() && (t_decimal[i] == 'e' || t_decimal[i] == 'E'))
+	{
+		f_exponent += std::atoi(t_decimal.c_str() + i + 1);
+	}
+
+	// Horner's rule from the last digit gives 0.digits, then shift by the decimal exponent
+	for (size_t j = f_digits.size(); j > 0; j--)
+	{
+		f_result.m_limbs[0] += uint32_t(f_digits[j - 1] - '0');
+		f_result.divideMagnitude(10);
+	}
+
+	for (; f_exponent > 0; f_exponent--)
+	{
+		f_result.multiplyMagnitude(10);
+	}
+
+	for (; f_exponent < 0; f_exponent++)
+	{
+		f_result.divideMagnitude(10);
+	}
+
+	f_result.m_negative = f_negative && !f_result.isZero();
+
+	return f_result;
+}
+
+/// <summary>
+/// Formats the value as a decimal string.
+/// </summary>
+/// <param name="t_digits">The number of digits after the decimal point.</param>
+/// <returns>The decimal string.</returns>
+std::string HighPrecision::toString(int t_digits) const
+{
+	std::string f_result = (m_negative ? "-" : "") + std::to_string(m_limbs[0]) + ".";
+	HighPrecision f_fraction = *this;
+	f_fraction.m_limbs[0] = 0;
+
+	for (int i = 0; i < t_digits; i++)
+	{
+		f_fraction.multiplyMagnitude(10);
+		f_result += char('0' + f_fraction.m_limbs[0]);
+		f_fraction.m_limbs[0] = 0;
+	}
+
+	return f_result;
+}
+
+/// <summary>
+/// Converts to the nearest double.
+/// </summary>
+/// <returns>The value as a double.</returns>
+double HighPrecision::toDouble() const
+{
+	double f_result = 0.0;
+
+	// Sum from the least significant limb so the big terms are added last
+	for (size_t i = m_limbs.size(); i > 0; i--)
+	{
+		f_result += std::ldexp(double(m_limbs[i - 1]), -32 * int(i - 1));
+	}
+
+	return m_negative ? -f_result : f_result;
+}
+
+/// <summary>
+/// Converts to a double-double, which keeps about 106 bits.
+/// </summary>
+/// <returns>The value as a double-double.</returns>
+DoubleDouble HighPrecision::toDoubleDouble() const
+{
+	double f_hi = toDouble();
+	HighPrecision f_remainder = *this - HighPrecision(f_hi, limbs());
+
+	return DoubleDouble(f_hi, f_remainder.toDouble());
+}
+
+/// <summary>
+/// Changes the number of limbs, truncating or zero extending the fraction.
+/// </summary>
+/// <param name="t_limbs">The number of limbs, including the integer limb.</param>
+void HighPrecision::setLimbs(int t_limbs)
+{
+	m_limbs.resize(size_t(std::max(t_limbs, 1)), 0);
+
+	if (isZero())
+	{
+		m_negative = false;
+	}
+}
+
+/// <summary>
+/// Gets the number of limbs, including the integer limb.
+/// </summary>
+/// <returns>The number of limbs.</returns>
+int HighPrecision::limbs() const
+{
+	return int(m_limbs.size());
+}
+
+/// <summary>
+/// Checks for zero.
+/// </summary>
+/// <returns>True if every limb is zero.</returns>
+bool HighPrecision::isZero() const
+{
+	for (uint32_t f_limb : m_limbs)
+	{
+		if (f_limb != 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Overload of the plus operator. The result has the larger precision of the two.
+/// </summary>
+/// <param name="t_other">The 2nd value.</param>
+/// <returns>The sum.</returns>
+HighPrecision HighPrecision::operator+(const HighPrecision &t_other) const
+{
+	return addSigned(*this, t_other, false);
+}
+
+/// <summary>
+/// Overload of the minus operator. The result has the larger precision of the two.
+/// </summary>
+/// <param name="t_other">The 2nd value.</param>
+/// <returns>The difference.</returns>
+HighPrecision HighPrecision::operator-(const HighPrecision &t_other) const
+{
+	return addSigned(*this, t_other, true);
+}
+
+/// <summary>
+/// Overload of the multiplication operator. The product is truncated to the larger precision of the two.
+/// </summary>
+/// <param name="t_other">The 2nd value.</param>
+/// <returns>The product.</returns>
+HighPrecision HighPrecision::operator*(const HighPrecision &t_other) const
+{
+	size_t f_size = std::max(m_limbs.size(), t_other.m_limbs.size());
+
+	// Shorter values have fewer fraction limbs, so pad them at the least significant end
+	std::vector<uint32_t> f_a = m_limbs;
+	std::vector<uint32_t> f_b = t_other.m_limbs;
+	f_a.resize(f_size, 0);
+	f_b.resize(f_size, 0);
+
+	std::vector<uint32_t> f_product(f_size * 2, 0);
+
+	// Schoolbook multiplication with limbs indexed from the least significant end
+	for (size_t i = 0; i < f_size; i++)
+	{
+		uint64_t f_limbA = f_a[f_size - 1 - i];
+
+		if (f_limbA == 0)
+		{
+			continue;
+		}
+
+		uint64_t f_carry = 0;
+
+		for (size_t j = 0; j < f_size; j++)
+		{
+			uint64_t f_sum = f_limbA * f_b[f_size - 1 - j] + f_product[i + j] + f_carry;
+			f_product[i + j] = uint32_t(f_sum);
+			f_carry = f_sum >> 32;
+		}
+
+		f_product[i + f_size] = uint32_t(f_carry);
+	}
+
+	HighPrecision f_result(0.0, int(f_size));
+
+	for (size_t k = 0; k < f_size; k++)
+	{
+		f_result.m_limbs[f_size - 1 - k] = f_product[k + f_size - 1];
+	}
+
+	f_result.m_negative = (m_negative != t_other.m_negative) && !f_result.isZero();
+
+	return f_result;
+}
+
+/// <summary>
+/// Overload of the unary negative operator.
+/// </summary>
+/// <returns>The negated value.</returns>
+HighPrecision HighPrecision::operator-() const
+{
+	HighPrecision f_result = *this;
+	f_result.m_negative = !m_negative && !isZero();
+
+	return f_result;
+}
+
+/// <summary>
+/// Overload of the plus-equals operator (double). The precision is kept.
+/// </summary>
+/// <param name="t_value">The value to add.</param>
+/// <returns>This value.</returns>
+HighPrecision &HighPrecision::operator+=(double t_value)
+{
+	*this = addSigned(*this, HighPrecision(t_value, limbs()), false);
+
+	return *this;
+}
+
+/// <summary>
+/// Overload of the minus-equals operator (double). The precision is kept.
+/// </summary>
+/// <param name="t_value">The value to subtract.</param>
+/// <returns>This value.</returns>
+HighPrecision &HighPrecision::operator-=(double t_value)
+{
+	*this = addSigned(*this, HighPrecision(t_value, limbs()), true);
+
+	return *this;
+}
+
+/// <summary>
+/// Compares the magnitudes of two values.
+/// </summary>
+/// <param name="t_other">The 2nd value.</param>
+/// <returns>-1, 0 or 1 as |this| is less than, equal to or greater than |other|.</returns>
+int HighPrecision::compareMagnitude(const HighPrecision &t_other) const
+{
+	size_t f_size = std::max(m_limbs.size(), t_other.m_limbs.size());
+
+	for (size_t i = 0; i < f_size; i++)
+	{
+		uint32_t f_a = i < m_limbs.size() ? m_limbs[i] : 0;
+		uint32_t f_b = i < t_other.m_limbs.size() ? t_other.m_limbs[i] : 0;
+
+		if (f_a != f_b)
+		{
+			return f_a < f_b ? -1 : 1;
+		}
+	}
+
+	return 0;
+}
+
+/// <summary>
+/// Adds the magnitude of another value to this one. The limb count must be at least the other's.
+/// </summary>
+/// <param name="t_other">The 2nd value.</param>
+void HighPrecision::addMagnitude(const HighPrecision &t_other)
+{
+	uint64_t f_carry = 0;
+
+	for (size_t i = m_limbs.size(); i > 0; i--)
+	{
+		uint64_t f_sum = uint64_t(m_limbs[i - 1]) + (i - 1 < t_other.m_limbs.size() ? t_other.m_limbs[i - 1] : 0) + f_carry;
+		m_limbs[i - 1] = uint32_t(f_sum);
+		f_carry = f_sum >> 32;
+	}
+}
+
+/// <summary>
+/// Subtracts the magnitude of a smaller value from this one. The limb count must be at least the other's.
+/// </summary>
+/// <param name="t_other">The 2nd value.</param>
+void HighPrecision::subtractMagnitude(const HighPrecision &t_other)
+{
+	int64_t f_borrow = 0;
+
+	for (size_t i = m_limbs.size(); i > 0; i--)
+	{
+		int64_t f_difference = int64_t(m_limbs[i - 1]) - (i - 1 < t_other.m_limbs.size() ? t_other.m_limbs[i - 1] : 0) - f_borrow;
+		f_borrow = f_difference < 0 ? 1 : 0;
+		m_limbs[i - 1] = uint32_t(f_difference + (f_borrow << 32));
+	}
+}
+
+/// <summary>
+/// Multiplies the magnitude by a small integer.
+/// </summary>
+/// <param name="t_factor">The factor.</param>
+void HighPrecision::multiplyMagnitude(uint32_t t_factor)
+{
+	uint64_t f_carry = 0;
+
+	for (size_t i = m_limbs.size(); i > 0; i--)
+	{
+		uint64_t f_product = uint64_t(m_limbs[i - 1]) * t_factor + f_carry;
+		m_limbs[i - 1] = uint32_t(f_product);
+		f_carry = f_product >> 32;
+	}
+}
+
+/// <summary>
+/// Divides the magnitude by a small integer, truncating.
+/// </summary>
+/// <param name="t_divisor">The divisor.</param>
+void HighPrecision::divideMagnitude(uint32_t t_divisor)
+{
+	uint64_t f_remainder = 0;
+
+	for (size_t i = 0; i < m_limbs.size(); i++)
+	{
+		uint64_t f_current = (f_remainder << 32) | m_limbs[i];
+		m_limbs[i] = uint32_t(f_current / t_divisor);
+		f_remainder = f_current % t_divisor;
+	}
+}
+
+/// <summary>
+/// Adds or subtracts two signed values.
+/// </summary>
+/// <param name="t_a">The 1st value.</param>
+/// <param name="t_b">The 2nd value.</param>
+/// <param name="t_negateB">True to subtract the 2nd value.</param>
+/// <returns>The result, with the larger precision of the two.</returns>
+HighPrecision HighPrecision::addSigned(const HighPrecision &t_a, const HighPrecision &t_b, bool t_negateB)
+{
+	int f_limbs = std::max(t_a.limbs(), t_b.limbs());
+	bool f_negativeB = t_b.m_negative != t_negateB;
+	HighPrecision f_result;
+
+	if (t_a.m_negative == f_negativeB)
+	{
+		f_result = t_a;
+		f_result.setLimbs(f_limbs);
+		f_result.addMagnitude(t_b);
+		f_result.m_negative = t_a.m_negative;
+	}
+	else if (t_a.compareMagnitude(t_b) >= 0)
+	{
+		f_result = t_a;
+		f_result.setLimbs(f_limbs);
+		f_result.subtractMagnitude(t_b);
+		f_result.m_negative = t_a.m_negative;
+	}
+	else
+	{
+		f_result = t_b;
+		f_result.setLimbs(f_limbs);
+		f_result.subtractMagnitude(t_a);
+		f_result.m_negative = f_negativeB;
+	}
+
+	if (f_result.isZero())
+	{
+		f_result.m_negative = false;
+	}
+
+	return f_result;
+}
@@ -0,0 +1,354 @@
+#include "WorkerThread.h"
+#include "KernelFamily.h"
+
+#include <algorithm>
+
+/// <summary>
+/// Create fractal with a kernel built from its template parameters: the register type T sets
+/// the precision and width, t_exponent the power of z, and t_features the outputs and early-outs.
+/// The flags are constants in each instantiation, so the tests on them fold away and a kernel
+/// without a feature is the same as if the feature had never been written.
+/// </summary>
+template <typename T, int t_exponent, int t_features>
+void WorkerThread::kernelFamily()
+{
+	typedef typename T::Real Real;
+	typedef typename T::Count Count;
+
+	const bool f_smooth = (t_features & KERNEL_SMOOTH) != 0;
+	const bool f_derivative = (t_features & KERNEL_DERIVATIVE) != 0;
+	const bool f_period = (t_features & KERNEL_PERIOD) != 0;
+	const bool f_julia = (t_features & KERNEL_JULIA) != 0;
+	const bool f_bulbCheck = (t_features & KERNEL_BULB_CHECK) != 0 && t_exponent == 2 && !f_julia;
+
+	double f_scaleX = (m_fracBR.x - m_fracTL.x) / (double(m_pixBR.x) - double(m_pixTL.x));
+	double f_scaleY = (m_fracBR.y - m_fracTL.y) / (double(m_pixBR.y) - double(m_pixTL.y));
+
+	Real __f_bailout = T::set1(f_smooth || f_derivative ? Globals::SMOOTH_BAILOUT * Globals::SMOOTH_BAILOUT : 4.0);
+	Real __f_offsets = T::mul(T::lanes(), T::set1(f_scaleX));
+	Real __f_one = T::set1(1.0);
+	Real __f_exponent = T::set1(t_exponent);
+	Real __f_quarter = T::set1(0.25);
+	Real __f_sixteenth = T::set1(0.0625);
+	Real __f_tolerance = T::set1(f_scaleX * Globals::PERIOD_TOLERANCE);
+	Real __f_all = T::lessEqual(T::zero(), T::zero());
+	Real __f_juliaR = T::set1(m_juliaC.x);
+	Real __f_juliaI = T::set1(m_juliaC.y);
+
+	// dz/dc picks up 1 each iteration, dz/dz0 for Julia starts at 1 instead
+	Real __f_dzStep = f_julia ? T::zero() : __f_one;
+	Count __f_iterations = T::count(m_iterations);
+	Count __f_step = T::count(1);
+
+	alignas(32) int f_n[8];
+	alignas(32) int f_p[8];
+	double f_zNorm[8];
+	double f_dzNorm[8];
+	float f_norm[8];
+
+	for (int f_y = int(m_pixTL.y); f_y < int(m_pixBR.y); f_y++)
+	{
+		int f_offsetY = f_y * m_screenWidth;
+		int *f_counts = countRow(f_offsetY);
+
+		Real __f_posY = T::set1(m_fracTL.y + (f_y - m_pixTL.y) * f_scaleY);
+
+		for (int f_x = int(m_pixTL.x); f_x < int(m_pixBR.x); f_x += T::WIDTH)
+		{
+			Real __f_posX = T::add(T::set1(m_fracTL.x + (f_x - m_pixTL.x) * f_scaleX), __f_offsets);
+
+			// Mandelbrot iterates from z = 0 with c at the pixel, Julia from z at the pixel with c fixed
+			Real __f_CR = f_julia ? __f_juliaR : __f_posX;
+			Real __f_CI = f_julia ? __f_juliaI : __f_posY;
+			Real __f_ZR = f_julia ? __f_posX : T::zero();
+			Real __f_ZI = f_julia ? __f_posY : T::zero();
+			Real __f_DZR = f_julia ? __f_one : T::zero();
+			Real __f_DZI = T::zero();
+			Real __f_SR = T::zero();
+			Real __f_SI = T::zero();
+			Real __f_norm = T::zero();
+			Real __f_dzNorm = T::zero();
+			Real __f_active = __f_all;
+			Count __f_N = T::count(0);
+			Count __f_P = T::count(0);
+
+			int f_saved = 0;
+			int f_nextSave = 1;
+
+			// Points in the main cardioid or the period-2 bulb start at the iteration limit and never run
+			if (f_bulbCheck)
+			{
+				Real __f_XQ = T::sub(__f_CR, __f_quarter);
+				Real __f_CI2 = T::mul(__f_CI, __f_CI);
+				Real __f_Q = T::fmadd(__f_XQ, __f_XQ, __f_CI2);
+				Real __f_cardioid = T::lessEqual(T::mul(__f_Q, T::add(__f_Q, __f_XQ)), T::mul(__f_quarter, __f_CI2));
+				Real __f_X1 = T::add(__f_CR, __f_one);
+				Real __f_bulb = T::lessEqual(T::fmadd(__f_X1, __f_X1, __f_CI2), __f_sixteenth);
+				__f_N = T::countBlend(__f_N, __f_iterations, T::either(__f_cardioid, __f_bulb));
+			}
+
+			for (int k = 1; ; k++)
+			{
+				Real __f_PR;
+				Real __f_PI;
+				Real __f_dzNormNow;
+
+				// With the derivative, z^(d - 1) serves both dz and z^d.
+				// dz = d * z^(d - 1) * dz + 1, from the z and dz of this iteration (no + 1 for Julia)
+				if (f_derivative)
+				{
+					Real __f_WR;
+					Real __f_WI;
+					ComplexPower<T, t_exponent - 1>::apply(__f_ZR, __f_ZI, __f_WR, __f_WI);
+
+					__f_dzNormNow = T::fmadd(__f_DZR, __f_DZR, T::mul(__f_DZI, __f_DZI));
+					Real __f_A = T::fmsub(__f_WR, __f_DZR, T::mul(__f_WI, __f_DZI));
+					__f_DZI = T::mul(__f_exponent, T::fmadd(__f_WR, __f_DZI, T::mul(__f_WI, __f_DZR)));
+					__f_DZR = T::fmadd(__f_exponent, __f_A, __f_dzStep);
+
+					__f_PR = T::fmsub(__f_WR, __f_ZR, T::mul(__f_WI, __f_ZI));
+					__f_PI = T::fmadd(__f_WR, __f_ZI, T::mul(__f_WI, __f_ZR));
+				}
+				else
+				{
+					ComplexPower<T, t_exponent>::apply(__f_ZR, __f_ZI, __f_PR, __f_PI);
+				}
+
+				Real __f_zNorm = T::fmadd(__f_ZR, __f_ZR, T::mul(__f_ZI, __f_ZI));
+				__f_ZR = T::add(__f_PR, __f_CR);
+				__f_ZI = T::add(__f_PI, __f_CI);
+
+				Real __f_mask = T::both(T::less(__f_zNorm, __f_bailout), T::countLess(__f_N, __f_iterations));
+
+				// Brent's method: an orbit that comes back to the saved point is periodic and never escapes
+				if (f_period)
+				{
+					Real __f_close = T::both(T::less(T::abs(T::sub(__f_ZR, __f_SR)), __f_tolerance), T::less(T::abs(T::sub(__f_ZI, __f_SI)), __f_tolerance));
+					__f_close = T::both(__f_close, __f_mask);
+					__f_N = T::countBlend(__f_N, __f_iterations, __f_close);
+					__f_P = T::countBlend(__f_P, T::count(k - f_saved), __f_close);
+					__f_mask = T::without(__f_mask, __f_close);
+
+					if (k == f_nextSave)
+					{
+						__f_SR = __f_ZR;
+						__f_SI = __f_ZI;
+						f_saved = k;
+						f_nextSave *= 2;
+					}
+				}
+
+				__f_N = T::countAdd(__f_N, __f_step, __f_mask);
+
+				// Lanes that were still running last time round take this |z|^2 (and |dz|^2)
+				if (f_smooth || f_derivative)
+				{
+					__f_norm = T::blend(__f_norm, __f_zNorm, __f_active);
+
+					if (f_derivative)
+					{
+						__f_dzNorm = T::blend(__f_dzNorm, __f_dzNormNow, __f_active);
+					}
+				}
+
+				__f_active = __f_mask;
+
+				if (!T::any(__f_mask))
+				{
+					break;
+				}
+			}
+
+			// Only lanes inside the section are written
+			int f_lanes = std::min(int(m_pixBR.x) - f_x, int(T::WIDTH));
+			T::storeCounts(&f_counts[f_x], __f_N, f_lanes);
+
+			if (f_smooth || f_derivative || f_period)
+			{
+				T::storeCounts(f_n, __f_N, T::WIDTH);
+				T::store(f_zNorm, __f_norm);
+			}
+
+			if (f_smooth)
+			{
+				for (int i = 0; i < T::WIDTH; i++)
+				{
+					f_norm[i] = float(f_zNorm[i]);
+				}
+
+				storeSmooth(f_offsetY + f_x, f_n, f_norm, f_lanes);
+			}
+
+			if (f_derivative)
+			{
+				T::store(f_dzNorm, __f_dzNorm);
+				storeDistance(f_offsetY + f_x, f_n, f_zNorm, f_dzNorm, f_scaleX, f_lanes);
+			}
+
+			if (f_period && m_period != nullptr)
+			{
+				T::storeCounts(f_p, __f_P, T::WIDTH);
+				std::copy(f_p, f_p + f_lanes, &m_period[f_offsetY + f_x]);
+			}
+		}
+
+		finishRow(f_offsetY, f_counts);
+	}
+}
+
+#pragma region registry
+
+/// <summary>
+/// Whether a feature combination is worth a kernel.
+/// </summary>
+constexpr bool validFeatures(int t_exponent, int t_features)
+{
+	return t_features >= 0 && ((t_features & KERNEL_BULB_CHECK) == 0 || (t_exponent == 2 && (t_features & KERNEL_JULIA) == 0));
+}
+
+/// <summary>
+/// Adds an instantiation for every feature combination up to t_features. Combinations that
+/// mean nothing are skipped without being instantiated: the cardioid and bulb test is only for
+/// the z^2 Mandelbrot set.
+/// </summary>
+template <typename T, int t_exponent, int t_features, bool t_valid>
+struct KernelRegistration
+{
+	static const int NEXT = t_features - 1;
+
+	static void add(std::vector<KernelEntry> &t_entries, Kernel t_kernel)
+	{
+		KernelRegistration<T, t_exponent, NEXT, validFeatures(t_exponent, NEXT)>::add(t_entries, t_kernel);
+		t_entries.push_back({ t_kernel, T::WIDTH, t_exponent, t_features, false, &WorkerThread::kernelFamily<T, t_exponent, t_features> });
+	}
+};
+
+template <typename T, int t_exponent, int t_features>
+struct KernelRegistration<T, t_exponent, t_features, false>
+{
+	static const int NEXT = t_features - 1;
+
+	static void add(std::vector<KernelEntry> &t_entries, Kernel t_kernel)
+	{
+		KernelRegistration<T, t_exponent, NEXT, validFeatures(t_exponent, NEXT)>::add(t_entries, t_kernel);
+	}
+};
+
+template <typename T, int t_exponent>
+struct KernelRegistration<T, t_exponent, -1, false>
+{
+	static void add(std::vector<KernelEntry> &, Kernel)
+	{
+	}
+};
+
+/// <summary>
+/// Every kernel that can be picked at runtime. The hand-written float and double kernels come
+/// first and are preferred where they cover the features, the template family fills in the rest.
+/// </summary>
+/// <returns>The registered kernels.</returns>
+const std::vector<KernelEntry> &WorkerThread::kernelRegistry()
+{
+	static const std::vector<KernelEntry> s_entries = []()
+	{
+		std::vector<KernelEntry> f_entries =
+		{
+			{ Kernel::Float, 8, 2, 0, true, &WorkerThread::kernelFloat<false> },
+			{ Kernel::Float, 8, 2, KERNEL_SMOOTH, true, &WorkerThread::kernelFloat<true> },
+			{ Kernel::Double, 8, 2, 0, true, &WorkerThread::kernelDouble<false, false> },
+			{ Kernel::Double, 8, 2, KERNEL_SMOOTH, true, &WorkerThread::kernelDouble<true, false> },
+			{ Kernel::Double, 8, 2, KERNEL_DERIVATIVE, true, &WorkerThread::kernelDouble<false, true> },
+			{ Kernel::Double, 8, 2, KERNEL_SMOOTH | KERNEL_DERIVATIVE, true, &WorkerThread::kernelDouble<true, true> }
+		};
+
+		KernelRegistration<SimdFloat8, 2, KERNEL_FEATURES - 1, true>::add(f_entries, Kernel::Float);
+		KernelRegistration<SimdDouble4, 2, KERNEL_FEATURES - 1, true>::add(f_entries, Kernel::Double);
+		KernelRegistration<SimdDouble2, 2, KERNEL_FEATURES - 1, true>::add(f_entries, Kernel::Double);
+
+		// Multibrot z^d, each with its own expansion of the power
+		KernelRegistration<SimdFloat8, 3, KERNEL_FEATURES - 1, true>::add(f_entries, Kernel::Float);
+		KernelRegistration<SimdDouble4, 3, KERNEL_FEATURES - 1, true>::add(f_entries, Kernel::Double);
+		KernelRegistration<SimdFloat8, 4, KERNEL_FEATURES - 1, true>::add(f_entries, Kernel::Float);
+		KernelRegistration<SimdDouble4, 4, KERNEL_FEATURES - 1, true>::add(f_entries, Kernel::Double);
+		KernelRegistration<SimdFloat8, 5, KERNEL_FEATURES - 1, true>::add(f_entries, Kernel::Float);
+		KernelRegistration<SimdDouble4, 5, KERNEL_FEATURES - 1, true>::add(f_entries, Kernel::Double);
+
+		return f_entries;
+	}();
+
+	return s_entries;
+}
+
+/// <summary>
+/// Finds the kernel for a precision, exponent and set of features. Only an exact match on the
+/// features is taken, so no kernel does work that nobody asked for. A hand-written kernel wins
+/// over the template family, then the widest registers win.
+/// </summary>
+/// <param name="t_kernel">The precision, float or double.</param>
+/// <param name="t_exponent">The power of z.</param>
+/// <param name="t_features">The KERNEL_ flags wanted.</param>
+/// <param name="t_width">The register width wanted, or 0 for any.</param>
+/// <returns>The kernel, or nullptr if none was registered.</returns>
+const KernelEntry *WorkerThread::findKernel(Kernel t_kernel, int t_exponent, int t_features, int t_width)
+{
+	const KernelEntry *f_best = nullptr;
+
+	for (const KernelEntry &f_entry : kernelRegistry())
+	{
+		if (f_entry.m_kernel != t_kernel || f_entry.m_exponent != t_exponent || f_entry.m_features != t_features)
+		{
+			continue;
+		}
+
+		if (t_width != 0 && f_entry.m_width != t_width)
+		{
+			continue;
+		}
+
+		if (f_best == nullptr || (f_entry.m_tuned && !f_best->m_tuned) || (f_entry.m_tuned == f_best->m_tuned && f_entry.m_width > f_best->m_width))
+		{
+			f_best = &f_entry;
+		}
+	}
+
+	return f_best;
+}
+
+/// <summary>
+/// Gets a display name for a registered kernel, such as "DOUBLE x4 Z^2 SMOOTH".
+/// </summary>
+/// <param name="t_entry">The kernel.</param>
+/// <returns>The name of the kernel.</returns>
+std::string WorkerThread::entryName(const KernelEntry &t_entry)
+{
+	std::string f_name = std::string(kernelName(t_entry.m_kernel)) + " x" + std::to_string(t_entry.m_width) + " Z^" + std::to_string(t_entry.m_exponent);
+
+	if (t_entry.m_features & KERNEL_SMOOTH)
+	{
+		f_name += " SMOOTH";
+	}
+
+	if (t_entry.m_features & KERNEL_DERIVATIVE)
+	{
+		f_name += " DE";
+	}
+
+	if (t_entry.m_features & KERNEL_PERIOD)
+	{
+		f_name += " PERIOD";
+	}
+
+	if (t_entry.m_features & KERNEL_BULB_CHECK)
+	{
+		f_name += " BULB";
+	}
+
+	if (t_entry.m_features & KERNEL_JULIA)
+	{
+		f_name += " JULIA";
+	}
+
+	return t_entry.m_tuned ? f_name + " TUNED" : f_name;
+}
+
+#pragma endregion
@@ -0,0 +1,357 @@
+#include "LoadTest.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// LoadTest constructor.
+/// </summary>
+/// <param name="t_port">The port the server listens on, on the loopback address.</param>
+LoadTest::LoadTest(int t_port) : m_port{ t_port }
+{
+
+}
+
+/// <summary>
+/// LoadTest destructor.
+/// </summary>
+LoadTest::~LoadTest()
+{
+
+}
+
+/// <summary>
+/// Builds the walk through the pyramid the clients follow. It zooms in and out and pans, and at each
+/// stop asks for the 2 by 2 tiles a small viewer would have on screen.
+/// </summary>
+/// <param name="t_length">The number of tiles.</param>
+void LoadTest::buildWalk(int t_length)
+{
+	std::mt19937 f_random(1);
+	std::uniform_real_distribution<double> f_step(0.0, 1.0);
+	Tile f_at{ 0, 0, 0 };
+
+	m_walk.clear();
+
+	while (int(m_walk.size()) < t_length)
+	{
+		int f_across = 1 << f_at.m_level;
+
+		for (int i = 0; i < 4 && int(m_walk.size()) < t_length; i++)
+		{
+			Tile f_tile{ f_at.m_level, f_at.m_x + (i & 1), f_at.m_y + (i >> 1) };
+
+			if (f_tile.m_x < f_across && f_tile.m_y < f_across)
+			{
+				m_walk.push_back(f_tile);
+			}
+		}
+
+		double f_choice = f_step(f_random);
+
+		if (f_choice < 0.4 && f_at.m_level + 1 < m_levels)
+		{
+			f_at = Tile{ f_at.m_level + 1, f_at.m_x * 2 + int(f_random() & 1), f_at.m_y * 2 + int(f_random() & 1) };
+		}
+		else if (f_choice < 0.6 && f_at.m_level > 0)
+		{
+			f_at = Tile{ f_at.m_level - 1, f_at.m_x / 2, f_at.m_y / 2 };
+		}
+		else
+		{
+			f_at.m_x = std::max(0, std::min(f_across - 1, f_at.m_x + int(f_random() % 3) - 1));
+			f_at.m_y = std::max(0, std::min(f_across - 1, f_at.m_y + int(f_random() % 3) - 1));
+		}
+	}
+}
+
+/// <summary>
+/// Gets the request path of a tile.
+/// </summary>
+/// <param name="t_tile">The tile.</param>
+/// <returns>The path, /z/x/y.png.</returns>
+std::string LoadTest::tilePath(const Tile &t_tile)
+{
+	return "/" + std::to_string(t_tile.m_level) + "/" + std::to_string(t_tile.m_x) + "/" + std::to_string(t_tile.m_y) + ".png";
+}
+
+#ifndef _WIN32
+
+/// <summary>
+/// Runs the clients against the server and writes what they saw.
+/// </summary>
+/// <param name="t_out">The stream to write the results to.</param>
+/// <returns>False if the server couldn't be reached or a request failed.</returns>
+bool LoadTest::run(std::ostream &t_out)
+{
+	int f_probe = connectToServer();
+
+	if (f_probe < 0)
+	{
+		t_out << "couldn't connect to 127.0.0.1:" << m_port << std::endl;
+		return false;
+	}
+
+	close(f_probe);
+
+	int f_perClient = (m_requests + m_clients - 1) / m_clients;
+	buildWalk(f_perClient);
+
+	std::vector<Result> f_results(m_clients);
+	std::vector<std::thread> f_threads;
+
+	t_out << "LOAD TEST (" << m_clients << " clients, " << f_perClient * m_clients << " requests, " << m_drop * 100.0 << "% hung up on, levels 0-" << m_levels - 1
+		<< ", 127.0.0.1:" << m_port << ")" << std::endl;
+
+	auto f_start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < m_clients; i++)
+	{
+		f_threads.emplace_back(&LoadTest::client, this, i, f_perClient, std::ref(f_results[i]));
+	}
+
+	for (std::thread &f_thread : f_threads)
+	{
+		f_thread.join();
+	}
+
+	std::chrono::duration<double> f_time = std::chrono::steady_clock::now() - f_start;
+
+	std::vector<double> f_latencies;
+	int f_errors = 0;
+	int f_dropped = 0;
+
+	for (const Result &f_result : f_results)
+	{
+		f_latencies.insert(f_latencies.end(), f_result.m_latencies.begin(), f_result.m_latencies.end());
+		f_errors += f_result.m_errors;
+		f_dropped += f_result.m_dropped;
+	}
+
+	std::sort(f_latencies.begin(), f_latencies.end());
+
+	auto f_percentile = [&](double t_fraction)
+	{
+		return f_latencies.empty() ? 0.0 : f_latencies[std::min(f_latencies.size() - 1, size_t(t_fraction * f_latencies.size()))] * 1000.0;
+	};
+
+	t_out << f_latencies.size() << " tiles in " << f_time.count() << "s, " << f_latencies.size() / f_time.count() << " tiles/s, "
+		<< f_dropped << " hung up on, " << f_errors << " errors" << std::endl;
+	t_out << "latency: p50 " << f_percentile(0.5) << "ms, p90 " << f_percentile(0.9) << "ms, p99 " << f_percentile(0.99) << "ms, max "
+		<< f_percentile(1.0) << "ms" << std::endl;
+
+	// The server's counters say how many renders the requests came to
+	int f_socket = connectToServer();
+	std::string f_input;
+	std::string f_body;
+	int f_status = 0;
+
+	if (f_socket >= 0 && get(f_socket, "/stats", f_input, f_status, f_body) && f_status == 200)
+	{
+		std::istringstream f_lines(f_body);
+		std::string f_line;
+		std::string f_separator = "server: ";
+
+		while (std::getline(f_lines, f_line))
+		{
+			t_out << f_separator << f_line;
+			f_separator = ", ";
+		}
+
+		t_out << std::endl;
+	}
+
+	if (f_socket >= 0)
+	{
+		close(f_socket);
+	}
+
+	return f_errors == 0;
+}
+
+/// <summary>
+/// Follows the walk as one client, over one connection kept open between requests. Requests that are
+/// hung up on go over a connection of their own, so the main one isn't lost. Runs on its own thread.
+/// </summary>
+/// <param name="t_index">The client, which decides its order and the tiles it hangs up on.</param>
+/// <param name="t_count">The number of requests.</param>
+/// <param name="t_result">What the client saw.</param>
+void LoadTest::client(int t_index, int t_count, Result &t_result) const
+{
+	std::mt19937 f_random(uint32_t(t_index) + 2);
+	std::uniform_real_distribution<double> f_chance(0.0, 1.0);
+	std::vector<Tile> f_walk(m_walk.begin(), m_walk.begin() + t_count);
+
+	// Clients keep to the walk but take each screenful in their own order
+	for (size_t i = 0; i < f_walk.size(); i += 8)
+	{
+		std::shuffle(f_walk.begin() + i, f_walk.begin() + std::min(f_walk.size(), i + 8), f_random);
+	}
+
+	int f_socket = -1;
+	std::string f_input;
+
+	for (const Tile &f_walked : f_walk)
+	{
+		if (f_chance(f_random) < m_drop)
+		{
+			// A deep tile nobody else is looking at, asked for and given up on at once
+			int f_level = m_levels - 1;
+			Tile f_tile{ f_level, int(f_random() % (1u << f_level)), int(f_random() % (1u << f_level)) };
+			std::string f_request = "GET " + tilePath(f_tile) + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+			int f_dropping = connectToServer();
+
+			if (f_dropping >= 0)
+			{
+				::send(f_dropping, f_request.data(), f_request.size(), MSG_NOSIGNAL);
+				close(f_dropping);
+			}
+
+			t_result.m_dropped++;
+			continue;
+		}
+
+		auto f_start = std::chrono::steady_clock::now();
+		int f_status = 0;
+		std::string f_body;
+		bool f_received = false;
+
+		// A connection the server closed while idle is opened again once
+		for (int f_attempt = 0; f_attempt < 2 && !f_received; f_attempt++)
+		{
+			if (f_socket < 0)
+			{
+				f_socket = connectToServer();
+				f_input.clear();
+			}
+
+			f_received = f_socket >= 0 && get(f_socket, tilePath(f_walked), f_input, f_status, f_body);
+
+			if (!f_received && f_socket >= 0)
+			{
+				close(f_socket);
+				f_socket = -1;
+			}
+		}
+
+		std::chrono::duration<double> f_time = std::chrono::steady_clock::now() - f_start;
+
+		if (!f_received || f_status != 200 || f_body.compare(0, 4, "\x89PNG") != 0)
+		{
+			t_result.m_errors++;
+			continue;
+		}
+
+		t_result.m_latencies.push_back(f_time.count());
+	}
+
+	if (f_socket >= 0)
+	{
+		close(f_socket);
+	}
+}
+
+/// <summary>
+/// Opens a connection to the server.
+/// </summary>
+/// <returns>The socket, or -1 if the server couldn't be reached.</returns>
+int LoadTest::connectToServer() const
+{
+	sockaddr_in f_address = {};
+	f_address.sin_family = AF_INET;
+	f_address.sin_port = htons(uint16_t(m_port));
+	f_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	int f_socket = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (f_socket >= 0 && connect(f_socket, (const sockaddr *)&f_address, sizeof(f_address)) != 0)
+	{
+		close(f_socket);
+		f_socket = -1;
+	}
+
+	return f_socket;
+}
+
+/// <summary>
+/// Sends a GET and reads the whole response.
+/// </summary>
+/// <param name="t_socket">The connection.</param>
+/// <param name="t_path">The path to get.</param>
+/// <param name="t_input">Bytes read from the connection and not used yet, kept between requests.</param>
+/// <param name="t_status">The status code.</param>
+/// <param name="t_body">The body.</param>
+/// <returns>False if the connection failed or the response couldn't be read.</returns>
+bool LoadTest::get(int t_socket, const std::string &t_path, std::string &t_input, int &t_status, std::string &t_body)
+{
+	std::string f_request = "GET " + t_path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+	if (::send(t_socket, f_request.data(), f_request.size(), MSG_NOSIGNAL) != ssize_t(f_request.size()))
+	{
+		return false;
+	}
+
+	size_t f_end = std::string::npos;
+	size_t f_length = 0;
+
+	while (true)
+	{
+		if (f_end == std::string::npos && (f_end = t_input.find("\r\n\r\n")) != std::string::npos)
+		{
+			std::string f_header = t_input.substr(0, f_end + 2);
+			std::transform(f_header.begin(), f_header.end(), f_header.begin(), [](char t_c) { return char(std::tolower((unsigned char)t_c)); });
+
+			size_t f_field = f_header.find("\r\ncontent-length:");
+			t_status = std::atoi(f_header.c_str() + std::min(f_header.size(), size_t(9)));
+			f_length = f_field == std::string::npos ? 0 : size_t(std::atoll(f_header.c_str() + f_field + 17));
+		}
+
+		if (f_end != std::string::npos && t_input.size() >= f_end + 4 + f_length)
+		{
+			t_body = t_input.substr(f_end + 4, f_length);
+			t_input.erase(0, f_end + 4 + f_length);
+
+			return true;
+		}
+
+		char f_buffer[16384];
+		ssize_t f_read = ::recv(t_socket, f_buffer, sizeof(f_buffer), 0);
+
+		if (f_read < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (f_read <= 0)
+		{
+			return false;
+		}
+
+		t_input.append(f_buffer, size_t(f_read));
+	}
+}
+
+#else
+
+// The server it tests is only built for POSIX systems
+
+bool LoadTest::run(std::ostream &t_out) { t_out << "the load test needs a POSIX system" << std::endl; return false; }
+void LoadTest::client(int, int, Result &) const {}
+int LoadTest::connectToServer() const { return -1; }
+bool LoadTest::get(int, const std::string &, std::string &, int &, std::string &) { return false; }
+
+#endif
@@ -36,6 +36,11 @@
 // All other code by Alan J Bolger, 2021
 
 #include "Application.h"
+#include "Benchmark.h"
+
+#include <fstream>
+#include <stdlib.h>
+#include <string>
 
 /// <summary>
 /// Mandelbrot.
@@ -43,7 +48,27 @@
 /// <returns>1 for successful exit.</returns>
 int WinMain()
 {
-	Application &f_app = Application();
+	// Run the benchmarks instead of the app when asked to
+	if (__argc > 1 && std::string(__argv[1]) == "--benchmark")
+	{
+		std::ofstream f_file(__argc > 2 ? __argv[2] : "benchmark.txt");
+		Benchmark::run(f_file);
+
+		return 1;
+	}
+
+	// Tiles only outlive the session when a directory is given for them
+	std::string f_cache;
+
+	for (int i = 1; i + 1 < __argc; i++)
+	{
+		if (std::string(__argv[i]) == "--cache")
+		{
+			f_cache = __argv[i + 1];
+		}
+	}
+
+	Application &f_app = Application(f_cache);
 	f_app.run();
 
 	return 1;
@@ -0,0 +1,411 @@
+#include "Palette.h"
+
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+/// <summary>
+/// Palette constructor.
+/// </summary>
+Palette::Palette()
+{
+
+}
+
+/// <summary>
+/// Palette destructor.
+/// </summary>
+Palette::~Palette()
+{
+
+}
+
+/// <summary>
+/// Builds one colour for every iteration count from 0 to t_iterations and clears the dirty flag.
+/// </summary>
+/// <param name="t_iterations">The highest iteration count that will be looked up.</param>
+void Palette::build(int t_iterations)
+{
+	m_colours.resize(size_t(std::max(t_iterations, 0)) + 1);
+
+	for (size_t i = 0; i < m_colours.size(); i++)
+	{
+		float f_position = float(i) / m_scale + m_offset;
+		m_colours[i] = gradient(f_position - std::floor(f_position));
+	}
+
+	m_dirty = false;
+}
+
+/// <summary>
+/// Colours a run of iteration counts, eight at a time with a gather from the table.
+/// Counts outside the table are clamped to its ends.
+/// </summary>
+/// <param name="t_counts">The iteration counts.</param>
+/// <param name="t_pixels">The RGBA output, one uint32_t per count.</param>
+/// <param name="t_count">The number of counts.</param>
+void Palette::apply(const int *t_counts, uint32_t *t_pixels, int t_count) const
+{
+	if (m_colours.empty())
+	{
+		return;
+	}
+
+	const int *f_table = (const int *)m_colours.data();
+
+	__m256i __f_zero = _mm256_setzero_si256();
+	__m256i __f_last = _mm256_set1_epi32(int(m_colours.size()) - 1);
+
+	int i = 0;
+
+	for (; i + 8 <= t_count; i += 8)
+	{
+		__m256i __f_index = _mm256_loadu_si256((const __m256i *)&t_counts[i]);
+		__f_index = _mm256_min_epi32(_mm256_max_epi32(__f_index, __f_zero), __f_last);
+		_mm256_storeu_si256((__m256i *)&t_pixels[i], _mm256_i32gather_epi32(f_table, __f_index, 4));
+	}
+
+	for (; i < t_count; i++)
+	{
+		t_pixels[i] = colour(t_counts[i]);
+	}
+}
+
+#pragma region smooth
+
+/// <summary>
+/// Blends the colours of eight counts towards the next entry by their fractions.
+/// Each channel is unpacked to float, interpolated and packed again.
+/// </summary>
+static inline __m256i blend8(const int *t_table, __m256i t_last, const int *t_counts, __m256 t_fractions)
+{
+	__m256i __f_index = _mm256_loadu_si256((const __m256i *)t_counts);
+	__f_index = _mm256_min_epi32(_mm256_max_epi32(__f_index, _mm256_setzero_si256()), t_last);
+	__m256i __f_from = _mm256_i32gather_epi32(t_table, __f_index, 4);
+	__m256i __f_to = _mm256_i32gather_epi32(t_table, _mm256_min_epi32(_mm256_add_epi32(__f_index, _mm256_set1_epi32(1)), t_last), 4);
+	__m256i __f_byte = _mm256_set1_epi32(255);
+	__m256i __f_result = _mm256_set1_epi32(int(0xFF000000));
+
+	for (int f_shift = 0; f_shift < 24; f_shift += 8)
+	{
+		__m256 __f_a = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(__f_from, f_shift), __f_byte));
+		__m256 __f_b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(__f_to, f_shift), __f_byte));
+		__m256 __f_c = _mm256_fmadd_ps(_mm256_sub_ps(__f_b, __f_a), t_fractions, __f_a);
+		__f_result = _mm256_or_si256(__f_result, _mm256_slli_epi32(_mm256_cvtps_epi32(__f_c), f_shift));
+	}
+
+	return __f_result;
+}
+
+#pragma endregion
+
+/// <summary>
+/// Colours a run of smooth iteration counts, count + fraction, by blending between neighbouring entries.
+/// </summary>
+/// <param name="t_counts">The iteration counts.</param>
+/// <param name="t_fractions">The fraction to add to each count, 0 to 1.</param>
+/// <param name="t_pixels">The RGBA output, one uint32_t per count.</param>
+/// <param name="t_count">The number of counts.</param>
+void Palette::applySmooth(const int *t_counts, const float *t_fractions, uint32_t *t_pixels, int t_count) const
+{
+	if (m_colours.empty())
+	{
+		return;
+	}
+
+	const int *f_table = (const int *)m_colours.data();
+	__m256i __f_last = _mm256_set1_epi32(int(m_colours.size()) - 1);
+
+	int i = 0;
+
+	for (; i + 8 <= t_count; i += 8)
+	{
+		_mm256_storeu_si256((__m256i *)&t_pixels[i], blend8(f_table, __f_last, &t_counts[i], _mm256_loadu_ps(&t_fractions[i])));
+	}
+
+	for (; i < t_count; i++)
+	{
+		t_pixels[i] = blend(t_counts[i], t_fractions[i]);
+	}
+}
+
+/// <summary>
+/// Colours a run of smooth iteration counts with the fractions stored as half floats.
+/// </summary>
+/// <param name="t_counts">The iteration counts.</param>
+/// <param name="t_fractions">The fraction to add to each count, 0 to 1, as float16.</param>
+/// <param name="t_pixels">The RGBA output, one uint32_t per count.</param>
+/// <param name="t_count">The number of counts.</param>
+void Palette::applySmooth(const int *t_counts, const uint16_t *t_fractions, uint32_t *t_pixels, int t_count) const
+{
+	if (m_colours.empty())
+	{
+		return;
+	}
+
+	const int *f_table = (const int *)m_colours.data();
+	__m256i __f_last = _mm256_set1_epi32(int(m_colours.size()) - 1);
+
+	int i = 0;
+
+	for (; i + 8 <= t_count; i += 8)
+	{
+		__m256 __f_fractions = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)&t_fractions[i]));
+		_mm256_storeu_si256((__m256i *)&t_pixels[i], blend8(f_table, __f_last, &t_counts[i], __f_fractions));
+	}
+
+	for (; i < t_count; i++)
+	{
+		t_pixels[i] = blend(t_counts[i], _cvtsh_ss(t_fractions[i]));
+	}
+}
+
+/// <summary>
+/// Darkens pixels that lie within a pixel of the set boundary, going by the distance channel.
+/// The colour is scaled by the distance, so thin filaments show up as dark lines.
+/// Distances below zero mean no estimate and are left alone.
+/// </summary>
+/// <param name="t_distances">The distance to the set in pixels.</param>
+/// <param name="t_pixels">The RGBA pixels to shade.</param>
+/// <param name="t_count">The number of pixels.</param>
+void Palette::shadeBoundary(const float *t_distances, uint32_t *t_pixels, int t_count)
+{
+	for (int i = 0; i < t_count; i++)
+	{
+		float f_distance = t_distances[i];
+
+		if (f_distance < 0.0f || f_distance >= 1.0f)
+		{
+			continue;
+		}
+
+		uint32_t f_colour = t_pixels[i];
+		uint32_t f_r = uint32_t(float(f_colour & 0xFF) * f_distance);
+		uint32_t f_g = uint32_t(float((f_colour >> 8) & 0xFF) * f_distance);
+		uint32_t f_b = uint32_t(float((f_colour >> 16) & 0xFF) * f_distance);
+		t_pixels[i] = (f_colour & 0xFF000000u) | (f_b << 16) | (f_g << 8) | f_r;
+	}
+}
+
+/// <summary>
+/// Gets the colour for a single iteration count.
+/// </summary>
+/// <param name="t_count">The iteration count.</param>
+/// <returns>The packed RGBA colour.</returns>
+uint32_t Palette::colour(int t_count) const
+{
+	return m_colours[size_t(std::min(std::max(t_count, 0), int(m_colours.size()) - 1))];
+}
+
+/// <summary>
+/// Gets the number of entries in the table.
+/// </summary>
+/// <returns>The number of entries.</returns>
+int Palette::size() const
+{
+	return int(m_colours.size());
+}
+
+/// <summary>
+/// Sets the gradient stops. They are sorted by position, an empty list is ignored.
+/// </summary>
+/// <param name="t_stops">The stops.</param>
+void Palette::setStops(const std::vector<PaletteStop> &t_stops)
+{
+	if (t_stops.empty())
+	{
+		return;
+	}
+
+	m_stops = t_stops;
+	std::sort(m_stops.begin(), m_stops.end(), [](const PaletteStop &t_a, const PaletteStop &t_b) { return t_a.m_position < t_b.m_position; });
+	m_dirty = true;
+}
+
+/// <summary>
+/// Gets the gradient stops.
+/// </summary>
+/// <returns>The stops, sorted by position.</returns>
+const std::vector<PaletteStop> &Palette::stops() const
+{
+	return m_stops;
+}
+
+/// <summary>
+/// Sets the number of iterations covered by one cycle of the gradient.
+/// </summary>
+/// <param name="t_scale">Iterations per cycle, at least 1.</param>
+void Palette::setScale(float t_scale)
+{
+	m_scale = std::max(t_scale, 1.0f);
+	m_dirty = true;
+}
+
+/// <summary>
+/// Gets the number of iterations covered by one cycle of the gradient.
+/// </summary>
+/// <returns>Iterations per cycle.</returns>
+float Palette::scale() const
+{
+	return m_scale;
+}
+
+/// <summary>
+/// Sets how far the gradient is shifted, in cycles. Only the fractional part matters,
+/// so an offset that keeps growing cycles the colours.
+/// </summary>
+/// <param name="t_offset">The offset in cycles.</param>
+void Palette::setOffset(float t_offset)
+{
+	m_offset = t_offset - std::floor(t_offset);
+	m_dirty = true;
+}
+
+/// <summary>
+/// Gets how far the gradient is shifted, in cycles.
+/// </summary>
+/// <returns>The offset in cycles.</returns>
+float Palette::offset() const
+{
+	return m_offset;
+}
+
+/// <summary>
+/// True if the palette has changed since the table was last built.
+/// </summary>
+/// <returns>True if the table needs rebuilding.</returns>
+bool Palette::isDirty() const
+{
+	return m_dirty;
+}
+
+/// <summary>
+/// Packs a colour the way it is stored in the pixel array, fully opaque.
+/// </summary>
+/// <param name="t_r">Red.</param>
+/// <param name="t_g">Green.</param>
+/// <param name="t_b">Blue.</param>
+/// <returns>The packed RGBA colour.</returns>
+uint32_t Palette::pack(uint8_t t_r, uint8_t t_g, uint8_t t_b)
+{
+	return uint32_t(t_r) | (uint32_t(t_g) << 8) | (uint32_t(t_b) << 16) | (uint32_t(255) << 24);
+}
+
+/// <summary>
+/// The original colouring, three phase-shifted sine waves, sampled into a gradient.
+/// With the default scale of 2 * pi / 0.1 iterations per cycle it matches the old look.
+/// </summary>
+/// <returns>The stops.</returns>
+std::vector<PaletteStop> Palette::rainbowStops()
+{
+	const int f_count = 16;
+	std::vector<PaletteStop> f_stops;
+
+	for (int i = 0; i < f_count; i++)
+	{
+		float f_position = float(i) / f_count;
+		float f_angle = f_position * 6.2831853f;
+
+		// Credit to @Eriksonn for this - it converts the fractal into a colour
+		// RBG values are normalised between 0 and 1 so I've multiplied them by 255
+		f_stops.push_back({ f_position, pack(
+			uint8_t((0.5f * std::sin(f_angle) + 0.5f) * 255.0f),
+			uint8_t((0.5f * std::sin(f_angle + 2.094f) + 0.5f) * 255.0f),
+			uint8_t((0.5f * std::sin(f_angle + 4.188f) + 0.5f) * 255.0f)) });
+	}
+
+	return f_stops;
+}
+
+/// <summary>
+/// Black through red and orange to pale yellow.
+/// </summary>
+/// <returns>The stops.</returns>
+std::vector<PaletteStop> Palette::fireStops()
+{
+	return {
+		{ 0.0f, pack(0, 0, 0) },
+		{ 0.3f, pack(160, 20, 0) },
+		{ 0.55f, pack(250, 120, 0) },
+		{ 0.8f, pack(255, 230, 140) }
+	};
+}
+
+/// <summary>
+/// Black to white and back.
+/// </summary>
+/// <returns>The stops.</returns>
+std::vector<PaletteStop> Palette::greyStops()
+{
+	return {
+		{ 0.0f, pack(0, 0, 0) },
+		{ 0.5f, pack(255, 255, 255) }
+	};
+}
+
+/// <summary>
+/// Blends the colour of a count towards the next entry, the scalar version of blend8.
+/// </summary>
+/// <param name="t_count">The iteration count.</param>
+/// <param name="t_fraction">How far towards the next entry, 0 to 1.</param>
+/// <returns>The packed RGBA colour.</returns>
+uint32_t Palette::blend(int t_count, float t_fraction) const
+{
+	uint32_t f_from = colour(t_count);
+	uint32_t f_to = colour(t_count + 1);
+	uint32_t f_colour = uint32_t(255) << 24;
+
+	for (int f_shift = 0; f_shift < 24; f_shift += 8)
+	{
+		float f_a = float((f_from >> f_shift) & 255);
+		float f_b = float((f_to >> f_shift) & 255);
+		f_colour |= uint32_t(std::lrint(f_a + (f_b - f_a) * t_fraction)) << f_shift;
+	}
+
+	return f_colour;
+}
+
+/// <summary>
+/// Interpolates the gradient at a position in [0, 1). The gradient wraps,
+/// so the last stop blends back into the first.
+/// </summary>
+/// <param name="t_position">The position.</param>
+/// <returns>The packed RGBA colour.</returns>
+uint32_t Palette::gradient(float t_position) const
+{
+	size_t f_next = 0;
+
+	while (f_next < m_stops.size() && m_stops[f_next].m_position <= t_position)
+	{
+		f_next++;
+	}
+
+	const PaletteStop &f_a = m_stops[(f_next + m_stops.size() - 1) % m_stops.size()];
+	const PaletteStop &f_b = m_stops[f_next % m_stops.size()];
+
+	float f_span = f_b.m_position - f_a.m_position;
+	float f_along = t_position - f_a.m_position;
+
+	// Wrapping from the last stop to the first
+	if (f_span <= 0.0f)
+	{
+		f_span += 1.0f;
+	}
+
+	if (f_along < 0.0f)
+	{
+		f_along += 1.0f;
+	}
+
+	float f_t = f_along / f_span;
+	uint32_t f_colour = uint32_t(255) << 24;
+
+	for (int f_shift = 0; f_shift < 24; f_shift += 8)
+	{
+		float f_from = float((f_a.m_colour >> f_shift) & 255);
+		float f_to = float((f_b.m_colour >> f_shift) & 255);
+		f_colour |= uint32_t(f_from + (f_to - f_from) * f_t + 0.5f) << f_shift;
+	}
+
+	return f_colour;
+}
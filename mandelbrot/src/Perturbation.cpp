@@ -0,0 +1,137 @@
+#include "Perturbation.h"
+
+#include <algorithm>
+
+/// <summary>
+/// Perturbation constructor.
+/// </summary>
+Perturbation::Perturbation()
+{
+
+}
+
+/// <summary>
+/// Perturbation destructor.
+/// </summary>
+Perturbation::~Perturbation()
+{
+
+}
+
+/// <summary>
+/// Iterates the reference orbit at the given point until it escapes or runs out of iterations.
+/// The orbit is iterated at the precision of the point and stored rounded to double.
+/// Any existing approximation table is discarded.
+/// </summary>
+/// <param name="t_cr">The real part of the reference point.</param>
+/// <param name="t_ci">The imaginary part of the reference point.</param>
+/// <param name="t_iterations">The number of iterations.</param>
+void Perturbation::setReference(const HighPrecision &t_cr, const HighPrecision &t_ci, int t_iterations)
+{
+	int f_limbs = std::max(t_cr.limbs(), t_ci.limbs());
+	HighPrecision f_zr(0.0, f_limbs);
+	HighPrecision f_zi(0.0, f_limbs);
+
+	m_iterations = t_iterations;
+	m_orbit.clear();
+	m_orbit.reserve(size_t(t_iterations) + 1);
+	m_bla.clear();
+
+	for (int i = 0; i <= t_iterations; i++)
+	{
+		std::complex<double> f_z(f_zr.toDouble(), f_zi.toDouble());
+		m_orbit.push_back(f_z);
+
+		if (std::norm(f_z) >= 4.0)
+		{
+			break;
+		}
+
+		HighPrecision f_zr2 = f_zr * f_zr;
+		HighPrecision f_zi2 = f_zi * f_zi;
+		HighPrecision f_zrzi = f_zr * f_zi;
+
+		f_zi = f_zrzi + f_zrzi + t_ci;
+		f_zr = f_zr2 - f_zi2 + t_cr;
+	}
+}
+
+/// <summary>
+/// Builds the bilinear approximation table for the current reference orbit.
+/// </summary>
+/// <param name="t_maxDelta">The largest |dc| of any pixel in the view.</param>
+/// <param name="t_memoryBudget">The maximum number of bytes the table may use.</param>
+void Perturbation::buildBla(double t_maxDelta, size_t t_memoryBudget)
+{
+	m_bla.build(m_orbit, t_maxDelta, t_memoryBudget);
+}
+
+/// <summary>
+/// Iterates a single pixel. The delta is rebased onto the start of the orbit whenever
+/// the full value gets smaller than the delta or the reference runs out, so one
+/// reference serves every pixel without glitch detection.
+/// </summary>
+/// <param name="t_dc">The offset of the pixel from the reference point.</param>
+/// <returns>The number of iterations before the pixel escaped.</returns>
+int Perturbation::iterate(std::complex<double> t_dc) const
+{
+	int f_last = int(m_orbit.size()) - 1;
+	int f_m = 0;
+	int f_n = 0;
+	std::complex<double> f_dz(0.0, 0.0);
+
+	while (f_n < m_iterations)
+	{
+		std::complex<double> f_z = m_orbit[f_m] + f_dz;
+		double f_norm = std::norm(f_z);
+
+		if (f_norm >= 4.0)
+		{
+			break;
+		}
+
+		if (f_norm < std::norm(f_dz) || f_m == f_last)
+		{
+			f_dz = f_z;
+			f_m = 0;
+		}
+
+		const BlaStep *f_step = m_useBla ? m_bla.lookup(f_m, std::norm(f_dz)) : nullptr;
+
+		if (f_step != nullptr && f_n + f_step->m_length <= m_iterations)
+		{
+			f_dz = f_step->m_a * f_dz + f_step->m_b * t_dc;
+			f_m += f_step->m_length;
+			f_n += f_step->m_length;
+		}
+		else
+		{
+			f_dz = 2.0 * m_orbit[f_m] * f_dz + f_dz * f_dz + t_dc;
+			f_m++;
+			f_n++;
+		}
+	}
+
+	return f_n;
+}
+
+/// <summary>
+/// Renders a section of the view. Pixel offsets are measured from m_referencePixel, m_spacing apart.
+/// </summary>
+/// <param name="t_fractal">The output buffer.</param>
+/// <param name="t_pixTL">Pixel top left coordinate.</param>
+/// <param name="t_pixBR">Pixel bottom right coordinate.</param>
+/// <param name="t_rowSize">The number of ints per row in the output buffer.</param>
+void Perturbation::render(int *t_fractal, const Vector2 &t_pixTL, const Vector2 &t_pixBR, int t_rowSize) const
+{
+	for (int y = int(t_pixTL.y); y < int(t_pixBR.y); y++)
+	{
+		double f_dci = (y - m_referencePixel.y) * m_spacing;
+
+		for (int x = int(t_pixTL.x); x < int(t_pixBR.x); x++)
+		{
+			double f_dcr = (x - m_referencePixel.x) * m_spacing;
+			t_fractal[y * t_rowSize + x] = iterate(std::complex<double>(f_dcr, f_dci));
+		}
+	}
+}
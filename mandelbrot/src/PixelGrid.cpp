@@ -82,6 +82,16 @@ sf::Texture &PixelGrid::getPixelBuffer()
 	return m_pixelBuffer;
 }
 
+/// <summary>
+/// Gets the raw RGBA pixel array, 4 bytes per pixel row by row, for code that fills it in bulk.
+/// Nothing is bounds-checked, so writes must stay within the grid.
+/// </summary>
+/// <returns>A pointer to the first byte of the pixel array.</returns>
+uint8_t *PixelGrid::getPixelArray()
+{
+	return m_pixelArray.data();
+}
+
 /// <summary>
 /// Clears the pixel array to 0 values.
 /// </summary>
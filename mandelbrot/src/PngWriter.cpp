@@ -0,0 +1,290 @@
+#include "PngWriter.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+/// <summary>
+/// PngWriter constructor.
+/// </summary>
+PngWriter::PngWriter()
+{
+
+}
+
+/// <summary>
+/// PngWriter destructor.
+/// </summary>
+PngWriter::~PngWriter()
+{
+
+}
+
+/// <summary>
+/// Creates the file and writes everything that comes before the pixels.
+/// </summary>
+/// <param name="t_path">The file to write.</param>
+/// <param name="t_width">The width in pixels.</param>
+/// <param name="t_height">The height in pixels.</param>
+/// <returns>False if the file couldn't be created.</returns>
+bool PngWriter::open(const std::string &t_path, int t_width, int t_height)
+{
+	m_buffer = nullptr;
+	m_file.open(t_path, std::ios::binary);
+
+	if (!m_file)
+	{
+		return false;
+	}
+
+	return start(t_width, t_height);
+}
+
+/// <summary>
+/// Starts an image in memory, for sending over a connection rather than writing to a file.
+/// </summary>
+/// <param name="t_buffer">Where the PNG goes. It is emptied first.</param>
+/// <param name="t_width">The width in pixels.</param>
+/// <param name="t_height">The height in pixels.</param>
+/// <returns>True.</returns>
+bool PngWriter::open(std::vector<uint8_t> &t_buffer, int t_width, int t_height)
+{
+	m_buffer = &t_buffer;
+	m_buffer->clear();
+
+	return start(t_width, t_height);
+}
+
+/// <summary>
+/// Writes everything that comes before the pixels.
+/// </summary>
+/// <param name="t_width">The width in pixels.</param>
+/// <param name="t_height">The height in pixels.</param>
+/// <returns>False if the file couldn't be written.</returns>
+bool PngWriter::start(int t_width, int t_height)
+{
+	m_width = t_width;
+	m_height = t_height;
+	m_rows = 0;
+	m_previous.assign(size_t(t_width) * 3, 0);
+	m_current.resize(size_t(t_width) * 3);
+	m_filtered.resize(size_t(t_width) * 3 + 1);
+	m_best.resize(size_t(t_width) * 3 + 1);
+
+	static const uint8_t f_signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	output(f_signature, sizeof(f_signature));
+
+	// 8 bits per channel, colour type 2 (RGB), deflate, adaptive filtering, no interlace
+	uint8_t f_header[13] = {
+		uint8_t(t_width >> 24), uint8_t(t_width >> 16), uint8_t(t_width >> 8), uint8_t(t_width),
+		uint8_t(t_height >> 24), uint8_t(t_height >> 16), uint8_t(t_height >> 8), uint8_t(t_height),
+		8, 2, 0, 0, 0 };
+	writeChunk("IHDR", f_header, sizeof(f_header));
+
+	return m_buffer != nullptr || bool(m_file);
+}
+
+/// <summary>
+/// Adds rows to the image.
+/// </summary>
+/// <param name="t_pixels">The rows as packed RGBA, R in the lowest byte. The alpha is dropped.</param>
+/// <param name="t_rows">The number of rows.</param>
+/// <returns>False if the file couldn't be written.</returns>
+bool PngWriter::writeRows(const uint32_t *t_pixels, int t_rows)
+{
+	for (int f_y = 0; f_y < t_rows && m_rows < m_height; f_y++, m_rows++)
+	{
+		const uint32_t *f_pixels = &t_pixels[size_t(f_y) * m_width];
+
+		for (int f_x = 0; f_x < m_width; f_x++)
+		{
+			m_current[f_x * 3 + 0] = uint8_t(f_pixels[f_x]);
+			m_current[f_x * 3 + 1] = uint8_t(f_pixels[f_x] >> 8);
+			m_current[f_x * 3 + 2] = uint8_t(f_pixels[f_x] >> 16);
+		}
+
+		filterRow();
+		m_deflater.write(m_best.data(), m_best.size(), m_compressed);
+		m_previous.swap(m_current);
+
+		if (m_compressed.size() >= CHUNK_SIZE)
+		{
+			writeChunk("IDAT", m_compressed.data(), m_compressed.size());
+			m_compressed.clear();
+		}
+	}
+
+	return m_buffer != nullptr || bool(m_file);
+}
+
+/// <summary>
+/// Ends the compressed stream and the file. Rows that were never written are left black.
+/// </summary>
+/// <returns>False if the file couldn't be written.</returns>
+bool PngWriter::close()
+{
+	std::fill(m_current.begin(), m_current.end(), uint8_t(0));
+
+	for (; m_rows < m_height; m_rows++)
+	{
+		filterRow();
+		m_deflater.write(m_best.data(), m_best.size(), m_compressed);
+		m_previous.swap(m_current);
+		std::fill(m_current.begin(), m_current.end(), uint8_t(0));
+	}
+
+	m_deflater.finish(m_compressed);
+	writeChunk("IDAT", m_compressed.data(), m_compressed.size());
+	m_compressed.clear();
+	writeChunk("IEND", nullptr, 0);
+
+	if (m_buffer != nullptr)
+	{
+		m_buffer = nullptr;
+		return true;
+	}
+
+	m_file.close();
+
+	return !m_file.fail();
+}
+
+/// <summary>
+/// Updates a CRC-32 (the one PNG and zlib use, reflected polynomial 0xEDB88320).
+/// </summary>
+/// <param name="t_crc">The CRC so far, 0 to start.</param>
+/// <param name="t_data">The data.</param>
+/// <param name="t_size">The data size in bytes.</param>
+/// <returns>The updated CRC.</returns>
+uint32_t PngWriter::crc32(uint32_t t_crc, const uint8_t *t_data, size_t t_size)
+{
+	struct Table
+	{
+		uint32_t m_entries[256];
+
+		Table()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t f_crc = i;
+
+				for (int f_bit = 0; f_bit < 8; f_bit++)
+				{
+					f_crc = (f_crc & 1) ? 0xEDB88320u ^ (f_crc >> 1) : f_crc >> 1;
+				}
+
+				m_entries[i] = f_crc;
+			}
+		}
+	};
+
+	static const Table f_table;
+
+	t_crc = ~t_crc;
+
+	for (size_t i = 0; i < t_size; i++)
+	{
+		t_crc = f_table.m_entries[(t_crc ^ t_data[i]) & 0xFF] ^ (t_crc >> 8);
+	}
+
+	return ~t_crc;
+}
+
+/// <summary>
+/// Filters the current row against the previous one with each of the five PNG filters and keeps the one
+/// whose bytes, taken as signed, sum smallest. That is the usual guess at what will compress best.
+/// </summary>
+void PngWriter::filterRow()
+{
+	const int f_size = m_width * 3;
+	long long f_bestSum = -1;
+
+	for (int f_filter = 0; f_filter < 5; f_filter++)
+	{
+		long long f_sum = 0;
+		m_filtered[0] = uint8_t(f_filter);
+
+		for (int i = 0; i < f_size; i++)
+		{
+			int f_a = i >= 3 ? m_current[i - 3] : 0;
+			int f_b = m_previous[i];
+			int f_c = i >= 3 ? m_previous[i - 3] : 0;
+			int f_predictor = 0;
+
+			switch (f_filter)
+			{
+			case 1:
+				f_predictor = f_a;
+				break;
+			case 2:
+				f_predictor = f_b;
+				break;
+			case 3:
+				f_predictor = (f_a + f_b) / 2;
+				break;
+			case 4:
+			{
+				// Paeth picks whichever neighbour is closest to a + b - c
+				int f_p = f_a + f_b - f_c;
+				int f_pa = std::abs(f_p - f_a);
+				int f_pb = std::abs(f_p - f_b);
+				int f_pc = std::abs(f_p - f_c);
+				f_predictor = f_pa <= f_pb && f_pa <= f_pc ? f_a : f_pb <= f_pc ? f_b : f_c;
+				break;
+			}
+			default:
+				break;
+			}
+
+			uint8_t f_value = uint8_t(m_current[i] - f_predictor);
+			m_filtered[i + 1] = f_value;
+			f_sum += std::abs(int(int8_t(f_value)));
+		}
+
+		if (f_bestSum < 0 || f_sum < f_bestSum)
+		{
+			f_bestSum = f_sum;
+			m_best.swap(m_filtered);
+		}
+	}
+}
+
+/// <summary>
+/// Writes a chunk: its length, type, data and the CRC of the type and data.
+/// </summary>
+/// <param name="t_type">The four letter chunk type.</param>
+/// <param name="t_data">The chunk data.</param>
+/// <param name="t_size">The data size in bytes.</param>
+void PngWriter::writeChunk(const char *t_type, const uint8_t *t_data, size_t t_size)
+{
+	uint8_t f_length[4] = { uint8_t(t_size >> 24), uint8_t(t_size >> 16), uint8_t(t_size >> 8), uint8_t(t_size) };
+	uint32_t f_crc = crc32(0, (const uint8_t *)t_type, 4);
+	f_crc = crc32(f_crc, t_data, t_size);
+	uint8_t f_crcBytes[4] = { uint8_t(f_crc >> 24), uint8_t(f_crc >> 16), uint8_t(f_crc >> 8), uint8_t(f_crc) };
+
+	output(f_length, 4);
+	output(t_type, 4);
+
+	if (t_size > 0)
+	{
+		output(t_data, t_size);
+	}
+
+	output(f_crcBytes, 4);
+}
+
+/// <summary>
+/// Writes bytes to the file or appends them to the buffer.
+/// </summary>
+/// <param name="t_data">The bytes.</param>
+/// <param name="t_size">The number of bytes.</param>
+void PngWriter::output(const void *t_data, size_t t_size)
+{
+	if (m_buffer != nullptr)
+	{
+		m_buffer->insert(m_buffer->end(), (const uint8_t *)t_data, (const uint8_t *)t_data + t_size);
+	}
+	else
+	{
+		m_file.write((const char *)t_data, t_size);
+	}
+}
@@ -0,0 +1,809 @@
+#include "RenderFarm.h"
+#include "Renderer.h"
+#include "Viewport.h"
+#include "Globals.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <csignal>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// What a farm message carries. Everything after the job goes one tile at a time.
+/// </summary>
+enum class FarmMessage : uint32_t
+{
+	// Coordinator to worker, the job as one line of text
+	Job = 1,
+	// Coordinator to worker, a tile to render as its x, y, width and height
+	Tile = 2,
+	// Coordinator to worker, a tile the worker should skip if it hasn't started it
+	Cancel = 3,
+	// Worker to coordinator, a rendered tile as RGBA rows
+	Result = 4,
+	// Coordinator to worker, the render is over
+	Done = 5
+};
+
+/// <summary>
+/// The start of every message, followed by m_size bytes.
+/// </summary>
+struct FarmHeader
+{
+	uint32_t m_type;
+	uint32_t m_tile;
+	uint32_t m_size;
+};
+
+#ifndef _WIN32
+
+/// <summary>
+/// Writes all of a buffer to a socket.
+/// </summary>
+/// <param name="t_socket">The socket.</param>
+/// <param name="t_data">The bytes.</param>
+/// <param name="t_size">The number of bytes.</param>
+/// <returns>False if the other end has gone.</returns>
+static bool sendAll(int t_socket, const void *t_data, size_t t_size)
+{
+	const uint8_t *f_data = (const uint8_t *)t_data;
+
+	while (t_size > 0)
+	{
+		ssize_t f_sent = ::send(t_socket, f_data, t_size, MSG_NOSIGNAL);
+
+		if (f_sent < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (f_sent <= 0)
+		{
+			return false;
+		}
+
+		f_data += f_sent;
+		t_size -= size_t(f_sent);
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Reads exactly a number of bytes from a socket, waiting for them.
+/// </summary>
+/// <param name="t_socket">The socket.</param>
+/// <param name="t_data">Where to put the bytes.</param>
+/// <param name="t_size">The number of bytes.</param>
+/// <returns>False if the other end has gone.</returns>
+static bool readAll(int t_socket, void *t_data, size_t t_size)
+{
+	uint8_t *f_data = (uint8_t *)t_data;
+
+	while (t_size > 0)
+	{
+		ssize_t f_read = ::recv(t_socket, f_data, t_size, 0);
+
+		if (f_read < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (f_read <= 0)
+		{
+			return false;
+		}
+
+		f_data += f_read;
+		t_size -= size_t(f_read);
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Sends a message.
+/// </summary>
+/// <param name="t_socket">The socket.</param>
+/// <param name="t_type">What the message is.</param>
+/// <param name="t_tile">The tile it is about, 0 if none.</param>
+/// <param name="t_payload">The bytes that follow the header.</param>
+/// <param name="t_size">The number of bytes.</param>
+/// <returns>False if the other end has gone.</returns>
+static bool sendMessage(int t_socket, FarmMessage t_type, int t_tile, const void *t_payload = nullptr, size_t t_size = 0)
+{
+	FarmHeader f_header{ uint32_t(t_type), uint32_t(t_tile), uint32_t(t_size) };
+
+	return sendAll(t_socket, &f_header, sizeof(f_header)) && (t_size == 0 || sendAll(t_socket, t_payload, t_size));
+}
+
+/// <summary>
+/// Writes a job as one line of text, with every double to full precision.
+/// </summary>
+/// <param name="t_job">The job.</param>
+/// <returns>The line.</returns>
+static std::string jobText(const FarmJob &t_job)
+{
+	std::ostringstream f_text;
+	f_text.precision(17);
+
+	f_text << t_job.m_width << " " << t_job.m_height << " " << t_job.m_tileSize << " " << t_job.m_iterations << " " << t_job.m_exponent << " "
+		<< t_job.m_julia << " " << t_job.m_juliaC.x << " " << t_job.m_juliaC.y << " " << int(t_job.m_smoothFormat) << " " << t_job.m_boundary << " "
+		<< t_job.m_antialias << " " << t_job.m_interiorChecks << " " << t_job.m_reproducible << " " << t_job.m_palette << " " << t_job.m_spacing << " "
+		<< t_job.m_centreX << " " << t_job.m_centreY;
+
+	return f_text.str();
+}
+
+/// <summary>
+/// Reads a job written by jobText.
+/// </summary>
+/// <param name="t_text">The line.</param>
+/// <param name="t_job">The job read.</param>
+/// <returns>False if the line is wrong.</returns>
+static bool readJob(const std::string &t_text, FarmJob &t_job)
+{
+	std::istringstream f_text(t_text);
+	int f_smooth = 0;
+
+	f_text >> t_job.m_width >> t_job.m_height >> t_job.m_tileSize >> t_job.m_iterations >> t_job.m_exponent >> t_job.m_julia >> t_job.m_juliaC.x
+		>> t_job.m_juliaC.y >> f_smooth >> t_job.m_boundary >> t_job.m_antialias >> t_job.m_interiorChecks >> t_job.m_reproducible >> t_job.m_palette
+		>> t_job.m_spacing >> t_job.m_centreX >> t_job.m_centreY;
+	t_job.m_smoothFormat = SmoothFormat(f_smooth);
+
+	// The kernels are only registered for exponents 2 to 5, as the command line allows
+	return bool(f_text) && t_job.m_width > 0 && t_job.m_height > 0 && t_job.m_tileSize > 0 && t_job.m_spacing > 0.0
+		&& t_job.m_iterations >= 1 && t_job.m_exponent >= 2 && t_job.m_exponent <= 5;
+}
+
+/// <summary>
+/// FarmCoordinator constructor. Splits the image into tiles, queued a row of tiles at a time so bands
+/// finish in order.
+/// </summary>
+/// <param name="t_job">The render.</param>
+/// <param name="t_socket">The path of the socket workers connect to.</param>
+FarmCoordinator::FarmCoordinator(const FarmJob &t_job, const std::string &t_socket) : m_job{ t_job }, m_socketPath{ t_socket }
+{
+	m_tilesAcross = (m_job.m_width + m_job.m_tileSize - 1) / m_job.m_tileSize;
+
+	for (int f_y = 0; f_y < m_job.m_height; f_y += m_job.m_tileSize)
+	{
+		for (int f_x = 0; f_x < m_job.m_width; f_x += m_job.m_tileSize)
+		{
+			m_queue.push_back(int(m_tiles.size()));
+			m_tiles.push_back(Tile{ f_x, f_y, std::min(m_job.m_tileSize, m_job.m_width - f_x), std::min(m_job.m_tileSize, m_job.m_height - f_y), false, 0 });
+		}
+
+		m_bandTiles[f_y / m_job.m_tileSize] = m_tilesAcross;
+	}
+}
+
+/// <summary>
+/// FarmCoordinator destructor. Tells the workers to stop and waits for the ones it started. After a
+/// failure they are stopped instead.
+/// </summary>
+FarmCoordinator::~FarmCoordinator()
+{
+	for (Connection &f_connection : m_connections)
+	{
+		sendMessage(f_connection.m_socket, FarmMessage::Done, 0);
+		close(f_connection.m_socket);
+	}
+
+	if (m_listener >= 0)
+	{
+		close(m_listener);
+		unlink(m_socketPath.c_str());
+	}
+
+	for (int f_child : m_children)
+	{
+		if (m_failed)
+		{
+			kill(f_child, SIGTERM);
+		}
+
+		waitpid(f_child, nullptr, 0);
+	}
+}
+
+/// <summary>
+/// Opens the socket workers connect to, replacing one left by an earlier run.
+/// </summary>
+/// <returns>False if it couldn't be opened.</returns>
+bool FarmCoordinator::listen()
+{
+	sockaddr_un f_address = {};
+	f_address.sun_family = AF_UNIX;
+
+	if (m_socketPath.size() >= sizeof(f_address.sun_path))
+	{
+		return false;
+	}
+
+	std::strncpy(f_address.sun_path, m_socketPath.c_str(), sizeof(f_address.sun_path) - 1);
+
+	// A worker that dies mid-send must not take the coordinator with it
+	signal(SIGPIPE, SIG_IGN);
+	unlink(m_socketPath.c_str());
+
+	m_listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (m_listener < 0 || bind(m_listener, (const sockaddr *)&f_address, sizeof(f_address)) != 0 || ::listen(m_listener, 64) != 0)
+	{
+		return false;
+	}
+
+	fcntl(m_listener, F_SETFL, fcntl(m_listener, F_GETFL) | O_NONBLOCK);
+	m_lastWorker = std::chrono::steady_clock::now();
+
+	return true;
+}
+
+/// <summary>
+/// Starts worker processes on this machine, each one this program run with --worker.
+/// </summary>
+/// <param name="t_executable">This program.</param>
+/// <param name="t_count">The number of workers.</param>
+/// <returns>False if a worker couldn't be started.</returns>
+bool FarmCoordinator::spawn(const std::string &t_executable, int t_count)
+{
+	for (int i = 0; i < t_count; i++)
+	{
+		pid_t f_child = fork();
+
+		if (f_child < 0)
+		{
+			return false;
+		}
+
+		if (f_child == 0)
+		{
+			execlp(t_executable.c_str(), t_executable.c_str(), "--worker", m_socketPath.c_str(), (char *)nullptr);
+			_exit(127);
+		}
+
+		m_children.push_back(f_child);
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Waits for the next band of rows to be complete, running the farm meanwhile.
+/// </summary>
+/// <param name="t_pixels">The band, width * rows RGBA pixels.</param>
+/// <param name="t_rows">The number of rows.</param>
+/// <returns>False once every band has been handed out, or if the render failed.</returns>
+bool FarmCoordinator::nextBand(std::vector<uint32_t> &t_pixels, int &t_rows)
+{
+	if (m_bandTiles.count(m_nextBand) == 0)
+	{
+		return false;
+	}
+
+	while (!m_failed && m_bandTiles[m_nextBand] > 0)
+	{
+		pump();
+	}
+
+	if (m_failed)
+	{
+		return false;
+	}
+
+	t_pixels.swap(m_bands[m_nextBand]);
+	t_rows = std::min(m_job.m_tileSize, m_job.m_height - m_nextBand * m_job.m_tileSize);
+	m_bands.erase(m_nextBand);
+	m_bandTiles.erase(m_nextBand);
+	m_nextBand++;
+
+	return true;
+}
+
+/// <summary>
+/// Gets whether the render failed, a tile ran out of retries or no workers were left.
+/// </summary>
+/// <returns>True on failure.</returns>
+bool FarmCoordinator::failed() const
+{
+	return m_failed;
+}
+
+/// <summary>
+/// Gets the number of tiles the image was split into.
+/// </summary>
+/// <returns>The number of tiles.</returns>
+int FarmCoordinator::tiles() const
+{
+	return int(m_tiles.size());
+}
+
+/// <summary>
+/// Gets the number of times a tile went back on the queue after its worker was lost.
+/// </summary>
+/// <returns>The number of retries.</returns>
+int FarmCoordinator::retries() const
+{
+	return m_retries;
+}
+
+/// <summary>
+/// Gets the number of tiles taken from one worker's queue for another.
+/// </summary>
+/// <returns>The number of steals.</returns>
+int FarmCoordinator::steals() const
+{
+	return m_steals;
+}
+
+/// <summary>
+/// Gets the number of results thrown away because another worker finished the tile first.
+/// </summary>
+/// <returns>The number of duplicates.</returns>
+int FarmCoordinator::duplicates() const
+{
+	return m_duplicates;
+}
+
+/// <summary>
+/// Gets the number of workers that connected.
+/// </summary>
+/// <returns>The number of workers.</returns>
+int FarmCoordinator::workersSeen() const
+{
+	return m_workersSeen;
+}
+
+/// <summary>
+/// Runs the farm for a moment: hands out tiles, takes in new workers and results, and drops workers
+/// that have gone or hung.
+/// </summary>
+void FarmCoordinator::pump()
+{
+	assign();
+
+	std::vector<pollfd> f_polls;
+	f_polls.push_back(pollfd{ m_listener, POLLIN, 0 });
+
+	for (const Connection &f_connection : m_connections)
+	{
+		f_polls.push_back(pollfd{ f_connection.m_socket, POLLIN, 0 });
+	}
+
+	if (poll(f_polls.data(), f_polls.size(), 200) < 0 && errno != EINTR)
+	{
+		m_failed = true;
+		return;
+	}
+
+	auto f_now = std::chrono::steady_clock::now();
+
+	for (size_t i = 1; i < f_polls.size(); i++)
+	{
+		if (f_polls[i].revents != 0)
+		{
+			receive(m_connections[i - 1]);
+		}
+	}
+
+	if ((f_polls[0].revents & POLLIN) != 0)
+	{
+		int f_socket;
+
+		while ((f_socket = accept(m_listener, nullptr, nullptr)) >= 0)
+		{
+			fcntl(f_socket, F_SETFL, fcntl(f_socket, F_GETFL) & ~O_NONBLOCK);
+
+			std::string f_job = jobText(m_job);
+			Connection f_connection{ f_socket, {}, {}, f_now, false };
+			f_connection.m_dead = !sendMessage(f_socket, FarmMessage::Job, 0, f_job.data(), f_job.size());
+			m_connections.push_back(std::move(f_connection));
+			m_workersSeen++;
+		}
+	}
+
+	for (size_t i = m_connections.size(); i-- > 0; )
+	{
+		Connection &f_connection = m_connections[i];
+		double f_quiet = std::chrono::duration<double>(f_now - f_connection.m_lastHeard).count();
+
+		if (f_connection.m_dead || (!f_connection.m_tiles.empty() && f_quiet > Globals::FARM_TILE_SECONDS))
+		{
+			drop(i);
+		}
+	}
+
+	if (!m_connections.empty())
+	{
+		m_lastWorker = f_now;
+	}
+	else if (std::chrono::duration<double>(f_now - m_lastWorker).count() > Globals::FARM_WAIT_SECONDS)
+	{
+		std::cerr << "no farm workers connected for " << Globals::FARM_WAIT_SECONDS << "s\n";
+		m_failed = true;
+	}
+
+	reap();
+}
+
+/// <summary>
+/// Tops every worker up to Globals::FARM_DEPTH tiles. Once the queue is empty, a worker with nothing
+/// left takes the last tile queued on the busiest worker, which is told to skip it.
+/// </summary>
+void FarmCoordinator::assign()
+{
+	for (Connection &f_connection : m_connections)
+	{
+		while (!f_connection.m_dead && int(f_connection.m_tiles.size()) < Globals::FARM_DEPTH && !m_queue.empty())
+		{
+			int f_tile = m_queue.front();
+			m_queue.pop_front();
+
+			if (!send(f_connection, f_tile))
+			{
+				m_queue.push_front(f_tile);
+			}
+		}
+	}
+
+	if (!m_queue.empty())
+	{
+		return;
+	}
+
+	for (Connection &f_idle : m_connections)
+	{
+		if (f_idle.m_dead || !f_idle.m_tiles.empty())
+		{
+			continue;
+		}
+
+		// Only a tile waiting behind another can be taken, the front one is likely being rendered
+		Connection *f_victim = nullptr;
+
+		for (Connection &f_connection : m_connections)
+		{
+			if (!f_connection.m_dead && f_connection.m_tiles.size() >= 2 && (f_victim == nullptr || f_connection.m_tiles.size() > f_victim->m_tiles.size()))
+			{
+				f_victim = &f_connection;
+			}
+		}
+
+		if (f_victim == nullptr)
+		{
+			return;
+		}
+
+		int f_tile = f_victim->m_tiles.back();
+		f_victim->m_tiles.pop_back();
+		f_victim->m_dead = !sendMessage(f_victim->m_socket, FarmMessage::Cancel, f_tile) || f_victim->m_dead;
+
+		if (send(f_idle, f_tile))
+		{
+			m_steals++;
+		}
+		else
+		{
+			m_queue.push_front(f_tile);
+		}
+	}
+}
+
+/// <summary>
+/// Sends a tile to a worker.
+/// </summary>
+/// <param name="t_connection">The worker.</param>
+/// <param name="t_tile">The tile.</param>
+/// <returns>False if the worker has gone, it is then marked to be dropped.</returns>
+bool FarmCoordinator::send(Connection &t_connection, int t_tile)
+{
+	const Tile &f_tile = m_tiles[t_tile];
+	int32_t f_rect[4] = { f_tile.m_x, f_tile.m_y, f_tile.m_width, f_tile.m_height };
+
+	if (!sendMessage(t_connection.m_socket, FarmMessage::Tile, t_tile, f_rect, sizeof(f_rect)))
+	{
+		t_connection.m_dead = true;
+		return false;
+	}
+
+	// An idle worker's silence is not a hang, so the clock starts with its first tile
+	if (t_connection.m_tiles.empty())
+	{
+		t_connection.m_lastHeard = std::chrono::steady_clock::now();
+	}
+
+	t_connection.m_tiles.push_back(t_tile);
+
+	return true;
+}
+
+/// <summary>
+/// Reads what a worker has sent and handles every whole message in it.
+/// </summary>
+/// <param name="t_connection">The worker.</param>
+void FarmCoordinator::receive(Connection &t_connection)
+{
+	uint8_t f_buffer[1 << 16];
+	ssize_t f_read;
+
+	while ((f_read = recv(t_connection.m_socket, f_buffer, sizeof(f_buffer), MSG_DONTWAIT)) > 0)
+	{
+		t_connection.m_input.insert(t_connection.m_input.end(), f_buffer, f_buffer + f_read);
+		t_connection.m_lastHeard = std::chrono::steady_clock::now();
+	}
+
+	if (f_read == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+	{
+		t_connection.m_dead = true;
+	}
+
+	size_t f_used = 0;
+
+	while (t_connection.m_input.size() - f_used >= sizeof(FarmHeader))
+	{
+		FarmHeader f_header;
+		std::memcpy(&f_header, t_connection.m_input.data() + f_used, sizeof(f_header));
+
+		if (t_connection.m_input.size() - f_used - sizeof(f_header) < f_header.m_size)
+		{
+			break;
+		}
+
+		if (f_header.m_type == uint32_t(FarmMessage::Result))
+		{
+			result(t_connection, int(f_header.m_tile), t_connection.m_input.data() + f_used + sizeof(f_header), f_header.m_size);
+		}
+
+		f_used += sizeof(f_header) + f_header.m_size;
+	}
+
+	t_connection.m_input.erase(t_connection.m_input.begin(), t_connection.m_input.begin() + f_used);
+}
+
+/// <summary>
+/// Puts a finished tile into its band. The first result for a tile is kept, any other is counted and
+/// dropped, and workers still holding the tile are told to skip it.
+/// </summary>
+/// <param name="t_connection">The worker that sent it.</param>
+/// <param name="t_tile">The tile.</param>
+/// <param name="t_pixels">The tile's rows as RGBA.</param>
+/// <param name="t_size">The number of bytes.</param>
+void FarmCoordinator::result(Connection &t_connection, int t_tile, const uint8_t *t_pixels, size_t t_size)
+{
+	auto f_held = std::find(t_connection.m_tiles.begin(), t_connection.m_tiles.end(), t_tile);
+
+	if (f_held != t_connection.m_tiles.end())
+	{
+		t_connection.m_tiles.erase(f_held);
+	}
+
+	if (t_tile < 0 || t_tile >= int(m_tiles.size()))
+	{
+		return;
+	}
+
+	Tile &f_tile = m_tiles[t_tile];
+
+	if (f_tile.m_done || t_size != size_t(f_tile.m_width) * f_tile.m_height * sizeof(uint32_t))
+	{
+		m_duplicates += f_tile.m_done ? 1 : 0;
+		return;
+	}
+
+	f_tile.m_done = true;
+	cancel(t_tile, &t_connection);
+
+	const int f_band = f_tile.m_y / m_job.m_tileSize;
+	std::vector<uint32_t> &f_pixels = m_bands[f_band];
+	f_pixels.resize(size_t(m_job.m_width) * std::min(m_job.m_tileSize, m_job.m_height - f_band * m_job.m_tileSize));
+
+	for (int f_y = 0; f_y < f_tile.m_height; f_y++)
+	{
+		std::memcpy(&f_pixels[size_t(f_y) * m_job.m_width + f_tile.m_x], t_pixels + size_t(f_y) * f_tile.m_width * sizeof(uint32_t), f_tile.m_width * sizeof(uint32_t));
+	}
+
+	m_bandTiles[f_band]--;
+}
+
+/// <summary>
+/// Tells every other worker holding a tile to skip it.
+/// </summary>
+/// <param name="t_tile">The tile.</param>
+/// <param name="t_except">The worker not to tell.</param>
+void FarmCoordinator::cancel(int t_tile, const Connection *t_except)
+{
+	for (Connection &f_connection : m_connections)
+	{
+		auto f_held = std::find(f_connection.m_tiles.begin(), f_connection.m_tiles.end(), t_tile);
+
+		if (&f_connection != t_except && f_held != f_connection.m_tiles.end())
+		{
+			f_connection.m_tiles.erase(f_held);
+			f_connection.m_dead = !sendMessage(f_connection.m_socket, FarmMessage::Cancel, t_tile) || f_connection.m_dead;
+		}
+	}
+}
+
+/// <summary>
+/// Closes a worker's connection and puts its unfinished tiles back at the front of the queue.
+/// </summary>
+/// <param name="t_index">The worker.</param>
+void FarmCoordinator::drop(size_t t_index)
+{
+	Connection f_connection = std::move(m_connections[t_index]);
+	m_connections.erase(m_connections.begin() + t_index);
+	close(f_connection.m_socket);
+
+	for (auto f_tile = f_connection.m_tiles.rbegin(); f_tile != f_connection.m_tiles.rend(); ++f_tile)
+	{
+		if (m_tiles[*f_tile].m_done)
+		{
+			continue;
+		}
+
+		if (++m_tiles[*f_tile].m_attempts > Globals::FARM_RETRIES)
+		{
+			std::cerr << "farm tile " << *f_tile << " failed " << m_tiles[*f_tile].m_attempts << " times\n";
+			m_failed = true;
+		}
+
+		m_queue.push_front(*f_tile);
+		m_retries++;
+	}
+}
+
+/// <summary>
+/// Collects the workers this coordinator started that have exited.
+/// </summary>
+void FarmCoordinator::reap()
+{
+	for (size_t i = m_children.size(); i-- > 0; )
+	{
+		if (waitpid(m_children[i], nullptr, WNOHANG) == m_children[i])
+		{
+			m_children.erase(m_children.begin() + i);
+		}
+	}
+}
+
+/// <summary>
+/// Connects to a coordinator and renders tiles until told to stop. Messages are read between tiles, so a
+/// tile given to another worker is skipped if it hasn't been started.
+/// </summary>
+/// <param name="t_socket">The path of the coordinator's socket.</param>
+/// <returns>0 when the coordinator says the render is over, 1 if it couldn't be reached or went away.</returns>
+int FarmWorker::run(const std::string &t_socket)
+{
+	sockaddr_un f_address = {};
+	f_address.sun_family = AF_UNIX;
+	std::strncpy(f_address.sun_path, t_socket.c_str(), sizeof(f_address.sun_path) - 1);
+
+	int f_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (f_socket < 0 || connect(f_socket, (const sockaddr *)&f_address, sizeof(f_address)) != 0)
+	{
+		std::cerr << "couldn't connect to " << t_socket << "\n";
+		return 1;
+	}
+
+	FarmHeader f_header;
+	std::string f_text;
+	FarmJob f_job;
+
+	if (!readAll(f_socket, &f_header, sizeof(f_header)) || f_header.m_type != uint32_t(FarmMessage::Job))
+	{
+		close(f_socket);
+		return 1;
+	}
+
+	f_text.resize(f_header.m_size);
+
+	if (!readAll(f_socket, &f_text[0], f_text.size()) || !readJob(f_text, f_job))
+	{
+		close(f_socket);
+		return 1;
+	}
+
+	Renderer f_renderer(f_job.m_tileSize, f_job.m_tileSize);
+	f_renderer.m_iterations = f_job.m_iterations;
+	f_renderer.m_exponent = f_job.m_exponent;
+	f_renderer.m_julia = f_job.m_julia;
+	f_renderer.m_juliaC = f_job.m_juliaC;
+	f_renderer.m_smoothFormat = f_job.m_smoothFormat;
+	f_renderer.m_boundary = f_job.m_boundary;
+	f_renderer.m_antialias = f_job.m_antialias;
+	f_renderer.m_interiorChecks = f_job.m_interiorChecks;
+	f_renderer.m_palette.setStops(f_job.m_palette == 1 ? Palette::fireStops() : f_job.m_palette == 2 ? Palette::greyStops() : Palette::rainbowStops());
+	f_renderer.m_kernel = Renderer::chooseKernel(f_job.m_spacing, f_job.m_exponent, f_job.m_julia, f_job.m_reproducible);
+
+	Viewport f_viewport(f_job.m_width, f_job.m_height);
+	f_viewport.setScale(1.0 / f_job.m_spacing);
+	f_viewport.setCentre(HighPrecision::fromString(f_job.m_centreX, f_viewport.precisionLimbs()), HighPrecision::fromString(f_job.m_centreY, f_viewport.precisionLimbs()));
+
+	std::deque<std::pair<int, std::vector<int32_t>>> f_pending;
+	std::vector<uint32_t> f_pixels;
+
+	while (true)
+	{
+		// Take in whatever has arrived, only waiting when there is nothing to render
+		pollfd f_poll{ f_socket, POLLIN, 0 };
+
+		while (f_pending.empty() || poll(&f_poll, 1, 0) > 0)
+		{
+			std::vector<int32_t> f_rect(4);
+
+			if (!readAll(f_socket, &f_header, sizeof(f_header)) || f_header.m_size > sizeof(int32_t) * 4
+				|| (f_header.m_size > 0 && !readAll(f_socket, f_rect.data(), f_header.m_size)))
+			{
+				close(f_socket);
+				return 1;
+			}
+
+			if (f_header.m_type == uint32_t(FarmMessage::Done))
+			{
+				close(f_socket);
+				return 0;
+			}
+
+			if (f_header.m_type == uint32_t(FarmMessage::Tile))
+			{
+				f_pending.emplace_back(int(f_header.m_tile), f_rect);
+			}
+			else if (f_header.m_type == uint32_t(FarmMessage::Cancel))
+			{
+				f_pending.erase(std::remove_if(f_pending.begin(), f_pending.end(),
+					[&](const std::pair<int, std::vector<int32_t>> &t_tile) { return t_tile.first == int(f_header.m_tile); }), f_pending.end());
+			}
+		}
+
+		int f_tile = f_pending.front().first;
+		std::vector<int32_t> f_rect = f_pending.front().second;
+		f_pending.pop_front();
+
+		// Edge tiles are rendered whole and cut down to the part inside the image
+		f_renderer.render(f_viewport, Vector2(f_rect[0], f_rect[1]));
+		f_pixels.resize(size_t(f_rect[2]) * f_rect[3]);
+
+		for (int f_y = 0; f_y < f_rect[3]; f_y++)
+		{
+			std::copy(f_renderer.pixels() + size_t(f_y) * f_job.m_tileSize, f_renderer.pixels() + size_t(f_y) * f_job.m_tileSize + f_rect[2], f_pixels.begin() + size_t(f_y) * f_rect[2]);
+		}
+
+		if (!sendMessage(f_socket, FarmMessage::Result, f_tile, f_pixels.data(), f_pixels.size() * sizeof(uint32_t)))
+		{
+			close(f_socket);
+			return 1;
+		}
+	}
+}
+
+#else
+
+// Windows has no fork or poll on Unix sockets, so the farm is only built for POSIX systems
+
+FarmCoordinator::FarmCoordinator(const FarmJob &t_job, const std::string &t_socket) : m_job{ t_job }, m_socketPath{ t_socket } {}
+FarmCoordinator::~FarmCoordinator() {}
+bool FarmCoordinator::listen() { return false; }
+bool FarmCoordinator::spawn(const std::string &, int) { return false; }
+bool FarmCoordinator::nextBand(std::vector<uint32_t> &, int &) { return false; }
+bool FarmCoordinator::failed() const { return true; }
+int FarmCoordinator::tiles() const { return 0; }
+int FarmCoordinator::retries() const { return 0; }
+int FarmCoordinator::steals() const { return 0; }
+int FarmCoordinator::duplicates() const { return 0; }
+int FarmCoordinator::workersSeen() const { return 0; }
+int FarmWorker::run(const std::string &) { std::cerr << "the render farm needs a POSIX system\n"; return 1; }
+
+#endif
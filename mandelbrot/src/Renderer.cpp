@@ -0,0 +1,642 @@
+#include "Renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+std::atomic<int> Globals::WORKER_COMPLETE{ 0 };
+
+/// <summary>
+/// Allocates a buffer aligned for the widest vector loads.
+/// </summary>
+static void *alignedAlloc(size_t t_size)
+{
+#ifdef _MSC_VER
+	return _aligned_malloc(t_size, 64);
+#else
+	return aligned_alloc(64, (t_size + 63) / 64 * 64);
+#endif
+}
+
+/// <summary>
+/// Frees a buffer from alignedAlloc.
+/// </summary>
+static void alignedFree(void *t_buffer)
+{
+#ifdef _MSC_VER
+	_aligned_free(t_buffer);
+#else
+	free(t_buffer);
+#endif
+}
+
+/// <summary>
+/// Renderer constructor. Allocates the buffers and starts the worker threads.
+/// </summary>
+/// <param name="t_width">The frame width in pixels.</param>
+/// <param name="t_height">The frame height in pixels.</param>
+/// <param name="t_pixels">Where to colour the frame, one RGBA value per pixel. A buffer is allocated when this is null.</param>
+Renderer::Renderer(int t_width, int t_height, uint32_t *t_pixels) : m_width{ t_width }, m_height{ t_height }, m_pixels{ t_pixels }
+{
+	size_t f_size = size_t(m_width) * size_t(m_height);
+
+	m_fractal = (int*)alignedAlloc(f_size * sizeof(int));
+
+	// The smooth channel is at most one float per pixel
+	m_smooth = alignedAlloc(f_size * sizeof(float));
+	m_distance = (float*)alignedAlloc(f_size * sizeof(float));
+
+	if (m_pixels == nullptr)
+	{
+		m_pixels = (uint32_t*)alignedAlloc(f_size * sizeof(uint32_t));
+		m_ownsPixels = true;
+	}
+
+	threadPoolInit();
+}
+
+/// <summary>
+/// Renderer destructor.
+/// </summary>
+Renderer::~Renderer()
+{
+	// Stop worker threads
+	for (int i = 0; i < Globals::MAX_THREADS; i++)
+	{
+		std::unique_lock<std::mutex> f_lockMutex(m_workers[i].m_mutex);
+		m_workers[i].m_alive = false;
+		m_workers[i].m_cvStart.notify_one();
+	}
+
+	// Clean up worker threads
+	for (int i = 0; i < Globals::MAX_THREADS; i++)
+	{
+		m_workers[i].m_thread.join();
+	}
+
+	// Clean up memory
+	alignedFree(m_fractal);
+	alignedFree(m_smooth);
+	alignedFree(m_distance);
+	alignedFree(m_preview);
+
+	if (m_ownsPixels)
+	{
+		alignedFree(m_pixels);
+	}
+}
+
+/// <summary>
+/// Renders a frame: computes it, colours it if colouring isn't fused and antialiases the edges if asked to.
+/// </summary>
+/// <param name="t_viewport">The view the frame is part of.</param>
+/// <param name="t_origin">The pixel in the viewport that is the top left of the frame.</param>
+void Renderer::render(const Viewport &t_viewport, const Vector2 &t_origin)
+{
+	compute(t_viewport, t_origin);
+
+	// Otherwise colour the result as a second pass
+	if (!m_fuseColour)
+	{
+		colour();
+	}
+
+	// Edges get extra samples once everything is coloured, since the test looks at the neighbours
+	if (m_antialias)
+	{
+		antialias();
+	}
+}
+
+/// <summary>
+/// Computes a frame using multi-threading (thread pooling), each worker takes a column section.
+/// A frame found in the tile cache is copied from there and no worker computes anything.
+/// </summary>
+/// <param name="t_viewport">The view the frame is part of.</param>
+/// <param name="t_origin">The pixel in the viewport that is the top left of the frame.</param>
+void Renderer::compute(const Viewport &t_viewport, const Vector2 &t_origin)
+{
+	buildPalette();
+
+	const size_t f_pixels = size_t(m_width) * size_t(m_height);
+	const uint64_t f_key = m_cache != nullptr ? tileKey(t_viewport, t_origin) : 0;
+	m_cached = m_cache != nullptr && m_cache->fetch(f_key, m_fractal, m_smooth, m_distance, f_pixels, m_cachedKernel);
+
+	// Perturbation needs the reference orbit at the exact centre before the workers start. Frames that
+	// are parts of one view share the centre, so the orbit is only iterated again when the view moves.
+	if (m_kernel == Kernel::Perturbation && !m_cached)
+	{
+		double f_spacing = t_viewport.pixelSpacing();
+
+		if (m_referenceIterations != m_iterations || m_referenceX.limbs() != t_viewport.centreX().limbs()
+			|| !(m_referenceX - t_viewport.centreX()).isZero() || !(m_referenceY - t_viewport.centreY()).isZero())
+		{
+			m_perturbation.setReference(t_viewport.centreX(), t_viewport.centreY(), m_iterations);
+			m_referenceX = t_viewport.centreX();
+			m_referenceY = t_viewport.centreY();
+			m_referenceIterations = m_iterations;
+		}
+
+		// The reference pixel is relative to the frame, which need not be centred on the view
+		Vector2 f_reference;
+		t_viewport.worldToScreen(t_viewport.centreX(), t_viewport.centreY(), f_reference);
+		f_reference = f_reference - t_origin;
+
+		// The table has to reach the frame corner furthest from the reference
+		double f_reach = std::max(std::abs(f_reference.x), std::abs(m_width - f_reference.x));
+		double f_reachY = std::max(std::abs(f_reference.y), std::abs(m_height - f_reference.y));
+
+		m_perturbation.m_referencePixel = f_reference;
+		m_perturbation.m_spacing = f_spacing;
+		m_perturbation.m_useBla = true;
+		m_perturbation.buildBla(f_spacing * std::sqrt(f_reach * f_reach + f_reachY * f_reachY), Globals::BLA_MEMORY_BUDGET);
+	}
+
+	// A cached frame still gives each worker its section, antialiasing samples from it
+	dispatch(t_viewport, t_origin, !m_cached);
+
+	if (m_cached)
+	{
+		// The workers didn't run, so a fused colouring has to be done as its own pass
+		if (m_fuseColour)
+		{
+			colour();
+		}
+
+		return;
+	}
+
+	wait();
+
+	if (m_cache != nullptr)
+	{
+		TileData f_tile;
+		size_t f_smoothBytes = m_smoothFormat == SmoothFormat::Float32 ? sizeof(float) : m_smoothFormat == SmoothFormat::Float16 ? sizeof(uint16_t) : 0;
+
+		f_tile.m_width = m_width;
+		f_tile.m_height = m_height;
+		f_tile.m_iterations = m_iterations;
+		f_tile.m_kernel = entry() != nullptr ? entry()->m_kernel : m_kernel;
+		f_tile.m_exponent = m_exponent;
+		f_tile.m_smoothFormat = m_smoothFormat;
+		f_tile.m_counts.assign(m_fractal, m_fractal + f_pixels);
+		f_tile.m_smooth.assign((const uint8_t *)m_smooth, (const uint8_t *)m_smooth + f_pixels * f_smoothBytes);
+
+		if (m_boundary)
+		{
+			f_tile.m_distance.assign(m_distance, m_distance + f_pixels);
+		}
+
+		m_cache->store(f_key, std::move(f_tile));
+	}
+}
+
+/// <summary>
+/// Colours and antialiases a frame whose counts were filled in by the owner rather than computed. The
+/// workers are given their sections of the view so antialiasing knows where to sample.
+/// </summary>
+/// <param name="t_viewport">The view the frame shows.</param>
+void Renderer::present(const Viewport &t_viewport)
+{
+	dispatch(t_viewport, Vector2(0, 0), false);
+	colour();
+
+	if (m_antialias)
+	{
+		antialias();
+	}
+}
+
+/// <summary>
+/// Gives each worker its column section of a frame and starts it computing if asked to. When colouring
+/// is fused the workers colour each row as they finish it. The counts are still kept because the
+/// palette may change afterwards.
+/// </summary>
+/// <param name="t_viewport">The view the frame is part of.</param>
+/// <param name="t_origin">The pixel in the viewport that is the top left of the frame.</param>
+/// <param name="t_compute">Whether to start the workers, or only tell them their sections.</param>
+void Renderer::dispatch(const Viewport &t_viewport, const Vector2 &t_origin, bool t_compute)
+{
+	Globals::WORKER_COMPLETE = 0;
+
+	Vector2 f_viewTL;
+	Vector2 f_viewTLLow;
+	t_viewport.screenToWorld(Vector2(0, 0), f_viewTL, f_viewTLLow);
+
+	for (int i = 0; i < Globals::MAX_THREADS; i++)
+	{
+		Vector2 f_pixTL;
+		Vector2 f_pixBR;
+		Vector2 f_fracTL;
+		Vector2 f_fracBR;
+		Vector2 f_fracTLLow;
+		Vector2 f_fracBRLow;
+
+		section(i, m_width, m_height, f_pixTL, f_pixBR);
+
+		t_viewport.screenToWorld(f_pixTL + t_origin, f_fracTL, f_fracTLLow);
+		t_viewport.screenToWorld(f_pixBR + t_origin, f_fracBR, f_fracBRLow);
+
+		m_workers[i].m_fuseColour = m_fuseColour;
+		m_workers[i].m_keepCounts = true;
+		m_workers[i].m_smoothFormat = m_smoothFormat;
+		m_workers[i].m_distance = m_boundary ? m_distance : nullptr;
+		m_workers[i].m_interiorChecks = m_interiorChecks;
+		m_workers[i].m_exponent = m_exponent;
+		m_workers[i].m_julia = m_julia;
+		m_workers[i].m_juliaC = m_juliaC;
+		m_workers[i].m_viewTL = f_viewTL;
+		m_workers[i].m_viewTLLow = f_viewTLLow;
+		m_workers[i].m_origin = t_origin;
+		m_workers[i].m_spacing = t_viewport.pixelSpacing();
+
+		if (t_compute)
+		{
+			m_workers[i].start(f_pixTL, f_pixBR, f_fracTL, f_fracBR, f_fracTLLow, f_fracBRLow, m_iterations, m_kernel);
+		}
+		else
+		{
+			m_workers[i].assign(f_pixTL, f_pixBR, f_fracTL, f_fracBR, f_fracTLLow, f_fracBRLow, m_iterations, m_kernel);
+		}
+	}
+}
+
+/// <summary>
+/// Colours the frame using the thread pool, each worker colours the section it computed.
+/// </summary>
+void Renderer::colour()
+{
+	buildPalette();
+
+	Globals::WORKER_COMPLETE = 0;
+
+	for (int i = 0; i < Globals::MAX_THREADS; i++)
+	{
+		Vector2 f_pixTL;
+		Vector2 f_pixBR;
+		section(i, m_width, m_height, f_pixTL, f_pixBR);
+
+		m_workers[i].startColouring(f_pixTL, f_pixBR);
+	}
+
+	wait();
+}
+
+/// <summary>
+/// Antialiases the frame using the thread pool. Each worker supersamples the edge pixels of the
+/// section it computed, so this has to follow compute.
+/// </summary>
+void Renderer::antialias()
+{
+	Globals::WORKER_COMPLETE = 0;
+
+	for (int i = 0; i < Globals::MAX_THREADS; i++)
+	{
+		Vector2 f_pixTL;
+		Vector2 f_pixBR;
+		section(i, m_width, m_height, f_pixTL, f_pixBR);
+
+		m_workers[i].startAntialiasing(f_pixTL, f_pixBR);
+	}
+
+	wait();
+
+	m_antialiased = 0;
+
+	for (int i = 0; i < Globals::MAX_THREADS; i++)
+	{
+		m_antialiased += m_workers[i].m_antialiased;
+	}
+}
+
+/// <summary>
+/// Draws a coarse frame quickly by computing one pixel in every t_step x t_step block with the plain kernel
+/// and filling the block with it. The workers compute into the small preview buffer, then the counts are
+/// spread over the full count buffer and coloured as usual.
+/// </summary>
+/// <param name="t_viewport">The view to draw, the same size as the frame.</param>
+/// <param name="t_step">The size of the blocks in pixels.</param>
+void Renderer::preview(const Viewport &t_viewport, int t_step)
+{
+	int f_width = m_width / t_step;
+	int f_height = m_height / t_step;
+
+	// Only the viewer previews, so the small buffer is made the first time it's wanted
+	if (m_preview == nullptr)
+	{
+		m_preview = (int*)alignedAlloc(size_t(f_width) * size_t(f_height) * sizeof(int));
+	}
+
+	buildPalette();
+
+	Globals::WORKER_COMPLETE = 0;
+
+	Vector2 f_viewTL;
+	Vector2 f_viewTLLow;
+	t_viewport.screenToWorld(Vector2(0, 0), f_viewTL, f_viewTLLow);
+
+	for (int i = 0; i < Globals::MAX_THREADS; i++)
+	{
+		Vector2 f_pixTL;
+		Vector2 f_pixBR;
+		Vector2 f_fracTL;
+		Vector2 f_fracBR;
+		Vector2 f_fracTLLow;
+		Vector2 f_fracBRLow;
+
+		section(i, f_width, f_height, f_pixTL, f_pixBR);
+
+		t_viewport.screenToWorld(Vector2(f_pixTL.x * t_step, 0), f_fracTL, f_fracTLLow);
+		t_viewport.screenToWorld(Vector2(f_pixBR.x * t_step, f_height * t_step), f_fracBR, f_fracBRLow);
+
+		m_workers[i].m_fractal = m_preview;
+		m_workers[i].m_screenWidth = f_width;
+		m_workers[i].m_fuseColour = false;
+		m_workers[i].m_keepCounts = true;
+		m_workers[i].m_smoothFormat = SmoothFormat::None;
+		m_workers[i].m_distance = nullptr;
+		m_workers[i].m_interiorChecks = m_interiorChecks;
+		m_workers[i].m_exponent = m_exponent;
+		m_workers[i].m_julia = m_julia;
+		m_workers[i].m_juliaC = m_juliaC;
+		m_workers[i].m_viewTL = f_viewTL;
+		m_workers[i].m_viewTLLow = f_viewTLLow;
+		m_workers[i].m_origin = Vector2(0, 0);
+		m_workers[i].m_spacing = t_viewport.pixelSpacing() * t_step;
+		m_workers[i].start(f_pixTL, f_pixBR, f_fracTL, f_fracBR, f_fracTLLow, f_fracBRLow, m_iterations, m_kernel);
+	}
+
+	wait();
+
+	for (int i = 0; i < Globals::MAX_THREADS; i++)
+	{
+		m_workers[i].m_fractal = m_fractal;
+		m_workers[i].m_screenWidth = m_width;
+	}
+
+	for (int f_y = 0; f_y < m_height; f_y++)
+	{
+		const int *f_row = &m_preview[std::min(f_y / t_step, f_height - 1) * f_width];
+
+		for (int f_x = 0; f_x < m_width; f_x++)
+		{
+			m_fractal[f_y * m_width + f_x] = f_row[std::min(f_x / t_step, f_width - 1)];
+		}
+	}
+
+	// The preview computes neither channel, so what the last full frame left in them no longer matches
+	// the counts. Cleared, a colouring pass before the next full frame draws no outline and no fractions.
+	const size_t f_pixels = size_t(m_width) * size_t(m_height);
+	std::fill(m_distance, m_distance + f_pixels, -1.0f);
+	std::memset(m_smooth, 0, f_pixels * sizeof(float));
+
+	colour();
+}
+
+/// <summary>
+/// Rebuilds the palette if it has changed. It has one entry per iteration count, so it is also
+/// rebuilt when the count changes.
+/// </summary>
+void Renderer::buildPalette()
+{
+	if (m_palette.isDirty() || m_palette.size() != m_iterations + 1)
+	{
+		m_palette.build(m_iterations);
+	}
+}
+
+/// <summary>
+/// Gets the frame width.
+/// </summary>
+/// <returns>The width in pixels.</returns>
+int Renderer::width() const
+{
+	return m_width;
+}
+
+/// <summary>
+/// Gets the frame height.
+/// </summary>
+/// <returns>The height in pixels.</returns>
+int Renderer::height() const
+{
+	return m_height;
+}
+
+/// <summary>
+/// Gets the iteration counts of the last frame.
+/// </summary>
+/// <returns>The counts, width * height.</returns>
+int *Renderer::fractal() const
+{
+	return m_fractal;
+}
+
+/// <summary>
+/// Gets the smooth channel of the last frame, in the format m_smoothFormat was when it was computed.
+/// </summary>
+/// <returns>The fractions, width * height of them.</returns>
+const void *Renderer::smooth() const
+{
+	return m_smooth;
+}
+
+/// <summary>
+/// Gets the smooth channel to fill in, for frames put together from elsewhere.
+/// </summary>
+/// <returns>The fractions, width * height of them.</returns>
+void *Renderer::smooth()
+{
+	return m_smooth;
+}
+
+/// <summary>
+/// Gets the distance estimates of the last frame, only filled in when m_boundary was set.
+/// </summary>
+/// <returns>The distances in pixels, width * height.</returns>
+const float *Renderer::distance() const
+{
+	return m_distance;
+}
+
+/// <summary>
+/// Gets the distance estimates to fill in, for frames put together from elsewhere.
+/// </summary>
+/// <returns>The distances in pixels, width * height.</returns>
+float *Renderer::distance()
+{
+	return m_distance;
+}
+
+/// <summary>
+/// Gets the colours of the last frame.
+/// </summary>
+/// <returns>The packed RGBA pixels, width * height.</returns>
+uint32_t *Renderer::pixels() const
+{
+	return m_pixels;
+}
+
+/// <summary>
+/// Gets the number of pixels the last antialiasing pass supersampled.
+/// </summary>
+/// <returns>The number of pixels.</returns>
+int Renderer::antialiased() const
+{
+	return m_antialiased;
+}
+
+/// <summary>
+/// Gets whether the last frame came from the tile cache.
+/// </summary>
+/// <returns>True if no worker computed it.</returns>
+bool Renderer::cached() const
+{
+	return m_cached;
+}
+
+/// <summary>
+/// Gets the registered kernel the last frame was computed with.
+/// </summary>
+/// <returns>The kernel, or null when the kernel isn't in the registry or the frame came from the tile cache.</returns>
+const KernelEntry *Renderer::entry() const
+{
+	return m_cached ? nullptr : m_workers[0].m_entry;
+}
+
+/// <summary>
+/// Gets the name of the kernel the last frame was computed with. A frame from the tile cache is named by
+/// the kernel stored with the tile, since no worker ran for it.
+/// </summary>
+/// <returns>The name.</returns>
+std::string Renderer::kernelName() const
+{
+	if (m_cached)
+	{
+		return std::string(WorkerThread::kernelName(m_cachedKernel)) + " (CACHED)";
+	}
+
+	return entry() != nullptr ? WorkerThread::entryName(*entry()) : std::string(WorkerThread::kernelName(m_kernel));
+}
+
+/// <summary>
+/// Gets the tile cache key of a frame: its place and size in the world, the iteration cap, the formula,
+/// the kernel and what it keeps besides the counts.
+/// </summary>
+/// <param name="t_viewport">The view the frame is part of.</param>
+/// <param name="t_origin">The pixel in the viewport that is the top left of the frame.</param>
+/// <returns>The key.</returns>
+uint64_t Renderer::tileKey(const Viewport &t_viewport, const Vector2 &t_origin) const
+{
+	// The world rect is the top left corner, the pixel spacing and the size, so the same rect is found
+	// whichever view it was part of. The corner gets enough digits to tell apart any two the limbs can hold.
+	HighPrecision f_left;
+	HighPrecision f_top;
+	t_viewport.screenToWorld(t_origin, f_left, f_top);
+
+	const int f_digits = f_left.limbs() * 10;
+	TileCache::Hasher f_hasher;
+
+	f_hasher.add(f_left.toString(f_digits)).add(f_top.toString(f_digits))
+		.add(t_viewport.scaleMantissa()).add(t_viewport.scaleExponent()).add(m_width).add(m_height)
+		.add(m_iterations).add(int(m_kernel)).add(int(Globals::KERNEL_VERSION)).add(m_exponent).add(m_julia)
+		.add(int(m_smoothFormat)).add(m_boundary).add(m_interiorChecks);
+
+	// The Julia constant is left over from the last Julia view when it isn't used, and mustn't split the key
+	if (m_julia)
+	{
+		f_hasher.add(m_juliaC.x).add(m_juliaC.y);
+	}
+
+	return f_hasher.value();
+}
+
+/// <summary>
+/// Picks the kernel for a pixel spacing. Float covers shallow zooms, then double, then double-double once
+/// neighbouring pixels can't be told apart in double, and perturbation once double-double runs out too.
+/// </summary>
+/// <param name="t_spacing">The pixel spacing in world units.</param>
+/// <param name="t_exponent">The power of z.</param>
+/// <param name="t_julia">Whether a Julia set is drawn.</param>
+/// <param name="t_reproducible">Whether the render must match on every machine.</param>
+/// <returns>The kernel.</returns>
+Kernel Renderer::chooseKernel(double t_spacing, int t_exponent, bool t_julia, bool t_reproducible)
+{
+	Kernel f_kernel;
+
+	if (t_reproducible)
+	{
+		f_kernel = Kernel::Fixed128;
+	}
+	else if (t_spacing < Globals::DOUBLE_DOUBLE_SPACING_LIMIT)
+	{
+		f_kernel = Kernel::Perturbation;
+	}
+	else if (t_spacing < Globals::DOUBLE_SPACING_LIMIT)
+	{
+		f_kernel = Kernel::DoubleDouble;
+	}
+	else if (t_spacing < Globals::FLOAT_SPACING_LIMIT)
+	{
+		f_kernel = Kernel::Double;
+	}
+	else
+	{
+		f_kernel = Kernel::Float;
+	}
+
+	// Only the z^2 Mandelbrot set has the deeper kernels, the multibrots and Julia sets stop at double
+	if ((t_exponent != 2 || t_julia) && f_kernel != Kernel::Float)
+	{
+		f_kernel = Kernel::Double;
+	}
+
+	return f_kernel;
+}
+
+/// <summary>
+/// Gets the column section a worker takes. The last section takes what is left over when the
+/// width doesn't divide evenly.
+/// </summary>
+/// <param name="t_index">The worker.</param>
+/// <param name="t_width">The width being split.</param>
+/// <param name="t_height">The height of the sections.</param>
+/// <param name="t_pixTL">Pixel top left coordinate.</param>
+/// <param name="t_pixBR">Pixel bottom right coordinate.</param>
+void Renderer::section(int t_index, int t_width, int t_height, Vector2 &t_pixTL, Vector2 &t_pixBR) const
+{
+	int f_sectionWidth = t_width / Globals::MAX_THREADS;
+
+	t_pixTL = Vector2(f_sectionWidth * t_index, 0);
+	t_pixBR = Vector2(t_index == Globals::MAX_THREADS - 1 ? t_width : f_sectionWidth * (t_index + 1), t_height);
+}
+
+/// <summary>
+/// Waits for all workers to complete.
+/// </summary>
+void Renderer::wait()
+{
+	while (Globals::WORKER_COMPLETE < Globals::MAX_THREADS)
+	{
+		// Blip, bloop, bleep!
+	}
+}
+
+/// <summary>
+/// Initialise the thread pool.
+/// </summary>
+void Renderer::threadPoolInit()
+{
+	for (int i = 0; i < Globals::MAX_THREADS; i++)
+	{
+		m_workers[i].m_alive = true;
+		m_workers[i].m_fractal = m_fractal;
+		m_workers[i].m_perturbation = &m_perturbation;
+		m_workers[i].m_palette = &m_palette;
+		m_workers[i].m_pixels = m_pixels;
+		m_workers[i].m_smooth = m_smooth;
+		m_workers[i].m_screenWidth = m_width;
+		m_workers[i].m_thread = std::thread(&WorkerThread::createFractal, &m_workers[i]);
+	}
+}
@@ -0,0 +1,425 @@
+#include "TileCache.h"
+#include "CountFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+/// <summary>
+/// Gets the memory a tile takes.
+/// </summary>
+/// <returns>The size in bytes.</returns>
+size_t TileData::bytes() const
+{
+	return m_counts.size() * sizeof(int) + m_smooth.size() + m_distance.size() * sizeof(float);
+}
+
+/// <summary>
+/// TileCache constructor.
+/// </summary>
+/// <param name="t_memoryBudget">The memory the tiles may take before they are spilled.</param>
+/// <param name="t_directory">Where to spill tiles to, or empty to drop them instead.</param>
+/// <param name="t_diskBudget">The space the tiles spilled by this cache may take before the oldest are deleted.</param>
+TileCache::TileCache(size_t t_memoryBudget, const std::string &t_directory, size_t t_diskBudget) : m_memoryBudget{ t_memoryBudget }, m_directory{ t_directory }, m_diskBudget{ t_diskBudget }
+{
+	if (m_directory.empty())
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	int f_result = _mkdir(m_directory.c_str());
+#else
+	int f_result = mkdir(m_directory.c_str(), 0755);
+#endif
+
+	// Without somewhere to spill to the cache works from memory alone
+	if (f_result != 0 && errno != EEXIST)
+	{
+		m_directory.clear();
+	}
+}
+
+/// <summary>
+/// TileCache destructor. The tiles still in memory are spilled so the next session can use them.
+/// </summary>
+TileCache::~TileCache()
+{
+	for (Entry &f_entry : m_entries)
+	{
+		spill(f_entry);
+	}
+}
+
+/// <summary>
+/// Looks a tile up in memory and then on disk.
+/// </summary>
+/// <param name="t_key">The tile's key.</param>
+/// <param name="t_tile">A copy of the tile if it was found.</param>
+/// <returns>True on a hit.</returns>
+bool TileCache::fetch(uint64_t t_key, TileData &t_tile)
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	if (!find(t_key))
+	{
+		return false;
+	}
+
+	t_tile = m_entries.front().m_tile;
+
+	return true;
+}
+
+/// <summary>
+/// Looks a tile up in memory and then on disk, and copies it into a frame's buffers.
+/// </summary>
+/// <param name="t_key">The tile's key.</param>
+/// <param name="t_counts">Where to put the counts.</param>
+/// <param name="t_smooth">Where to put the smooth channel, if the tile has one.</param>
+/// <param name="t_distance">Where to put the distances, if the tile has them.</param>
+/// <param name="t_pixels">The number of pixels in the buffers.</param>
+/// <param name="t_kernel">Set to the kernel the tile was computed with.</param>
+/// <returns>True on a hit.</returns>
+bool TileCache::fetch(uint64_t t_key, int *t_counts, void *t_smooth, float *t_distance, size_t t_pixels, Kernel &t_kernel)
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	if (!find(t_key))
+	{
+		return false;
+	}
+
+	const TileData &f_tile = m_entries.front().m_tile;
+
+	// A hash that matches a tile of another size can only be a collision
+	if (f_tile.m_counts.size() != t_pixels)
+	{
+		m_hits--;
+		m_misses++;
+		return false;
+	}
+
+	std::copy(f_tile.m_counts.begin(), f_tile.m_counts.end(), t_counts);
+	std::copy(f_tile.m_smooth.begin(), f_tile.m_smooth.end(), (uint8_t *)t_smooth);
+	std::copy(f_tile.m_distance.begin(), f_tile.m_distance.end(), t_distance);
+	t_kernel = f_tile.m_kernel;
+
+	return true;
+}
+
+/// <summary>
+/// Gets whether a tile is held, in memory or on disk, without counting a lookup or loading it.
+/// </summary>
+/// <param name="t_key">The tile's key.</param>
+/// <returns>True if a fetch would hit.</returns>
+bool TileCache::contains(uint64_t t_key) const
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	if (m_index.count(t_key) != 0)
+	{
+		return true;
+	}
+
+	if (m_directory.empty())
+	{
+		return false;
+	}
+
+	FILE *f_file = std::fopen(path(t_key).c_str(), "rb");
+
+	if (f_file == nullptr)
+	{
+		return false;
+	}
+
+	std::fclose(f_file);
+
+	return true;
+}
+
+/// <summary>
+/// Adds a tile, spilling the least recently used ones if memory is over budget.
+/// </summary>
+/// <param name="t_key">The tile's key.</param>
+/// <param name="t_tile">The tile.</param>
+void TileCache::store(uint64_t t_key, TileData &&t_tile)
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	insert(t_key, std::move(t_tile), false);
+}
+
+/// <summary>
+/// Drops every tile held in memory. Spilled tiles stay on disk.
+/// </summary>
+void TileCache::clear()
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	m_entries.clear();
+	m_index.clear();
+	m_memoryUsed = 0;
+}
+
+/// <summary>
+/// Gets the number of lookups that found their tile.
+/// </summary>
+/// <returns>The number of hits, from memory or disk.</returns>
+uint64_t TileCache::hits() const
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	return m_hits;
+}
+
+/// <summary>
+/// Gets the number of lookups that had to be computed.
+/// </summary>
+/// <returns>The number of misses.</returns>
+uint64_t TileCache::misses() const
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	return m_misses;
+}
+
+/// <summary>
+/// Gets the number of hits that were read back from disk.
+/// </summary>
+/// <returns>The number of disk hits.</returns>
+uint64_t TileCache::diskHits() const
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	return m_diskHits;
+}
+
+/// <summary>
+/// Gets the memory the tiles held in memory take.
+/// </summary>
+/// <returns>The size in bytes.</returns>
+size_t TileCache::memoryUsed() const
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	return m_memoryUsed;
+}
+
+/// <summary>
+/// Finds a tile and makes it the most recently used, loading it from disk if it was spilled.
+/// The caller holds the lock.
+/// </summary>
+/// <param name="t_key">The tile's key.</param>
+/// <returns>True if the tile is now at the front of the list.</returns>
+bool TileCache::find(uint64_t t_key)
+{
+	auto f_found = m_index.find(t_key);
+
+	if (f_found != m_index.end())
+	{
+		m_entries.splice(m_entries.begin(), m_entries, f_found->second);
+		m_hits++;
+		return true;
+	}
+
+	if (load(t_key))
+	{
+		m_hits++;
+		m_diskHits++;
+		return true;
+	}
+
+	m_misses++;
+
+	return false;
+}
+
+/// <summary>
+/// Reads a spilled tile back into memory.
+/// </summary>
+/// <param name="t_key">The tile's key.</param>
+/// <returns>False if the tile isn't on disk.</returns>
+bool TileCache::load(uint64_t t_key)
+{
+	if (m_directory.empty())
+	{
+		return false;
+	}
+
+	CountFile f_file;
+
+	if (!f_file.open(path(t_key)))
+	{
+		return false;
+	}
+
+	TileData f_tile;
+	size_t f_pixels = size_t(f_file.m_header.m_width) * f_file.m_header.m_height;
+
+	f_tile.m_width = int(f_file.m_header.m_width);
+	f_tile.m_height = int(f_file.m_header.m_height);
+	f_tile.m_iterations = int(f_file.m_header.m_iterations);
+	f_tile.m_kernel = Kernel(f_file.m_header.m_kernel);
+	f_tile.m_exponent = int(f_file.m_header.m_exponent);
+	f_tile.m_counts.assign(f_file.counts(), f_file.counts() + f_pixels);
+
+	if (f_file.smooth() != nullptr)
+	{
+		f_tile.m_smoothFormat = SmoothFormat::Float32;
+		f_tile.m_smooth.assign((const uint8_t *)f_file.smooth(), (const uint8_t *)(f_file.smooth() + f_pixels));
+	}
+
+	if (f_file.distance() != nullptr)
+	{
+		f_tile.m_distance.assign(f_file.distance(), f_file.distance() + f_pixels);
+	}
+
+	insert(t_key, std::move(f_tile), true);
+
+	return true;
+}
+
+/// <summary>
+/// Puts a tile at the front of the list and spills from the back until memory is within budget.
+/// The caller holds the lock.
+/// </summary>
+/// <param name="t_key">The tile's key.</param>
+/// <param name="t_tile">The tile.</param>
+/// <param name="t_onDisk">Whether the tile was read from disk.</param>
+void TileCache::insert(uint64_t t_key, TileData &&t_tile, bool t_onDisk)
+{
+	auto f_found = m_index.find(t_key);
+
+	if (f_found != m_index.end())
+	{
+		m_memoryUsed -= f_found->second->m_tile.bytes();
+		m_entries.erase(f_found->second);
+	}
+
+	m_memoryUsed += t_tile.bytes();
+	m_entries.push_front(Entry{ t_key, std::move(t_tile), t_onDisk });
+	m_index[t_key] = m_entries.begin();
+
+	// The newest tile always stays, even when it alone is over budget
+	while (m_memoryUsed > m_memoryBudget && m_entries.size() > 1)
+	{
+		spill(m_entries.back());
+		m_memoryUsed -= m_entries.back().m_tile.bytes();
+		m_index.erase(m_entries.back().m_key);
+		m_entries.pop_back();
+	}
+}
+
+/// <summary>
+/// Writes a tile to the cache directory unless it is there already. It is written under another name
+/// and renamed when complete, so a tile on disk is always whole. Half precision smooth channels are not
+/// spilled, since a count file holds floats.
+/// </summary>
+/// <param name="t_entry">The tile.</param>
+void TileCache::spill(Entry &t_entry)
+{
+	const TileData &f_tile = t_entry.m_tile;
+
+	if (m_directory.empty() || t_entry.m_onDisk || f_tile.m_smoothFormat == SmoothFormat::Float16)
+	{
+		return;
+	}
+
+	const std::string f_path = path(t_entry.m_key);
+	CountFile f_file;
+
+	f_file.m_header.m_width = uint32_t(f_tile.m_width);
+	f_file.m_header.m_height = uint32_t(f_tile.m_height);
+	f_file.m_header.m_iterations = uint32_t(f_tile.m_iterations);
+	f_file.m_header.m_kernel = uint32_t(f_tile.m_kernel);
+	f_file.m_header.m_exponent = uint32_t(f_tile.m_exponent);
+	f_file.m_header.m_flags = (f_tile.m_smooth.empty() ? 0 : CountFile::FLAG_SMOOTH) | (f_tile.m_distance.empty() ? 0 : CountFile::FLAG_DISTANCE);
+
+	bool f_written = f_file.create(f_path + ".new")
+		&& f_file.writeRows(0, f_tile.m_height, f_tile.m_counts.data(), (const float *)f_tile.m_smooth.data(), f_tile.m_distance.data());
+	f_file.close();
+
+#ifdef _WIN32
+	std::remove(f_path.c_str());
+#endif
+
+	if (!f_written || std::rename((f_path + ".new").c_str(), f_path.c_str()) != 0)
+	{
+		std::remove((f_path + ".new").c_str());
+		return;
+	}
+
+	t_entry.m_onDisk = true;
+
+	// Only what this cache spilled is counted, tiles left by earlier sessions are kept
+	m_spilled.emplace_back(t_entry.m_key, f_tile.bytes());
+	m_diskUsed += f_tile.bytes();
+
+	while (m_diskUsed > m_diskBudget && !m_spilled.empty())
+	{
+		std::remove(path(m_spilled.front().first).c_str());
+		m_diskUsed -= m_spilled.front().second;
+		m_spilled.pop_front();
+	}
+}
+
+/// <summary>
+/// Gets the file a tile is spilled to, its key in hex.
+/// </summary>
+/// <param name="t_key">The tile's key.</param>
+/// <returns>The path.</returns>
+std::string TileCache::path(uint64_t t_key) const
+{
+	char f_name[24];
+	std::snprintf(f_name, sizeof(f_name), "%016llx.mbc", (unsigned long long)t_key);
+
+	return m_directory + "/" + f_name;
+}
+
+/// <summary>
+/// Adds bytes to the hash.
+/// </summary>
+/// <param name="t_data">The bytes.</param>
+/// <param name="t_size">The number of bytes.</param>
+/// <returns>This hasher.</returns>
+TileCache::Hasher &TileCache::Hasher::add(const void *t_data, size_t t_size)
+{
+	const uint8_t *f_bytes = (const uint8_t *)t_data;
+
+	for (size_t i = 0; i < t_size; i++)
+	{
+		m_hash = (m_hash ^ f_bytes[i]) * 1099511628211ull;
+	}
+
+	return *this;
+}
+
+/// <summary>
+/// Adds a string and its length to the hash, so neighbouring strings can't run together.
+/// </summary>
+/// <param name="t_value">The string.</param>
+/// <returns>This hasher.</returns>
+TileCache::Hasher &TileCache::Hasher::add(const std::string &t_value)
+{
+	add(t_value.size());
+
+	return add(t_value.data(), t_value.size());
+}
+
+/// <summary>
+/// Gets the hash of everything added.
+/// </summary>
+/// <returns>The hash.</returns>
+uint64_t TileCache::Hasher::value() const
+{
+	return m_hash;
+}
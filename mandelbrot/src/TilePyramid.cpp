@@ -0,0 +1,292 @@
+#include "TilePyramid.h"
+#include "PngWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <fstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+const char *TilePyramid::DEEP_ZOOM_NAME = "mandelbrot";
+
+/// <summary>
+/// TilePyramid constructor.
+/// </summary>
+/// <param name="t_renderer">The renderer, a square frame one tile in size with its settings made.</param>
+/// <param name="t_directory">The directory to write the pyramid to.</param>
+/// <param name="t_layout">The directory layout.</param>
+TilePyramid::TilePyramid(Renderer &t_renderer, const std::string &t_directory, PyramidLayout t_layout) : m_renderer{ t_renderer }, m_directory{ t_directory }, m_layout{ t_layout }, m_tileSize{ t_renderer.width() }
+{
+	m_tile.resize(size_t(m_tileSize) * size_t(m_tileSize));
+}
+
+/// <summary>
+/// TilePyramid destructor.
+/// </summary>
+TilePyramid::~TilePyramid()
+{
+	finishWriting();
+}
+
+/// <summary>
+/// Renders and writes every level. Levels are done in order of depth, and a level only holds the tiles
+/// whose parents weren't entirely inside the set.
+/// </summary>
+/// <param name="t_centreX">The real part of the centre of the level 0 tile.</param>
+/// <param name="t_centreY">The imaginary part of the centre of the level 0 tile.</param>
+/// <param name="t_extent">The width of the level 0 tile in world units.</param>
+/// <param name="t_levels">The number of levels, the deepest is one tile wide times 2^(levels - 1).</param>
+/// <returns>False if a file couldn't be written or the deepest level is too large.</returns>
+bool TilePyramid::build(const HighPrecision &t_centreX, const HighPrecision &t_centreY, double t_extent, int t_levels)
+{
+	// Level widths in pixels have to fit an int
+	if (t_levels < 1 || int64_t(m_tileSize) << (t_levels - 1) > int64_t(INT32_MAX))
+	{
+		return false;
+	}
+
+	if (!makeDirectory(m_directory) || !writeInterior())
+	{
+		return false;
+	}
+
+	// Deep Zoom starts from a single pixel, so its levels below one full tile are single smaller tiles
+	if (m_layout == PyramidLayout::DeepZoom)
+	{
+		if (!writeDeepZoomDescriptor(m_tileSize << (t_levels - 1)) || !makeDirectory(m_directory + "/" + DEEP_ZOOM_NAME + "_files"))
+		{
+			return false;
+		}
+
+		for (int f_size = 1, f_level = 0; f_size < m_tileSize; f_size *= 2, f_level++)
+		{
+			Viewport f_viewport(f_size, f_size);
+			f_viewport.setScale(f_size / t_extent);
+			f_viewport.setCentre(t_centreX, t_centreY);
+
+			makeDirectory(m_directory + "/" + DEEP_ZOOM_NAME + "_files/" + std::to_string(f_level));
+			m_renderer.m_kernel = Renderer::chooseKernel(f_viewport.pixelSpacing(), m_renderer.m_exponent, m_renderer.m_julia, m_reproducible);
+			m_renderer.render(f_viewport);
+
+			finishWriting();
+
+			for (int f_y = 0; f_y < f_size; f_y++)
+			{
+				std::copy(m_renderer.pixels() + size_t(f_y) * m_tileSize, m_renderer.pixels() + size_t(f_y) * m_tileSize + f_size, m_tile.begin() + size_t(f_y) * f_size);
+			}
+
+			writeTile(m_directory + "/" + DEEP_ZOOM_NAME + "_files/" + std::to_string(f_level) + "/0_0.png", f_size);
+			m_rendered++;
+		}
+	}
+
+	std::vector<std::pair<int, int>> f_tiles = { { 0, 0 } };
+
+	for (int f_level = 0; f_level < t_levels && !f_tiles.empty(); f_level++)
+	{
+		int f_size = m_tileSize << f_level;
+
+		Viewport f_viewport(f_size, f_size);
+		f_viewport.setScale(f_size / t_extent);
+		f_viewport.setCentre(t_centreX, t_centreY);
+		m_renderer.m_kernel = Renderer::chooseKernel(f_viewport.pixelSpacing(), m_renderer.m_exponent, m_renderer.m_julia, m_reproducible);
+
+		std::vector<std::pair<int, int>> f_children;
+
+		for (const std::pair<int, int> &f_tile : f_tiles)
+		{
+			if (!renderTile(f_viewport, f_tile.first, f_tile.second, m_tileSize, tilePath(f_level, f_tile.first, f_tile.second)))
+			{
+				m_skipped++;
+			}
+
+			// A tile whose pixels all reached the cap only says so for the points it sampled, the children
+			// sample the points between them, which can escape along filaments too thin to show here
+			if (f_level + 1 < t_levels)
+			{
+				for (int i = 0; i < 4; i++)
+				{
+					f_children.push_back({ f_tile.first * 2 + (i & 1), f_tile.second * 2 + (i >> 1) });
+				}
+			}
+		}
+
+		f_tiles.swap(f_children);
+	}
+
+	finishWriting();
+
+	return m_written;
+}
+
+/// <summary>
+/// Gets the number of tiles rendered.
+/// </summary>
+/// <returns>The number of tiles.</returns>
+int TilePyramid::rendered() const
+{
+	return m_rendered;
+}
+
+/// <summary>
+/// Gets the number of tiles rendered and not written because every pixel reached the iteration cap.
+/// </summary>
+/// <returns>The number of tiles.</returns>
+uint64_t TilePyramid::skipped() const
+{
+	return m_skipped;
+}
+
+/// <summary>
+/// Renders one tile and hands it to the writer unless every pixel reached the iteration cap.
+/// </summary>
+/// <param name="t_viewport">The whole level.</param>
+/// <param name="t_x">The tile column.</param>
+/// <param name="t_y">The tile row.</param>
+/// <param name="t_size">The tile size in pixels.</param>
+/// <param name="t_path">The file to write.</param>
+/// <returns>False if every pixel reached the cap and the tile wasn't written.</returns>
+bool TilePyramid::renderTile(const Viewport &t_viewport, int t_x, int t_y, int t_size, const std::string &t_path)
+{
+	m_renderer.render(t_viewport, Vector2(double(t_x) * t_size, double(t_y) * t_size));
+	m_rendered++;
+
+	const int *f_counts = m_renderer.fractal();
+	bool f_interior = true;
+
+	for (size_t i = 0; i < size_t(t_size) * size_t(t_size) && f_interior; i++)
+	{
+		f_interior = f_counts[i] >= m_renderer.m_iterations;
+	}
+
+	if (f_interior)
+	{
+		return false;
+	}
+
+	// The previous tile has to be written before its buffer is reused
+	finishWriting();
+	std::copy(m_renderer.pixels(), m_renderer.pixels() + m_tile.size(), m_tile.begin());
+	writeTile(t_path, t_size);
+
+	return true;
+}
+
+/// <summary>
+/// Writes the tile buffer to a PNG on the writer thread, so it is compressed while the next tile renders.
+/// </summary>
+/// <param name="t_path">The file to write.</param>
+/// <param name="t_size">The tile size in pixels.</param>
+void TilePyramid::writeTile(const std::string &t_path, int t_size)
+{
+	m_writer = std::thread([this, t_path, t_size]
+	{
+		PngWriter f_png;
+		bool f_written = f_png.open(t_path, t_size, t_size) && f_png.writeRows(m_tile.data(), t_size) && f_png.close();
+		m_written = m_written && f_written;
+	});
+}
+
+/// <summary>
+/// Writes the tile every interior tile would be, for viewers to show where a tile is missing.
+/// </summary>
+/// <returns>False if the file couldn't be written.</returns>
+bool TilePyramid::writeInterior()
+{
+	m_renderer.buildPalette();
+	std::fill(m_tile.begin(), m_tile.end(), m_renderer.m_palette.colour(m_renderer.m_iterations));
+
+	PngWriter f_png;
+
+	return f_png.open(m_directory + "/interior.png", m_tileSize, m_tileSize) && f_png.writeRows(m_tile.data(), m_tileSize) && f_png.close();
+}
+
+/// <summary>
+/// Writes the Deep Zoom descriptor, name.dzi.
+/// </summary>
+/// <param name="t_size">The width and height of the deepest level in pixels.</param>
+/// <returns>False if the file couldn't be written.</returns>
+bool TilePyramid::writeDeepZoomDescriptor(int t_size)
+{
+	std::ofstream f_file(m_directory + "/" + DEEP_ZOOM_NAME + ".dzi");
+
+	f_file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		<< "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"png\" Overlap=\"0\" TileSize=\"" << m_tileSize << "\">\n"
+		<< "  <Size Width=\"" << t_size << "\" Height=\"" << t_size << "\"/>\n"
+		<< "</Image>\n";
+
+	return bool(f_file);
+}
+
+/// <summary>
+/// Gets the file a tile is written to, making its directories.
+/// </summary>
+/// <param name="t_level">The level, 0 being one tile.</param>
+/// <param name="t_x">The tile column.</param>
+/// <param name="t_y">The tile row.</param>
+/// <returns>The path.</returns>
+std::string TilePyramid::tilePath(int t_level, int t_x, int t_y)
+{
+	if (m_layout == PyramidLayout::DeepZoom)
+	{
+		std::string f_level = m_directory + "/" + DEEP_ZOOM_NAME + "_files/" + std::to_string(deepZoomLevel(t_level));
+		makeDirectory(f_level);
+
+		return f_level + "/" + std::to_string(t_x) + "_" + std::to_string(t_y) + ".png";
+	}
+
+	std::string f_column = m_directory + "/" + std::to_string(t_level) + "/" + std::to_string(t_x);
+	makeDirectory(m_directory + "/" + std::to_string(t_level));
+	makeDirectory(f_column);
+
+	return f_column + "/" + std::to_string(t_y) + ".png";
+}
+
+/// <summary>
+/// Gets the Deep Zoom level of a pyramid level, counting from the one pixel image.
+/// </summary>
+/// <param name="t_level">The level, 0 being one tile.</param>
+/// <returns>The Deep Zoom level.</returns>
+int TilePyramid::deepZoomLevel(int t_level) const
+{
+	int f_level = t_level;
+
+	for (int f_size = 1; f_size < m_tileSize; f_size *= 2)
+	{
+		f_level++;
+	}
+
+	return f_level;
+}
+
+/// <summary>
+/// Waits for the writer thread.
+/// </summary>
+void TilePyramid::finishWriting()
+{
+	if (m_writer.joinable())
+	{
+		m_writer.join();
+	}
+}
+
+/// <summary>
+/// Creates a directory if it isn't there already.
+/// </summary>
+/// <param name="t_path">The directory.</param>
+/// <returns>False if it couldn't be created.</returns>
+bool TilePyramid::makeDirectory(const std::string &t_path)
+{
+#ifdef _WIN32
+	int f_result = _mkdir(t_path.c_str());
+#else
+	int f_result = mkdir(t_path.c_str(), 0755);
+#endif
+
+	return f_result == 0 || errno == EEXIST;
+}
@@ -0,0 +1,357 @@
+#include "TileQuadtree.h"
+#include "Globals.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+/// <summary>
+/// TileQuadtree constructor.
+/// </summary>
+/// <param name="t_cache">The cache the tiles are kept in, shared with the screen renderer.</param>
+TileQuadtree::TileQuadtree(TileCache &t_cache) : m_cache{ t_cache }
+{
+	m_tileRenderer.m_cache = &m_cache;
+}
+
+/// <summary>
+/// TileQuadtree destructor.
+/// </summary>
+TileQuadtree::~TileQuadtree()
+{
+
+}
+
+/// <summary>
+/// Gets whether a view can be drawn from tiles. Views zoomed out past level 0 are not, and neither are
+/// views deeper than double precision, whose tile corners could no longer be placed exactly.
+/// </summary>
+/// <param name="t_viewport">The view.</param>
+/// <returns>True if update can draw it.</returns>
+bool TileQuadtree::covers(const Viewport &t_viewport) const
+{
+	int f_level = levelFor(t_viewport.pixelSpacing());
+
+	return f_level >= 0 && tileSpacing(f_level) >= Globals::DOUBLE_SPACING_LIMIT;
+}
+
+/// <summary>
+/// Fills the screen renderer's counts, smooth channel and distances for a view from tiles, working out
+/// from the centre of the screen. Cached tiles are copied in. The rest are computed until the budget is
+/// used up, after that a tile with a cached ancestor gets the ancestor's pixels until a later call. The
+/// screen renderer's settings decide the tiles', then its present colours the result.
+/// </summary>
+/// <param name="t_screen">The renderer the view is drawn into.</param>
+/// <param name="t_viewport">The view, which covers has to allow.</param>
+/// <param name="t_budget">Seconds to spend computing tiles before placeholders are used.</param>
+/// <param name="t_reproducible">Whether the tiles have to be computed with a reproducible kernel.</param>
+/// <returns>True if every tile was exact, false if placeholders are waiting to be replaced.</returns>
+bool TileQuadtree::update(Renderer &t_screen, const Viewport &t_viewport, double t_budget, bool t_reproducible)
+{
+	auto f_start = std::chrono::steady_clock::now();
+
+	m_tileRenderer.m_iterations = t_screen.m_iterations;
+	m_tileRenderer.m_smoothFormat = t_screen.m_smoothFormat;
+	m_tileRenderer.m_boundary = t_screen.m_boundary;
+	m_tileRenderer.m_interiorChecks = t_screen.m_interiorChecks;
+	m_tileRenderer.m_exponent = t_screen.m_exponent;
+	m_tileRenderer.m_julia = t_screen.m_julia;
+	m_tileRenderer.m_juliaC = t_screen.m_juliaC;
+	// Tiles are only counts, the screen colours and antialiases them once they are put together
+	m_tileRenderer.m_fuseColour = false;
+	m_tileRenderer.m_antialias = false;
+	m_reproducible = t_reproducible;
+
+	m_level = levelFor(t_viewport.pixelSpacing());
+	m_exact = 0;
+	m_placeholders = 0;
+
+	const int f_width = t_screen.width();
+	const int f_height = t_screen.height();
+	const double f_spacing = t_viewport.pixelSpacing();
+	const double f_tileSpacing = tileSpacing(m_level);
+	const double f_centreX = t_viewport.centreX().toDouble();
+	const double f_centreY = t_viewport.centreY().toDouble();
+
+	// The tile each screen column and row falls in, from the nearest pixel of the level
+	std::vector<int64_t> f_columns(f_width);
+	std::vector<int64_t> f_rows(f_height);
+
+	for (int x = 0; x < f_width; x++)
+	{
+		f_columns[x] = floorDiv(std::llround((f_centreX + (x - f_width / 2.0) * f_spacing + WORLD_SIZE / 2.0) / f_tileSpacing), TILE);
+	}
+
+	for (int y = 0; y < f_height; y++)
+	{
+		f_rows[y] = floorDiv(std::llround((f_centreY + (y - f_height / 2.0) * f_spacing + WORLD_SIZE / 2.0) / f_tileSpacing), TILE);
+	}
+
+	// Each tile's rectangle on screen, nearest the centre first so the middle sharpens first
+	struct Visible
+	{
+		int64_t m_x;
+		int64_t m_y;
+		Vector2 m_pixTL;
+		Vector2 m_pixBR;
+		double m_distance;
+	};
+
+	std::vector<Visible> f_tiles;
+
+	for (int y = 0; y < f_height; )
+	{
+		int f_bottom = y;
+
+		while (f_bottom < f_height && f_rows[f_bottom] == f_rows[y])
+		{
+			f_bottom++;
+		}
+
+		for (int x = 0; x < f_width; )
+		{
+			int f_right = x;
+
+			while (f_right < f_width && f_columns[f_right] == f_columns[x])
+			{
+				f_right++;
+			}
+
+			double f_dx = (x + f_right - f_width) / 2.0;
+			double f_dy = (y + f_bottom - f_height) / 2.0;
+			f_tiles.push_back(Visible{ f_columns[x], f_rows[y], Vector2(x, y), Vector2(f_right, f_bottom), f_dx * f_dx + f_dy * f_dy });
+
+			x = f_right;
+		}
+
+		y = f_bottom;
+	}
+
+	std::sort(f_tiles.begin(), f_tiles.end(), [](const Visible &t_a, const Visible &t_b) { return t_a.m_distance < t_b.m_distance; });
+
+	TileData f_tile;
+
+	for (const Visible &f_visible : f_tiles)
+	{
+		uint64_t f_key = key(m_level, f_visible.m_x, f_visible.m_y);
+
+		// Checked first so a tile about to be computed isn't counted as a miss twice
+		if (m_cache.contains(f_key) && m_cache.fetch(f_key, f_tile) && f_tile.m_counts.size() == size_t(TILE) * TILE)
+		{
+			compose(t_screen, t_viewport, m_level, f_visible.m_x, f_visible.m_y, f_visible.m_pixTL, f_visible.m_pixBR,
+				f_tile.m_counts.data(), f_tile.m_smooth.data(), f_tile.m_smooth.size() / f_tile.m_counts.size(), f_tile.m_distance.empty() ? nullptr : f_tile.m_distance.data());
+			m_exact++;
+			continue;
+		}
+
+		if (std::chrono::duration<double>(std::chrono::steady_clock::now() - f_start).count() > t_budget)
+		{
+			bool f_placed = false;
+
+			for (int f_ancestor = m_level - 1; f_ancestor >= 0 && !f_placed; f_ancestor--)
+			{
+				int64_t f_span = int64_t(1) << (m_level - f_ancestor);
+				int64_t f_x = floorDiv(f_visible.m_x, f_span);
+				int64_t f_y = floorDiv(f_visible.m_y, f_span);
+				uint64_t f_ancestorKey = key(f_ancestor, f_x, f_y);
+
+				if (m_cache.contains(f_ancestorKey) && m_cache.fetch(f_ancestorKey, f_tile) && f_tile.m_counts.size() == size_t(TILE) * TILE)
+				{
+					compose(t_screen, t_viewport, f_ancestor, f_x, f_y, f_visible.m_pixTL, f_visible.m_pixBR,
+						f_tile.m_counts.data(), f_tile.m_smooth.data(), f_tile.m_smooth.size() / f_tile.m_counts.size(), f_tile.m_distance.empty() ? nullptr : f_tile.m_distance.data());
+					m_placeholders++;
+					f_placed = true;
+				}
+			}
+
+			if (f_placed)
+			{
+				continue;
+			}
+		}
+
+		// Nothing to stand in for it, or still within budget, so the tile is computed now. The renderer
+		// puts it in the cache and its buffers are used as they are. Looking up an ancestor changed the
+		// kernel, so the key is taken again to set it back.
+		Viewport f_viewport(TILE, TILE);
+		key(m_level, f_visible.m_x, f_visible.m_y);
+		tileViewport(m_level, f_visible.m_x, f_visible.m_y, f_viewport);
+		m_tileRenderer.compute(f_viewport);
+
+		size_t f_smoothBytes = m_tileRenderer.m_smoothFormat == SmoothFormat::Float32 ? sizeof(float) : m_tileRenderer.m_smoothFormat == SmoothFormat::Float16 ? sizeof(uint16_t) : 0;
+		compose(t_screen, t_viewport, m_level, f_visible.m_x, f_visible.m_y, f_visible.m_pixTL, f_visible.m_pixBR,
+			m_tileRenderer.fractal(), (const uint8_t *)m_tileRenderer.smooth(), f_smoothBytes, m_tileRenderer.m_boundary ? m_tileRenderer.distance() : nullptr);
+		m_exact++;
+	}
+
+	return m_placeholders == 0;
+}
+
+/// <summary>
+/// Gets the level the last view was drawn from.
+/// </summary>
+/// <returns>The level, 0 being a single tile over the whole world.</returns>
+int TileQuadtree::level() const
+{
+	return m_level;
+}
+
+/// <summary>
+/// Gets the number of tiles in the last view that were at its own level.
+/// </summary>
+/// <returns>The number of tiles.</returns>
+int TileQuadtree::exact() const
+{
+	return m_exact;
+}
+
+/// <summary>
+/// Gets the number of tiles in the last view that were drawn from an ancestor.
+/// </summary>
+/// <returns>The number of tiles.</returns>
+int TileQuadtree::placeholders() const
+{
+	return m_placeholders;
+}
+
+/// <summary>
+/// Picks the coarsest level whose pixel spacing is no larger than a view's, so tiles are never blown up
+/// on screen and are at most twice as fine as it.
+/// </summary>
+/// <param name="t_spacing">The view's pixel spacing.</param>
+/// <returns>The level, below 0 when the view is zoomed out past the whole quadtree.</returns>
+int TileQuadtree::levelFor(double t_spacing)
+{
+	// A view at exactly a level's spacing mustn't be pushed to the next one by rounding in log2
+	return int(std::ceil(std::log2(WORLD_SIZE / (TILE * t_spacing)) - 1e-9));
+}
+
+/// <summary>
+/// Gets the pixel spacing of a level. It is a power of two, so every tile corner is exact in double.
+/// </summary>
+/// <param name="t_level">The level.</param>
+/// <returns>The spacing in world units.</returns>
+double TileQuadtree::tileSpacing(int t_level)
+{
+	return std::ldexp(WORLD_SIZE / TILE, -t_level);
+}
+
+/// <summary>
+/// Sets up the view of one tile.
+/// </summary>
+/// <param name="t_level">The tile's level.</param>
+/// <param name="t_x">The tile's column, 0 at the left edge of the world.</param>
+/// <param name="t_y">The tile's row, 0 at the top edge of the world.</param>
+/// <param name="t_viewport">The TILE by TILE view to set.</param>
+void TileQuadtree::tileViewport(int t_level, int64_t t_x, int64_t t_y, Viewport &t_viewport) const
+{
+	double f_spacing = tileSpacing(t_level);
+
+	// The scale goes first, it decides how many limbs the centre is held in
+	t_viewport.setScale(1.0 / f_spacing);
+	t_viewport.setCentre(HighPrecision((double(t_x) * TILE + TILE / 2) * f_spacing - WORLD_SIZE / 2.0, t_viewport.precisionLimbs()),
+		HighPrecision((double(t_y) * TILE + TILE / 2) * f_spacing - WORLD_SIZE / 2.0, t_viewport.precisionLimbs()));
+}
+
+/// <summary>
+/// Gets a tile's cache key, and leaves the tile renderer set up to compute it.
+/// </summary>
+/// <param name="t_level">The tile's level.</param>
+/// <param name="t_x">The tile's column.</param>
+/// <param name="t_y">The tile's row.</param>
+/// <returns>The key.</returns>
+uint64_t TileQuadtree::key(int t_level, int64_t t_x, int64_t t_y)
+{
+	// Each level picks its own kernel, so an ancestor is looked up with the kernel it was computed with
+	m_tileRenderer.m_kernel = Renderer::chooseKernel(tileSpacing(t_level), m_tileRenderer.m_exponent, m_tileRenderer.m_julia, m_reproducible);
+
+	Viewport f_viewport(TILE, TILE);
+	tileViewport(t_level, t_x, t_y, f_viewport);
+
+	return m_tileRenderer.tileKey(f_viewport);
+}
+
+/// <summary>
+/// Copies a tile into a rectangle of the screen, taking the tile pixel nearest each screen pixel.
+/// Distances are scaled from the tile's pixels to the screen's.
+/// </summary>
+/// <param name="t_screen">The renderer the view is drawn into.</param>
+/// <param name="t_viewport">The view.</param>
+/// <param name="t_level">The tile's level.</param>
+/// <param name="t_x">The tile's column.</param>
+/// <param name="t_y">The tile's row.</param>
+/// <param name="t_pixTL">The top left of the rectangle.</param>
+/// <param name="t_pixBR">The bottom right of the rectangle, exclusive.</param>
+/// <param name="t_counts">The tile's counts.</param>
+/// <param name="t_smooth">The tile's smooth channel.</param>
+/// <param name="t_smoothBytes">The bytes per pixel of the smooth channel, 0 if there is none.</param>
+/// <param name="t_distance">The tile's distances, or null if it has none.</param>
+void TileQuadtree::compose(Renderer &t_screen, const Viewport &t_viewport, int t_level, int64_t t_x, int64_t t_y, const Vector2 &t_pixTL, const Vector2 &t_pixBR,
+	const int *t_counts, const uint8_t *t_smooth, size_t t_smoothBytes, const float *t_distance) const
+{
+	const int f_width = t_screen.width();
+	const int f_height = t_screen.height();
+	const double f_spacing = t_viewport.pixelSpacing();
+	const double f_tileSpacing = tileSpacing(t_level);
+	const double f_centreX = t_viewport.centreX().toDouble();
+	const double f_centreY = t_viewport.centreY().toDouble();
+	const float f_distanceScale = float(f_tileSpacing / f_spacing);
+
+	const int f_left = int(t_pixTL.x);
+	const int f_top = int(t_pixTL.y);
+	const int f_right = int(t_pixBR.x);
+	const int f_bottom = int(t_pixBR.y);
+
+	// Rounding at the tile's edges can land a pixel just outside it, that pixel takes the edge instead
+	std::vector<int> f_columns(f_right - f_left);
+
+	for (int x = f_left; x < f_right; x++)
+	{
+		int64_t f_column = std::llround((f_centreX + (x - f_width / 2.0) * f_spacing + WORLD_SIZE / 2.0) / f_tileSpacing) - t_x * TILE;
+		f_columns[x - f_left] = int(std::min<int64_t>(std::max<int64_t>(f_column, 0), TILE - 1));
+	}
+
+	int *f_counts = t_screen.fractal();
+	uint8_t *f_smooth = (uint8_t *)t_screen.smooth();
+	float *f_distance = t_screen.m_boundary ? t_screen.distance() : nullptr;
+
+	for (int y = f_top; y < f_bottom; y++)
+	{
+		int64_t f_row = std::llround((f_centreY + (y - f_height / 2.0) * f_spacing + WORLD_SIZE / 2.0) / f_tileSpacing) - t_y * TILE;
+		const size_t f_source = size_t(std::min<int64_t>(std::max<int64_t>(f_row, 0), TILE - 1)) * TILE;
+
+		for (int x = f_left; x < f_right; x++)
+		{
+			const size_t f_from = f_source + f_columns[x - f_left];
+			const size_t f_to = size_t(y) * f_width + x;
+
+			f_counts[f_to] = t_counts[f_from];
+
+			if (t_smoothBytes > 0)
+			{
+				std::memcpy(f_smooth + f_to * t_smoothBytes, t_smooth + f_from * t_smoothBytes, t_smoothBytes);
+			}
+
+			if (f_distance != nullptr && t_distance != nullptr)
+			{
+				f_distance[f_to] = t_distance[f_from] * f_distanceScale;
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Divides rounding towards minus infinity, so tiles left of and above the world's corner are numbered
+/// the same way as the rest.
+/// </summary>
+/// <param name="t_value">The value.</param>
+/// <param name="t_divisor">The divisor, above 0.</param>
+/// <returns>The floor of the quotient.</returns>
+int64_t TileQuadtree::floorDiv(int64_t t_value, int64_t t_divisor)
+{
+	int64_t f_quotient = t_value / t_divisor;
+
+	return f_quotient * t_divisor > t_value ? f_quotient - 1 : f_quotient;
+}
@@ -0,0 +1,619 @@
+#include "TileServer.h"
+#include "PngWriter.h"
+#include "Viewport.h"
+#include "Globals.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <csignal>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// TileServer constructor.
+/// </summary>
+/// <param name="t_renderer">The renderer, a square frame one tile in size with its settings made. Give it a tile cache so tiles asked for again aren't computed again.</param>
+/// <param name="t_centreX">The real part of the centre of the level 0 tile, at the precision of the deepest level.</param>
+/// <param name="t_centreY">The imaginary part of the centre of the level 0 tile.</param>
+/// <param name="t_extent">The width of the level 0 tile in world units.</param>
+/// <param name="t_levels">The number of levels served, the deepest is one tile wide times 2^(levels - 1).</param>
+TileServer::TileServer(Renderer &t_renderer, const HighPrecision &t_centreX, const HighPrecision &t_centreY, double t_extent, int t_levels)
+	: m_renderer{ t_renderer }, m_centreX{ t_centreX }, m_centreY{ t_centreY }, m_extent{ t_extent }, m_levels{ t_levels }, m_tileSize{ t_renderer.width() }
+{
+
+}
+
+#ifndef _WIN32
+
+/// <summary>
+/// Writes all of a buffer to a socket.
+/// </summary>
+/// <param name="t_socket">The socket.</param>
+/// <param name="t_data">The bytes.</param>
+/// <param name="t_size">The number of bytes.</param>
+/// <returns>False if the client has gone.</returns>
+static bool sendAll(int t_socket, const void *t_data, size_t t_size)
+{
+	const uint8_t *f_data = (const uint8_t *)t_data;
+
+	while (t_size > 0)
+	{
+		ssize_t f_sent = ::send(t_socket, f_data, t_size, MSG_NOSIGNAL);
+
+		if (f_sent < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (f_sent <= 0)
+		{
+			return false;
+		}
+
+		f_data += f_sent;
+		t_size -= size_t(f_sent);
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Sends a response with its body.
+/// </summary>
+/// <param name="t_socket">The socket.</param>
+/// <param name="t_status">The status line after the version, such as "200 OK".</param>
+/// <param name="t_type">The content type.</param>
+/// <param name="t_body">The body.</param>
+/// <param name="t_size">The body size in bytes.</param>
+/// <param name="t_keepAlive">Whether the connection stays open for another request.</param>
+/// <returns>False if the client has gone.</returns>
+static bool sendResponse(int t_socket, const char *t_status, const char *t_type, const void *t_body, size_t t_size, bool t_keepAlive)
+{
+	std::ostringstream f_header;
+	f_header << "HTTP/1.1 " << t_status << "\r\n"
+		<< "Content-Type: " << t_type << "\r\n"
+		<< "Content-Length: " << t_size << "\r\n"
+		<< "Access-Control-Allow-Origin: *\r\n"
+		<< "Connection: " << (t_keepAlive ? "keep-alive" : "close") << "\r\n\r\n";
+
+	// One send for the lot, since a body sent after its header would wait on the client's delayed ACK
+	std::string f_text = f_header.str();
+	f_text.append((const char *)t_body, t_size);
+
+	return sendAll(t_socket, f_text.data(), f_text.size());
+}
+
+/// <summary>
+/// Sends a response whose body is a line of text.
+/// </summary>
+/// <param name="t_socket">The socket.</param>
+/// <param name="t_status">The status line after the version.</param>
+/// <param name="t_keepAlive">Whether the connection stays open for another request.</param>
+/// <returns>False if the client has gone.</returns>
+static bool sendText(int t_socket, const char *t_status, const std::string &t_text, bool t_keepAlive)
+{
+	return sendResponse(t_socket, t_status, "text/plain", t_text.data(), t_text.size(), t_keepAlive);
+}
+
+/// <summary>
+/// Checks without waiting whether a client has hung up. A client that has sent its next request is still
+/// there.
+/// </summary>
+/// <param name="t_socket">The socket.</param>
+/// <returns>True if the client closed the connection or it failed.</returns>
+static bool hungUp(int t_socket)
+{
+	pollfd f_poll{ t_socket, POLLIN, 0 };
+
+	if (poll(&f_poll, 1, 0) <= 0)
+	{
+		return false;
+	}
+
+	if (f_poll.revents & (POLLERR | POLLHUP | POLLNVAL))
+	{
+		return true;
+	}
+
+	char f_byte;
+	ssize_t f_read = ::recv(t_socket, &f_byte, 1, MSG_PEEK | MSG_DONTWAIT);
+
+	return f_read == 0 || (f_read < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+}
+
+/// <summary>
+/// TileServer destructor. Stops the render thread and closes the socket.
+/// </summary>
+TileServer::~TileServer()
+{
+	{
+		std::lock_guard<std::mutex> f_lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_work.notify_all();
+
+	if (m_renderThread.joinable())
+	{
+		m_renderThread.join();
+	}
+
+	if (m_listener >= 0)
+	{
+		close(m_listener);
+	}
+}
+
+/// <summary>
+/// Opens the port on the loopback address and starts the render thread.
+/// </summary>
+/// <param name="t_port">The TCP port.</param>
+/// <returns>False if the port couldn't be opened or the deepest level is too large.</returns>
+bool TileServer::listen(int t_port)
+{
+	// Level widths in pixels have to fit an int
+	if (m_levels < 1 || int64_t(m_tileSize) << (m_levels - 1) > int64_t(INT32_MAX))
+	{
+		return false;
+	}
+
+	// A client that hangs up mid-send must not take the server with it
+	signal(SIGPIPE, SIG_IGN);
+
+	sockaddr_in f_address = {};
+	f_address.sin_family = AF_INET;
+	f_address.sin_port = htons(uint16_t(t_port));
+	f_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	m_listener = socket(AF_INET, SOCK_STREAM, 0);
+	int f_reuse = 1;
+
+	if (m_listener < 0 || setsockopt(m_listener, SOL_SOCKET, SO_REUSEADDR, &f_reuse, sizeof(f_reuse)) != 0
+		|| bind(m_listener, (const sockaddr *)&f_address, sizeof(f_address)) != 0 || ::listen(m_listener, Globals::SERVER_CONNECTIONS) != 0)
+	{
+		return false;
+	}
+
+	m_renderThread = std::thread(&TileServer::renderTiles, this);
+
+	return true;
+}
+
+/// <summary>
+/// Accepts connections until told to stop, then waits for the open ones to finish.
+/// </summary>
+/// <param name="t_stop">Set to stop the server, from a signal handler if need be.</param>
+void TileServer::run(const std::atomic<bool> &t_stop)
+{
+	while (!t_stop)
+	{
+		{
+			std::unique_lock<std::mutex> f_lock(m_mutex);
+
+			// Past the limit, connections wait in the listen backlog until one closes
+			if (m_connections >= Globals::SERVER_CONNECTIONS)
+			{
+				m_finished.wait_for(f_lock, std::chrono::milliseconds(100));
+				continue;
+			}
+		}
+
+		pollfd f_poll{ m_listener, POLLIN, 0 };
+
+		if (poll(&f_poll, 1, 100) <= 0)
+		{
+			continue;
+		}
+
+		int f_socket = accept(m_listener, nullptr, nullptr);
+
+		if (f_socket < 0)
+		{
+			continue;
+		}
+
+		// Responses are written whole, so there is nothing for Nagle's algorithm to gather
+		int f_noDelay = 1;
+		setsockopt(f_socket, IPPROTO_TCP, TCP_NODELAY, &f_noDelay, sizeof(f_noDelay));
+
+		{
+			std::lock_guard<std::mutex> f_lock(m_mutex);
+			m_connections++;
+		}
+
+		std::thread(&TileServer::serve, this, f_socket).detach();
+	}
+
+	std::unique_lock<std::mutex> f_lock(m_mutex);
+	m_stopping = true;
+	m_work.notify_all();
+	m_finished.notify_all();
+
+	while (m_connections > 0)
+	{
+		m_finished.wait_for(f_lock, std::chrono::milliseconds(100));
+	}
+}
+
+/// <summary>
+/// Gets the number of tile requests, answered or dropped.
+/// </summary>
+/// <returns>The number of requests.</returns>
+uint64_t TileServer::requests() const
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	return m_requests;
+}
+
+/// <summary>
+/// Gets the number of tiles rendered.
+/// </summary>
+/// <returns>The number of tiles.</returns>
+uint64_t TileServer::renders() const
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	return m_renders;
+}
+
+/// <summary>
+/// Gets the number of tile requests that waited for a render another request had started or queued.
+/// </summary>
+/// <returns>The number of requests.</returns>
+uint64_t TileServer::coalesced() const
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	return m_coalesced;
+}
+
+/// <summary>
+/// Gets the number of queued tiles taken off the queue because every request for them was dropped.
+/// </summary>
+/// <returns>The number of tiles.</returns>
+uint64_t TileServer::cancelled() const
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	return m_cancelled;
+}
+
+/// <summary>
+/// Gets the number of tile requests whose client hung up before the tile was ready.
+/// </summary>
+/// <returns>The number of requests.</returns>
+uint64_t TileServer::dropped() const
+{
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+
+	return m_dropped;
+}
+
+/// <summary>
+/// Gets the counters as lines of "name value", as GET /stats sends them.
+/// </summary>
+/// <returns>The counters.</returns>
+std::string TileServer::stats() const
+{
+	std::ostringstream f_text;
+
+	{
+		std::lock_guard<std::mutex> f_lock(m_mutex);
+		f_text << "requests " << m_requests << "\n"
+			<< "renders " << m_renders << "\n"
+			<< "coalesced " << m_coalesced << "\n"
+			<< "cancelled " << m_cancelled << "\n"
+			<< "dropped " << m_dropped << "\n"
+			<< "queued " << m_queue.size() << "\n"
+			<< "connections " << m_connections << "\n";
+	}
+
+	if (m_renderer.m_cache != nullptr)
+	{
+		f_text << "cache_hits " << m_renderer.m_cache->hits() << "\n"
+			<< "cache_misses " << m_renderer.m_cache->misses() << "\n";
+	}
+
+	return f_text.str();
+}
+
+/// <summary>
+/// Answers the requests on one connection until the client closes it, goes idle or the server stops.
+/// Runs on its own thread.
+/// </summary>
+/// <param name="t_socket">The connection.</param>
+void TileServer::serve(int t_socket)
+{
+	std::string f_input;
+	bool f_open = true;
+
+	while (f_open)
+	{
+		size_t f_end = f_input.find("\r\n\r\n");
+		auto f_idleSince = std::chrono::steady_clock::now();
+
+		// Read until a whole header has arrived, waking now and then to see if the server is stopping
+		while (f_end == std::string::npos)
+		{
+			{
+				std::lock_guard<std::mutex> f_lock(m_mutex);
+				f_open = !m_stopping;
+			}
+
+			std::chrono::duration<double> f_idle = std::chrono::steady_clock::now() - f_idleSince;
+			pollfd f_poll{ t_socket, POLLIN, 0 };
+
+			if (!f_open || f_idle.count() > Globals::SERVER_IDLE_SECONDS || f_input.size() > 8192)
+			{
+				f_open = false;
+				break;
+			}
+
+			if (poll(&f_poll, 1, 100) <= 0)
+			{
+				continue;
+			}
+
+			char f_buffer[4096];
+			ssize_t f_read = ::recv(t_socket, f_buffer, sizeof(f_buffer), 0);
+
+			if (f_read < 0 && errno == EINTR)
+			{
+				continue;
+			}
+
+			if (f_read <= 0)
+			{
+				f_open = false;
+				break;
+			}
+
+			f_input.append(f_buffer, size_t(f_read));
+			f_end = f_input.find("\r\n\r\n");
+		}
+
+		if (!f_open)
+		{
+			break;
+		}
+
+		std::string f_header = f_input.substr(0, f_end + 2);
+		f_input.erase(0, f_end + 4);
+
+		std::string f_method;
+		std::string f_target;
+		std::string f_version;
+		std::istringstream(f_header.substr(0, f_header.find("\r\n"))) >> f_method >> f_target >> f_version;
+
+		std::transform(f_header.begin(), f_header.end(), f_header.begin(), [](char t_c) { return char(std::tolower((unsigned char)t_c)); });
+
+		// HTTP/1.1 keeps the connection by default and HTTP/1.0 closes it
+		bool f_keepAlive = f_version == "HTTP/1.1" ? f_header.find("\r\nconnection: close") == std::string::npos : f_header.find("\r\nconnection: keep-alive") != std::string::npos;
+
+		// Only GETs are served, so a request with a body would leave it to be read as the next request
+		if (f_method != "GET" || f_header.find("\r\ncontent-length:") != std::string::npos || f_header.find("\r\ntransfer-encoding:") != std::string::npos)
+		{
+			sendText(t_socket, "405 Method Not Allowed", "only GET is served\n", false);
+			break;
+		}
+
+		f_open = respond(t_socket, f_target, f_keepAlive) && f_keepAlive;
+	}
+
+	close(t_socket);
+
+	std::lock_guard<std::mutex> f_lock(m_mutex);
+	m_connections--;
+	m_finished.notify_all();
+}
+
+/// <summary>
+/// Answers one GET request.
+/// </summary>
+/// <param name="t_socket">The connection.</param>
+/// <param name="t_target">The path asked for, /z/x/y.png or /stats.</param>
+/// <param name="t_keepAlive">Whether the connection stays open for another request.</param>
+/// <returns>False if the client has gone.</returns>
+bool TileServer::respond(int t_socket, const std::string &t_target, bool t_keepAlive)
+{
+	std::string f_path = t_target.substr(0, t_target.find('?'));
+
+	if (f_path == "/stats")
+	{
+		return sendText(t_socket, "200 OK", stats(), t_keepAlive);
+	}
+
+	int f_level = -1;
+	int f_x = -1;
+	int f_y = -1;
+	int f_length = 0;
+
+	if (std::sscanf(f_path.c_str(), "/%d/%d/%d.png%n", &f_level, &f_x, &f_y, &f_length) != 3 || f_length != int(f_path.size()))
+	{
+		return sendText(t_socket, "404 Not Found", "tiles are /z/x/y.png\n", t_keepAlive);
+	}
+
+	if (f_level < 0 || f_level >= m_levels || f_x < 0 || f_y < 0 || f_x >= (1 << f_level) || f_y >= (1 << f_level))
+	{
+		return sendText(t_socket, "404 Not Found", "no such tile\n", t_keepAlive);
+	}
+
+	std::shared_ptr<Pending> f_pending = request(t_socket, f_level, f_x, f_y);
+
+	if (!f_pending)
+	{
+		return false;
+	}
+
+	if (!f_pending->m_done)
+	{
+		sendText(t_socket, "503 Service Unavailable", "the server is stopping\n", false);
+		return false;
+	}
+
+	// The PNG isn't changed once the tile is done, so it can be sent without the lock
+	return sendResponse(t_socket, "200 OK", "image/png", f_pending->m_png.data(), f_pending->m_png.size(), t_keepAlive);
+}
+
+/// <summary>
+/// Waits for a tile to be rendered, joining the render of it that is already queued or running if there
+/// is one and queueing a new one otherwise. Gives up if the client hangs up meanwhile.
+/// </summary>
+/// <param name="t_socket">The connection the request came in on.</param>
+/// <param name="t_level">The level.</param>
+/// <param name="t_x">The tile column.</param>
+/// <param name="t_y">The tile row.</param>
+/// <returns>The tile, not yet done if the server is stopping, or null if the client hung up.</returns>
+std::shared_ptr<TileServer::Pending> TileServer::request(int t_socket, int t_level, int t_x, int t_y)
+{
+	std::unique_lock<std::mutex> f_lock(m_mutex);
+	m_requests++;
+
+	std::shared_ptr<Pending> &f_entry = m_pending[key(t_level, t_x, t_y)];
+	std::shared_ptr<Pending> f_pending = f_entry;
+
+	if (f_pending)
+	{
+		f_pending->m_waiters++;
+		m_coalesced++;
+	}
+	else
+	{
+		f_pending = std::make_shared<Pending>(Pending{ t_level, t_x, t_y, 1, false, false, {} });
+		f_entry = f_pending;
+		m_queue.push_back(f_pending);
+		m_work.notify_one();
+	}
+
+	while (!f_pending->m_done && !m_stopping)
+	{
+		m_finished.wait_for(f_lock, std::chrono::milliseconds(50));
+
+		if (!f_pending->m_done && hungUp(t_socket))
+		{
+			m_dropped++;
+			abandon(f_pending);
+
+			return nullptr;
+		}
+	}
+
+	f_pending->m_waiters--;
+
+	return f_pending;
+}
+
+/// <summary>
+/// Lets go of a tile a request no longer wants. The last request to let go of a tile that hasn't started
+/// rendering takes it off the queue. Called with the lock held.
+/// </summary>
+/// <param name="t_pending">The tile.</param>
+void TileServer::abandon(const std::shared_ptr<Pending> &t_pending)
+{
+	if (--t_pending->m_waiters > 0 || t_pending->m_started)
+	{
+		return;
+	}
+
+	m_queue.erase(std::find(m_queue.begin(), m_queue.end(), t_pending));
+	m_pending.erase(key(t_pending->m_level, t_pending->m_x, t_pending->m_y));
+	m_cancelled++;
+}
+
+/// <summary>
+/// Renders queued tiles, newest first, until the server stops. Runs on the render thread.
+/// </summary>
+void TileServer::renderTiles()
+{
+	std::unique_lock<std::mutex> f_lock(m_mutex);
+	std::vector<uint8_t> f_png;
+
+	while (true)
+	{
+		m_work.wait(f_lock, [this] { return m_stopping || !m_queue.empty(); });
+
+		if (m_stopping)
+		{
+			return;
+		}
+
+		// A map viewer asks for what is on screen now after what it has scrolled past
+		std::shared_ptr<Pending> f_pending = m_queue.back();
+		m_queue.pop_back();
+		f_pending->m_started = true;
+
+		f_lock.unlock();
+		renderTile(*f_pending, f_png);
+		f_lock.lock();
+
+		f_pending->m_png.swap(f_png);
+		f_pending->m_done = true;
+		m_pending.erase(key(f_pending->m_level, f_pending->m_x, f_pending->m_y));
+		m_renders++;
+		m_finished.notify_all();
+	}
+}
+
+/// <summary>
+/// Renders one tile and compresses it.
+/// </summary>
+/// <param name="t_pending">The tile.</param>
+/// <param name="t_png">Where the PNG goes.</param>
+void TileServer::renderTile(Pending &t_pending, std::vector<uint8_t> &t_png)
+{
+	int f_size = m_tileSize << t_pending.m_level;
+
+	Viewport f_viewport(f_size, f_size);
+	f_viewport.setScale(f_size / m_extent);
+	f_viewport.setCentre(m_centreX, m_centreY);
+	m_renderer.m_kernel = Renderer::chooseKernel(f_viewport.pixelSpacing(), m_renderer.m_exponent, m_renderer.m_julia, m_reproducible);
+	m_renderer.render(f_viewport, Vector2(double(t_pending.m_x) * m_tileSize, double(t_pending.m_y) * m_tileSize));
+
+	PngWriter f_png;
+	f_png.open(t_png, m_tileSize, m_tileSize);
+	f_png.writeRows(m_renderer.pixels(), m_tileSize);
+	f_png.close();
+}
+
+#else
+
+// Windows sockets differ enough that the server is only built for POSIX systems
+
+TileServer::~TileServer() {}
+bool TileServer::listen(int) { std::cerr << "the tile server needs a POSIX system\n"; return false; }
+void TileServer::run(const std::atomic<bool> &) {}
+uint64_t TileServer::requests() const { return 0; }
+uint64_t TileServer::renders() const { return 0; }
+uint64_t TileServer::coalesced() const { return 0; }
+uint64_t TileServer::cancelled() const { return 0; }
+uint64_t TileServer::dropped() const { return 0; }
+std::string TileServer::stats() const { return ""; }
+
+#endif
+
+/// <summary>
+/// Gets the key a tile is found by among the pending ones.
+/// </summary>
+/// <param name="t_level">The level.</param>
+/// <param name="t_x">The tile column.</param>
+/// <param name="t_y">The tile row.</param>
+/// <returns>The key.</returns>
+uint64_t TileServer::key(int t_level, int t_x, int t_y)
+{
+	// Levels stay below 27 and coordinates below 2^26, since a level's width in pixels fits an int
+	return uint64_t(t_level) << 58 | uint64_t(uint32_t(t_x)) << 29 | uint64_t(uint32_t(t_y));
+}
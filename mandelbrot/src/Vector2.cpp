@@ -1,5 +1,7 @@
 #include "Vector2.h"
 
+#include <cmath>
+
 #define PI 3.14159265358979323846
 
 #pragma region constructors
@@ -22,6 +24,7 @@ Vector2::Vector2(double t_x, double t_y) : x{ static_cast<double>(t_x) }, y{ sta
 
 }
 
+#ifndef MANDELBROT_HEADLESS
 /// <summary>
 /// Vector2 constructor.
 /// </summary>
@@ -48,6 +51,7 @@ Vector2::Vector2(sf::Vector2u t_vector) : x{ static_cast<double>(t_vector.x) },
 {
 
 }
+#endif // !MANDELBROT_HEADLESS
 
 #pragma endregion
 
@@ -0,0 +1,198 @@
+#include "Viewport.h"
+
+#include <cmath>
+
+/// <summary>
+/// Viewport constructor. Starts on the whole set.
+/// </summary>
+/// <param name="t_width">The width of the view in pixels.</param>
+/// <param name="t_height">The height of the view in pixels.</param>
+Viewport::Viewport(int t_width, int t_height) : m_width{ t_width }, m_height{ t_height }
+{
+	setScale(t_width / 3.5);
+	setCentre(HighPrecision(-0.75, precisionLimbs()), HighPrecision(0.0, precisionLimbs()));
+}
+
+/// <summary>
+/// Viewport destructor.
+/// </summary>
+Viewport::~Viewport()
+{
+
+}
+
+/// <summary>
+/// Moves the centre of the view.
+/// </summary>
+/// <param name="t_x">The real part of the new centre.</param>
+/// <param name="t_y">The imaginary part of the new centre.</param>
+void Viewport::setCentre(const HighPrecision &t_x, const HighPrecision &t_y)
+{
+	m_centreX = t_x;
+	m_centreY = t_y;
+	normalise();
+}
+
+/// <summary>
+/// Sets the scale.
+/// </summary>
+/// <param name="t_scale">The number of pixels per world unit.</param>
+void Viewport::setScale(double t_scale)
+{
+	m_scaleMantissa = t_scale;
+	m_scaleExponent = 0;
+	normalise();
+}
+
+/// <summary>
+/// Zooms while keeping the world point under the anchor in place.
+/// </summary>
+/// <param name="t_factor">The zoom factor, above 1 to zoom in.</param>
+/// <param name="t_anchor">The screen position to zoom around.</param>
+void Viewport::zoom(double t_factor, const Vector2 &t_anchor)
+{
+	double f_spacing = pixelSpacing();
+	double f_dx = t_anchor.x - m_width / 2.0;
+	double f_dy = t_anchor.y - m_height / 2.0;
+
+	m_scaleMantissa *= t_factor;
+	normalise();
+
+	// The anchor's offset from the centre shrinks by the zoom factor
+	double f_shift = f_spacing * (1.0 - 1.0 / t_factor);
+	m_centreX += f_dx * f_shift;
+	m_centreY += f_dy * f_shift;
+}
+
+/// <summary>
+/// Pans so the world moves with the given screen delta.
+/// </summary>
+/// <param name="t_screenDelta">The movement in pixels.</param>
+void Viewport::pan(const Vector2 &t_screenDelta)
+{
+	double f_spacing = pixelSpacing();
+
+	m_centreX -= t_screenDelta.x * f_spacing;
+	m_centreY -= t_screenDelta.y * f_spacing;
+}
+
+/// <summary>
+/// Converts screen coordinates to exact world coordinates.
+/// </summary>
+/// <param name="t_screen">Screen coordinates.</param>
+/// <param name="t_worldX">The real part of the world coordinates.</param>
+/// <param name="t_worldY">The imaginary part of the world coordinates.</param>
+void Viewport::screenToWorld(const Vector2 &t_screen, HighPrecision &t_worldX, HighPrecision &t_worldY) const
+{
+	double f_spacing = pixelSpacing();
+
+	t_worldX = m_centreX;
+	t_worldY = m_centreY;
+	t_worldX += (t_screen.x - m_width / 2.0) * f_spacing;
+	t_worldY += (t_screen.y - m_height / 2.0) * f_spacing;
+}
+
+/// <summary>
+/// Converts screen coordinates to world coordinates as double-double hi and lo parts.
+/// </summary>
+/// <param name="t_screen">Screen coordinates.</param>
+/// <param name="t_world">World coordinates (hi part).</param>
+/// <param name="t_worldLow">World coordinates (lo part).</param>
+void Viewport::screenToWorld(const Vector2 &t_screen, Vector2 &t_world, Vector2 &t_worldLow) const
+{
+	HighPrecision f_x;
+	HighPrecision f_y;
+	screenToWorld(t_screen, f_x, f_y);
+
+	DoubleDouble f_ddX = f_x.toDoubleDouble();
+	DoubleDouble f_ddY = f_y.toDoubleDouble();
+
+	t_world = Vector2(f_ddX.hi, f_ddY.hi);
+	t_worldLow = Vector2(f_ddX.lo, f_ddY.lo);
+}
+
+/// <summary>
+/// Converts world coordinates to screen coordinates.
+/// </summary>
+/// <param name="t_worldX">The real part of the world coordinates.</param>
+/// <param name="t_worldY">The imaginary part of the world coordinates.</param>
+/// <param name="t_screen">Screen coordinates.</param>
+void Viewport::worldToScreen(const HighPrecision &t_worldX, const HighPrecision &t_worldY, Vector2 &t_screen) const
+{
+	// The difference from the centre is small, so it survives the trip through double
+	double f_scale = m_scaleMantissa;
+
+	t_screen.x = std::ldexp((t_worldX - m_centreX).toDouble() * f_scale, m_scaleExponent) + m_width / 2.0;
+	t_screen.y = std::ldexp((t_worldY - m_centreY).toDouble() * f_scale, m_scaleExponent) + m_height / 2.0;
+}
+
+/// <summary>
+/// Gets the real part of the centre.
+/// </summary>
+/// <returns>The real part of the centre.</returns>
+const HighPrecision &Viewport::centreX() const
+{
+	return m_centreX;
+}
+
+/// <summary>
+/// Gets the imaginary part of the centre.
+/// </summary>
+/// <returns>The imaginary part of the centre.</returns>
+const HighPrecision &Viewport::centreY() const
+{
+	return m_centreY;
+}
+
+/// <summary>
+/// Gets the distance between neighbouring pixels in world units.
+/// </summary>
+/// <returns>The pixel spacing.</returns>
+double Viewport::pixelSpacing() const
+{
+	return std::ldexp(1.0 / m_scaleMantissa, -m_scaleExponent);
+}
+
+/// <summary>
+/// Gets the mantissa of the scale, in the range [1, 2).
+/// </summary>
+/// <returns>The scale mantissa.</returns>
+double Viewport::scaleMantissa() const
+{
+	return m_scaleMantissa;
+}
+
+/// <summary>
+/// Gets the power of two of the scale.
+/// </summary>
+/// <returns>The scale exponent.</returns>
+int Viewport::scaleExponent() const
+{
+	return m_scaleExponent;
+}
+
+/// <summary>
+/// Gets the number of limbs needed to place every pixel exactly, with 64 bits to spare.
+/// </summary>
+/// <returns>The number of limbs, including the integer limb.</returns>
+int Viewport::precisionLimbs() const
+{
+	int f_bits = m_scaleExponent + 64;
+
+	return 1 + (f_bits > 0 ? (f_bits + 31) / 32 : 0) + 1;
+}
+
+/// <summary>
+/// Brings the scale mantissa back into [1, 2) and matches the centre's precision to the depth.
+/// </summary>
+void Viewport::normalise()
+{
+	int f_exponent;
+	double f_fraction = std::frexp(m_scaleMantissa, &f_exponent);
+
+	m_scaleMantissa = f_fraction * 2.0;
+	m_scaleExponent += f_exponent - 1;
+
+	m_centreX.setLimbs(precisionLimbs());
+	m_centreY.setLimbs(precisionLimbs());
+}
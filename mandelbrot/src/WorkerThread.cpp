@@ -1,4 +1,73 @@
 #include "WorkerThread.h"
+#include "DoubleDouble.h"
+#include "Fixed128.h"
+#include "KernelFamily.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#pragma region double-double
+
+// Vectorised double-double arithmetic, each value is held as a hi and a lo register.
+// See Dekker (1971) and the QD library by Hida, Li and Bailey.
+
+/// <summary>
+/// Adds two values, returning the rounded sum and its error.
+/// </summary>
+static inline void ddTwoSum(const __m256d t_a, const __m256d t_b, __m256d &t_sum, __m256d &t_error)
+{
+	t_sum = _mm256_add_pd(t_a, t_b);
+	__m256d __f_bb = _mm256_sub_pd(t_sum, t_a);
+	t_error = _mm256_add_pd(_mm256_sub_pd(t_a, _mm256_sub_pd(t_sum, __f_bb)), _mm256_sub_pd(t_b, __f_bb));
+}
+
+/// <summary>
+/// Renormalises a hi/lo pair where |hi| is known to be at least |lo|.
+/// </summary>
+static inline void ddQuickTwoSum(const __m256d t_a, const __m256d t_b, __m256d &t_hi, __m256d &t_lo)
+{
+	t_hi = _mm256_add_pd(t_a, t_b);
+	t_lo = _mm256_sub_pd(t_b, _mm256_sub_pd(t_hi, t_a));
+}
+
+/// <summary>
+/// Double-double addition.
+/// </summary>
+static inline void ddAdd(const __m256d t_aHi, const __m256d t_aLo, const __m256d t_bHi, const __m256d t_bLo, __m256d &t_hi, __m256d &t_lo)
+{
+	__m256d __f_sum;
+	__m256d __f_error;
+	ddTwoSum(t_aHi, t_bHi, __f_sum, __f_error);
+	__f_error = _mm256_add_pd(__f_error, _mm256_add_pd(t_aLo, t_bLo));
+	ddQuickTwoSum(__f_sum, __f_error, t_hi, t_lo);
+}
+
+/// <summary>
+/// Double-double multiplication. FMA gives the exact error of the hi * hi product.
+/// </summary>
+static inline void ddMul(const __m256d t_aHi, const __m256d t_aLo, const __m256d t_bHi, const __m256d t_bLo, __m256d &t_hi, __m256d &t_lo)
+{
+	__m256d __f_product = _mm256_mul_pd(t_aHi, t_bHi);
+	__m256d __f_error = _mm256_fmsub_pd(t_aHi, t_bHi, __f_product);
+	__f_error = _mm256_fmadd_pd(t_aHi, t_bLo, __f_error);
+	__f_error = _mm256_fmadd_pd(t_aLo, t_bHi, __f_error);
+	ddQuickTwoSum(__f_product, __f_error, t_hi, t_lo);
+}
+
+/// <summary>
+/// Double-double square.
+/// </summary>
+static inline void ddSqr(const __m256d t_aHi, const __m256d t_aLo, __m256d &t_hi, __m256d &t_lo)
+{
+	__m256d __f_product = _mm256_mul_pd(t_aHi, t_aHi);
+	__m256d __f_error = _mm256_fmsub_pd(t_aHi, t_aHi, __f_product);
+	__f_error = _mm256_fmadd_pd(_mm256_add_pd(t_aHi, t_aHi), t_aLo, __f_error);
+	ddQuickTwoSum(__f_product, __f_error, t_hi, t_lo);
+}
+
+#pragma endregion
 
 /// <summary>
 /// WorkerThread constructor.
@@ -17,127 +86,1184 @@ WorkerThread::~WorkerThread()
 }
 
 /// <summary>
-/// Start.
+/// Sets the section the worker covers without computing it, for a section whose counts are already
+/// known. Colouring and antialiasing then work on it as if it had been computed.
 /// </summary>
 /// <param name="t_pixTL">Pixel top left coordinate.</param>
 /// <param name="t_pixBR">Pixel top right coordinate.</param>
 /// <param name="t_fracTL">Fractal top left coordinate.</param>
 /// <param name="t_fracBR">Fractal top right coordinate.</param>
+/// <param name="t_fracTLLow">Low part of the fractal top left coordinate (double-double kernel only).</param>
+/// <param name="t_fracBRLow">Low part of the fractal top right coordinate (double-double kernel only).</param>
 /// <param name="t_iterations">The number of iterations.</param>
-void WorkerThread::start(const Vector2 &t_pixTL, const Vector2 &t_pixBR, const Vector2 &t_fracTL, const Vector2 &t_fracBR, const int t_iterations)
+/// <param name="t_kernel">The kernel to iterate with.</param>
+void WorkerThread::assign(const Vector2 &t_pixTL, const Vector2 &t_pixBR, const Vector2 &t_fracTL, const Vector2 &t_fracBR, const Vector2 &t_fracTLLow, const Vector2 &t_fracBRLow, const int t_iterations, const Kernel t_kernel)
 {
 	m_pixTL = t_pixTL;
 	m_pixBR = t_pixBR;
 	m_fracTL = t_fracTL;
 	m_fracBR = t_fracBR;
+	m_fracTLLow = t_fracTLLow;
+	m_fracBRLow = t_fracBRLow;
 	m_iterations = t_iterations;
+	m_kernel = t_kernel;
+}
+
+/// <summary>
+/// Start.
+/// </summary>
+/// <param name="t_pixTL">Pixel top left coordinate.</param>
+/// <param name="t_pixBR">Pixel top right coordinate.</param>
+/// <param name="t_fracTL">Fractal top left coordinate.</param>
+/// <param name="t_fracBR">Fractal top right coordinate.</param>
+/// <param name="t_fracTLLow">Low part of the fractal top left coordinate (double-double kernel only).</param>
+/// <param name="t_fracBRLow">Low part of the fractal top right coordinate (double-double kernel only).</param>
+/// <param name="t_iterations">The number of iterations.</param>
+/// <param name="t_kernel">The kernel to iterate with.</param>
+void WorkerThread::start(const Vector2 &t_pixTL, const Vector2 &t_pixBR, const Vector2 &t_fracTL, const Vector2 &t_fracBR, const Vector2 &t_fracTLLow, const Vector2 &t_fracBRLow, const int t_iterations, const Kernel t_kernel)
+{
+	assign(t_pixTL, t_pixBR, t_fracTL, t_fracBR, t_fracTLLow, t_fracBRLow, t_iterations, t_kernel);
+	m_job = WorkerJob::Compute;
 	std::unique_lock<std::mutex> f_lockMutex(m_mutex);
+	m_started = true;
 	m_cvStart.notify_one();
 }
 
 /// <summary>
-/// Create fractal using Advanced Vector Extensions.
-/// https://software.intel.com/sites/landingpage/IntrinsicsGuide/
+/// Starts colouring a section of iteration counts into the pixel array.
+/// </summary>
+/// <param name="t_pixTL">Pixel top left coordinate.</param>
+/// <param name="t_pixBR">Pixel bottom right coordinate.</param>
+void WorkerThread::startColouring(const Vector2 &t_pixTL, const Vector2 &t_pixBR)
+{
+	m_pixTL = t_pixTL;
+	m_pixBR = t_pixBR;
+	m_job = WorkerJob::Colour;
+	std::unique_lock<std::mutex> f_lockMutex(m_mutex);
+	m_started = true;
+	m_cvStart.notify_one();
+}
+
+/// <summary>
+/// Starts antialiasing the section the worker last computed, which must already be coloured.
+/// </summary>
+/// <param name="t_pixTL">Pixel top left coordinate.</param>
+/// <param name="t_pixBR">Pixel bottom right coordinate.</param>
+void WorkerThread::startAntialiasing(const Vector2 &t_pixTL, const Vector2 &t_pixBR)
+{
+	m_pixTL = t_pixTL;
+	m_pixBR = t_pixBR;
+	m_job = WorkerJob::Antialias;
+	std::unique_lock<std::mutex> f_lockMutex(m_mutex);
+	m_started = true;
+	m_cvStart.notify_one();
+}
+
+/// <summary>
+/// Worker loop. Waits to be started and then computes, colours or antialiases its section.
 /// </summary>
 void WorkerThread::createFractal()
 {
 	while (m_alive)
 	{
+		// The flag catches a start that comes before the thread first waits
 		std::unique_lock<std::mutex> f_lockMutex(m_mutex);
-		m_cvStart.wait(f_lockMutex);
-
-		double f_scaleX = (m_fracBR.x - m_fracTL.x) / (double(m_pixBR.x) - double(m_pixTL.x));
-		double f_scaleY = (m_fracBR.y - m_fracTL.y) / (double(m_pixBR.y) - double(m_pixTL.y));
-
-		double f_posY = m_fracTL.y;
-
-		int f_x;
-		int f_y;
-
-		int f_offsetY = 0;
-		int f_rowSize = m_screenWidth;
-
-		__m256i __f_one;
-		__m256d __f_two;
-		__m256d __f_four;
-		__m256d __f_mask1;
-		__m256i __f_mask2;
-
-		__m256d __f_A;
-		__m256d __f_B;
-		__m256i __f_C;
-		__m256i __f_N;
-		__m256d __f_ZR;
-		__m256d __f_ZI;
-		__m256d __f_ZR2; 
-		__m256d __f_ZI2;
-		__m256d __f_CR;
-		__m256d __f_CI;
-
-		__m256d __f_xPosOffsets; 
-		__m256d __f_posX;
-		__m256d __f_scaleX; 
-		__m256d __f_jumpX;
-		__m256i __f_iterations;		
-
-		__f_one = _mm256_set1_epi64x(1);
-		__f_two = _mm256_set1_pd(2.0);
-		__f_four = _mm256_set1_pd(4.0);
-		__f_iterations = _mm256_set1_epi64x(m_iterations);
-
-		__f_scaleX = _mm256_set1_pd(f_scaleX);
-		__f_jumpX = _mm256_set1_pd(f_scaleX * 4);
-		__f_xPosOffsets = _mm256_set_pd(0, 1, 2, 3);
-		__f_xPosOffsets = _mm256_mul_pd(__f_xPosOffsets, __f_scaleX);
-
-		for (f_y = m_pixTL.y; f_y < m_pixBR.y; f_y++)
-		{
-			// Reset X position
-			__f_A = _mm256_set1_pd(m_fracTL.x);
-			__f_posX = _mm256_add_pd(__f_A, __f_xPosOffsets);
-
-			__f_CI = _mm256_set1_pd(f_posY);
-
-			for (f_x = m_pixTL.x; f_x < m_pixBR.x; f_x += 4)
-			{
-				__f_CR = __f_posX;
-				__f_ZR = _mm256_setzero_pd();
-				__f_ZI = _mm256_setzero_pd();
-				__f_N = _mm256_setzero_si256();
-
-			repeat:
-				__f_ZR2 = _mm256_mul_pd(__f_ZR, __f_ZR);
-				__f_ZI2 = _mm256_mul_pd(__f_ZI, __f_ZI);
-				__f_A = _mm256_sub_pd(__f_ZR2, __f_ZI2);
-				__f_A = _mm256_add_pd(__f_A, __f_CR);
-				__f_B = _mm256_mul_pd(__f_ZR, __f_ZI);
-				__f_B = _mm256_fmadd_pd(__f_B, __f_two, __f_CI);
-				__f_ZR = __f_A;
-				__f_ZI = __f_B;
-				__f_A = _mm256_add_pd(__f_ZR2, __f_ZI2);
-				__f_mask1 = _mm256_cmp_pd(__f_A, __f_four, _CMP_LT_OQ);
-				__f_mask2 = _mm256_cmpgt_epi64(__f_iterations, __f_N);
-				__f_mask2 = _mm256_and_si256(__f_mask2, _mm256_castpd_si256(__f_mask1));
-				__f_C = _mm256_and_si256(__f_one, __f_mask2);											
-				__f_N = _mm256_add_epi64(__f_N, __f_C);
-
-				if (_mm256_movemask_pd(_mm256_castsi256_pd(__f_mask2)) > 0)
+		m_cvStart.wait(f_lockMutex, [this] { return m_started || !m_alive; });
+
+		if (!m_alive)
+		{
+			break;
+		}
+
+		m_started = false;
+
+		switch (m_job)
+		{
+		case WorkerJob::Colour:
+			colour();
+			break;
+		case WorkerJob::Antialias:
+			antialias();
+			break;
+		default:
+			compute();
+			break;
+		}
+
+		Globals::WORKER_COMPLETE++;
+	}
+}
+
+/// <summary>
+/// Runs the selected kernel over the section on the calling thread.
+/// </summary>
+void WorkerThread::compute()
+{
+	m_entry = nullptr;
+
+	switch (m_kernel)
+	{
+	case Kernel::DoubleDouble:
+		clearChannels();
+		kernelDoubleDouble();
+		break;
+	case Kernel::Fixed128:
+		clearChannels();
+		kernelFixed128();
+		break;
+	case Kernel::Perturbation:
+		clearChannels();
+
+		// One row at a time so each row can be coloured while it is still in cache
+		for (int f_y = int(m_pixTL.y); f_y < int(m_pixBR.y); f_y++)
+		{
+			int f_offsetY = f_y * m_screenWidth;
+			int *f_counts = countRow(f_offsetY);
+
+			// With a row size of 0 the row is written from f_counts[0], indexed by x alone
+			m_perturbation->render(f_counts, Vector2(m_pixTL.x, f_y), Vector2(m_pixBR.x, f_y + 1), 0);
+			finishRow(f_offsetY, f_counts);
+		}
+		break;
+	default:
+	{
+		// Float and double come from the registry, built for exactly the features wanted.
+		// dz overflows float long before the orbit escapes, so the distance channel is always double.
+		Kernel f_kernel = m_kernel == Kernel::Float && m_distance != nullptr ? Kernel::Double : m_kernel;
+		m_entry = findKernel(f_kernel, m_exponent, features(), 0);
+
+		// The double family is registered for every set of features, so it covers any gap in the float ones
+		if (m_entry == nullptr)
+		{
+			m_entry = findKernel(Kernel::Double, m_exponent, features(), 0);
+		}
+
+		// Only exponents 2 to 5 are registered. Anything else leaves the section escaped at once rather
+		// than calling through a null entry, since the assert is gone from release builds.
+		assert(m_entry != nullptr && "no kernel is registered for this exponent, exponents 2 to 5 are");
+
+		if (m_entry == nullptr)
+		{
+			clearChannels();
+
+			for (int f_y = int(m_pixTL.y); f_y < int(m_pixBR.y); f_y++)
+			{
+				int f_offsetY = f_y * m_screenWidth;
+				int *f_counts = countRow(f_offsetY);
+
+				std::fill(&f_counts[int(m_pixTL.x)], &f_counts[int(m_pixBR.x)], 0);
+				finishRow(f_offsetY, f_counts);
+			}
+
+			break;
+		}
+
+		(this->*m_entry->m_function)();
+		break;
+	}
+	}
+}
+
+/// <summary>
+/// The KERNEL_ flags for the outputs and checks currently asked for.
+/// </summary>
+/// <returns>The flags to look the kernel up with.</returns>
+int WorkerThread::features() const
+{
+	int f_features = 0;
+
+	if (m_smoothFormat != SmoothFormat::None)
+	{
+		f_features |= KERNEL_SMOOTH;
+	}
+
+	if (m_distance != nullptr)
+	{
+		f_features |= KERNEL_DERIVATIVE;
+	}
+
+	if (m_interiorChecks || m_period != nullptr)
+	{
+		f_features |= KERNEL_PERIOD;
+	}
+
+	// The cardioid and bulb only have a closed form for the z^2 Mandelbrot set
+	if (m_interiorChecks && m_exponent == 2 && !m_julia)
+	{
+		f_features |= KERNEL_BULB_CHECK;
+	}
+
+	if (m_julia)
+	{
+		f_features |= KERNEL_JULIA;
+	}
+
+	return f_features;
+}
+
+/// <summary>
+/// Colours the section on the calling thread, one palette lookup per iteration count.
+/// </summary>
+void WorkerThread::colour()
+{
+	int f_x = int(m_pixTL.x);
+	int f_width = int(m_pixBR.x) - f_x;
+
+	for (int f_y = int(m_pixTL.y); f_y < int(m_pixBR.y); f_y++)
+	{
+		int f_offset = f_y * m_screenWidth + f_x;
+		colourRow(f_offset, &m_fractal[f_offset], f_width);
+	}
+}
+
+/// <summary>
+/// Colours a run of pixels, using the smooth channel when there is one
+/// and outlining the boundary when there is a distance channel.
+/// </summary>
+/// <param name="t_offset">The offset of the first pixel in the shared buffers.</param>
+/// <param name="t_counts">The iteration counts for the run.</param>
+/// <param name="t_count">The number of pixels.</param>
+void WorkerThread::colourRow(int t_offset, const int *t_counts, int t_count)
+{
+	switch (m_smoothFormat)
+	{
+	case SmoothFormat::Float32:
+		m_palette->applySmooth(t_counts, &((const float *)m_smooth)[t_offset], &m_pixels[t_offset], t_count);
+		break;
+	case SmoothFormat::Float16:
+		m_palette->applySmooth(t_counts, &((const uint16_t *)m_smooth)[t_offset], &m_pixels[t_offset], t_count);
+		break;
+	default:
+		m_palette->apply(t_counts, &m_pixels[t_offset], t_count);
+		break;
+	}
+
+	if (m_distance != nullptr)
+	{
+		Palette::shadeBoundary(&m_distance[t_offset], &m_pixels[t_offset], t_count);
+	}
+}
+
+/// <summary>
+/// Writes the smooth channel for up to eight pixels. The fraction to add to the count is
+/// 1 - log2(log|z| / log(bailout)), which runs from 1 down to 0 as |z| at escape grows from
+/// the bailout to its square, so bands blend into each other.
+/// Pixels that never escaped get 0.
+/// </summary>
+/// <param name="t_offset">The offset of the first pixel in the shared buffer.</param>
+/// <param name="t_counts">The iteration counts.</param>
+/// <param name="t_norms">|z|^2 at escape.</param>
+/// <param name="t_lanes">The number of pixels to write.</param>
+void WorkerThread::storeSmooth(int t_offset, const int *t_counts, const float *t_norms, int t_lanes)
+{
+	alignas(32) float f_fraction[8];
+
+	for (int i = 0; i < 8; i++)
+	{
+		f_fraction[i] = 0.0f;
+
+		if (i < t_lanes && t_counts[i] < m_iterations)
+		{
+			f_fraction[i] = smoothFraction(t_norms[i], m_exponent);
+		}
+	}
+
+	if (m_smoothFormat == SmoothFormat::Float16)
+	{
+		alignas(16) uint16_t f_half[8];
+		_mm_store_si128((__m128i *)f_half, _mm256_cvtps_ph(_mm256_load_ps(f_fraction), _MM_FROUND_TO_NEAREST_INT));
+		std::copy(f_half, f_half + t_lanes, &((uint16_t *)m_smooth)[t_offset]);
+	}
+	else
+	{
+		std::copy(f_fraction, f_fraction + t_lanes, &((float *)m_smooth)[t_offset]);
+	}
+}
+
+/// <summary>
+/// The smooth fraction for a pixel that escaped with the given |z|^2. For z^d the log of |z|
+/// grows d times each iteration, so the fraction is taken in base d.
+/// </summary>
+/// <param name="t_norm">|z|^2 at escape.</param>
+/// <param name="t_exponent">The power of z.</param>
+/// <returns>The fraction to add to the count, 0 to 1.</returns>
+float WorkerThread::smoothFraction(float t_norm, int t_exponent)
+{
+	float f_ratio = 0.5f * std::log(t_norm) / std::log(float(Globals::SMOOTH_BAILOUT));
+	float f_fraction = t_exponent == 2 ? std::log2(f_ratio) : std::log(f_ratio) / std::log(float(t_exponent));
+	return std::min(std::max(1.0f - f_fraction, 0.0f), 1.0f);
+}
+
+/// <summary>
+/// Writes the distance channel for up to eight pixels, in pixels rather than world units.
+/// The exterior distance estimate is 2 * |z| * log|z| / |dz| at escape, which is within a
+/// factor of 4 of the true distance to the set. Pixels that never escaped get 0.
+/// </summary>
+/// <param name="t_offset">The offset of the first pixel in the shared buffer.</param>
+/// <param name="t_counts">The iteration counts.</param>
+/// <param name="t_norms">|z|^2 at escape.</param>
+/// <param name="t_derivativeNorms">|dz|^2 at escape.</param>
+/// <param name="t_spacing">The distance between pixels in world units.</param>
+/// <param name="t_lanes">The number of pixels to write.</param>
+void WorkerThread::storeDistance(int t_offset, const int *t_counts, const double *t_norms, const double *t_derivativeNorms, double t_spacing, int t_lanes)
+{
+	for (int i = 0; i < t_lanes; i++)
+	{
+		double f_distance = 0.0;
+
+		// 2 * |z| * log|z| is |z| * log|z|^2
+		if (t_counts[i] < m_iterations && t_derivativeNorms[i] > 0.0)
+		{
+			f_distance = std::sqrt(t_norms[i] / t_derivativeNorms[i]) * std::log(t_norms[i]) / t_spacing;
+		}
+
+		m_distance[t_offset + i] = float(f_distance);
+	}
+}
+
+/// <summary>
+/// Fills the extra channels over the section for kernels that don't produce them.
+/// The smooth fraction and period become 0 and the distance becomes -1, meaning no estimate.
+/// </summary>
+void WorkerThread::clearChannels()
+{
+	int f_x = int(m_pixTL.x);
+	int f_width = int(m_pixBR.x) - f_x;
+
+	for (int f_y = int(m_pixTL.y); f_y < int(m_pixBR.y); f_y++)
+	{
+		size_t f_offset = size_t(f_y) * size_t(m_screenWidth) + size_t(f_x);
+
+		if (m_smoothFormat != SmoothFormat::None)
+		{
+			size_t f_bytes = m_smoothFormat == SmoothFormat::Float16 ? sizeof(uint16_t) : sizeof(float);
+			std::memset((uint8_t *)m_smooth + f_offset * f_bytes, 0, size_t(f_width) * f_bytes);
+		}
+
+		if (m_distance != nullptr)
+		{
+			std::fill(&m_distance[f_offset], &m_distance[f_offset] + f_width, -1.0f);
+		}
+
+		if (m_period != nullptr)
+		{
+			std::fill(&m_period[f_offset], &m_period[f_offset] + f_width, 0);
+		}
+	}
+}
+
+/// <summary>
+/// Gets where a kernel should write the counts for a row, indexed by the absolute x position.
+/// That is the shared buffer when the counts are kept, otherwise a scratch row that is coloured and reused.
+/// </summary>
+/// <param name="t_offsetY">The offset of the row in the shared buffer.</param>
+/// <returns>The row to write to.</returns>
+int *WorkerThread::countRow(int t_offsetY)
+{
+	if (m_keepCounts)
+	{
+		return &m_fractal[t_offsetY];
+	}
+
+	if (int(m_rowCounts.size()) < m_screenWidth)
+	{
+		m_rowCounts.resize(size_t(m_screenWidth));
+	}
+
+	return m_rowCounts.data();
+}
+
+/// <summary>
+/// Called by the kernels once a row is done. When colouring is fused the row is coloured straight away.
+/// </summary>
+/// <param name="t_offsetY">The offset of the row in the shared buffer.</param>
+/// <param name="t_counts">The row returned by countRow.</param>
+void WorkerThread::finishRow(int t_offsetY, const int *t_counts)
+{
+	if (m_fuseColour)
+	{
+		int f_x = int(m_pixTL.x);
+		colourRow(t_offsetY + f_x, &t_counts[f_x], int(m_pixBR.x) - f_x);
+	}
+}
+
+/// <summary>
+/// Gets a display name for a kernel.
+/// </summary>
+/// <param name="t_kernel">The kernel.</param>
+/// <returns>The name of the kernel.</returns>
+const char *WorkerThread::kernelName(Kernel t_kernel)
+{
+	switch (t_kernel)
+	{
+	case Kernel::Float:
+		return "FLOAT";
+	case Kernel::DoubleDouble:
+		return "DOUBLE-DOUBLE";
+	case Kernel::Fixed128:
+		return "FIXED128";
+	case Kernel::Perturbation:
+		return "PERTURBATION";
+	default:
+		return "DOUBLE";
+	}
+}
+
+/// <summary>
+/// Create fractal using single precision, eight pixels per AVX register.
+/// Only used at shallow zooms where the pixel spacing is far above float rounding.
+/// With t_smooth the bailout is raised and |z|^2 is kept at escape for the smooth channel.
+/// </summary>
+template <bool t_smooth>
+void WorkerThread::kernelFloat()
+{
+	double f_scaleX = (m_fracBR.x - m_fracTL.x) / (double(m_pixBR.x) - double(m_pixTL.x));
+	double f_scaleY = (m_fracBR.y - m_fracTL.y) / (double(m_pixBR.y) - double(m_pixTL.y));
+
+	int f_x;
+	int f_y;
+
+	int f_offsetY = 0;
+	int f_rowSize = m_screenWidth;
+
+	__m256i __f_one = _mm256_set1_epi32(1);
+	__m256 __f_two = _mm256_set1_ps(2.0f);
+	__m256 __f_bailout = _mm256_set1_ps(t_smooth ? float(Globals::SMOOTH_BAILOUT * Globals::SMOOTH_BAILOUT) : 4.0f);
+	__m256i __f_iterations = _mm256_set1_epi32(m_iterations);
+	__m256i __f_laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256d __f_scaleX = _mm256_set1_pd(f_scaleX);
+	__m256d __f_fracX = _mm256_set1_pd(m_fracTL.x);
+	__m256d __f_lowOffsets = _mm256_setr_pd(0, 1, 2, 3);
+	__m256d __f_highOffsets = _mm256_setr_pd(4, 5, 6, 7);
+
+	__m256 __f_mask1;
+	__m256i __f_mask2;
+
+	__m256d __f_X;
+	__m256 __f_A;
+	__m256 __f_B;
+	__m256i __f_N;
+	__m256 __f_ZR;
+	__m256 __f_ZI;
+	__m256 __f_ZR2;
+	__m256 __f_ZI2;
+	__m256 __f_CR;
+	__m256 __f_CI;
+	__m256 __f_norm;
+	__m256i __f_active;
+
+	alignas(32) int f_n[8];
+	alignas(32) float f_norm[8];
+
+	for (f_y = m_pixTL.y; f_y < m_pixBR.y; f_y++)
+	{
+		int *f_counts = countRow(f_offsetY);
+
+		__f_CI = _mm256_set1_ps(float(m_fracTL.y + (f_y - m_pixTL.y) * f_scaleY));
+
+		for (f_x = m_pixTL.x; f_x < m_pixBR.x; f_x += 8)
+		{
+			// Positions are worked out in double and rounded once, so they don't drift across the row
+			__f_X = _mm256_set1_pd(double(f_x - m_pixTL.x));
+			__m128 __f_low = _mm256_cvtpd_ps(_mm256_fmadd_pd(_mm256_add_pd(__f_X, __f_lowOffsets), __f_scaleX, __f_fracX));
+			__m128 __f_high = _mm256_cvtpd_ps(_mm256_fmadd_pd(_mm256_add_pd(__f_X, __f_highOffsets), __f_scaleX, __f_fracX));
+			__f_CR = _mm256_insertf128_ps(_mm256_castps128_ps256(__f_low), __f_high, 1);
+
+			__f_ZR = _mm256_setzero_ps();
+			__f_ZI = _mm256_setzero_ps();
+			__f_N = _mm256_setzero_si256();
+			__f_norm = _mm256_setzero_ps();
+			__f_active = _mm256_set1_epi32(-1);
+
+		repeat:
+			__f_ZR2 = _mm256_mul_ps(__f_ZR, __f_ZR);
+			__f_ZI2 = _mm256_mul_ps(__f_ZI, __f_ZI);
+			__f_A = _mm256_sub_ps(__f_ZR2, __f_ZI2);
+			__f_A = _mm256_add_ps(__f_A, __f_CR);
+			__f_B = _mm256_mul_ps(__f_ZR, __f_ZI);
+			__f_B = _mm256_fmadd_ps(__f_B, __f_two, __f_CI);
+			__f_ZR = __f_A;
+			__f_ZI = __f_B;
+			__f_A = _mm256_add_ps(__f_ZR2, __f_ZI2);
+			__f_mask1 = _mm256_cmp_ps(__f_A, __f_bailout, _CMP_LT_OQ);
+			__f_mask2 = _mm256_cmpgt_epi32(__f_iterations, __f_N);
+			__f_mask2 = _mm256_and_si256(__f_mask2, _mm256_castps_si256(__f_mask1));
+			__f_N = _mm256_add_epi32(__f_N, _mm256_and_si256(__f_one, __f_mask2));
+
+			// Lanes that were still running last time round take this |z|^2, finished lanes keep theirs
+			if (t_smooth)
+			{
+				__f_norm = _mm256_blendv_ps(__f_norm, __f_A, _mm256_castsi256_ps(__f_active));
+				__f_active = __f_mask2;
+			}
+
+			if (_mm256_movemask_ps(_mm256_castsi256_ps(__f_mask2)) > 0)
+			{
+				goto repeat;
+			}
+
+			// Counters are already 32-bit, so they go straight to the buffer. Only lanes inside the section are written.
+			int f_remaining = int(m_pixBR.x) - f_x;
+
+			if (f_remaining >= 8)
+			{
+				_mm256_storeu_si256((__m256i *)&f_counts[f_x], __f_N);
+			}
+			else
+			{
+				_mm256_maskstore_epi32(&f_counts[f_x], _mm256_cmpgt_epi32(_mm256_set1_epi32(f_remaining), __f_laneIndices), __f_N);
+			}
+
+			if (t_smooth)
+			{
+				_mm256_store_si256((__m256i *)f_n, __f_N);
+				_mm256_store_ps(f_norm, __f_norm);
+				storeSmooth(f_offsetY + f_x, f_n, f_norm, f_remaining < 8 ? f_remaining : 8);
+			}
+		}
+
+		finishRow(f_offsetY, f_counts);
+		f_offsetY += f_rowSize;
+	}
+}
+
+/// <summary>
+/// Create fractal using Advanced Vector Extensions.
+/// Eight pixels are iterated together as two double registers, the even pixels in one and the
+/// odd pixels in the other. Their masks interleave into a single register of 32-bit counters,
+/// which is already in pixel order and goes to the buffer with one store.
+/// With t_smooth the bailout is raised and |z|^2 is kept at escape for the smooth channel.
+/// With t_distance the derivative dz is iterated alongside z for the distance channel.
+/// Both are compile-time flags, so the plain kernel pays nothing for them.
+/// https://software.intel.com/sites/landingpage/IntrinsicsGuide/
+/// </summary>
+template <bool t_smooth, bool t_distance>
+void WorkerThread::kernelDouble()
+{
+	double f_scaleX = (m_fracBR.x - m_fracTL.x) / (double(m_pixBR.x) - double(m_pixTL.x));
+	double f_scaleY = (m_fracBR.y - m_fracTL.y) / (double(m_pixBR.y) - double(m_pixTL.y));
+
+	double f_posY = m_fracTL.y;
+
+	int f_x;
+	int f_y;
+
+	int f_offsetY = 0;
+	int f_rowSize = m_screenWidth;
+
+	__m256i __f_one;
+	__m256d __f_two;
+	__m256d __f_bailout;
+	__m256i __f_mask;
+
+	__m256d __f_A;
+	__m256d __f_B;
+	__m256i __f_N;
+	__m256d __f_ZR0;
+	__m256d __f_ZI0;
+	__m256d __f_ZR1;
+	__m256d __f_ZI1;
+	__m256d __f_ZR2;
+	__m256d __f_ZI2;
+	__m256d __f_CR0;
+	__m256d __f_CR1;
+	__m256d __f_CI;
+
+	__m256d __f_evenOffsets;
+	__m256d __f_oddOffsets;
+	__m256d __f_posX;
+	__m256d __f_scaleX;
+	__m256d __f_jumpX;
+	__m256i __f_iterations;
+	__m256i __f_laneIndices;
+	__m256d __f_norm0;
+	__m256d __f_norm1;
+	__m256d __f_DZR0;
+	__m256d __f_DZI0;
+	__m256d __f_DZR1;
+	__m256d __f_DZI1;
+	__m256d __f_dzNorm0;
+	__m256d __f_dzNorm1;
+	__m256d __f_dzNormEven;
+	__m256d __f_dzNormOdd;
+	__m256d __f_onePD;
+	__m256i __f_active;
+
+	alignas(32) int f_n[8];
+	alignas(32) double f_lanes0[4];
+	alignas(32) double f_lanes1[4];
+	double f_zNorm[8];
+	double f_dzNorm[8];
+	float f_norm[8];
+
+	__f_one = _mm256_set1_epi32(1);
+	__f_two = _mm256_set1_pd(2.0);
+	__f_bailout = _mm256_set1_pd(t_smooth || t_distance ? Globals::SMOOTH_BAILOUT * Globals::SMOOTH_BAILOUT : 4.0);
+	__f_onePD = _mm256_set1_pd(1.0);
+	__f_iterations = _mm256_set1_epi32(m_iterations);
+	__f_laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	__f_scaleX = _mm256_set1_pd(f_scaleX);
+	__f_jumpX = _mm256_set1_pd(f_scaleX * 8);
+	__f_evenOffsets = _mm256_mul_pd(_mm256_setr_pd(0, 2, 4, 6), __f_scaleX);
+	__f_oddOffsets = _mm256_mul_pd(_mm256_setr_pd(1, 3, 5, 7), __f_scaleX);
+
+	for (f_y = m_pixTL.y; f_y < m_pixBR.y; f_y++)
+	{
+		int *f_counts = countRow(f_offsetY);
+
+		// Reset X position
+		__f_posX = _mm256_set1_pd(m_fracTL.x);
+
+		__f_CI = _mm256_set1_pd(f_posY);
+
+		for (f_x = m_pixTL.x; f_x < m_pixBR.x; f_x += 8)
+		{
+			__f_CR0 = _mm256_add_pd(__f_posX, __f_evenOffsets);
+			__f_CR1 = _mm256_add_pd(__f_posX, __f_oddOffsets);
+			__f_ZR0 = _mm256_setzero_pd();
+			__f_ZI0 = _mm256_setzero_pd();
+			__f_ZR1 = _mm256_setzero_pd();
+			__f_ZI1 = _mm256_setzero_pd();
+			__f_N = _mm256_setzero_si256();
+			__f_norm0 = _mm256_setzero_pd();
+			__f_norm1 = _mm256_setzero_pd();
+			__f_DZR0 = _mm256_setzero_pd();
+			__f_DZI0 = _mm256_setzero_pd();
+			__f_DZR1 = _mm256_setzero_pd();
+			__f_DZI1 = _mm256_setzero_pd();
+			__f_dzNorm0 = _mm256_setzero_pd();
+			__f_dzNorm1 = _mm256_setzero_pd();
+			__f_active = _mm256_set1_epi32(-1);
+
+		repeat:
+			// dz = 2 * z * dz + 1, from the z and dz of this iteration
+			if (t_distance)
+			{
+				__f_dzNormEven = _mm256_fmadd_pd(__f_DZR0, __f_DZR0, _mm256_mul_pd(__f_DZI0, __f_DZI0));
+				__f_A = _mm256_fmsub_pd(__f_ZR0, __f_DZR0, _mm256_mul_pd(__f_ZI0, __f_DZI0));
+				__f_DZI0 = _mm256_mul_pd(__f_two, _mm256_fmadd_pd(__f_ZR0, __f_DZI0, _mm256_mul_pd(__f_ZI0, __f_DZR0)));
+				__f_DZR0 = _mm256_fmadd_pd(__f_two, __f_A, __f_onePD);
+
+				__f_dzNormOdd = _mm256_fmadd_pd(__f_DZR1, __f_DZR1, _mm256_mul_pd(__f_DZI1, __f_DZI1));
+				__f_A = _mm256_fmsub_pd(__f_ZR1, __f_DZR1, _mm256_mul_pd(__f_ZI1, __f_DZI1));
+				__f_DZI1 = _mm256_mul_pd(__f_two, _mm256_fmadd_pd(__f_ZR1, __f_DZI1, _mm256_mul_pd(__f_ZI1, __f_DZR1)));
+				__f_DZR1 = _mm256_fmadd_pd(__f_two, __f_A, __f_onePD);
+			}
+
+			// Even pixels
+			__f_ZR2 = _mm256_mul_pd(__f_ZR0, __f_ZR0);
+			__f_ZI2 = _mm256_mul_pd(__f_ZI0, __f_ZI0);
+			__f_A = _mm256_sub_pd(__f_ZR2, __f_ZI2);
+			__f_A = _mm256_add_pd(__f_A, __f_CR0);
+			__f_B = _mm256_mul_pd(__f_ZR0, __f_ZI0);
+			__f_ZI0 = _mm256_fmadd_pd(__f_B, __f_two, __f_CI);
+			__f_ZR0 = __f_A;
+			__m256d __f_normEven = _mm256_add_pd(__f_ZR2, __f_ZI2);
+			__m256d __f_mask0 = _mm256_cmp_pd(__f_normEven, __f_bailout, _CMP_LT_OQ);
+
+			// Odd pixels
+			__f_ZR2 = _mm256_mul_pd(__f_ZR1, __f_ZR1);
+			__f_ZI2 = _mm256_mul_pd(__f_ZI1, __f_ZI1);
+			__f_A = _mm256_sub_pd(__f_ZR2, __f_ZI2);
+			__f_A = _mm256_add_pd(__f_A, __f_CR1);
+			__f_B = _mm256_mul_pd(__f_ZR1, __f_ZI1);
+			__f_ZI1 = _mm256_fmadd_pd(__f_B, __f_two, __f_CI);
+			__f_ZR1 = __f_A;
+			__m256d __f_normOdd = _mm256_add_pd(__f_ZR2, __f_ZI2);
+			__m256d __f_mask1 = _mm256_cmp_pd(__f_normOdd, __f_bailout, _CMP_LT_OQ);
+
+			// Each 64-bit mask is two equal 32-bit halves, so taking the low half of the even
+			// lanes and the high half of the odd lanes gives one 32-bit mask per pixel
+			__f_mask = _mm256_blend_epi32(_mm256_castpd_si256(__f_mask0), _mm256_castpd_si256(__f_mask1), 0xAA);
+			__f_mask = _mm256_and_si256(__f_mask, _mm256_cmpgt_epi32(__f_iterations, __f_N));
+			__f_N = _mm256_add_epi32(__f_N, _mm256_and_si256(__f_one, __f_mask));
+
+			// Lanes that were still running last time round take this |z|^2 (and |dz|^2). The packed mask is
+			// spread back out to 64 bits, pixels 0, 2, 4, 6 for the even register and 1, 3, 5, 7 for the odd.
+			if (t_smooth || t_distance)
+			{
+				__m256d __f_activeEven = _mm256_castsi256_pd(_mm256_shuffle_epi32(__f_active, _MM_SHUFFLE(2, 2, 0, 0)));
+				__m256d __f_activeOdd = _mm256_castsi256_pd(_mm256_shuffle_epi32(__f_active, _MM_SHUFFLE(3, 3, 1, 1)));
+				__f_norm0 = _mm256_blendv_pd(__f_norm0, __f_normEven, __f_activeEven);
+				__f_norm1 = _mm256_blendv_pd(__f_norm1, __f_normOdd, __f_activeOdd);
+
+				if (t_distance)
 				{
-					goto repeat;
-				}					
+					__f_dzNorm0 = _mm256_blendv_pd(__f_dzNorm0, __f_dzNormEven, __f_activeEven);
+					__f_dzNorm1 = _mm256_blendv_pd(__f_dzNorm1, __f_dzNormOdd, __f_activeOdd);
+				}
 
-				m_fractal[f_offsetY + f_x + 0] = int(__f_N.m256i_i64[3]);
-				m_fractal[f_offsetY + f_x + 1] = int(__f_N.m256i_i64[2]);
-				m_fractal[f_offsetY + f_x + 2] = int(__f_N.m256i_i64[1]);
-				m_fractal[f_offsetY + f_x + 3] = int(__f_N.m256i_i64[0]);
+				__f_active = __f_mask;
+			}
 
-				__f_posX = _mm256_add_pd(__f_posX, __f_jumpX);
+			if (_mm256_movemask_ps(_mm256_castsi256_ps(__f_mask)) > 0)
+			{
+				goto repeat;
 			}
 
-			f_posY += f_scaleY;
-			f_offsetY += f_rowSize;
+			// Only lanes inside the section are written
+			int f_remaining = int(m_pixBR.x) - f_x;
+
+			if (f_remaining >= 8)
+			{
+				_mm256_storeu_si256((__m256i *)&f_counts[f_x], __f_N);
+			}
+			else
+			{
+				_mm256_maskstore_epi32(&f_counts[f_x], _mm256_cmpgt_epi32(_mm256_set1_epi32(f_remaining), __f_laneIndices), __f_N);
+			}
+
+			// Put the escape values back in pixel order for the extra channels
+			if (t_smooth || t_distance)
+			{
+				_mm256_store_si256((__m256i *)f_n, __f_N);
+				_mm256_store_pd(f_lanes0, __f_norm0);
+				_mm256_store_pd(f_lanes1, __f_norm1);
+
+				for (int i = 0; i < 4; i++)
+				{
+					f_zNorm[i * 2] = f_lanes0[i];
+					f_zNorm[i * 2 + 1] = f_lanes1[i];
+				}
+			}
+
+			if (t_smooth)
+			{
+				for (int i = 0; i < 8; i++)
+				{
+					f_norm[i] = float(f_zNorm[i]);
+				}
+
+				storeSmooth(f_offsetY + f_x, f_n, f_norm, f_remaining < 8 ? f_remaining : 8);
+			}
+
+			if (t_distance)
+			{
+				_mm256_store_pd(f_lanes0, __f_dzNorm0);
+				_mm256_store_pd(f_lanes1, __f_dzNorm1);
+
+				for (int i = 0; i < 4; i++)
+				{
+					f_dzNorm[i * 2] = f_lanes0[i];
+					f_dzNorm[i * 2 + 1] = f_lanes1[i];
+				}
+
+				storeDistance(f_offsetY + f_x, f_n, f_zNorm, f_dzNorm, f_scaleX, f_remaining < 8 ? f_remaining : 8);
+			}
+
+			__f_posX = _mm256_add_pd(__f_posX, __f_jumpX);
 		}
 
-		Globals::WORKER_COMPLETE++;
+		f_posY += f_scaleY;
+		finishRow(f_offsetY, f_counts);
+		f_offsetY += f_rowSize;
+	}
+}
+
+/// <summary>
+/// Create fractal using double-double arithmetic for zooms beyond the reach of double.
+/// Every value is a hi/lo pair of AVX registers, four pixels at a time.
+/// </summary>
+void WorkerThread::kernelDoubleDouble()
+{
+	// The corners are nearly equal at these depths, so subtract the hi and lo parts separately
+	double f_scaleX = ((m_fracBR.x - m_fracTL.x) + (m_fracBRLow.x - m_fracTLLow.x)) / (double(m_pixBR.x) - double(m_pixTL.x));
+	double f_scaleY = ((m_fracBR.y - m_fracTL.y) + (m_fracBRLow.y - m_fracTLLow.y)) / (double(m_pixBR.y) - double(m_pixTL.y));
+
+	DoubleDouble f_fracTLX(m_fracTL.x, m_fracTLLow.x);
+	DoubleDouble f_fracTLY(m_fracTL.y, m_fracTLLow.y);
+
+	int f_x;
+	int f_y;
+
+	int f_offsetY = 0;
+	int f_rowSize = m_screenWidth;
+
+	alignas(32) int64_t f_n[4];
+
+	__m256i __f_one = _mm256_set1_epi64x(1);
+	__m256d __f_four = _mm256_set1_pd(4.0);
+	__m256i __f_iterations = _mm256_set1_epi64x(m_iterations);
+	__m256d __f_scaleX = _mm256_set1_pd(f_scaleX);
+	__m256d __f_laneOffsets = _mm256_setr_pd(0, 1, 2, 3);
+	__m256d __f_fracXHi = _mm256_set1_pd(f_fracTLX.hi);
+	__m256d __f_fracXLo = _mm256_set1_pd(f_fracTLX.lo);
+
+	__m256d __f_mask1;
+	__m256i __f_mask2;
+
+	__m256d __f_A;
+	__m256d __f_B;
+	__m256i __f_N;
+	__m256d __f_ZRHi;
+	__m256d __f_ZRLo;
+	__m256d __f_ZIHi;
+	__m256d __f_ZILo;
+	__m256d __f_ZR2Hi;
+	__m256d __f_ZR2Lo;
+	__m256d __f_ZI2Hi;
+	__m256d __f_ZI2Lo;
+	__m256d __f_ZRZIHi;
+	__m256d __f_ZRZILo;
+	__m256d __f_CRHi;
+	__m256d __f_CRLo;
+	__m256d __f_CIHi;
+	__m256d __f_CILo;
+
+	for (f_y = m_pixTL.y; f_y < m_pixBR.y; f_y++)
+	{
+		int *f_counts = countRow(f_offsetY);
+
+		DoubleDouble f_ci = f_fracTLY + DoubleDouble::twoProd(double(f_y - m_pixTL.y), f_scaleY);
+		__f_CIHi = _mm256_set1_pd(f_ci.hi);
+		__f_CILo = _mm256_set1_pd(f_ci.lo);
+
+		for (f_x = m_pixTL.x; f_x < m_pixBR.x; f_x += 4)
+		{
+			// The pixel offset is an exact product, added onto the corner in double-double
+			__f_A = _mm256_add_pd(_mm256_set1_pd(double(f_x - m_pixTL.x)), __f_laneOffsets);
+			__f_B = _mm256_mul_pd(__f_A, __f_scaleX);
+			ddAdd(__f_fracXHi, __f_fracXLo, __f_B, _mm256_fmsub_pd(__f_A, __f_scaleX, __f_B), __f_CRHi, __f_CRLo);
+
+			__f_ZRHi = _mm256_setzero_pd();
+			__f_ZRLo = _mm256_setzero_pd();
+			__f_ZIHi = _mm256_setzero_pd();
+			__f_ZILo = _mm256_setzero_pd();
+			__f_N = _mm256_setzero_si256();
+
+		repeat:
+			ddSqr(__f_ZRHi, __f_ZRLo, __f_ZR2Hi, __f_ZR2Lo);
+			ddSqr(__f_ZIHi, __f_ZILo, __f_ZI2Hi, __f_ZI2Lo);
+			ddMul(__f_ZRHi, __f_ZRLo, __f_ZIHi, __f_ZILo, __f_ZRZIHi, __f_ZRZILo);
+
+			// The escape test only needs the hi parts
+			__f_A = _mm256_add_pd(__f_ZR2Hi, __f_ZI2Hi);
+			__f_mask1 = _mm256_cmp_pd(__f_A, __f_four, _CMP_LT_OQ);
+
+			// zr = zr^2 - zi^2 + cr
+			ddAdd(__f_ZR2Hi, __f_ZR2Lo, _mm256_sub_pd(_mm256_setzero_pd(), __f_ZI2Hi), _mm256_sub_pd(_mm256_setzero_pd(), __f_ZI2Lo), __f_A, __f_B);
+			ddAdd(__f_A, __f_B, __f_CRHi, __f_CRLo, __f_ZRHi, __f_ZRLo);
+
+			// zi = 2 * zr * zi + ci (doubling is exact)
+			ddAdd(_mm256_add_pd(__f_ZRZIHi, __f_ZRZIHi), _mm256_add_pd(__f_ZRZILo, __f_ZRZILo), __f_CIHi, __f_CILo, __f_ZIHi, __f_ZILo);
+
+			__f_mask2 = _mm256_cmpgt_epi64(__f_iterations, __f_N);
+			__f_mask2 = _mm256_and_si256(__f_mask2, _mm256_castpd_si256(__f_mask1));
+			__f_N = _mm256_add_epi64(__f_N, _mm256_and_si256(__f_one, __f_mask2));
+
+			if (_mm256_movemask_pd(_mm256_castsi256_pd(__f_mask2)) > 0)
+			{
+				goto repeat;
+			}
+
+			_mm256_store_si256((__m256i *)f_n, __f_N);
+
+			// The last group of a section can run past its edge, and those lanes belong to the next one
+			int f_remaining = int(m_pixBR.x) - f_x;
+
+			for (int i = 0; i < 4 && i < f_remaining; i++)
+			{
+				f_counts[f_x + i] = int(f_n[i]);
+			}
+		}
+
+		finishRow(f_offsetY, f_counts);
+		f_offsetY += f_rowSize;
 	}
-}
\ No newline at end of file
+}
+
+/// <summary>
+/// Create fractal using 128-bit fixed-point integers. Slower than the floating-point kernels,
+/// but the iteration counts are bit-identical on every x86-64 host.
+/// AVX2 has no 64-bit multiply-high, so each pixel is iterated with scalar integer instructions.
+/// </summary>
+void WorkerThread::kernelFixed128()
+{
+	int f_width = int(m_pixBR.x - m_pixTL.x);
+	int f_height = int(m_pixBR.y - m_pixTL.y);
+
+	if (f_width <= 0 || f_height <= 0)
+	{
+		return;
+	}
+
+	// Each pixel is the view's top left plus a whole number of steps, with no floating-point rounding,
+	// so a pixel gets the same coordinate whichever frame, band or section it is computed in
+	Fixed128 f_scale = Fixed128::fromDouble(m_spacing);
+	Fixed128 f_fracTLX = Fixed128::fromDoubleDouble(m_viewTL.x, m_viewTLLow.x) + f_scale.multiply(uint32_t(m_origin.x + m_pixTL.x));
+	Fixed128 f_fracTLY = Fixed128::fromDoubleDouble(m_viewTL.y, m_viewTLLow.y) + f_scale.multiply(uint32_t(m_origin.y + m_pixTL.y));
+
+	int f_offsetY = 0;
+	int f_rowSize = m_screenWidth;
+
+	Fixed128 f_ci = f_fracTLY;
+
+	for (int f_y = int(m_pixTL.y); f_y < int(m_pixBR.y); f_y++)
+	{
+		int *f_counts = countRow(f_offsetY);
+
+		Fixed128 f_cr = f_fracTLX;
+
+		for (int f_x = int(m_pixTL.x); f_x < int(m_pixBR.x); f_x++)
+		{
+			Fixed128 f_zr;
+			Fixed128 f_zi;
+			int f_n = 0;
+
+			while (f_n < m_iterations)
+			{
+				Fixed128 f_zr2 = f_zr.sqr();
+				Fixed128 f_zi2 = f_zi.sqr();
+
+				if (!(f_zr2 + f_zi2).lessThan(4))
+				{
+					break;
+				}
+
+				f_zi = (f_zr * f_zi).twice() + f_ci;
+				f_zr = f_zr2 - f_zi2 + f_cr;
+				f_n++;
+			}
+
+			f_counts[f_x] = f_n;
+			f_cr = f_cr + f_scale;
+		}
+
+		f_ci = f_ci + f_scale;
+		finishRow(f_offsetY, f_counts);
+		f_offsetY += f_rowSize;
+	}
+}
+
+#pragma region antialiasing
+
+/// <summary>
+/// Supersamples the pixels of the section that sit on an edge and replaces their colour with the
+/// average of the samples. Edges are found from the variance of the brightness of the 3x3
+/// neighbourhood, taken from the palette colours of the counts, and from the distance channel
+/// when there is one, so flat areas cost nothing. Only the float and double kernels are sampled,
+/// the deeper kernels would need their own arithmetic for each sample.
+/// </summary>
+void WorkerThread::antialias()
+{
+	m_antialiased = 0;
+
+	if (m_kernel != Kernel::Float && m_kernel != Kernel::Double)
+	{
+		return;
+	}
+
+	int f_grid = std::min(std::max(m_antialiasSamples, 2), ANTIALIAS_MAX_GRID);
+	int f_samples = f_grid * f_grid;
+
+	// Rounded up to whole registers, the spare lanes start outside the bailout and stop at once
+	int f_padded = (f_samples + 3) & ~3;
+
+	double f_scaleX = (m_fracBR.x - m_fracTL.x) / (double(m_pixBR.x) - double(m_pixTL.x));
+	double f_scaleY = (m_fracBR.y - m_fracTL.y) / (double(m_pixBR.y) - double(m_pixTL.y));
+
+	alignas(32) double f_cr[ANTIALIAS_MAX_GRID * ANTIALIAS_MAX_GRID];
+	alignas(32) double f_ci[ANTIALIAS_MAX_GRID * ANTIALIAS_MAX_GRID];
+	int f_counts[ANTIALIAS_MAX_GRID * ANTIALIAS_MAX_GRID];
+	float f_fractions[ANTIALIAS_MAX_GRID * ANTIALIAS_MAX_GRID];
+	uint32_t f_colours[ANTIALIAS_MAX_GRID * ANTIALIAS_MAX_GRID];
+
+	std::fill(f_cr, f_cr + f_padded, 1.0e3);
+	std::fill(f_ci, f_ci + f_padded, 0.0);
+
+	for (int f_y = int(m_pixTL.y); f_y < int(m_pixBR.y); f_y++)
+	{
+		for (int f_x = int(m_pixTL.x); f_x < int(m_pixBR.x); f_x++)
+		{
+			if (!isEdge(f_x, f_y))
+			{
+				continue;
+			}
+
+			// Samples on a regular grid centred in the pixel
+			double f_posX = m_fracTL.x + (double(f_x) - double(m_pixTL.x)) * f_scaleX;
+			double f_posY = m_fracTL.y + (double(f_y) - double(m_pixTL.y)) * f_scaleY;
+
+			for (int j = 0; j < f_grid; j++)
+			{
+				for (int i = 0; i < f_grid; i++)
+				{
+					f_cr[j * f_grid + i] = f_posX + ((i + 0.5) / f_grid - 0.5) * f_scaleX;
+					f_ci[j * f_grid + i] = f_posY + ((j + 0.5) / f_grid - 0.5) * f_scaleY;
+				}
+			}
+
+			switch (m_exponent)
+			{
+			case 3:
+				sampleDouble<3>(f_cr, f_ci, f_counts, f_fractions, f_padded);
+				break;
+			case 4:
+				sampleDouble<4>(f_cr, f_ci, f_counts, f_fractions, f_padded);
+				break;
+			case 5:
+				sampleDouble<5>(f_cr, f_ci, f_counts, f_fractions, f_padded);
+				break;
+			default:
+				sampleDouble<2>(f_cr, f_ci, f_counts, f_fractions, f_padded);
+				break;
+			}
+
+			if (m_smoothFormat == SmoothFormat::None)
+			{
+				m_palette->apply(f_counts, f_colours, f_samples);
+			}
+			else
+			{
+				m_palette->applySmooth(f_counts, f_fractions, f_colours, f_samples);
+			}
+
+			uint32_t f_r = 0;
+			uint32_t f_g = 0;
+			uint32_t f_b = 0;
+
+			for (int i = 0; i < f_samples; i++)
+			{
+				f_r += f_colours[i] & 0xFF;
+				f_g += (f_colours[i] >> 8) & 0xFF;
+				f_b += (f_colours[i] >> 16) & 0xFF;
+			}
+
+			int f_offset = f_y * m_screenWidth + f_x;
+			m_pixels[f_offset] = Palette::pack(uint8_t(f_r / f_samples), uint8_t(f_g / f_samples), uint8_t(f_b / f_samples));
+
+			if (m_distance != nullptr)
+			{
+				Palette::shadeBoundary(&m_distance[f_offset], &m_pixels[f_offset], 1);
+			}
+
+			m_antialiased++;
+		}
+	}
+}
+
+/// <summary>
+/// Whether a pixel needs supersampling. Neighbours are read from the shared count buffer,
+/// so edges between sections are found the same as anywhere else.
+/// </summary>
+/// <param name="t_x">The pixel column.</param>
+/// <param name="t_y">The pixel row.</param>
+/// <returns>True when the neighbourhood varies by more than the threshold.</returns>
+bool WorkerThread::isEdge(int t_x, int t_y) const
+{
+	if (m_distance != nullptr)
+	{
+		float f_distance = m_distance[t_y * m_screenWidth + t_x];
+
+		if (f_distance > 0.0f && f_distance < 1.0f)
+		{
+			return true;
+		}
+	}
+
+	float f_sum = 0.0f;
+	float f_sumSquares = 0.0f;
+
+	for (int j = -1; j <= 1; j++)
+	{
+		int f_y = std::min(std::max(t_y + j, int(m_pixTL.y)), int(m_pixBR.y) - 1);
+
+		for (int i = -1; i <= 1; i++)
+		{
+			int f_x = std::min(std::max(t_x + i, 0), m_screenWidth - 1);
+			uint32_t f_colour = m_palette->colour(m_fractal[f_y * m_screenWidth + f_x]);
+
+			// Rec. 601 luma
+			float f_luma = 0.299f * float(f_colour & 0xFF) + 0.587f * float((f_colour >> 8) & 0xFF) + 0.114f * float((f_colour >> 16) & 0xFF);
+			f_sum += f_luma;
+			f_sumSquares += f_luma * f_luma;
+		}
+	}
+
+	float f_mean = f_sum / 9.0f;
+	return f_sumSquares / 9.0f - f_mean * f_mean > m_antialiasThreshold;
+}
+
+/// <summary>
+/// Iterates a batch of Mandelbrot or Julia points of z^t_exponent + c with double precision,
+/// four at a time. The bailout and the smooth fraction match the double kernel so samples
+/// agree with the pixels around them.
+/// </summary>
+/// <param name="t_cr">The real parts, aligned to 32 bytes.</param>
+/// <param name="t_ci">The imaginary parts, aligned to 32 bytes.</param>
+/// <param name="t_counts">The iteration counts.</param>
+/// <param name="t_fractions">The smooth fractions, 0 when there is no smooth channel.</param>
+/// <param name="t_count">The number of points, a multiple of four.</param>
+template <int t_exponent>
+void WorkerThread::sampleDouble(const double *t_cr, const double *t_ci, int *t_counts, float *t_fractions, int t_count) const
+{
+	bool f_smooth = m_smoothFormat != SmoothFormat::None;
+	double f_bailout = f_smooth || m_distance != nullptr ? Globals::SMOOTH_BAILOUT * Globals::SMOOTH_BAILOUT : 4.0;
+
+	__m256d __f_bailout = _mm256_set1_pd(f_bailout);
+	__m256d __f_juliaR = _mm256_set1_pd(m_juliaC.x);
+	__m256d __f_juliaI = _mm256_set1_pd(m_juliaC.y);
+	__m256i __f_one = _mm256_set1_epi64x(1);
+	__m256i __f_iterations = _mm256_set1_epi64x(m_iterations);
+
+	alignas(32) int64_t f_n[4];
+	alignas(32) double f_norm[4];
+
+	for (int i = 0; i < t_count; i += 4)
+	{
+		__m256d __f_CR = _mm256_load_pd(&t_cr[i]);
+		__m256d __f_CI = _mm256_load_pd(&t_ci[i]);
+		__m256d __f_ZR = _mm256_setzero_pd();
+		__m256d __f_ZI = _mm256_setzero_pd();
+
+		// For Julia the sample point is the start of the orbit
+		if (m_julia)
+		{
+			__f_ZR = __f_CR;
+			__f_ZI = __f_CI;
+			__f_CR = __f_juliaR;
+			__f_CI = __f_juliaI;
+		}
+		__m256d __f_norm = _mm256_setzero_pd();
+		__m256d __f_active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+		__m256i __f_N = _mm256_setzero_si256();
+		__m256i __f_mask;
+
+		do
+		{
+			__m256d __f_PR;
+			__m256d __f_PI;
+			ComplexPower<SimdDouble4, t_exponent>::apply(__f_ZR, __f_ZI, __f_PR, __f_PI);
+
+			__m256d __f_zNorm = _mm256_fmadd_pd(__f_ZR, __f_ZR, _mm256_mul_pd(__f_ZI, __f_ZI));
+			__f_ZR = _mm256_add_pd(__f_PR, __f_CR);
+			__f_ZI = _mm256_add_pd(__f_PI, __f_CI);
+			__f_mask = _mm256_castpd_si256(_mm256_cmp_pd(__f_zNorm, __f_bailout, _CMP_LT_OQ));
+			__f_mask = _mm256_and_si256(__f_mask, _mm256_cmpgt_epi64(__f_iterations, __f_N));
+			__f_N = _mm256_add_epi64(__f_N, _mm256_and_si256(__f_one, __f_mask));
+
+			__f_norm = _mm256_blendv_pd(__f_norm, __f_zNorm, __f_active);
+			__f_active = _mm256_castsi256_pd(__f_mask);
+		} while (_mm256_movemask_pd(__f_active) != 0);
+
+		_mm256_store_si256((__m256i *)f_n, __f_N);
+		_mm256_store_pd(f_norm, __f_norm);
+
+		for (int j = 0; j < 4; j++)
+		{
+			t_counts[i + j] = int(f_n[j]);
+			t_fractions[i + j] = f_smooth && f_n[j] < m_iterations ? smoothFraction(float(f_norm[j]), t_exponent) : 0.0f;
+		}
+	}
+}
+
+#pragma endregion
+
+// The registry takes the address of each hand-written kernel
+template void WorkerThread::kernelFloat<false>();
+template void WorkerThread::kernelFloat<true>();
+template void WorkerThread::kernelDouble<false, false>();
+template void WorkerThread::kernelDouble<true, false>();
+template void WorkerThread::kernelDouble<false, true>();
+template void WorkerThread::kernelDouble<true, true>();